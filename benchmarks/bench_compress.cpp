@@ -0,0 +1,153 @@
+/**
+ * Block encoding + compression benchmark
+ *
+ * Measures, on a synthetic lock-heavy trace:
+ * 1. Block encode (delta-of-delta/varint) throughput
+ * 2. LZ block compression and decompression throughput
+ * 3. Peak rate at which producer threads can emit events into the queue
+ *
+ * The drain thread must encode + compress faster than (3) to keep up.
+ *
+ * Usage: bench_compress [events] [producer_threads]
+ */
+
+#include <ucdbg/ucdbg.hpp>
+#include <ucdbg/block_format.hpp>
+#include <ucdbg/lz_compress.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Per-thread event streams: acquire/release pairs over a small set of locks
+static std::vector<std::vector<ucdbg::TraceEvent>> make_trace(size_t events, size_t threads) {
+    std::vector<std::vector<ucdbg::TraceEvent>> per_thread(threads);
+    std::mt19937_64 rng(42);
+    for (size_t t = 0; t < threads; ++t) {
+        uint64_t ts = 1'700'000'000'000'000'000ull + t * 1000;
+        auto& list = per_thread[t];
+        list.reserve(events / threads + 1);
+        while (list.size() < events / threads) {
+            uint64_t lock = 0x7f3a00001000ull + 64 * (rng() % 16);
+            for (auto type : {ucdbg::EventType::LockAcquire, ucdbg::EventType::LockRelease}) {
+                ts += 40 + rng() % 400;
+                ucdbg::TraceEvent e;
+                std::memset(&e, 0, sizeof(e));
+                e.timestamp_ns = ts;
+                e.thread_id = 4000 + t;
+                e.format_version = ucdbg::TRACE_FORMAT_VERSION;
+                e.kind = ucdbg::EventKind::Concurrency;
+                e.concurrency.type = type;
+                e.concurrency.lock_id = lock;
+                list.push_back(e);
+            }
+        }
+    }
+    return per_thread;
+}
+
+static double measure_emit_rate(size_t threads, size_t events_per_thread) {
+    using namespace ucdbg::internal;
+    tracing_active.store(true);
+    std::atomic<bool> done{false};
+    std::thread consumer([&] {
+        std::vector<ucdbg::TraceEvent> batch(1024);
+        while (!done.load() || event_queue().size_approx() > 0) {
+            event_queue().try_dequeue_bulk(batch.data(), batch.size());
+        }
+    });
+    auto start = Clock::now();
+    std::vector<std::thread> producers;
+    for (size_t t = 0; t < threads; ++t) {
+        producers.emplace_back([events_per_thread] {
+            for (size_t i = 0; i < events_per_thread; ++i) {
+                emit(make_concurrency_event(ucdbg::EventType::LockAcquire, i & 0xFF));
+            }
+        });
+    }
+    for (auto& p : producers) p.join();
+    double elapsed = seconds_since(start);
+    done.store(true);
+    consumer.join();
+    tracing_active.store(false);
+    return static_cast<double>(threads * events_per_thread) / elapsed;
+}
+
+int main(int argc, char** argv) {
+    size_t events = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20'000'000;
+    size_t threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10)
+                              : std::max(1u, std::thread::hardware_concurrency());
+    const size_t block_events = 4096;
+
+    std::cout << "=== Block Compression Benchmark ===" << std::endl;
+    std::cout << events << " events, " << threads << " threads" << std::endl;
+
+    auto trace = make_trace(events, threads);
+    size_t total_events = 0;
+    for (const auto& list : trace) total_events += list.size();
+    double raw_bytes = static_cast<double>(total_events * sizeof(ucdbg::TraceEvent));
+
+    // 1. Encode into blocks
+    std::vector<std::vector<uint8_t>> blocks;
+    ucdbg::internal::BlockEncoder encoder;
+    auto start = Clock::now();
+    for (const auto& list : trace) {
+        for (size_t i = 0; i < list.size(); i += block_events) {
+            encoder.reset(list[i].thread_id);
+            for (size_t j = i; j < list.size() && j < i + block_events; ++j) encoder.append(list[j]);
+            blocks.emplace_back(encoder.payload(), encoder.payload() + encoder.payload_size());
+        }
+    }
+    double encode_s = seconds_since(start);
+    size_t encoded_bytes = 0;
+    for (const auto& b : blocks) encoded_bytes += b.size();
+
+    // 2. Compress every block
+    std::vector<std::vector<uint8_t>> compressed(blocks.size());
+    start = Clock::now();
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        compressed[i].resize(ucdbg::internal::lz_compress_bound(blocks[i].size()));
+        compressed[i].resize(ucdbg::internal::lz_compress(blocks[i].data(), blocks[i].size(), compressed[i].data()));
+    }
+    double compress_s = seconds_since(start);
+    size_t compressed_bytes = 0;
+    for (const auto& b : compressed) compressed_bytes += b.size();
+
+    // 3. Decompress and verify
+    start = Clock::now();
+    bool ok = true;
+    std::vector<uint8_t> out;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        out.resize(blocks[i].size());
+        ok &= ucdbg::internal::lz_decompress(compressed[i].data(), compressed[i].size(), out.data(), out.size());
+        ok &= out == blocks[i];
+    }
+    double decompress_s = seconds_since(start);
+
+    double emit_rate = measure_emit_rate(threads, 2'000'000);
+    double drain_rate = total_events / (encode_s + compress_s);
+
+    std::cout.setf(std::ios::fixed);
+    std::cout.precision(1);
+    std::cout << "Raw:        " << raw_bytes / 1e6 << " MB" << std::endl;
+    std::cout << "Encoded:    " << encoded_bytes / 1e6 << " MB (" << raw_bytes / encoded_bytes << "x)" << std::endl;
+    std::cout << "Compressed: " << compressed_bytes / 1e6 << " MB (" << raw_bytes / compressed_bytes << "x)" << std::endl;
+    std::cout << "Encode:     " << total_events / encode_s / 1e6 << " Mevents/s" << std::endl;
+    std::cout << "Compress:   " << encoded_bytes / compress_s / 1e6 << " MB/s, "
+              << total_events / compress_s / 1e6 << " Mevents/s" << std::endl;
+    std::cout << "Decompress: " << encoded_bytes / decompress_s / 1e6 << " MB/s" << std::endl;
+    std::cout << "Drain (encode+compress): " << drain_rate / 1e6 << " Mevents/s" << std::endl;
+    std::cout << "Peak emit (" << threads << " producers): " << emit_rate / 1e6 << " Mevents/s" << std::endl;
+    std::cout << "Headroom:   " << drain_rate / emit_rate << "x" << std::endl;
+    std::cout << (ok ? "Round trip OK" : "Round trip FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
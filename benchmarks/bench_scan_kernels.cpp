@@ -0,0 +1,153 @@
+/**
+ * Scan kernel benchmark: AVX2 vs scalar
+ *
+ * Runs "events of lock X in time window T" selection and per-type counting
+ * over an array-of-structs TraceEvent array, then over the equivalent
+ * columnar arrays. Phases run one after another so peak memory is the AoS
+ * array (events x 32 bytes).
+ *
+ * Usage: bench_scan_kernels [events]   (default 100M, ~3.2 GB)
+ */
+
+#include <ucdbg/scan_kernels.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+template <class F>
+static double best_of(int runs, F&& f) {
+    double best = 1e30;
+    for (int r = 0; r < runs; ++r) {
+        auto start = Clock::now();
+        f();
+        best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    return best;
+}
+
+static void report(const char* name, size_t events, size_t bytes_per_event, double scalar_s, double avx2_s) {
+    std::cout << "  " << name << ": scalar " << events / scalar_s / 1e6 << " Mevents/s ("
+              << events * bytes_per_event / scalar_s / 1e9 << " GB/s), avx2 "
+              << events / avx2_s / 1e6 << " Mevents/s (" << events * bytes_per_event / avx2_s / 1e9
+              << " GB/s), speedup " << scalar_s / avx2_s << "x" << std::endl;
+}
+
+// Same pseudo-random stream for both layouts
+struct Generator {
+    std::mt19937_64 rng{99};
+    uint64_t ts = 1'700'000'000'000'000'000ull;
+
+    void next(uint64_t& timestamp, uint64_t& lock, uint8_t& kind, uint8_t& type) {
+        uint64_t r = rng();
+        ts += r % 200;
+        timestamp = ts;
+        lock = 0x7f0000000000ull + 64 * ((r >> 8) % 64);
+        kind = (r >> 20) % 16 ? 0 : 1;
+        type = static_cast<uint8_t>((r >> 24) % ucdbg::EVENT_TYPE_COUNT);
+    }
+};
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100'000'000;
+    const int runs = 3;
+    std::cout.setf(std::ios::fixed);
+    std::cout.precision(1);
+    std::cout << "=== Scan Kernel Benchmark ===" << std::endl;
+    std::cout << count << " events, AVX2 " << (ucdbg::internal::cpu_has_avx2() ? "available" : "NOT available")
+              << std::endl;
+    if (!ucdbg::internal::cpu_has_avx2()) {
+        return 0;
+    }
+
+    std::vector<uint64_t> bitmap(ucdbg::bitmap_words(count));
+    uint64_t lock_id = 0x7f0000000000ull + 64 * 5;
+    uint64_t begin = 0, end = 0;
+    size_t expected = 0;
+    uint64_t expected_counts[256] = {};
+    bool ok = true;
+
+    // Array of structs
+    {
+        std::vector<ucdbg::TraceEvent> events(count);
+        Generator gen;
+        for (auto& e : events) {
+            std::memset(&e, 0, sizeof(e));
+            uint8_t kind, type;
+            gen.next(e.timestamp_ns, e.concurrency.lock_id, kind, type);
+            e.thread_id = 1;
+            e.format_version = ucdbg::TRACE_FORMAT_VERSION;
+            e.kind = static_cast<ucdbg::EventKind>(kind);
+            e.concurrency.type = static_cast<ucdbg::EventType>(type);
+        }
+        begin = events[count / 3].timestamp_ns;
+        end = events[2 * count / 3].timestamp_ns;
+
+        std::cout << "Array of structs (32 bytes/event):" << std::endl;
+        size_t got = 0;
+        double scalar_s = best_of(runs, [&] {
+            expected = ucdbg::internal::select_lock_window_scalar(events.data(), count, lock_id, begin, end, bitmap.data());
+        });
+        double avx2_s = best_of(runs, [&] {
+            got = ucdbg::internal::select_lock_window_avx2(events.data(), count, lock_id, begin, end, bitmap.data());
+        });
+        ok &= got == expected;
+        report("select_lock_window", count, 32, scalar_s, avx2_s);
+
+        uint64_t counts[256];
+        scalar_s = best_of(runs, [&] {
+            std::memset(expected_counts, 0, sizeof(expected_counts));
+            ucdbg::internal::count_by_type_scalar(events.data(), count, expected_counts);
+        });
+        avx2_s = best_of(runs, [&] {
+            std::memset(counts, 0, sizeof(counts));
+            ucdbg::internal::count_by_type_avx2(events.data(), count, counts);
+        });
+        ok &= std::memcmp(counts, expected_counts, sizeof(counts)) == 0;
+        report("count_by_type     ", count, 32, scalar_s, avx2_s);
+    }
+
+    // Columnar
+    {
+        std::vector<uint64_t> timestamps(count), locks(count);
+        std::vector<uint8_t> versions(count, ucdbg::TRACE_FORMAT_VERSION), kinds(count), types(count);
+        Generator gen;
+        for (size_t i = 0; i < count; ++i) {
+            gen.next(timestamps[i], locks[i], kinds[i], types[i]);
+        }
+
+        std::cout << "Columnar (ts+lock+version+kind = 18 bytes/event, version+kind+type = 3 bytes/event):" << std::endl;
+        size_t got = 0;
+        double scalar_s = best_of(runs, [&] {
+            got = ucdbg::internal::select_lock_window_scalar(timestamps.data(), locks.data(), versions.data(),
+                                                             kinds.data(), count, lock_id, begin, end, bitmap.data());
+        });
+        ok &= got == expected;
+        double avx2_s = best_of(runs, [&] {
+            got = ucdbg::internal::select_lock_window_avx2(timestamps.data(), locks.data(), versions.data(),
+                                                           kinds.data(), count, lock_id, begin, end, bitmap.data());
+        });
+        ok &= got == expected;
+        report("select_lock_window", count, 18, scalar_s, avx2_s);
+
+        uint64_t counts[256];
+        scalar_s = best_of(runs, [&] {
+            std::memset(counts, 0, sizeof(counts));
+            ucdbg::internal::count_by_type_scalar(versions.data(), kinds.data(), types.data(), count, counts);
+        });
+        ok &= std::memcmp(counts, expected_counts, sizeof(counts)) == 0;
+        avx2_s = best_of(runs, [&] {
+            std::memset(counts, 0, sizeof(counts));
+            ucdbg::internal::count_by_type_avx2(versions.data(), kinds.data(), types.data(), count, counts);
+        });
+        ok &= std::memcmp(counts, expected_counts, sizeof(counts)) == 0;
+        report("count_by_type     ", count, 3, scalar_s, avx2_s);
+    }
+
+    std::cout << "Selected " << expected << " events; results " << (ok ? "match" : "DIFFER") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <ucdbg/trace_types.hpp>
+#include <ucdbg/varint.hpp>
+
+namespace ucdbg {
+
+/**
+ * Block-based streaming trace format.
+ *
+ * File layout (little-endian):
+ *   BlockFileHeader                      16 bytes
+ *   Block*                               one thread's events per block
+ *     BlockHeader                        8 bytes (magic, payload size)
+ *     payload                            varint-encoded events, optionally
+ *                                        compressed (BlockFooter::codec)
+ *     BlockFooter                        40 bytes (time range, count, thread)
+ *   Thread name table                    names_count x (thread_id, u16 len, bytes)
+ *   String table                         strings_count x (u16 len, bytes), in
+ *                                        string_id_t order (span/counter names)
+ *   Block index                          block_count x BlockIndexEntry
+ *   BlockFileTrailer                     40 bytes, always last
+ *
+ * The trailer locates the index, so a reader can seek to any time window
+ * without touching the blocks in between. A file that was never closed has
+ * no trailer; its blocks can still be recovered by a forward scan using the
+ * block headers.
+ *
+ * Sidecar index (optional, "<trace>.idx"), for traces that are never closed:
+ *   BlockFileHeader                      16 bytes, BLOCK_SIDECAR_MAGIC
+ *   BlockIndexEntry*                     appended as each block is written
+ * The writer deletes it once the trailer is written. A reader opening a
+ * trace without a trailer takes the index from the sidecar and scans only
+ * the blocks written after its last entry, instead of the whole file.
+ *
+ * Event encoding inside a block payload (all fields operate on the 32-byte
+ * serialized TraceEvent image, so every kind round-trips losslessly):
+ *   u8      tag      bits 0-3 kind (15 = escape, explicit kind byte follows)
+ *                    bit 4 ARG, bit 5 HDR, bit 6 VERSION, bit 7 SAME_VALUE
+ *   varint  zigzag(delta-of-delta of timestamp_ns)
+ *   [u8]    kind                       if kind nibble is 15
+ *   u8      payload byte 20            (EventType / LogLevel)
+ *   [varint payload bytes 21-23]       if ARG
+ *   [varint header reserved bytes]     if HDR
+ *   [u8     format_version]            if VERSION (differs from block)
+ *   [varint zigzag(value - prev)]      unless SAME_VALUE; value = bytes 24-31
+ */
+
+constexpr char BLOCK_FILE_MAGIC[8] = {'U', 'C', 'D', 'B', 'G', 'B', 'L', 'K'};
+constexpr char BLOCK_TRAILER_MAGIC[8] = {'U', 'C', 'D', 'B', 'G', 'I', 'D', 'X'};
+constexpr char BLOCK_SIDECAR_MAGIC[8] = {'U', 'C', 'D', 'B', 'G', 'S', 'I', 'X'};
+constexpr const char* BLOCK_SIDECAR_SUFFIX = ".idx";
+constexpr uint32_t BLOCK_MAGIC = 0x4B424355;  // "UCBK"
+constexpr uint16_t BLOCK_FILE_VERSION = 1;
+
+// Compression applied to a block payload (explicit uint8_t for binary format)
+enum class BlockCodec : uint8_t {
+    None = 0,
+    LZ = 1      // internal::lz_compress (lz_compress.hpp)
+};
+
+#pragma pack(push, 1)
+struct BlockFileHeader {
+    char magic[8];
+    uint16_t version;
+    uint16_t flags;
+    uint32_t reserved;
+};
+
+struct BlockHeader {
+    uint32_t magic;
+    uint32_t payload_size;
+};
+
+struct BlockFooter {
+    timestamp_t first_ts;           // Timestamp of first event in block
+    timestamp_t last_ts;            // Timestamp of last event in block
+    thread_id_t thread_id;          // Thread that produced every event
+    uint32_t event_count;
+    uint32_t payload_size;          // Bytes between header and footer
+    uint8_t event_version;          // format_version of the first event
+    uint8_t codec;                  // BlockCodec applied to the payload
+    uint8_t reserved[2];
+    uint32_t raw_size;              // Payload size before compression
+};
+
+struct BlockIndexEntry {
+    uint64_t offset;                // File offset of the BlockHeader
+    timestamp_t first_ts;
+    timestamp_t last_ts;
+    thread_id_t thread_id;
+    uint32_t event_count;
+    uint32_t reserved;
+};
+
+struct BlockFileTrailer {
+    uint64_t index_offset;
+    uint64_t block_count;
+    uint64_t names_offset;
+    uint32_t names_count;
+    uint32_t strings_count;         // String table follows the thread name table (0 in older files)
+    char magic[8];
+};
+#pragma pack(pop)
+
+static_assert(sizeof(BlockFileHeader) == 16, "BlockFileHeader must be 16 bytes");
+static_assert(sizeof(BlockHeader) == 8, "BlockHeader must be 8 bytes");
+static_assert(sizeof(BlockFooter) == 40, "BlockFooter must be 40 bytes");
+static_assert(sizeof(BlockIndexEntry) == 40, "BlockIndexEntry must be 40 bytes");
+static_assert(sizeof(BlockFileTrailer) == 40, "BlockFileTrailer must be 40 bytes");
+
+namespace internal {
+
+// Tag byte layout
+constexpr uint8_t TAG_KIND_MASK = 0x0F;
+constexpr uint8_t TAG_KIND_ESCAPE = 0x0F;
+constexpr uint8_t TAG_ARG = 0x10;
+constexpr uint8_t TAG_HDR = 0x20;
+constexpr uint8_t TAG_VERSION = 0x40;
+constexpr uint8_t TAG_SAME_VALUE = 0x80;
+
+// Worst case encoded size of one event
+constexpr size_t MAX_ENCODED_EVENT_BYTES = 4 + 4 * MAX_VARINT_BYTES;
+
+/**
+ * Accumulates one thread's events into a block payload.
+ * Usage: enc.reset(tid); enc.append(e)...; write(enc.payload(), enc.footer());
+ */
+class BlockEncoder {
+public:
+    void reset(thread_id_t thread_id) {
+        size_ = 0;
+        footer_ = BlockFooter{};
+        footer_.thread_id = thread_id;
+        prev_ts_ = 0;
+        prev_delta_ = 0;
+        prev_value_ = 0;
+    }
+
+    void append(const TraceEvent& event) {
+        uint8_t raw[sizeof(TraceEvent)];
+        event.serialize_to(raw);
+
+        if (footer_.event_count == 0) {
+            footer_.first_ts = event.timestamp_ns;
+            footer_.event_version = event.format_version;
+            prev_ts_ = event.timestamp_ns;
+        }
+
+        uint32_t arg = raw[21] | (raw[22] << 8) | (raw[23] << 16);
+        uint16_t hdr = static_cast<uint16_t>(raw[18] | (raw[19] << 8));
+        uint64_t value;
+        std::memcpy(&value, raw + 24, sizeof(value));
+        uint8_t kind = raw[17];
+
+        int64_t delta = static_cast<int64_t>(event.timestamp_ns - prev_ts_);
+        int64_t dod = delta - prev_delta_;
+
+        uint8_t tag = kind < TAG_KIND_ESCAPE ? kind : TAG_KIND_ESCAPE;
+        if (arg) tag |= TAG_ARG;
+        if (hdr) tag |= TAG_HDR;
+        if (event.format_version != footer_.event_version) tag |= TAG_VERSION;
+        if (value == prev_value_) tag |= TAG_SAME_VALUE;
+
+        if (payload_.size() < size_ + MAX_ENCODED_EVENT_BYTES) {
+            payload_.resize(2 * payload_.size() + MAX_ENCODED_EVENT_BYTES);
+        }
+        uint8_t* out = payload_.data() + size_;
+        *out++ = tag;
+        out = write_varint(out, zigzag_encode(dod));
+        if ((tag & TAG_KIND_MASK) == TAG_KIND_ESCAPE) *out++ = kind;
+        *out++ = raw[20];
+        if (tag & TAG_ARG) out = write_varint(out, arg);
+        if (tag & TAG_HDR) out = write_varint(out, hdr);
+        if (tag & TAG_VERSION) *out++ = event.format_version;
+        if (!(tag & TAG_SAME_VALUE)) {
+            out = write_varint(out, zigzag_encode(static_cast<int64_t>(value - prev_value_)));
+        }
+        size_ = static_cast<size_t>(out - payload_.data());
+
+        prev_delta_ = delta;
+        prev_ts_ = event.timestamp_ns;
+        prev_value_ = value;
+        footer_.last_ts = event.timestamp_ns;
+        footer_.event_count++;
+    }
+
+    uint32_t event_count() const { return footer_.event_count; }
+    size_t payload_size() const { return size_; }
+    const uint8_t* payload() const { return payload_.data(); }
+
+    BlockFooter footer() const {
+        BlockFooter footer = footer_;
+        footer.payload_size = static_cast<uint32_t>(size_);
+        footer.raw_size = footer.payload_size;
+        return footer;
+    }
+
+private:
+    std::vector<uint8_t> payload_;  // Grown geometrically, never shrunk
+    size_t size_ = 0;
+    BlockFooter footer_{};
+    timestamp_t prev_ts_ = 0;
+    int64_t prev_delta_ = 0;
+    uint64_t prev_value_ = 0;
+};
+
+/**
+ * Decodes a block payload, invoking on_event(const TraceEvent&) per event.
+ * Returns false if the payload is truncated or does not match the footer.
+ */
+template <class F>
+bool decode_block(const uint8_t* payload, size_t size, const BlockFooter& footer, F&& on_event) {
+    const uint8_t* in = payload;
+    const uint8_t* end = payload + size;
+    timestamp_t prev_ts = footer.first_ts;
+    int64_t prev_delta = 0;
+    uint64_t prev_value = 0;
+
+    for (uint32_t i = 0; i < footer.event_count; ++i) {
+        uint64_t v;
+        if (end - in < 1) return false;
+        uint8_t tag = *in++;
+
+        if (!(in = read_varint(in, end, v))) return false;
+        int64_t delta = prev_delta + zigzag_decode(v);
+        timestamp_t ts = prev_ts + static_cast<uint64_t>(delta);
+
+        uint8_t raw[sizeof(TraceEvent)] = {};
+        std::memcpy(raw, &ts, sizeof(ts));
+        std::memcpy(raw + 8, &footer.thread_id, sizeof(footer.thread_id));
+        raw[16] = footer.event_version;
+        raw[17] = tag & TAG_KIND_MASK;
+        if (raw[17] == TAG_KIND_ESCAPE) {
+            if (end - in < 1) return false;
+            raw[17] = *in++;
+        }
+        if (end - in < 1) return false;
+        raw[20] = *in++;
+        if (tag & TAG_ARG) {
+            if (!(in = read_varint(in, end, v))) return false;
+            raw[21] = static_cast<uint8_t>(v);
+            raw[22] = static_cast<uint8_t>(v >> 8);
+            raw[23] = static_cast<uint8_t>(v >> 16);
+        }
+        if (tag & TAG_HDR) {
+            if (!(in = read_varint(in, end, v))) return false;
+            raw[18] = static_cast<uint8_t>(v);
+            raw[19] = static_cast<uint8_t>(v >> 8);
+        }
+        if (tag & TAG_VERSION) {
+            if (end - in < 1) return false;
+            raw[16] = *in++;
+        }
+        uint64_t value = prev_value;
+        if (!(tag & TAG_SAME_VALUE)) {
+            if (!(in = read_varint(in, end, v))) return false;
+            value = prev_value + static_cast<uint64_t>(zigzag_decode(v));
+        }
+        std::memcpy(raw + 24, &value, sizeof(value));
+
+        TraceEvent event;
+        event.deserialize_from(raw);
+        on_event(static_cast<const TraceEvent&>(event));
+
+        prev_ts = ts;
+        prev_delta = delta;
+        prev_value = value;
+    }
+    return in == end;
+}
+
+} // namespace internal
+} // namespace ucdbg
@@ -0,0 +1,490 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <ucdbg/block_format.hpp>
+#include <ucdbg/lz_compress.hpp>
+
+namespace ucdbg {
+
+/**
+ * Random-access reader for the block trace format (see block_format.hpp).
+ *
+ * open() loads only the header, trailer, block index, thread name and
+ * string tables;
+ * blocks are read on demand with pread, so concurrent read_block() calls on
+ * one reader are safe. Files without a trailer (tracer never shut down) are
+ * indexed from the sidecar index if the writer kept one, and by a forward
+ * scan over the block headers past its last entry (or from the start).
+ */
+class BlockTraceReader {
+public:
+    BlockTraceReader() = default;
+
+    ~BlockTraceReader() {
+        close();
+    }
+
+    BlockTraceReader(const BlockTraceReader&) = delete;
+    BlockTraceReader& operator=(const BlockTraceReader&) = delete;
+
+    bool open(const char* path) {
+        close();
+        fd_ = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0) {
+            return false;
+        }
+        struct stat st;
+        if (::fstat(fd_, &st) != 0) {
+            close();
+            return false;
+        }
+        file_size_ = static_cast<uint64_t>(st.st_size);
+
+        BlockFileHeader header;
+        if (!read_at(0, &header, sizeof(header)) ||
+            std::memcmp(header.magic, BLOCK_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version > BLOCK_FILE_VERSION) {
+            close();
+            return false;
+        }
+
+        if (!load_index()) {
+            recovered_ = true;
+            if (!load_sidecar((std::string(path) + BLOCK_SIDECAR_SUFFIX).c_str())) {
+                index_.clear();
+                scanned_blocks_ = 0;
+                scan_blocks(sizeof(BlockFileHeader));
+            }
+        }
+        build_thread_lookup();
+        return true;
+    }
+
+    void close() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+        fd_ = -1;
+        file_size_ = 0;
+        recovered_ = false;
+        scanned_blocks_ = 0;
+        index_.clear();
+        thread_names_.clear();
+        strings_.clear();
+        by_thread_.clear();
+    }
+
+    bool is_open() const {
+        return fd_ >= 0;
+    }
+
+    // True when the trailer was missing (trace never closed)
+    bool recovered() const {
+        return recovered_;
+    }
+
+    // Blocks located by scanning the file rather than from the trailer or sidecar index
+    size_t scanned_blocks() const {
+        return scanned_blocks_;
+    }
+
+    const std::vector<BlockIndexEntry>& blocks() const {
+        return index_;
+    }
+
+    const std::unordered_map<thread_id_t, std::string>& thread_names() const {
+        return thread_names_;
+    }
+
+    // Span/counter/log names, indexed by string_id_t
+    const std::vector<std::string>& strings() const {
+        return strings_;
+    }
+
+    // Name for id, or an empty string if it is not in the table
+    const std::string& string(string_id_t id) const {
+        static const std::string empty;
+        return id < strings_.size() ? strings_[id] : empty;
+    }
+
+    uint64_t event_count() const {
+        uint64_t total = 0;
+        for (const auto& entry : index_) {
+            total += entry.event_count;
+        }
+        return total;
+    }
+
+    /**
+     * Indices of blocks overlapping [begin, end], ordered by thread then time.
+     * Costs O(threads * log(blocks per thread)) plus the size of the result.
+     */
+    std::vector<size_t> blocks_in_window(timestamp_t begin, timestamp_t end) const {
+        std::vector<size_t> result;
+        for (const auto& [thread_id, lookup] : by_thread_) {
+            auto [first, last] = window_range(lookup, begin, end);
+            for (size_t i = first; i < last; ++i) {
+                if (index_[lookup.blocks[i]].last_ts >= begin) {
+                    result.push_back(lookup.blocks[i]);
+                }
+            }
+        }
+        return result;
+    }
+
+    // Blocks of one thread overlapping [begin, end] in time order; O(log(blocks of the thread))
+    std::vector<size_t> blocks_in_window(timestamp_t begin, timestamp_t end, thread_id_t thread_id) const {
+        std::vector<size_t> result;
+        auto it = by_thread_.find(thread_id);
+        if (it != by_thread_.end()) {
+            auto [first, last] = window_range(it->second, begin, end);
+            for (size_t i = first; i < last; ++i) {
+                if (index_[it->second.blocks[i]].last_ts >= begin) {
+                    result.push_back(it->second.blocks[i]);
+                }
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Decodes one block, appending its events to out.
+     * Returns false on I/O error or a corrupt block.
+     */
+    bool read_block(size_t block, std::vector<TraceEvent>& out) const {
+        return decode(block, [&out](const TraceEvent& event) { out.push_back(event); });
+    }
+
+    /**
+     * Invokes on_event(const TraceEvent&) for each event with a timestamp in
+     * [begin, end], visiting only the blocks that overlap the window.
+     */
+    template <class F>
+    bool for_each_event(timestamp_t begin, timestamp_t end, F&& on_event) const {
+        return for_each_in_blocks(blocks_in_window(begin, end), begin, end, on_event);
+    }
+
+    // As above, for one thread's events only (in time order)
+    template <class F>
+    bool for_each_event(timestamp_t begin, timestamp_t end, thread_id_t thread_id, F&& on_event) const {
+        return for_each_in_blocks(blocks_in_window(begin, end, thread_id), begin, end, on_event);
+    }
+
+    // Invokes on_event(const TraceEvent&) for every event in file order
+    template <class F>
+    bool for_each_event(F&& on_event) const {
+        for (size_t block = 0; block < index_.size(); ++block) {
+            if (!decode(block, on_event)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Invokes on_event(const TraceEvent&) for every event in global timestamp
+     * order by merging the per-thread block sequences. Holds one decoded
+     * block per thread in memory, never the whole trace.
+     */
+    template <class F>
+    bool for_each_event_ordered(F&& on_event) const {
+        return for_each_event_ordered(0, UINT64_MAX, on_event);
+    }
+
+    /**
+     * As above, for the events with a timestamp in [begin, end]: each
+     * thread's merge starts at its first block overlapping the window, found
+     * by binary search, and stops after its last.
+     */
+    template <class F>
+    bool for_each_event_ordered(timestamp_t begin, timestamp_t end, F&& on_event) const {
+        struct Cursor {
+            const ThreadLookup* lookup = nullptr;
+            size_t next_block = 0;
+            size_t end_block = 0;
+            size_t position = 0;
+            std::vector<TraceEvent> events;
+        };
+        std::vector<Cursor> cursors;
+        cursors.reserve(by_thread_.size());
+        for (const auto& [thread_id, lookup] : by_thread_) {
+            auto [first, last] = window_range(lookup, begin, end);
+            if (first < last) {
+                Cursor& cursor = cursors.emplace_back();
+                cursor.lookup = &lookup;
+                cursor.next_block = first;
+                cursor.end_block = last;
+            }
+        }
+
+        // Loads the cursor's next block with events in the window; false when exhausted or corrupt
+        bool corrupt = false;
+        auto refill = [&](Cursor& cursor) {
+            while (cursor.next_block < cursor.end_block) {
+                cursor.events.clear();
+                cursor.position = 0;
+                if (!read_block(cursor.lookup->blocks[cursor.next_block++], cursor.events)) {
+                    corrupt = true;
+                    return false;
+                }
+                cursor.events.erase(std::remove_if(cursor.events.begin(), cursor.events.end(),
+                                                   [&](const TraceEvent& e) {
+                                                       return e.timestamp_ns < begin || e.timestamp_ns > end;
+                                                   }),
+                                    cursor.events.end());
+                if (!cursor.events.empty()) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        using Entry = std::pair<timestamp_t, size_t>;  // (timestamp, cursor)
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+        for (size_t i = 0; i < cursors.size(); ++i) {
+            if (refill(cursors[i])) {
+                heap.emplace(cursors[i].events[0].timestamp_ns, i);
+            }
+        }
+        while (!heap.empty()) {
+            size_t i = heap.top().second;
+            heap.pop();
+            Cursor& cursor = cursors[i];
+            on_event(static_cast<const TraceEvent&>(cursor.events[cursor.position]));
+            if (++cursor.position < cursor.events.size() || refill(cursor)) {
+                heap.emplace(cursor.events[cursor.position].timestamp_ns, i);
+            }
+        }
+        return !corrupt;
+    }
+
+private:
+    struct ThreadLookup {
+        std::vector<size_t> blocks;
+        std::vector<timestamp_t> max_last_ts;
+    };
+
+    /**
+     * Positions [first, last) in lookup.blocks that may overlap [begin, end]:
+     * blocks before first end before begin, blocks from last start after end.
+     */
+    std::pair<size_t, size_t> window_range(const ThreadLookup& lookup, timestamp_t begin, timestamp_t end) const {
+        // Blocks sorted by first_ts; max_last_ts is the running max of last_ts
+        size_t first = std::lower_bound(lookup.max_last_ts.begin(), lookup.max_last_ts.end(), begin) -
+                       lookup.max_last_ts.begin();
+        size_t last = std::partition_point(lookup.blocks.begin() + first, lookup.blocks.end(),
+                                           [&](size_t block) { return index_[block].first_ts <= end; }) -
+                      lookup.blocks.begin();
+        return {first, last};
+    }
+
+    template <class F>
+    bool for_each_in_blocks(const std::vector<size_t>& blocks, timestamp_t begin, timestamp_t end,
+                            F& on_event) const {
+        for (size_t block : blocks) {
+            bool ok = decode(block, [&](const TraceEvent& event) {
+                if (event.timestamp_ns >= begin && event.timestamp_ns <= end) {
+                    on_event(event);
+                }
+            });
+            if (!ok) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool read_at(uint64_t offset, void* data, size_t size) const {
+        if (offset + size > file_size_) {
+            return false;
+        }
+        auto* out = static_cast<char*>(data);
+        while (size > 0) {
+            ssize_t n = ::pread(fd_, out, size, static_cast<off_t>(offset));
+            if (n <= 0) {
+                return false;
+            }
+            out += n;
+            offset += static_cast<uint64_t>(n);
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    template <class F>
+    bool decode(size_t block, F&& on_event) const {
+        if (block >= index_.size()) {
+            return false;
+        }
+        uint64_t offset = index_[block].offset;
+        BlockHeader header;
+        if (!read_at(offset, &header, sizeof(header)) || header.magic != BLOCK_MAGIC) {
+            return false;
+        }
+        std::vector<uint8_t> payload(header.payload_size);
+        BlockFooter footer;
+        if (!read_at(offset + sizeof(header), payload.data(), payload.size()) ||
+            !read_at(offset + sizeof(header) + payload.size(), &footer, sizeof(footer)) ||
+            footer.payload_size != header.payload_size) {
+            return false;
+        }
+        switch (static_cast<BlockCodec>(footer.codec)) {
+            case BlockCodec::None:
+                return internal::decode_block(payload.data(), payload.size(), footer, on_event);
+            case BlockCodec::LZ: {
+                std::vector<uint8_t> raw(footer.raw_size);
+                if (!internal::lz_decompress(payload.data(), payload.size(), raw.data(), raw.size())) {
+                    return false;
+                }
+                return internal::decode_block(raw.data(), raw.size(), footer, on_event);
+            }
+            default:
+                return false;  // Unknown codec
+        }
+    }
+
+    bool load_index() {
+        BlockFileTrailer trailer;
+        if (file_size_ < sizeof(BlockFileHeader) + sizeof(trailer) ||
+            !read_at(file_size_ - sizeof(trailer), &trailer, sizeof(trailer)) ||
+            std::memcmp(trailer.magic, BLOCK_TRAILER_MAGIC, sizeof(trailer.magic)) != 0) {
+            return false;
+        }
+        uint64_t index_bytes = trailer.block_count * sizeof(BlockIndexEntry);
+        if (trailer.index_offset + index_bytes + sizeof(trailer) != file_size_) {
+            return false;
+        }
+        index_.resize(trailer.block_count);
+        if (!read_at(trailer.index_offset, index_.data(), index_bytes)) {
+            index_.clear();
+            return false;
+        }
+
+        uint64_t offset = trailer.names_offset;
+        for (uint32_t i = 0; i < trailer.names_count; ++i) {
+            thread_id_t thread_id;
+            uint16_t length;
+            if (!read_at(offset, &thread_id, sizeof(thread_id)) ||
+                !read_at(offset + sizeof(thread_id), &length, sizeof(length))) {
+                break;
+            }
+            std::string name(length, '\0');
+            if (!read_at(offset + sizeof(thread_id) + sizeof(length), name.data(), length)) {
+                break;
+            }
+            thread_names_[thread_id] = std::move(name);
+            offset += sizeof(thread_id) + sizeof(length) + length;
+        }
+
+        strings_.reserve(trailer.strings_count);
+        for (uint32_t i = 0; i < trailer.strings_count; ++i) {
+            uint16_t length;
+            if (!read_at(offset, &length, sizeof(length))) {
+                break;
+            }
+            std::string text(length, '\0');
+            if (!read_at(offset + sizeof(length), text.data(), length)) {
+                break;
+            }
+            strings_.push_back(std::move(text));
+            offset += sizeof(length) + length;
+        }
+        return true;
+    }
+
+    /**
+     * Takes the index from the sidecar, then scans from its last entry on:
+     * blocks written after the sidecar's buffer was last flushed are found
+     * by the scan, and a torn last block is dropped. False if there is no
+     * usable sidecar (missing, or describing another trace).
+     */
+    bool load_sidecar(const char* sidecar_path) {
+        std::FILE* file = std::fopen(sidecar_path, "rb");
+        if (!file) {
+            return false;
+        }
+        BlockFileHeader header;
+        bool ok = std::fread(&header, sizeof(header), 1, file) == 1 &&
+                  std::memcmp(header.magic, BLOCK_SIDECAR_MAGIC, sizeof(header.magic)) == 0;
+        BlockIndexEntry entry;
+        while (ok && std::fread(&entry, sizeof(entry), 1, file) == 1 && entry.offset < file_size_) {
+            index_.push_back(entry);
+        }
+        std::fclose(file);
+        if (!ok || index_.empty()) {
+            return false;
+        }
+
+        BlockIndexEntry last = index_.back();
+        index_.pop_back();
+        size_t indexed = index_.size();
+        scan_blocks(last.offset);
+        if (index_.size() > indexed) {
+            --scanned_blocks_;  // The last entry is re-read, not found by the scan
+            const BlockIndexEntry& found = index_[indexed];
+            return found.thread_id == last.thread_id && found.first_ts == last.first_ts &&
+                   found.event_count == last.event_count;
+        }
+        return true;
+    }
+
+    // Appends index entries for the blocks from offset on; stops at the first torn block
+    void scan_blocks(uint64_t offset) {
+        BlockHeader header;
+        while (read_at(offset, &header, sizeof(header)) && header.magic == BLOCK_MAGIC) {
+            BlockFooter footer;
+            uint64_t footer_offset = offset + sizeof(header) + header.payload_size;
+            if (!read_at(footer_offset, &footer, sizeof(footer)) ||
+                footer.payload_size != header.payload_size) {
+                break;
+            }
+            BlockIndexEntry entry{};
+            entry.offset = offset;
+            entry.first_ts = footer.first_ts;
+            entry.last_ts = footer.last_ts;
+            entry.thread_id = footer.thread_id;
+            entry.event_count = footer.event_count;
+            index_.push_back(entry);
+            ++scanned_blocks_;
+            offset = footer_offset + sizeof(footer);
+        }
+    }
+
+    void build_thread_lookup() {
+        for (size_t i = 0; i < index_.size(); ++i) {
+            by_thread_[index_[i].thread_id].blocks.push_back(i);
+        }
+        for (auto& [thread_id, lookup] : by_thread_) {
+            std::sort(lookup.blocks.begin(), lookup.blocks.end(), [this](size_t a, size_t b) {
+                return index_[a].first_ts < index_[b].first_ts;
+            });
+            timestamp_t running = 0;
+            lookup.max_last_ts.reserve(lookup.blocks.size());
+            for (size_t block : lookup.blocks) {
+                running = std::max(running, index_[block].last_ts);
+                lookup.max_last_ts.push_back(running);
+            }
+        }
+    }
+
+    int fd_ = -1;
+    uint64_t file_size_ = 0;
+    bool recovered_ = false;
+    size_t scanned_blocks_ = 0;
+    std::vector<BlockIndexEntry> index_;
+    std::unordered_map<thread_id_t, std::string> thread_names_;
+    std::vector<std::string> strings_;
+    std::unordered_map<thread_id_t, ThreadLookup> by_thread_;
+};
+
+} // namespace ucdbg
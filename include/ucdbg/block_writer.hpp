@@ -0,0 +1,257 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <stdio_ext.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <ucdbg/block_format.hpp>
+#include <ucdbg/lz_compress.hpp>
+
+namespace ucdbg {
+
+/**
+ * Streams events into the block trace format (see block_format.hpp).
+ *
+ * Events are grouped per thread; a thread's block is written once it holds
+ * max_block_events events, when the thread emits ThreadEnd, or when
+ * flush()/close() is called. A thread's encoder is dropped once its block
+ * is written at ThreadEnd or by flush(), so memory follows the threads
+ * with unwritten events rather than every thread ever seen. With
+ * BlockCodec::LZ each payload is compressed as it is written, falling back to
+ * the raw payload when compression does not shrink it. Not thread-safe:
+ * intended to be driven by the tracer's single drain thread.
+ */
+class BlockTraceWriter {
+public:
+    static constexpr size_t DEFAULT_BLOCK_EVENTS = 4096;
+
+    /**
+     * sidecar_index: also append each block's index entry to "<path>.idx" as
+     * it is written, so a trace that is never closed (crash, kill) can still
+     * be opened without scanning every block. Deleted by close().
+     */
+    explicit BlockTraceWriter(size_t max_block_events = DEFAULT_BLOCK_EVENTS,
+                              BlockCodec codec = BlockCodec::LZ, bool sidecar_index = false)
+        : max_block_events_(max_block_events ? max_block_events : DEFAULT_BLOCK_EVENTS),
+          codec_(codec), sidecar_index_(sidecar_index) {}
+
+    ~BlockTraceWriter() {
+        close();
+    }
+
+    BlockTraceWriter(const BlockTraceWriter&) = delete;
+    BlockTraceWriter& operator=(const BlockTraceWriter&) = delete;
+
+    bool open(const char* path) {
+        if (file_) {
+            return false;
+        }
+        file_ = std::fopen(path, "wb");
+        if (!file_) {
+            return false;
+        }
+        // A stale sidecar from an earlier trace at this path would describe the wrong blocks
+        sidecar_path_ = std::string(path) + BLOCK_SIDECAR_SUFFIX;
+        std::remove(sidecar_path_.c_str());
+        BlockFileHeader header{};
+        header.version = BLOCK_FILE_VERSION;
+        if (sidecar_index_) {
+            sidecar_ = std::fopen(sidecar_path_.c_str(), "wb");
+            if (sidecar_) {
+                std::memcpy(header.magic, BLOCK_SIDECAR_MAGIC, sizeof(header.magic));
+                std::fwrite(&header, sizeof(header), 1, sidecar_);
+            }
+        }
+        std::memcpy(header.magic, BLOCK_FILE_MAGIC, sizeof(header.magic));
+        offset_ = 0;
+        pending_.clear();
+        index_.clear();
+        thread_names_.clear();
+        strings_.clear();
+        write_bytes(&header, sizeof(header));
+        return true;
+    }
+
+    bool is_open() const {
+        return file_ != nullptr;
+    }
+
+    void append(const TraceEvent& event) {
+        auto pending = pending_.try_emplace(event.thread_id).first;
+        internal::BlockEncoder& encoder = pending->second;
+        if (encoder.event_count() == 0) {
+            encoder.reset(event.thread_id);
+        }
+        encoder.append(event);
+        if (event.kind == EventKind::Concurrency && event.concurrency.type == EventType::ThreadEnd) {
+            // The thread is gone (its ID may be reused): write its last block and drop the encoder
+            write_block(encoder);
+            pending_.erase(pending);
+        } else if (encoder.event_count() >= max_block_events_) {
+            write_block(encoder);
+        }
+    }
+
+    void append(const TraceEvent* events, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            append(events[i]);
+        }
+    }
+
+    void set_thread_name(thread_id_t thread_id, std::string name) {
+        thread_names_[thread_id] = std::move(name);
+    }
+
+    // String table (indexed by string_id_t) written at close
+    void set_strings(std::vector<std::string> strings) {
+        strings_ = std::move(strings);
+    }
+
+    // Write every partially filled block, drop the encoders and flush stdio buffers
+    void flush() {
+        if (!file_) {
+            return;
+        }
+        for (auto& [thread_id, encoder] : pending_) {
+            if (encoder.event_count() > 0) {
+                write_block(encoder);
+            }
+        }
+        pending_.clear();  // Recreated on a thread's next event
+        std::fflush(file_);
+        if (sidecar_) {
+            std::fflush(sidecar_);
+        }
+    }
+
+    // Flush, then append the thread name and string tables, block index and trailer
+    void close() {
+        if (!file_) {
+            return;
+        }
+        flush();
+
+        BlockFileTrailer trailer{};
+        trailer.names_offset = offset_;
+        trailer.names_count = static_cast<uint32_t>(thread_names_.size());
+        for (const auto& [thread_id, name] : thread_names_) {
+            uint16_t length = static_cast<uint16_t>(name.size() < 0xFFFF ? name.size() : 0xFFFF);
+            write_bytes(&thread_id, sizeof(thread_id));
+            write_bytes(&length, sizeof(length));
+            write_bytes(name.data(), length);
+        }
+        trailer.strings_count = static_cast<uint32_t>(strings_.size());
+        for (const std::string& text : strings_) {
+            uint16_t length = static_cast<uint16_t>(text.size() < 0xFFFF ? text.size() : 0xFFFF);
+            write_bytes(&length, sizeof(length));
+            write_bytes(text.data(), length);
+        }
+
+        trailer.index_offset = offset_;
+        trailer.block_count = index_.size();
+        write_bytes(index_.data(), index_.size() * sizeof(BlockIndexEntry));
+
+        std::memcpy(trailer.magic, BLOCK_TRAILER_MAGIC, sizeof(trailer.magic));
+        write_bytes(&trailer, sizeof(trailer));
+
+        std::fclose(file_);
+        file_ = nullptr;
+        if (sidecar_) {
+            std::fclose(sidecar_);
+            sidecar_ = nullptr;
+            std::remove(sidecar_path_.c_str());
+        }
+    }
+
+    /**
+     * Drop the open file without writing anything more to it: buffered bytes
+     * are discarded and no trailer is written. For a forked child, whose
+     * copy of the file must not add to the parent's trace; the next open()
+     * starts a new trace.
+     */
+    void abandon() {
+        if (!file_) {
+            return;
+        }
+        __fpurge(file_);
+        std::fclose(file_);
+        file_ = nullptr;
+        if (sidecar_) {
+            __fpurge(sidecar_);
+            std::fclose(sidecar_);
+            sidecar_ = nullptr;
+        }
+    }
+
+    uint64_t bytes_written() const {
+        return offset_;
+    }
+
+    size_t block_count() const {
+        return index_.size();
+    }
+
+    // Threads with an encoder: events not yet written, or no flush since their last block
+    size_t pending_threads() const {
+        return pending_.size();
+    }
+
+private:
+    void write_bytes(const void* data, size_t size) {
+        if (size == 0) {
+            return;
+        }
+        std::fwrite(data, 1, size, file_);
+        offset_ += size;
+    }
+
+    void write_block(internal::BlockEncoder& encoder) {
+        BlockFooter footer = encoder.footer();
+
+        BlockIndexEntry entry{};
+        entry.offset = offset_;
+        entry.first_ts = footer.first_ts;
+        entry.last_ts = footer.last_ts;
+        entry.thread_id = footer.thread_id;
+        entry.event_count = footer.event_count;
+        index_.push_back(entry);
+
+        const uint8_t* payload = encoder.payload();
+        if (codec_ == BlockCodec::LZ) {
+            compressed_.resize(internal::lz_compress_bound(footer.raw_size));
+            size_t size = internal::lz_compress(payload, footer.raw_size, compressed_.data());
+            if (size < footer.raw_size) {
+                payload = compressed_.data();
+                footer.payload_size = static_cast<uint32_t>(size);
+                footer.codec = static_cast<uint8_t>(BlockCodec::LZ);
+            }
+        }
+
+        BlockHeader header{BLOCK_MAGIC, footer.payload_size};
+        write_bytes(&header, sizeof(header));
+        write_bytes(payload, footer.payload_size);
+        write_bytes(&footer, sizeof(footer));
+        if (sidecar_) {
+            std::fwrite(&entry, sizeof(entry), 1, sidecar_);
+        }
+
+        encoder.reset(footer.thread_id);
+    }
+
+    std::FILE* file_ = nullptr;
+    uint64_t offset_ = 0;
+    size_t max_block_events_;
+    BlockCodec codec_;
+    bool sidecar_index_;
+    std::FILE* sidecar_ = nullptr;
+    std::string sidecar_path_;
+    std::vector<uint8_t> compressed_;
+    std::unordered_map<thread_id_t, internal::BlockEncoder> pending_;
+    std::vector<BlockIndexEntry> index_;
+    std::unordered_map<thread_id_t, std::string> thread_names_;
+    std::vector<std::string> strings_;
+};
+
+} // namespace ucdbg
@@ -0,0 +1,475 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <ucdbg/trace_types.hpp>
+
+namespace ucdbg {
+
+/**
+ * Streaming writer for the Chrome Trace Event JSON format, loadable by
+ * chrome://tracing and the Perfetto UI.
+ *
+ * Events must be appended in timestamp order (BlockTraceReader::
+ * for_each_event_ordered). Paired events become complete ("X") slices on
+ * their thread once the closing event arrives:
+ *
+ *   LockAcquire -> LockRelease            "lock <id>"
+ *   SharedLockAcquire -> SharedLockRelease "shared lock <id>"
+ *   LockContended -> LockAcquire          "wait lock <id>" (shared alike)
+ *   SemaphoreContended -> SemaphoreAcquire, CondWaitBegin -> CondWaitEnd,
+ *   LatchWaitBegin -> LatchWaitEnd, BarrierWaitBegin -> BarrierWaitEnd
+ *   TaskBegin -> TaskEnd                  "task"
+ *
+ * Spans become B/E events named from the string table, counters become
+ * counter tracks, and flow events, task queueing and coroutine resumption
+ * become flow arrows. Anything else is a thread-scoped instant event.
+ *
+ * Only slices that are still open are kept in memory, so memory is bounded
+ * by the number of locks held (and waits in progress) at any one time, not
+ * by the length of the trace. Timestamps are written relative to the first
+ * event, in microseconds with nanosecond decimals.
+ *
+ * Slices and spans on a thread must nest. Those that do not (hand-over-hand
+ * locking, a lock held across the end of a span) are split as in
+ * PerfettoTraceWriter: ending an outer slice or span ends the ones above it
+ * and begins them again at the same timestamp.
+ */
+class ChromeTraceWriter {
+public:
+    ChromeTraceWriter() = default;
+
+    ~ChromeTraceWriter() {
+        close();
+    }
+
+    ChromeTraceWriter(const ChromeTraceWriter&) = delete;
+    ChromeTraceWriter& operator=(const ChromeTraceWriter&) = delete;
+
+    bool open(const char* path) {
+        if (file_) {
+            return false;
+        }
+        file_ = std::fopen(path, "wb");
+        if (!file_) {
+            return false;
+        }
+        buffer_.resize(1 << 20);
+        std::setvbuf(file_, buffer_.data(), _IOFBF, buffer_.size());
+        bytes_written_ = 0;
+        events_written_ = 0;
+        first_ = true;
+        have_base_ = false;
+        base_ts_ = 0;
+        last_ts_ = 0;
+        stacks_.clear();
+        write("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+        record("{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"ucdbg\"}}");
+        return true;
+    }
+
+    // Names for span and counter events, indexed by string_id_t
+    void set_strings(const std::vector<std::string>& strings) {
+        strings_ = strings;
+    }
+
+    void thread_name(thread_id_t thread_id, std::string_view name) {
+        std::string line = "{\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(thread_id) +
+                           ",\"name\":\"thread_name\",\"args\":{\"name\":";
+        append_json_string(line, name);
+        line += "}}";
+        record(line);
+    }
+
+    void append(const TraceEvent& event) {
+        if (!file_ || !event.is_valid()) {
+            return;
+        }
+        if (!have_base_) {
+            base_ts_ = event.timestamp_ns;
+            have_base_ = true;
+        }
+        last_ts_ = event.timestamp_ns > last_ts_ ? event.timestamp_ns : last_ts_;
+        switch (event.kind) {
+            case EventKind::Concurrency:
+                append_concurrency(event);
+                break;
+            case EventKind::Span:
+                append_span(event);
+                break;
+            case EventKind::Counter:
+                append_counter(event);
+                break;
+            case EventKind::Log:
+                append_log(event);
+                break;
+            default:
+                break;  // Unknown kind from a newer writer
+        }
+    }
+
+    /**
+     * Ends slices still open at the end of the trace (marked unfinished),
+     * finishes the JSON document and closes the file.
+     * Returns false if any write failed.
+     */
+    bool close() {
+        if (!file_) {
+            return false;
+        }
+        // Spans left open keep their B event only, as chrome://tracing expects
+        for (const auto& [tid, stack] : stacks_) {
+            for (const OpenSlice& open : stack) {
+                if (open.key.slice != Slice::Span) {
+                    complete(open.key, open.start, last_ts_, "\"unfinished\":true");
+                }
+            }
+        }
+        stacks_.clear();
+        write("\n]}\n");
+        bool ok = !std::ferror(file_);
+        ok = std::fclose(file_) == 0 && ok;
+        file_ = nullptr;
+        return ok;
+    }
+
+    uint64_t bytes_written() const {
+        return bytes_written_;
+    }
+
+    // Trace events written, including metadata records
+    uint64_t events_written() const {
+        return events_written_;
+    }
+
+private:
+    enum class Slice : uint8_t {
+        Hold,
+        SharedHold,
+        Wait,
+        SharedWait,
+        SemaphoreWait,
+        CondWait,
+        LatchWait,
+        BarrierWait,
+        Task,
+        Span    // id: string_id_t; written as B/E events, not a complete slice
+    };
+
+    struct SliceKey {
+        thread_id_t thread_id;
+        lock_id_t id;
+        Slice slice;
+
+        bool operator==(const SliceKey& other) const {
+            return thread_id == other.thread_id && id == other.id && slice == other.slice;
+        }
+    };
+
+    struct OpenSlice {
+        SliceKey key;
+        timestamp_t start;
+    };
+
+    static const char* slice_name(Slice slice) {
+        switch (slice) {
+            case Slice::Hold: return "lock";
+            case Slice::SharedHold: return "shared lock";
+            case Slice::Wait: return "wait lock";
+            case Slice::SharedWait: return "wait shared lock";
+            case Slice::SemaphoreWait: return "wait semaphore";
+            case Slice::CondWait: return "cond wait";
+            case Slice::LatchWait: return "wait latch";
+            case Slice::BarrierWait: return "wait barrier";
+            case Slice::Task: return "task";
+            case Slice::Span: return "span";
+        }
+        return "slice";
+    }
+
+    void append_concurrency(const TraceEvent& event) {
+        thread_id_t tid = event.thread_id;
+        lock_id_t id = event.concurrency.lock_id;
+        timestamp_t ts = event.timestamp_ns;
+        uint32_t arg = event.concurrency_arg();
+        switch (event.concurrency.type) {
+            case EventType::LockContended:
+                begin_slice({tid, id, Slice::Wait}, ts);
+                return;
+            case EventType::LockAcquire:
+                end_slice({tid, id, Slice::Wait}, ts);
+                begin_slice({tid, id, Slice::Hold}, ts);
+                return;
+            case EventType::LockRelease:
+                end_slice({tid, id, Slice::Hold}, ts);
+                return;
+            case EventType::SharedLockContended:
+                begin_slice({tid, id, Slice::SharedWait}, ts);
+                return;
+            case EventType::SharedLockAcquire:
+                end_slice({tid, id, Slice::SharedWait}, ts);
+                begin_slice({tid, id, Slice::SharedHold}, ts);
+                return;
+            case EventType::SharedLockRelease:
+                end_slice({tid, id, Slice::SharedHold}, ts);
+                return;
+            case EventType::SemaphoreContended:
+                begin_slice({tid, id, Slice::SemaphoreWait}, ts);
+                return;
+            case EventType::SemaphoreAcquire:
+                end_slice({tid, id, Slice::SemaphoreWait}, ts);
+                return;
+            case EventType::CondWaitBegin:
+                begin_slice({tid, id, Slice::CondWait}, ts);
+                return;
+            case EventType::CondWaitEnd:
+                end_slice({tid, id, Slice::CondWait}, ts,
+                          std::string("\"reason\":\"") +
+                              wake_reason_to_string(static_cast<WakeReason>(arg)) + "\"");
+                return;
+            case EventType::LatchWaitBegin:
+                begin_slice({tid, id, Slice::LatchWait}, ts);
+                return;
+            case EventType::LatchWaitEnd:
+                end_slice({tid, id, Slice::LatchWait}, ts);
+                return;
+            case EventType::BarrierWaitBegin:
+                begin_slice({tid, id, Slice::BarrierWait}, ts);
+                return;
+            case EventType::BarrierWaitEnd:
+                end_slice({tid, id, Slice::BarrierWait}, ts, "\"phase\":" + std::to_string(arg));
+                return;
+            case EventType::LockHoldHistogram:
+            case EventType::LockWaitHistogram:
+            case EventType::LockClassName:
+            case EventType::AtomicCounterOwner:
+                return;  // Summary records (ucdbg-analyze), not points in time
+            case EventType::TaskEnqueue:
+                flow("s", "task", id, tid, ts);
+                return;
+            case EventType::TaskBegin:
+                flow("f", "task", id, tid, ts);
+                begin_slice({tid, id, Slice::Task}, ts);
+                return;
+            case EventType::TaskEnd:
+                end_slice({tid, id, Slice::Task}, ts, "\"tag\":" + std::to_string(arg));
+                return;
+            case EventType::CoroSuspend:
+                instant(event);
+                flow("s", "coro", id, tid, ts);
+                return;
+            case EventType::CoroResume:
+                flow("f", "coro", id, tid, ts);
+                instant(event);
+                return;
+            case EventType::FlowBegin:
+                flow("s", "flow", id, tid, ts);
+                return;
+            case EventType::FlowStep:
+                flow("t", "flow", id, tid, ts);
+                return;
+            case EventType::FlowEnd:
+                flow("f", "flow", id, tid, ts);
+                return;
+            default:
+                instant(event);
+                return;
+        }
+    }
+
+    void append_span(const TraceEvent& event) {
+        SliceKey key{event.thread_id, event.span.name_id, Slice::Span};
+        if (event.span.phase == SpanPhase::Begin) {
+            span_begin(key, event.timestamp_ns);
+            begin_slice(key, event.timestamp_ns);
+        } else {
+            end_slice(key, event.timestamp_ns);
+        }
+    }
+
+    void span_begin(const SliceKey& key, timestamp_t ts) {
+        std::string line = "{\"ph\":\"B\",\"pid\":1,\"tid\":" + std::to_string(key.thread_id) +
+                           ",\"ts\":" + timestamp(ts) + ",\"cat\":\"span\",\"name\":";
+        append_json_string(line, string_name(static_cast<string_id_t>(key.id)));
+        line += "}";
+        record(line);
+    }
+
+    void span_end(const SliceKey& key, timestamp_t ts) {
+        record("{\"ph\":\"E\",\"pid\":1,\"tid\":" + std::to_string(key.thread_id) + ",\"ts\":" +
+               timestamp(ts) + "}");
+    }
+
+    void append_counter(const TraceEvent& event) {
+        std::string line = "{\"ph\":\"C\",\"pid\":1,\"tid\":" + std::to_string(event.thread_id) +
+                           ",\"ts\":" + timestamp(event.timestamp_ns) + ",\"name\":";
+        append_json_string(line, string_name(event.counter.name_id));
+        line += ",\"args\":{\"value\":" + std::to_string(event.counter.value) + "}}";
+        record(line);
+    }
+
+    void append_log(const TraceEvent& event) {
+        std::string line = "{\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":" + std::to_string(event.thread_id) +
+                           ",\"ts\":" + timestamp(event.timestamp_ns) +
+                           ",\"cat\":\"log\",\"name\":\"log\",\"args\":{\"level\":" +
+                           std::to_string(static_cast<unsigned>(event.log.level)) + ",\"message\":";
+        append_json_string(line, string_name(event.log.message_string_id));
+        line += "}}";
+        record(line);
+    }
+
+    void instant(const TraceEvent& event) {
+        std::string line = "{\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":" + std::to_string(event.thread_id) +
+                           ",\"ts\":" + timestamp(event.timestamp_ns) + ",\"cat\":\"event\",\"name\":\"" +
+                           event_type_to_string(event.concurrency.type) + "\",\"args\":{\"id\":\"" +
+                           hex(event.concurrency.lock_id) + "\",\"arg\":" +
+                           std::to_string(event.concurrency_arg()) + "}}";
+        record(line);
+    }
+
+    // Flow arrow point; "bp":"e" binds it to the enclosing slice
+    void flow(const char* phase, const char* category, uint64_t id, thread_id_t tid, timestamp_t ts) {
+        std::string line = std::string("{\"ph\":\"") + phase + "\",\"bp\":\"e\",\"pid\":1,\"tid\":" +
+                           std::to_string(tid) + ",\"ts\":" + timestamp(ts) + ",\"cat\":\"" + category +
+                           "\",\"name\":\"" + category + "\",\"id\":\"" + hex(id) + "\"}";
+        record(line);
+    }
+
+    void begin_slice(const SliceKey& key, timestamp_t ts) {
+        stacks_[key.thread_id].push_back({key, ts});
+    }
+
+    /**
+     * Emits the innermost open slice for key, splitting the slices above it;
+     * unmatched ends (trace began mid-slice) are dropped
+     */
+    void end_slice(const SliceKey& key, timestamp_t ts, const std::string& args = std::string()) {
+        auto it = stacks_.find(key.thread_id);
+        if (it == stacks_.end()) {
+            return;
+        }
+        std::vector<OpenSlice>& stack = it->second;
+        size_t depth = stack.size();
+        while (depth > 0 && !(stack[depth - 1].key == key)) {
+            --depth;
+        }
+        if (depth == 0) {
+            return;
+        }
+        for (size_t i = stack.size() - 1; i >= depth; --i) {
+            finish(stack[i], ts, std::string());
+        }
+        finish(stack[depth - 1], ts, args);
+        stack.erase(stack.begin() + (depth - 1));
+        for (size_t i = depth - 1; i < stack.size(); ++i) {
+            stack[i].start = ts;
+            if (stack[i].key.slice == Slice::Span) {
+                span_begin(stack[i].key, ts);
+            }
+        }
+        if (stack.empty()) {
+            stacks_.erase(it);
+        }
+    }
+
+    void finish(const OpenSlice& open, timestamp_t ts, const std::string& args) {
+        if (open.key.slice == Slice::Span) {
+            span_end(open.key, ts);
+        } else {
+            complete(open.key, open.start, ts, args);
+        }
+    }
+
+    void complete(const SliceKey& key, timestamp_t start, timestamp_t end, const std::string& args) {
+        std::string line = "{\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(key.thread_id) +
+                           ",\"ts\":" + timestamp(start) + ",\"dur\":" + duration(end - start) +
+                           ",\"cat\":\"" + (key.slice == Slice::Task ? "task" : "lock") + "\",\"name\":\"" +
+                           slice_name(key.slice);
+        if (key.slice != Slice::Task) {
+            line += ' ';
+            line += hex(key.id);
+        }
+        line += "\",\"args\":{\"id\":\"" + hex(key.id) + "\"";
+        if (!args.empty()) {
+            line += "," + args;
+        }
+        line += "}}";
+        record(line);
+    }
+
+    const std::string& string_name(string_id_t id) const {
+        static const std::string unknown = "?";
+        return id < strings_.size() ? strings_[id] : unknown;
+    }
+
+    std::string timestamp(timestamp_t ts) const {
+        return duration(ts >= base_ts_ ? ts - base_ts_ : 0);
+    }
+
+    // Nanoseconds as microseconds with three decimals, exact
+    static std::string duration(uint64_t ns) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%" PRIu64 ".%03" PRIu64, ns / 1000, ns % 1000);
+        return text;
+    }
+
+    static std::string hex(uint64_t value) {
+        char text[24];
+        std::snprintf(text, sizeof(text), "0x%" PRIx64, value);
+        return text;
+    }
+
+    static void append_json_string(std::string& out, std::string_view text) {
+        out += '"';
+        for (char c : text) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                        out += escaped;
+                    } else {
+                        out += c;
+                    }
+            }
+        }
+        out += '"';
+    }
+
+    void record(const std::string& line) {
+        if (!first_) {
+            write(",\n");
+        }
+        first_ = false;
+        write(line);
+        ++events_written_;
+    }
+
+    void write(std::string_view text) {
+        std::fwrite(text.data(), 1, text.size(), file_);
+        bytes_written_ += text.size();
+    }
+
+    std::FILE* file_ = nullptr;
+    std::vector<char> buffer_;
+    uint64_t bytes_written_ = 0;
+    uint64_t events_written_ = 0;
+    bool first_ = true;
+    bool have_base_ = false;
+    timestamp_t base_ts_ = 0;
+    timestamp_t last_ts_ = 0;
+    std::vector<std::string> strings_;
+    std::unordered_map<thread_id_t, std::vector<OpenSlice>> stacks_;     // Open slices per thread, innermost last
+};
+
+} // namespace ucdbg
@@ -0,0 +1,498 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <span>
+#include <vector>
+#include <ucdbg/trace_types.hpp>
+
+namespace ucdbg {
+
+/**
+ * Columnar (struct-of-arrays) trace layout for offline analysis.
+ *
+ * Each block stores up to block_events events as one array per field, so a
+ * scan over e.g. lock IDs reads 8 bytes per event instead of 32. Every column
+ * starts at a 64-byte aligned file offset, which keeps SIMD loads aligned
+ * whether blocks are read into memory or mapped.
+ *
+ * File layout (little-endian):
+ *   ColumnarFileHeader                   16 bytes
+ *   Block*
+ *     ColumnBlockHeader                  88 bytes (count, time range, column offsets)
+ *     column arrays                      each 64-byte aligned, event_count x width
+ *   ColumnIndexEntry x block_count
+ *   ColumnarTrailer                      24 bytes, always last
+ *
+ * Columns hold the raw TraceEvent fields; together they reconstruct every
+ * event byte-for-byte (see ColumnBlock::event()).
+ */
+
+enum class Column : uint8_t {
+    Timestamp = 0,  // u64 timestamp_ns
+    ThreadId = 1,   // u64 thread_id
+    LockId = 2,     // u64 payload bytes 24-31 (lock_id / message id)
+    Arg = 3,        // u32 payload bytes 21-23
+    Reserved = 4,   // u16 header bytes 18-19
+    Version = 5,    // u8  format_version
+    Kind = 6,       // u8  EventKind
+    Type = 7        // u8  payload byte 20 (EventType / LogLevel)
+};
+
+constexpr size_t COLUMN_COUNT = 8;
+constexpr size_t COLUMN_ALIGNMENT = 64;
+constexpr uint32_t ALL_COLUMNS = (1u << COLUMN_COUNT) - 1;
+
+constexpr uint32_t column_bit(Column column) {
+    return 1u << static_cast<unsigned>(column);
+}
+
+constexpr size_t column_width(Column column) {
+    switch (column) {
+        case Column::Timestamp:
+        case Column::ThreadId:
+        case Column::LockId: return 8;
+        case Column::Arg: return 4;
+        case Column::Reserved: return 2;
+        default: return 1;
+    }
+}
+
+constexpr char COLUMNAR_FILE_MAGIC[8] = {'U', 'C', 'D', 'B', 'G', 'C', 'O', 'L'};
+constexpr char COLUMNAR_TRAILER_MAGIC[8] = {'U', 'C', 'D', 'B', 'G', 'C', 'I', 'X'};
+constexpr uint32_t COLUMN_BLOCK_MAGIC = 0x4B434355;  // "UCCK"
+constexpr uint16_t COLUMNAR_FILE_VERSION = 1;
+
+#pragma pack(push, 1)
+struct ColumnarFileHeader {
+    char magic[8];
+    uint16_t version;
+    uint16_t column_count;
+    uint32_t reserved;
+};
+
+struct ColumnBlockHeader {
+    uint32_t magic;
+    uint32_t event_count;
+    timestamp_t min_ts;
+    timestamp_t max_ts;
+    uint64_t column_offset[COLUMN_COUNT];   // Absolute, 64-byte aligned
+};
+
+struct ColumnIndexEntry {
+    uint64_t offset;                        // File offset of ColumnBlockHeader
+    timestamp_t min_ts;
+    timestamp_t max_ts;
+    uint32_t event_count;
+    uint32_t reserved;
+};
+
+struct ColumnarTrailer {
+    uint64_t index_offset;
+    uint64_t block_count;
+    char magic[8];
+};
+#pragma pack(pop)
+
+static_assert(sizeof(ColumnarFileHeader) == 16, "ColumnarFileHeader must be 16 bytes");
+static_assert(sizeof(ColumnBlockHeader) == 88, "ColumnBlockHeader must be 88 bytes");
+static_assert(sizeof(ColumnIndexEntry) == 32, "ColumnIndexEntry must be 32 bytes");
+static_assert(sizeof(ColumnarTrailer) == 24, "ColumnarTrailer must be 24 bytes");
+
+namespace internal {
+
+// Heap buffer aligned to COLUMN_ALIGNMENT, grown on demand, never shrunk
+class AlignedBuffer {
+public:
+    AlignedBuffer() = default;
+    ~AlignedBuffer() { release(); }
+
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+    AlignedBuffer(AlignedBuffer&& other) noexcept
+        : data_(other.data_), capacity_(other.capacity_) {
+        other.data_ = nullptr;
+        other.capacity_ = 0;
+    }
+
+    void reserve(size_t size) {
+        if (size <= capacity_) {
+            return;
+        }
+        release();
+        data_ = static_cast<uint8_t*>(::operator new(size, std::align_val_t(COLUMN_ALIGNMENT)));
+        capacity_ = size;
+    }
+
+    uint8_t* data() { return data_; }
+    const uint8_t* data() const { return data_; }
+
+private:
+    void release() {
+        if (data_) {
+            ::operator delete(data_, std::align_val_t(COLUMN_ALIGNMENT));
+        }
+        data_ = nullptr;
+        capacity_ = 0;
+    }
+
+    uint8_t* data_ = nullptr;
+    size_t capacity_ = 0;
+};
+
+} // namespace internal
+
+/**
+ * One decoded columnar block. Only the columns requested from
+ * ColumnarTraceReader::read_block() are populated; the others are empty.
+ */
+class ColumnBlock {
+public:
+    size_t size() const { return event_count_; }
+    uint32_t columns() const { return columns_; }
+    bool has(Column column) const { return columns_ & column_bit(column); }
+
+    std::span<const uint64_t> timestamps() const { return view<uint64_t>(Column::Timestamp); }
+    std::span<const uint64_t> thread_ids() const { return view<uint64_t>(Column::ThreadId); }
+    std::span<const uint64_t> lock_ids() const { return view<uint64_t>(Column::LockId); }
+    std::span<const uint32_t> args() const { return view<uint32_t>(Column::Arg); }
+    std::span<const uint16_t> reserved() const { return view<uint16_t>(Column::Reserved); }
+    std::span<const uint8_t> versions() const { return view<uint8_t>(Column::Version); }
+    std::span<const uint8_t> kinds() const { return view<uint8_t>(Column::Kind); }
+    std::span<const uint8_t> types() const { return view<uint8_t>(Column::Type); }
+
+    // Reassemble event i; requires all columns (ALL_COLUMNS)
+    TraceEvent event(size_t i) const {
+        uint8_t raw[sizeof(TraceEvent)];
+        std::memcpy(raw, &timestamps()[i], 8);
+        std::memcpy(raw + 8, &thread_ids()[i], 8);
+        raw[16] = versions()[i];
+        raw[17] = kinds()[i];
+        std::memcpy(raw + 18, &reserved()[i], 2);
+        raw[20] = types()[i];
+        uint32_t arg = args()[i];
+        raw[21] = static_cast<uint8_t>(arg);
+        raw[22] = static_cast<uint8_t>(arg >> 8);
+        raw[23] = static_cast<uint8_t>(arg >> 16);
+        std::memcpy(raw + 24, &lock_ids()[i], 8);
+        TraceEvent event;
+        event.deserialize_from(raw);
+        return event;
+    }
+
+private:
+    friend class ColumnarTraceReader;
+
+    template <class T>
+    std::span<const T> view(Column column) const {
+        if (!has(column)) {
+            return {};
+        }
+        return {reinterpret_cast<const T*>(data_[static_cast<size_t>(column)].data()), event_count_};
+    }
+
+    internal::AlignedBuffer data_[COLUMN_COUNT];
+    size_t event_count_ = 0;
+    uint32_t columns_ = 0;
+};
+
+/**
+ * Converts a stream of TraceEvents into the columnar layout.
+ * Usage: writer.open(path); writer.append(e)...; writer.close();
+ */
+class ColumnarTraceWriter {
+public:
+    static constexpr size_t DEFAULT_BLOCK_EVENTS = 65536;
+
+    explicit ColumnarTraceWriter(size_t block_events = DEFAULT_BLOCK_EVENTS)
+        : block_events_(block_events ? block_events : DEFAULT_BLOCK_EVENTS) {}
+
+    ~ColumnarTraceWriter() {
+        close();
+    }
+
+    ColumnarTraceWriter(const ColumnarTraceWriter&) = delete;
+    ColumnarTraceWriter& operator=(const ColumnarTraceWriter&) = delete;
+
+    bool open(const char* path) {
+        if (file_) {
+            return false;
+        }
+        file_ = std::fopen(path, "wb");
+        if (!file_) {
+            return false;
+        }
+        ColumnarFileHeader header{};
+        std::memcpy(header.magic, COLUMNAR_FILE_MAGIC, sizeof(header.magic));
+        header.version = COLUMNAR_FILE_VERSION;
+        header.column_count = COLUMN_COUNT;
+        offset_ = 0;
+        index_.clear();
+        write_bytes(&header, sizeof(header));
+        return true;
+    }
+
+    void append(const TraceEvent& event) {
+        uint8_t raw[sizeof(TraceEvent)];
+        event.serialize_to(raw);
+        uint16_t reserved;
+        uint64_t value;
+        std::memcpy(&reserved, raw + 18, sizeof(reserved));
+        std::memcpy(&value, raw + 24, sizeof(value));
+
+        timestamps_.push_back(event.timestamp_ns);
+        thread_ids_.push_back(event.thread_id);
+        lock_ids_.push_back(value);
+        args_.push_back(raw[21] | (raw[22] << 8) | (raw[23] << 16));
+        reserved_.push_back(reserved);
+        versions_.push_back(raw[16]);
+        kinds_.push_back(raw[17]);
+        types_.push_back(raw[20]);
+
+        if (timestamps_.size() >= block_events_) {
+            write_block();
+        }
+    }
+
+    void close() {
+        if (!file_) {
+            return;
+        }
+        if (!timestamps_.empty()) {
+            write_block();
+        }
+        ColumnarTrailer trailer{};
+        trailer.index_offset = offset_;
+        trailer.block_count = index_.size();
+        std::memcpy(trailer.magic, COLUMNAR_TRAILER_MAGIC, sizeof(trailer.magic));
+        write_bytes(index_.data(), index_.size() * sizeof(ColumnIndexEntry));
+        write_bytes(&trailer, sizeof(trailer));
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+
+    uint64_t bytes_written() const {
+        return offset_;
+    }
+
+private:
+    void write_bytes(const void* data, size_t size) {
+        if (size == 0) {
+            return;
+        }
+        std::fwrite(data, 1, size, file_);
+        offset_ += size;
+    }
+
+    void pad_to_alignment() {
+        static const uint8_t zeros[COLUMN_ALIGNMENT] = {};
+        write_bytes(zeros, (COLUMN_ALIGNMENT - offset_ % COLUMN_ALIGNMENT) % COLUMN_ALIGNMENT);
+    }
+
+    void write_block() {
+        size_t count = timestamps_.size();
+        const void* columns[COLUMN_COUNT] = {
+            timestamps_.data(), thread_ids_.data(), lock_ids_.data(), args_.data(),
+            reserved_.data(), versions_.data(), kinds_.data(), types_.data()};
+
+        ColumnBlockHeader header{};
+        header.magic = COLUMN_BLOCK_MAGIC;
+        header.event_count = static_cast<uint32_t>(count);
+        header.min_ts = timestamps_[0];
+        header.max_ts = timestamps_[0];
+        for (timestamp_t ts : timestamps_) {
+            header.min_ts = ts < header.min_ts ? ts : header.min_ts;
+            header.max_ts = ts > header.max_ts ? ts : header.max_ts;
+        }
+
+        // Column offsets: header, then each column rounded up to the alignment
+        uint64_t block_offset = offset_;
+        uint64_t cursor = block_offset + sizeof(header);
+        for (size_t c = 0; c < COLUMN_COUNT; ++c) {
+            cursor = (cursor + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT * COLUMN_ALIGNMENT;
+            header.column_offset[c] = cursor;
+            cursor += count * column_width(static_cast<Column>(c));
+        }
+
+        write_bytes(&header, sizeof(header));
+        for (size_t c = 0; c < COLUMN_COUNT; ++c) {
+            pad_to_alignment();
+            write_bytes(columns[c], count * column_width(static_cast<Column>(c)));
+        }
+
+        index_.push_back({block_offset, header.min_ts, header.max_ts, header.event_count, 0});
+
+        timestamps_.clear();
+        thread_ids_.clear();
+        lock_ids_.clear();
+        args_.clear();
+        reserved_.clear();
+        versions_.clear();
+        kinds_.clear();
+        types_.clear();
+    }
+
+    std::FILE* file_ = nullptr;
+    uint64_t offset_ = 0;
+    size_t block_events_;
+    std::vector<ColumnIndexEntry> index_;
+
+    std::vector<uint64_t> timestamps_;
+    std::vector<uint64_t> thread_ids_;
+    std::vector<uint64_t> lock_ids_;
+    std::vector<uint32_t> args_;
+    std::vector<uint16_t> reserved_;
+    std::vector<uint8_t> versions_;
+    std::vector<uint8_t> kinds_;
+    std::vector<uint8_t> types_;
+};
+
+/**
+ * Reads columnar traces, fetching only the requested columns of a block.
+ * read_block() uses pread, so one reader may serve several threads as long
+ * as each uses its own ColumnBlock.
+ */
+class ColumnarTraceReader {
+public:
+    ColumnarTraceReader() = default;
+
+    ~ColumnarTraceReader() {
+        close();
+    }
+
+    ColumnarTraceReader(const ColumnarTraceReader&) = delete;
+    ColumnarTraceReader& operator=(const ColumnarTraceReader&) = delete;
+
+    bool open(const char* path) {
+        close();
+        fd_ = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0) {
+            return false;
+        }
+        struct stat st;
+        if (::fstat(fd_, &st) != 0) {
+            close();
+            return false;
+        }
+        file_size_ = static_cast<uint64_t>(st.st_size);
+
+        ColumnarFileHeader header;
+        ColumnarTrailer trailer;
+        if (!read_at(0, &header, sizeof(header)) ||
+            std::memcmp(header.magic, COLUMNAR_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version > COLUMNAR_FILE_VERSION || header.column_count != COLUMN_COUNT ||
+            file_size_ < sizeof(header) + sizeof(trailer) ||
+            !read_at(file_size_ - sizeof(trailer), &trailer, sizeof(trailer)) ||
+            std::memcmp(trailer.magic, COLUMNAR_TRAILER_MAGIC, sizeof(trailer.magic)) != 0 ||
+            trailer.index_offset + trailer.block_count * sizeof(ColumnIndexEntry) + sizeof(trailer) != file_size_) {
+            close();
+            return false;
+        }
+        index_.resize(trailer.block_count);
+        if (!read_at(trailer.index_offset, index_.data(), index_.size() * sizeof(ColumnIndexEntry))) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+        fd_ = -1;
+        file_size_ = 0;
+        index_.clear();
+    }
+
+    const std::vector<ColumnIndexEntry>& blocks() const {
+        return index_;
+    }
+
+    uint64_t event_count() const {
+        uint64_t total = 0;
+        for (const auto& entry : index_) {
+            total += entry.event_count;
+        }
+        return total;
+    }
+
+    /**
+     * Loads the columns selected by the column_bit() mask of one block.
+     * Returns false on I/O error or a corrupt block header.
+     */
+    bool read_block(size_t block, uint32_t columns, ColumnBlock& out) const {
+        if (block >= index_.size()) {
+            return false;
+        }
+        ColumnBlockHeader header;
+        if (!read_at(index_[block].offset, &header, sizeof(header)) ||
+            header.magic != COLUMN_BLOCK_MAGIC) {
+            return false;
+        }
+        out.event_count_ = header.event_count;
+        out.columns_ = 0;
+        for (size_t c = 0; c < COLUMN_COUNT; ++c) {
+            if (!(columns & (1u << c))) {
+                continue;
+            }
+            size_t bytes = header.event_count * column_width(static_cast<Column>(c));
+            out.data_[c].reserve(bytes);
+            if (!read_at(header.column_offset[c], out.data_[c].data(), bytes)) {
+                return false;
+            }
+            out.columns_ |= 1u << c;
+        }
+        return true;
+    }
+
+    /**
+     * Invokes on_block(const ColumnBlock&) for each block overlapping
+     * [begin, end] (by min/max timestamp), loading only the given columns.
+     */
+    template <class F>
+    bool for_each_block(uint32_t columns, F&& on_block,
+                        timestamp_t begin = 0, timestamp_t end = ~timestamp_t{0}) const {
+        ColumnBlock block;
+        for (size_t i = 0; i < index_.size(); ++i) {
+            if (index_[i].max_ts < begin || index_[i].min_ts > end) {
+                continue;
+            }
+            if (!read_block(i, columns, block)) {
+                return false;
+            }
+            on_block(static_cast<const ColumnBlock&>(block));
+        }
+        return true;
+    }
+
+private:
+    bool read_at(uint64_t offset, void* data, size_t size) const {
+        if (offset + size > file_size_) {
+            return false;
+        }
+        auto* out = static_cast<char*>(data);
+        while (size > 0) {
+            ssize_t n = ::pread(fd_, out, size, static_cast<off_t>(offset));
+            if (n <= 0) {
+                return false;
+            }
+            out += n;
+            offset += static_cast<uint64_t>(n);
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    int fd_ = -1;
+    uint64_t file_size_ = 0;
+    std::vector<ColumnIndexEntry> index_;
+};
+
+} // namespace ucdbg
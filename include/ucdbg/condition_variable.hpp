@@ -0,0 +1,177 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <ucdbg/event_helpers.hpp>
+#include <ucdbg/event_queue.hpp>
+
+namespace ucdbg {
+namespace internal {
+
+// Lock id of the mutex behind a lock: matches LockGuard's default id for the same mutex
+template <class Lock>
+lock_id_t lock_id_of(Lock& lock) {
+    if constexpr (requires { lock.mutex(); }) {
+        return reinterpret_cast<lock_id_t>(lock.mutex());
+    } else {
+        return reinterpret_cast<lock_id_t>(&lock);
+    }
+}
+
+/**
+ * Drop-in wrapper around std::condition_variable / condition_variable_any
+ * that traces the handoff:
+ *
+ *   CondNotifyOne/CondNotifyAll  emitted before waking waiters
+ *   CondWaitBegin                emitted before the mutex is released
+ *   CondWaitEnd                  emitted after the mutex is reacquired
+ *
+ * All events carry the mutex lock_id, so notify -> CondWaitEnd is the wakeup
+ * latency including the lock reacquisition. Notifies use the mutex of the
+ * most recent wait, since std notify calls do not name one.
+ *
+ * Wakeup reasons are inferred from a signal count: notify_one grants one
+ * signal and notify_all one per waiter; a waiter that wakes without timing
+ * out and finds no signal to consume reports Spurious. Notifiers that do not
+ * hold the mutex can race this accounting, so treat it as approximate.
+ */
+template <class CV>
+class TracedConditionVariable {
+public:
+    TracedConditionVariable() = default;
+
+    TracedConditionVariable(const TracedConditionVariable&) = delete;
+    TracedConditionVariable& operator=(const TracedConditionVariable&) = delete;
+
+    void notify_one() noexcept {
+        uint32_t waiters = waiters_.load(std::memory_order_acquire);
+        uint32_t signals = signals_.load(std::memory_order_relaxed);
+        while (signals < waiters &&
+               !signals_.compare_exchange_weak(signals, signals + 1, std::memory_order_acq_rel)) {
+        }
+        emit(make_concurrency_event(EventType::CondNotifyOne, last_lock_id(), waiters));
+        cv_.notify_one();
+    }
+
+    void notify_all() noexcept {
+        uint32_t waiters = waiters_.load(std::memory_order_acquire);
+        signals_.store(waiters, std::memory_order_release);
+        emit(make_concurrency_event(EventType::CondNotifyAll, last_lock_id(), waiters));
+        cv_.notify_all();
+    }
+
+    template <class Lock>
+    void wait(Lock& lock) {
+        lock_id_t lock_id = begin_wait(lock);
+        cv_.wait(lock);
+        end_wait(lock_id, false);
+    }
+
+    template <class Lock, class Predicate>
+    void wait(Lock& lock, Predicate pred) {
+        while (!pred()) {
+            wait(lock);
+        }
+    }
+
+    template <class Lock, class Clock, class Duration>
+    std::cv_status wait_until(Lock& lock, const std::chrono::time_point<Clock, Duration>& deadline) {
+        lock_id_t lock_id = begin_wait(lock);
+        std::cv_status status = cv_.wait_until(lock, deadline);
+        end_wait(lock_id, status == std::cv_status::timeout);
+        return status;
+    }
+
+    template <class Lock, class Clock, class Duration, class Predicate>
+    bool wait_until(Lock& lock, const std::chrono::time_point<Clock, Duration>& deadline, Predicate pred) {
+        while (!pred()) {
+            if (wait_until(lock, deadline) == std::cv_status::timeout) {
+                return pred();
+            }
+        }
+        return true;
+    }
+
+    template <class Lock, class Rep, class Period>
+    std::cv_status wait_for(Lock& lock, const std::chrono::duration<Rep, Period>& timeout) {
+        return wait_until(lock, std::chrono::steady_clock::now() + timeout);
+    }
+
+    template <class Lock, class Rep, class Period, class Predicate>
+    bool wait_for(Lock& lock, const std::chrono::duration<Rep, Period>& timeout, Predicate pred) {
+        return wait_until(lock, std::chrono::steady_clock::now() + timeout, std::move(pred));
+    }
+
+    // Threads currently inside a wait
+    uint32_t waiters() const {
+        return waiters_.load(std::memory_order_relaxed);
+    }
+
+    CV& native() {
+        return cv_;
+    }
+
+private:
+    template <class Lock>
+    lock_id_t begin_wait(Lock& lock) {
+        lock_id_t lock_id = lock_id_of(lock);
+        last_lock_id_.store(lock_id, std::memory_order_relaxed);
+        waiters_.fetch_add(1, std::memory_order_acq_rel);
+        emit(make_concurrency_event(EventType::CondWaitBegin, lock_id));
+        return lock_id;
+    }
+
+    void end_wait(lock_id_t lock_id, bool timed_out) {
+        WakeReason reason = WakeReason::Timeout;
+        if (!timed_out) {
+            reason = consume_signal() ? WakeReason::Notified : WakeReason::Spurious;
+        }
+        uint32_t waiters = waiters_.fetch_sub(1, std::memory_order_acq_rel) - 1;
+        // Signals granted to a waiter that timed out instead are never consumed
+        uint32_t signals = signals_.load(std::memory_order_relaxed);
+        while (signals > waiters &&
+               !signals_.compare_exchange_weak(signals, waiters, std::memory_order_acq_rel)) {
+        }
+        emit(make_concurrency_event(EventType::CondWaitEnd, lock_id, static_cast<uint32_t>(reason)));
+    }
+
+    bool consume_signal() {
+        uint32_t signals = signals_.load(std::memory_order_acquire);
+        while (signals > 0) {
+            if (signals_.compare_exchange_weak(signals, signals - 1, std::memory_order_acq_rel)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    lock_id_t last_lock_id() const {
+        return last_lock_id_.load(std::memory_order_relaxed);
+    }
+
+    CV cv_;
+    std::atomic<uint32_t> waiters_{0};
+    std::atomic<uint32_t> signals_{0};
+    std::atomic<lock_id_t> last_lock_id_{0};
+};
+
+} // namespace internal
+
+/**
+ * Traced replacements for std::condition_variable and
+ * std::condition_variable_any, with the same interface.
+ *
+ * Usage:
+ *   std::mutex mtx;
+ *   ucdbg::ConditionVariable cv;
+ *   std::unique_lock<std::mutex> lock(mtx);
+ *   cv.wait(lock, [&] { return ready; });
+ */
+using ConditionVariable = internal::TracedConditionVariable<std::condition_variable>;
+using ConditionVariableAny = internal::TracedConditionVariable<std::condition_variable_any>;
+
+} // namespace ucdbg
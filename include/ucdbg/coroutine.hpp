@@ -0,0 +1,142 @@
+#pragma once
+
+#include <coroutine>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <ucdbg/event_helpers.hpp>
+#include <ucdbg/event_queue.hpp>
+#include <ucdbg/string_table.hpp>
+
+namespace ucdbg {
+namespace internal {
+
+// T as the compiler spells it, e.g. "net::Socket::ReadAwaiter"
+template <class T>
+constexpr std::string_view type_name() {
+#if defined(_MSC_VER)
+    std::string_view text = __FUNCSIG__;  // "... type_name<T>(void)"
+    size_t begin = text.find("type_name<") + 10;
+    size_t end = text.rfind(">(void)");
+#else
+    std::string_view text = __PRETTY_FUNCTION__;  // "... [with T = T; ...]" (GCC), "[T = T]" (Clang)
+    size_t begin = text.find("T = ") + 4;
+    size_t end = text.find_first_of(";]", begin);
+#endif
+    return text.substr(begin, end - begin);
+}
+
+template <class Awaitable>
+decltype(auto) get_awaiter(Awaitable&& awaitable) {
+    if constexpr (requires { std::forward<Awaitable>(awaitable).operator co_await(); }) {
+        return std::forward<Awaitable>(awaitable).operator co_await();
+    } else if constexpr (requires { operator co_await(std::forward<Awaitable>(awaitable)); }) {
+        return operator co_await(std::forward<Awaitable>(awaitable));
+    } else {
+        return std::forward<Awaitable>(awaitable);
+    }
+}
+
+} // namespace internal
+
+/**
+ * Default tag for an awaiter type: its name interned in the trace's string
+ * table (once per type), so readers can name it the way LockClassName
+ * records name lock classes. An explicit tag passed to traced_await()
+ * should likewise be a string ID, e.g. ucdbg::intern("socket read").
+ */
+template <class T>
+uint32_t awaiter_tag() {
+    static const uint32_t tag = intern(internal::type_name<T>());
+    return tag;
+}
+
+/**
+ * Awaiter wrapper emitting CoroSuspend when the coroutine suspends and
+ * CoroResume when it continues, both with the coroutine frame address as
+ * lock_id and the awaiter tag as arg. CoroResume is emitted on the thread
+ * that resumed the coroutine, so thread migrations and resumption latency
+ * per awaiter type can be read straight from the pair.
+ *
+ * Nothing is emitted if the awaiter is ready. If await_suspend returns
+ * false the pair is still emitted, with near-zero latency on one thread.
+ */
+template <class Awaiter>
+class TracedAwaiter {
+public:
+    TracedAwaiter(Awaiter awaiter, uint32_t tag) : awaiter_(std::forward<Awaiter>(awaiter)), tag_(tag) {}
+
+    bool await_ready() {
+        return awaiter_.await_ready();
+    }
+
+    template <class Promise>
+    decltype(auto) await_suspend(std::coroutine_handle<Promise> handle) {
+        frame_ = reinterpret_cast<lock_id_t>(handle.address());
+        // Before the inner await_suspend: once it returns, another thread may already own the frame
+        internal::emit(internal::make_concurrency_event(EventType::CoroSuspend, frame_, tag_));
+        return awaiter_.await_suspend(handle);
+    }
+
+    decltype(auto) await_resume() {
+        if (frame_) {
+            internal::emit(internal::make_concurrency_event(EventType::CoroResume, frame_, tag_));
+        }
+        return awaiter_.await_resume();
+    }
+
+private:
+    Awaiter awaiter_;
+    uint32_t tag_;
+    lock_id_t frame_ = 0;
+};
+
+template <class T>
+constexpr bool is_traced_awaiter = false;
+
+template <class Awaiter>
+constexpr bool is_traced_awaiter<TracedAwaiter<Awaiter>> = true;
+
+namespace internal {
+
+// Awaiters obtained by lvalue reference are kept by reference, temporaries by value
+template <class Awaitable>
+using awaiter_storage_t = std::conditional_t<
+    std::is_lvalue_reference_v<decltype(get_awaiter(std::declval<Awaitable>()))>,
+    decltype(get_awaiter(std::declval<Awaitable>())),
+    std::remove_cvref_t<decltype(get_awaiter(std::declval<Awaitable>()))>>;
+
+} // namespace internal
+
+/**
+ * Traces one co_await:
+ *   auto data = co_await ucdbg::traced_await(socket.read_async(buffer));
+ */
+template <class Awaitable>
+auto traced_await(Awaitable&& awaitable,
+                  uint32_t tag = awaiter_tag<std::remove_cvref_t<internal::awaiter_storage_t<Awaitable>>>()) {
+    return TracedAwaiter<internal::awaiter_storage_t<Awaitable>>(
+        internal::get_awaiter(std::forward<Awaitable>(awaitable)), tag);
+}
+
+/**
+ * Promise mixin that traces every co_await in the coroutine body:
+ *
+ *   struct promise_type : ucdbg::TracedPromise { ... };
+ *
+ * Does not cover initial_suspend/final_suspend, which do not go through
+ * await_transform.
+ */
+struct TracedPromise {
+    template <class Awaitable>
+    decltype(auto) await_transform(Awaitable&& awaitable) {
+        if constexpr (is_traced_awaiter<std::remove_cvref_t<Awaitable>>) {
+            return std::forward<Awaitable>(awaitable);  // Explicit traced_await(), e.g. with a tag
+        } else {
+            return traced_await(std::forward<Awaitable>(awaitable));
+        }
+    }
+};
+
+} // namespace ucdbg
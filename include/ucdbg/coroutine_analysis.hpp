@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <ucdbg/histogram.hpp>
+#include <ucdbg/trace_types.hpp>
+
+namespace ucdbg {
+
+// Suspensions of one awaiter tag
+struct AwaiterStats {
+    uint64_t suspends = 0;
+    uint64_t migrations = 0;        // Resumed on a thread other than the one that suspended
+    LatencyHistogram resume_ns;     // CoroSuspend -> CoroResume of the same frame
+};
+
+/**
+ * Coroutine resumption latency per awaiter tag (coroutine.hpp).
+ *
+ * Feed every event in timestamp order. Each CoroSuspend is paired with the
+ * next CoroResume of the same frame (lock_id), wherever it was emitted;
+ * resumes without a suspend (tracing started mid-await) are ignored.
+ * Memory grows with the tags and the frames suspended at once.
+ */
+class CoroutineAnalyzer {
+public:
+    void add(const TraceEvent& event) {
+        if (!event.is_valid() || event.kind != EventKind::Concurrency) {
+            return;
+        }
+        uint64_t frame = event.concurrency.lock_id;
+        if (event.concurrency.type == EventType::CoroSuspend) {
+            uint32_t tag = event.concurrency_arg();
+            ++awaiters_[tag].suspends;
+            suspended_[frame] = {event.timestamp_ns, event.thread_id, tag};
+        } else if (event.concurrency.type == EventType::CoroResume) {
+            auto it = suspended_.find(frame);
+            if (it == suspended_.end()) {
+                return;
+            }
+            const Suspension& s = it->second;
+            AwaiterStats& stats = awaiters_[s.tag];
+            stats.resume_ns.record(event.timestamp_ns > s.ts ? event.timestamp_ns - s.ts : 0);
+            stats.migrations += event.thread_id != s.thread_id;
+            suspended_.erase(it);
+        }
+    }
+
+    // Awaiter tag (a string ID unless given explicitly) -> stats
+    const std::unordered_map<uint32_t, AwaiterStats>& awaiters() const {
+        return awaiters_;
+    }
+
+    // Coroutines still suspended at the end of the trace
+    size_t open_count() const {
+        return suspended_.size();
+    }
+
+private:
+    struct Suspension {
+        timestamp_t ts;
+        thread_id_t thread_id;
+        uint32_t tag;
+    };
+
+    std::unordered_map<uint32_t, AwaiterStats> awaiters_;
+    std::unordered_map<uint64_t, Suspension> suspended_;
+};
+
+} // namespace ucdbg
@@ -0,0 +1,484 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <ucdbg/trace_types.hpp>
+
+namespace ucdbg {
+
+// What a thread on the critical path was waiting for
+enum class DependencyKind : uint8_t {
+    Lock = 0,           // Lock handoff: the holder's release
+    Condition = 1,      // Condition variable notify (object: the associated mutex)
+    Sync = 2,           // Semaphore release, latch or barrier arrival
+    Task = 3,           // TaskEnqueue -> TaskBegin
+    Flow = 4            // FlowBegin/FlowStep -> FlowStep/FlowEnd
+};
+
+inline const char* dependency_kind_to_string(DependencyKind kind) {
+    switch (kind) {
+        case DependencyKind::Lock: return "lock";
+        case DependencyKind::Condition: return "cond";
+        case DependencyKind::Sync: return "sync";
+        case DependencyKind::Task: return "task";
+        case DependencyKind::Flow: return "flow";
+    }
+    return "unknown";
+}
+
+struct CriticalPathSegment {
+    enum class Kind : uint8_t {
+        Running = 0,    // The thread was doing the work
+        Blocked = 1,    // Waiting, and nothing traced woke it (timeout, untraced waker)
+        Wakeup = 2      // Woken by another thread at begin, running again at end
+    };
+
+    thread_id_t thread_id = 0;
+    timestamp_t begin = 0;
+    timestamp_t end = 0;
+    Kind kind = Kind::Running;
+    DependencyKind dependency = DependencyKind::Lock;   // Blocked and Wakeup only
+    uint64_t object = 0;                                // lock_id, task or flow ID
+};
+
+// A wait the critical path went through, clipped to the window
+struct CriticalWait {
+    thread_id_t thread_id = 0;
+    DependencyKind dependency = DependencyKind::Lock;
+    uint64_t object = 0;
+    timestamp_t begin = 0;
+    timestamp_t end = 0;
+    bool woken = false;                 // Else the path stayed on the waiting thread
+    thread_id_t waker = 0;
+    timestamp_t woken_at = 0;
+};
+
+struct CriticalThreadStats {
+    uint64_t running_ns = 0;
+    uint64_t blocked_ns = 0;
+    uint64_t wakeup_ns = 0;
+
+    uint64_t total_ns() const {
+        return running_ns + blocked_ns + wakeup_ns;
+    }
+};
+
+struct CriticalLockStats {
+    uint64_t waits = 0;                 // Waits for the lock on the path
+    uint64_t wait_ns = 0;               // Their length (nested waits count in each lock)
+    uint64_t handoff_ns = 0;            // Release -> acquire latency on the path
+    uint64_t held_ns = 0;               // Running time on the path inside its critical sections
+};
+
+/**
+ * Critical path of one thread over [begin, end).
+ *
+ * segments partition the window in time order: each instant is charged to
+ * exactly one thread, so per-thread totals add up to end - begin.
+ */
+struct CriticalPath {
+    thread_id_t thread_id = 0;
+    timestamp_t begin = 0;
+    timestamp_t end = 0;
+    std::vector<CriticalPathSegment> segments;
+    std::vector<CriticalWait> waits;
+    std::unordered_map<thread_id_t, CriticalThreadStats> threads;
+    std::unordered_map<lock_id_t, CriticalLockStats> locks;
+};
+
+/**
+ * Cross-thread critical-path analysis.
+ *
+ * Feed events in timestamp order (BlockTraceReader::for_each_event_ordered),
+ * then query critical_path(). While events arrive, every completed wait is
+ * recorded with the thread that ended it: the holder whose release handed
+ * over a contended lock, the notifier of a condition variable wait, the
+ * last releaser or arriver of a semaphore, latch or barrier, and the
+ * enqueuing or handing-off thread of a task or flow.
+ *
+ * The query walks backward from the end of the window: the thread is
+ * charged as running until the last wait it finished; if another thread
+ * woke it, the path jumps to that thread at the wakeup, else it stays and
+ * the wait is charged as blocked. Memory grows with the waits and lock
+ * holds fed, so feed the window of interest (plus some lead-in for the
+ * waits already in progress at its start), not a whole long trace.
+ */
+class CriticalPathAnalyzer {
+public:
+    void add(const TraceEvent& event) {
+        if (!event.is_valid() || event.kind != EventKind::Concurrency) {
+            return;
+        }
+        thread_id_t tid = event.thread_id;
+        uint64_t id = event.concurrency.lock_id;
+        timestamp_t ts = event.timestamp_ns;
+        ThreadTimeline& thread = threads_[tid];
+        if (thread.events++ == 0) {
+            thread.first_ts = ts;
+        }
+        thread.last_ts = ts;
+
+        switch (event.concurrency.type) {
+            case EventType::LockContended:
+            case EventType::SharedLockContended:
+                waiting_[{tid, id, DependencyKind::Lock}] = ts;
+                break;
+            case EventType::LockAcquire:
+            case EventType::SharedLockAcquire:
+                end_wait(tid, id, DependencyKind::Lock, ts, true);
+                thread.holds.push_back({ts, UINT64_MAX, id});
+                thread.open_holds[id].push_back(thread.holds.size() - 1);
+                break;
+            case EventType::LockRelease:
+            case EventType::SharedLockRelease:
+                release(tid, id, ts);
+                break;
+            case EventType::CondWaitBegin:
+                waiting_[{tid, id, DependencyKind::Condition}] = ts;
+                break;
+            case EventType::CondWaitEnd:
+                end_wait(tid, id, DependencyKind::Condition, ts,
+                         static_cast<WakeReason>(event.concurrency_arg()) == WakeReason::Notified);
+                break;
+            case EventType::CondNotifyOne:
+            case EventType::CondNotifyAll:
+                signals_[{id, DependencyKind::Condition}] = {tid, ts};
+                break;
+            case EventType::SemaphoreContended:
+            case EventType::LatchWaitBegin:
+            case EventType::BarrierWaitBegin:
+                waiting_[{tid, id, DependencyKind::Sync}] = ts;
+                break;
+            case EventType::LatchArrive:
+            case EventType::BarrierArrive:
+                // arrive_and_wait waits from its arrival
+                waiting_[{tid, id, DependencyKind::Sync}] = ts;
+                signals_[{id, DependencyKind::Sync}] = {tid, ts};
+                break;
+            case EventType::SemaphoreRelease:
+                signals_[{id, DependencyKind::Sync}] = {tid, ts};
+                break;
+            case EventType::SemaphoreAcquire:
+            case EventType::LatchWaitEnd:
+            case EventType::BarrierWaitEnd:
+                end_wait(tid, id, DependencyKind::Sync, ts, true);
+                break;
+            case EventType::TaskEnqueue:
+                signals_[{id, DependencyKind::Task}] = {tid, ts};
+                break;
+            case EventType::TaskBegin:
+                arrive(tid, id, DependencyKind::Task, ts);
+                break;
+            case EventType::FlowBegin:
+                signals_[{id, DependencyKind::Flow}] = {tid, ts};
+                break;
+            case EventType::FlowStep:
+                arrive(tid, id, DependencyKind::Flow, ts);
+                signals_[{id, DependencyKind::Flow}] = {tid, ts};
+                break;
+            case EventType::FlowEnd:
+                arrive(tid, id, DependencyKind::Flow, ts);
+                break;
+            default:
+                break;
+        }
+    }
+
+    /**
+     * Critical path ending at the end of thread_id's window [begin, end).
+     * Time before a thread's first event counts as running.
+     */
+    CriticalPath critical_path(thread_id_t thread_id, timestamp_t begin, timestamp_t end) const {
+        CriticalPath path;
+        path.thread_id = thread_id;
+        path.begin = begin;
+        path.end = end;
+
+        thread_id_t current = thread_id;
+        timestamp_t t = end;
+        size_t next = waits_before(current, t);
+        while (t > begin) {
+            const Wait* wait = nullptr;
+            const ThreadTimeline* thread = find(current);
+            while (thread && next > 0) {
+                const Wait& candidate = thread->waits[--next];
+                if (candidate.end <= begin) {
+                    break;
+                }
+                if (candidate.end <= t) {
+                    wait = &candidate;
+                    break;
+                }
+            }
+            if (!wait) {
+                add_segment(path, {current, begin, t, CriticalPathSegment::Kind::Running});
+                break;
+            }
+            add_segment(path, {current, std::max(wait->end, begin), t, CriticalPathSegment::Kind::Running});
+            path.waits.push_back({current, wait->kind, wait->object, std::max(wait->begin, begin), wait->end,
+                                  wait->woken, wait->waker, wait->woken_at});
+            if (wait->woken) {
+                add_segment(path, {current, std::max(wait->woken_at, begin), wait->end,
+                                   CriticalPathSegment::Kind::Wakeup, wait->kind, wait->object});
+                current = wait->waker;
+                t = wait->woken_at;
+                next = waits_before(current, t);
+            } else {
+                add_segment(path, {current, std::max(wait->begin, begin), wait->end,
+                                   CriticalPathSegment::Kind::Blocked, wait->kind, wait->object});
+                t = wait->begin;
+            }
+        }
+        std::reverse(path.segments.begin(), path.segments.end());
+        std::reverse(path.waits.begin(), path.waits.end());
+        attribute(path);
+        return path;
+    }
+
+    // Over the thread's whole traced lifetime
+    CriticalPath critical_path(thread_id_t thread_id) const {
+        timestamp_t first = 0, last = 0;
+        return thread_span(thread_id, first, last) ? critical_path(thread_id, first, last + 1)
+                                                   : critical_path(thread_id, 0, 0);
+    }
+
+    // Timestamps of the thread's first and last concurrency event; false if it has none
+    bool thread_span(thread_id_t thread_id, timestamp_t& first, timestamp_t& last) const {
+        const ThreadTimeline* thread = find(thread_id);
+        if (!thread) {
+            return false;
+        }
+        first = thread->first_ts;
+        last = thread->last_ts;
+        return true;
+    }
+
+private:
+    struct Wait {
+        timestamp_t begin;
+        timestamp_t end;
+        DependencyKind kind;
+        bool woken;
+        uint64_t object;
+        thread_id_t waker;
+        timestamp_t woken_at;
+    };
+
+    struct Hold {
+        timestamp_t begin;
+        timestamp_t end;                // UINT64_MAX while held
+        lock_id_t lock_id;
+    };
+
+    struct ThreadTimeline {
+        uint64_t events = 0;
+        timestamp_t first_ts = 0;
+        timestamp_t last_ts = 0;
+        std::vector<Wait> waits;        // Ordered by end (events arrive in order)
+        std::vector<Hold> holds;        // Ordered by begin
+        std::unordered_map<lock_id_t, std::vector<size_t>> open_holds;
+    };
+
+    struct WaitKey {
+        thread_id_t thread_id;
+        uint64_t object;
+        DependencyKind kind;
+
+        bool operator==(const WaitKey& other) const {
+            return thread_id == other.thread_id && object == other.object && kind == other.kind;
+        }
+    };
+
+    struct WaitKeyHash {
+        size_t operator()(const WaitKey& key) const {
+            uint64_t h = key.thread_id * 0x9E3779B97F4A7C15ull ^ key.object * 0xC2B2AE3D27D4EB4Full ^
+                         static_cast<uint64_t>(key.kind);
+            return static_cast<size_t>(h ^ (h >> 31));
+        }
+    };
+
+    using SignalKey = std::pair<uint64_t, DependencyKind>;
+
+    struct SignalKeyHash {
+        size_t operator()(const SignalKey& key) const {
+            uint64_t h = key.first * 0x9E3779B97F4A7C15ull ^ static_cast<uint64_t>(key.second);
+            return static_cast<size_t>(h ^ (h >> 31));
+        }
+    };
+
+    // Latest release, notify, arrival or flow source of an object
+    struct Signal {
+        thread_id_t thread_id;
+        timestamp_t ts;
+    };
+
+    // Waiter whose lock handoff has not been seen yet
+    struct PendingHandoff {
+        thread_id_t thread_id;
+        size_t wait;
+    };
+
+    const ThreadTimeline* find(thread_id_t thread_id) const {
+        auto it = threads_.find(thread_id);
+        return it == threads_.end() ? nullptr : &it->second;
+    }
+
+    // Number of the thread's waits that ended before t
+    size_t waits_before(thread_id_t thread_id, timestamp_t t) const {
+        const ThreadTimeline* thread = find(thread_id);
+        if (!thread) {
+            return 0;
+        }
+        return static_cast<size_t>(std::partition_point(thread->waits.begin(), thread->waits.end(),
+                                                        [t](const Wait& w) { return w.end < t; }) -
+                                   thread->waits.begin());
+    }
+
+    /**
+     * Records the wait of tid on object ending at ts, if it was seen
+     * starting. Its waker is the latest signal from another thread since the
+     * wait began; a lock's holder may record its release only after the
+     * waiter's acquire, so a lock wait without one is settled by the next
+     * release from another thread (see release()).
+     */
+    void end_wait(thread_id_t tid, uint64_t object, DependencyKind kind, timestamp_t ts, bool wakeable) {
+        auto it = waiting_.find({tid, object, kind});
+        if (it == waiting_.end()) {
+            return;
+        }
+        Wait wait{it->second, ts, kind, false, object, 0, 0};
+        waiting_.erase(it);
+        auto signal = signals_.find({object, kind});
+        if (wakeable && signal != signals_.end() && signal->second.thread_id != tid &&
+            signal->second.ts >= wait.begin) {
+            wait.woken = true;
+            wait.waker = signal->second.thread_id;
+            wait.woken_at = signal->second.ts;
+        }
+        std::vector<Wait>& waits = threads_[tid].waits;
+        waits.push_back(wait);
+        if (kind == DependencyKind::Lock && !wait.woken) {
+            pending_handoffs_[object].push_back({tid, waits.size() - 1});
+        }
+    }
+
+    // A task or flow reaching tid: a dependency on its latest source thread
+    void arrive(thread_id_t tid, uint64_t object, DependencyKind kind, timestamp_t ts) {
+        auto signal = signals_.find({object, kind});
+        if (signal != signals_.end() && signal->second.thread_id != tid) {
+            threads_[tid].waits.push_back(
+                {signal->second.ts, ts, kind, true, object, signal->second.thread_id, signal->second.ts});
+        }
+    }
+
+    void release(thread_id_t tid, lock_id_t lock_id, timestamp_t ts) {
+        ThreadTimeline& thread = threads_[tid];
+        auto open = thread.open_holds.find(lock_id);
+        if (open != thread.open_holds.end()) {
+            thread.holds[open->second.back()].end = ts;
+            open->second.pop_back();
+            if (open->second.empty()) {
+                thread.open_holds.erase(open);
+            }
+        }
+        signals_[{lock_id, DependencyKind::Lock}] = {tid, ts};
+
+        auto pending = pending_handoffs_.find(lock_id);
+        if (pending != pending_handoffs_.end()) {
+            // A waiter releasing first was not woken by a traced release
+            for (const PendingHandoff& handoff : pending->second) {
+                Wait& wait = threads_[handoff.thread_id].waits[handoff.wait];
+                if (handoff.thread_id != tid) {
+                    wait.woken = true;
+                    wait.waker = tid;
+                    wait.woken_at = std::min(ts, wait.end);
+                }
+            }
+            pending_handoffs_.erase(pending);
+        }
+    }
+
+    static void add_segment(CriticalPath& path, const CriticalPathSegment& segment) {
+        if (segment.begin >= segment.end) {
+            return;
+        }
+        if (!path.segments.empty()) {
+            // Built backward: merge with the running segment that follows
+            CriticalPathSegment& later = path.segments.back();
+            if (later.thread_id == segment.thread_id && later.kind == CriticalPathSegment::Kind::Running &&
+                segment.kind == CriticalPathSegment::Kind::Running && later.begin == segment.end) {
+                later.begin = segment.begin;
+                return;
+            }
+        }
+        path.segments.push_back(segment);
+    }
+
+    void attribute(CriticalPath& path) const {
+        std::unordered_map<thread_id_t, std::vector<timestamp_t>> max_ends;
+        for (const CriticalPathSegment& segment : path.segments) {
+            uint64_t length = segment.end - segment.begin;
+            CriticalThreadStats& thread = path.threads[segment.thread_id];
+            switch (segment.kind) {
+                case CriticalPathSegment::Kind::Running:
+                    thread.running_ns += length;
+                    attribute_holds(path, segment, max_ends);
+                    break;
+                case CriticalPathSegment::Kind::Blocked:
+                    thread.blocked_ns += length;
+                    break;
+                case CriticalPathSegment::Kind::Wakeup:
+                    thread.wakeup_ns += length;
+                    if (segment.dependency == DependencyKind::Lock) {
+                        path.locks[segment.object].handoff_ns += length;
+                    }
+                    break;
+            }
+        }
+        for (const CriticalWait& wait : path.waits) {
+            if (wait.dependency == DependencyKind::Lock) {
+                CriticalLockStats& lock = path.locks[wait.object];
+                ++lock.waits;
+                lock.wait_ns += wait.end - wait.begin;
+            }
+        }
+    }
+
+    // Charges a running segment to the locks its thread held meanwhile
+    void attribute_holds(CriticalPath& path, const CriticalPathSegment& segment,
+                         std::unordered_map<thread_id_t, std::vector<timestamp_t>>& max_ends) const {
+        const ThreadTimeline* thread = find(segment.thread_id);
+        if (!thread || thread->holds.empty()) {
+            return;
+        }
+        // Running maximum of hold ends: holds before i ending after t are all found walking back from i
+        auto [it, inserted] = max_ends.try_emplace(segment.thread_id);
+        std::vector<timestamp_t>& max_end = it->second;
+        if (inserted) {
+            max_end.reserve(thread->holds.size());
+            for (const Hold& hold : thread->holds) {
+                max_end.push_back(max_end.empty() ? hold.end : std::max(max_end.back(), hold.end));
+            }
+        }
+        size_t i = static_cast<size_t>(std::partition_point(thread->holds.begin(), thread->holds.end(),
+                                                            [&](const Hold& h) { return h.begin < segment.end; }) -
+                                       thread->holds.begin());
+        while (i > 0 && max_end[i - 1] > segment.begin) {
+            const Hold& hold = thread->holds[--i];
+            if (hold.end > segment.begin) {
+                path.locks[hold.lock_id].held_ns +=
+                    std::min(hold.end, segment.end) - std::max(hold.begin, segment.begin);
+            }
+        }
+    }
+
+    std::unordered_map<thread_id_t, ThreadTimeline> threads_;
+    std::unordered_map<WaitKey, timestamp_t, WaitKeyHash> waiting_;
+    std::unordered_map<SignalKey, Signal, SignalKeyHash> signals_;
+    std::unordered_map<lock_id_t, std::vector<PendingHandoff>> pending_handoffs_;
+};
+
+} // namespace ucdbg
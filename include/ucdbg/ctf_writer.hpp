@@ -0,0 +1,376 @@
+#pragma once
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <ucdbg/trace_types.hpp>
+
+namespace ucdbg {
+
+// Stream files are CTF packets: header, context, then events
+constexpr uint32_t CTF_MAGIC = 0xC1FC1FC1;
+
+#pragma pack(push, 1)
+struct CtfPacketHeader {
+    uint32_t magic;             // CTF_MAGIC
+    uint8_t uuid[16];           // Matches the metadata's trace uuid
+    uint32_t stream_id;         // Always 0: one stream class
+};
+
+struct CtfPacketContext {
+    uint64_t timestamp_begin;
+    uint64_t timestamp_end;
+    uint64_t content_size;      // Bits, header included
+    uint64_t packet_size;       // Bits; equal to content_size (no padding)
+    uint64_t thread_id;
+};
+
+// Event header; the payload that follows is bytes 20-31 of the TraceEvent
+struct CtfEventHeader {
+    uint8_t id;                 // EventKind
+    uint64_t timestamp;
+    uint16_t lock_class;        // TraceEvent bytes 18-19: lock class of lock events, else reserved
+};
+#pragma pack(pop)
+
+constexpr size_t CTF_PAYLOAD_OFFSET = offsetof(TraceEvent, concurrency);
+constexpr size_t CTF_PAYLOAD_SIZE = sizeof(TraceEvent) - CTF_PAYLOAD_OFFSET;
+constexpr size_t CTF_EVENT_SIZE = sizeof(CtfEventHeader) + CTF_PAYLOAD_SIZE;
+
+// The metadata describes payloads with these offsets; keep them in sync with TraceEvent
+static_assert(CTF_PAYLOAD_OFFSET == 20 && CTF_PAYLOAD_SIZE == 12, "CTF payload is TraceEvent bytes 20-31");
+static_assert(offsetof(TraceEvent, reserved) == 18 && sizeof(TraceEvent::reserved) == 2, "lock class");
+static_assert(offsetof(CtfEventHeader, lock_class) == 9 && sizeof(CtfEventHeader) == 11, "event header");
+static_assert(offsetof(TraceEvent, concurrency.lock_id) - CTF_PAYLOAD_OFFSET == 4, "concurrency lock_id");
+static_assert(offsetof(TraceEvent, log.message_string_id) - CTF_PAYLOAD_OFFSET == 4, "log message id");
+static_assert(offsetof(TraceEvent, span.name_id) - CTF_PAYLOAD_OFFSET == 4, "span name id");
+static_assert(offsetof(TraceEvent, counter.value) - CTF_PAYLOAD_OFFSET == 4, "counter value");
+
+/**
+ * Writes a Common Trace Format 1.8 trace: a directory holding a TSDL
+ * `metadata` file and one binary stream file per thread (`stream_<tid>`),
+ * readable by babeltrace and other CTF tools.
+ *
+ * Events are buffered per thread and written as CTF packets of up to
+ * packet_bytes. Each event is an 11-byte header (event class id = EventKind,
+ * 64-bit timestamp on the monotonic clock, 16-bit lock class) followed by
+ * the 12 payload bytes of its TraceEvent, copied unchanged; the metadata,
+ * generated from the TraceEvent layout and the EventType names, describes
+ * them field by field. Thread names and the string table go into the metadata's env
+ * block (thread_name_<tid>, string_<id>), written again at close.
+ *
+ * Stream files are opened only while a packet is flushed, so the number of
+ * threads is not limited by the file descriptor limit. Not thread-safe:
+ * intended to be driven by the tracer's single drain thread, like
+ * BlockTraceWriter.
+ */
+class CtfTraceWriter {
+public:
+    static constexpr size_t DEFAULT_PACKET_BYTES = 64 * 1024;
+
+    explicit CtfTraceWriter(size_t packet_bytes = DEFAULT_PACKET_BYTES)
+        : packet_bytes_(packet_bytes > PACKET_OVERHEAD + CTF_EVENT_SIZE ? packet_bytes : DEFAULT_PACKET_BYTES) {}
+
+    ~CtfTraceWriter() {
+        close();
+    }
+
+    CtfTraceWriter(const CtfTraceWriter&) = delete;
+    CtfTraceWriter& operator=(const CtfTraceWriter&) = delete;
+
+    // Creates the trace directory (if needed) and its metadata; stream files of an earlier trace are removed
+    bool open(const char* directory) {
+        if (open_) {
+            return false;
+        }
+        if (::mkdir(directory, 0755) != 0 && errno != EEXIST) {
+            return false;
+        }
+        directory_ = directory;
+        remove_streams();
+        std::random_device random;
+        for (uint8_t& byte : uuid_) {
+            byte = static_cast<uint8_t>(random());
+        }
+        streams_.clear();
+        thread_names_.clear();
+        strings_.clear();
+        failed_ = false;
+        open_ = true;
+        if (!write_metadata()) {
+            open_ = false;
+            return false;
+        }
+        return true;
+    }
+
+    bool is_open() const {
+        return open_;
+    }
+
+    void append(const TraceEvent& event) {
+        Stream& stream = streams_[event.thread_id];
+        if (stream.events.empty()) {
+            stream.timestamp_begin = event.timestamp_ns;
+            stream.events.reserve(packet_bytes_ - PACKET_OVERHEAD);
+        }
+        CtfEventHeader header{static_cast<uint8_t>(event.kind), event.timestamp_ns, event.lock_class()};
+        const auto* raw = reinterpret_cast<const uint8_t*>(&event);
+        stream.events.insert(stream.events.end(), reinterpret_cast<const uint8_t*>(&header),
+                             reinterpret_cast<const uint8_t*>(&header) + sizeof(header));
+        stream.events.insert(stream.events.end(), raw + CTF_PAYLOAD_OFFSET, raw + sizeof(TraceEvent));
+        stream.timestamp_end = event.timestamp_ns;
+        if (PACKET_OVERHEAD + stream.events.size() + CTF_EVENT_SIZE > packet_bytes_) {
+            write_packet(event.thread_id, stream);
+        }
+    }
+
+    void append(const TraceEvent* events, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            append(events[i]);
+        }
+    }
+
+    void set_thread_name(thread_id_t thread_id, std::string name) {
+        thread_names_[thread_id] = std::move(name);
+    }
+
+    // Span/counter/log names, indexed by string_id_t
+    void set_strings(std::vector<std::string> strings) {
+        strings_ = std::move(strings);
+    }
+
+    // Writes every thread's buffered events as a packet
+    void flush() {
+        for (auto& [thread_id, stream] : streams_) {
+            write_packet(thread_id, stream);
+        }
+    }
+
+    // Flushes and rewrites the metadata with thread names and strings; false if any write failed
+    bool close() {
+        if (!open_) {
+            return false;
+        }
+        flush();
+        bool ok = write_metadata() && !failed_;
+        open_ = false;
+        streams_.clear();
+        return ok;
+    }
+
+    // Forget the trace without writing buffered packets or metadata (forked child)
+    void abandon() {
+        open_ = false;
+    }
+
+    /**
+     * TSDL metadata for the stream layout written by this class. uuid is
+     * the trace uuid; env entries are appended verbatim as key = "value".
+     */
+    static std::string metadata(const uint8_t (&uuid)[16],
+                                const std::vector<std::pair<std::string, std::string>>& env = {}) {
+        std::string uuid_text = format_uuid(uuid);
+        std::string m;
+        m += "/* CTF 1.8 */\n\n";
+        m += "typealias integer { size = 8; align = 8; signed = false; } := uint8_t;\n";
+        m += "typealias integer { size = 16; align = 8; signed = false; } := uint16_t;\n";
+        m += "typealias integer { size = 24; align = 8; signed = false; } := uint24_t;\n";
+        m += "typealias integer { size = 32; align = 8; signed = false; } := uint32_t;\n";
+        m += "typealias integer { size = 64; align = 8; signed = false; } := uint64_t;\n";
+        m += "typealias integer { size = 64; align = 8; signed = true; } := int64_t;\n";
+        m += "typealias integer { size = 64; align = 8; signed = false; map = clock.monotonic.value; }"
+             " := uint64_clock_monotonic_t;\n\n";
+
+        m += "trace {\n";
+        m += "    major = 1;\n    minor = 8;\n";
+        m += "    uuid = \"" + uuid_text + "\";\n";
+        m += "    byte_order = le;\n";
+        m += "    packet.header := struct {\n";
+        m += "        uint32_t magic;\n        uint8_t uuid[16];\n        uint32_t stream_id;\n";
+        m += "    };\n};\n\n";
+
+        m += "env {\n    domain = \"ucdbg\";\n    tracer_name = \"ucdbg\";\n";
+        for (const auto& [key, value] : env) {
+            m += "    " + key + " = " + quote(value) + ";\n";
+        }
+        m += "};\n\n";
+
+        m += "clock {\n    name = monotonic;\n    uuid = \"" + uuid_text + "\";\n";
+        m += "    description = \"std::chrono::steady_clock\";\n";
+        m += "    freq = 1000000000;\n    offset = 0;\n};\n\n";
+
+        m += "stream {\n    id = 0;\n";
+        m += "    event.header := struct {\n";
+        m += "        uint8_t id;\n        uint64_clock_monotonic_t timestamp;\n        uint16_t lock_class;\n    };\n";
+        m += "    packet.context := struct {\n";
+        m += "        uint64_clock_monotonic_t timestamp_begin;\n";
+        m += "        uint64_clock_monotonic_t timestamp_end;\n";
+        m += "        uint64_t content_size;\n        uint64_t packet_size;\n        uint64_t thread_id;\n";
+        m += "    };\n};\n\n";
+
+        m += "enum event_type : uint8_t {\n";
+        for (size_t type = 0; type < EVENT_TYPE_COUNT; ++type) {
+            m += "    " + event_type_to_string(static_cast<EventType>(type)) + " = " + std::to_string(type) +
+                 (type + 1 < EVENT_TYPE_COUNT ? ",\n" : "\n");
+        }
+        m += "};\n\n";
+        m += "enum log_level : uint8_t { Trace = 0, Debug = 1, Info = 2, Warning = 3, Error = 4, Fatal = 5 };\n";
+        m += "enum span_phase : uint8_t { Begin = 0, End = 1 };\n\n";
+
+        // Fields mirror TraceEvent bytes 20-31 (see the static_asserts above)
+        m += event_class("concurrency", EventKind::Concurrency,
+                         "        enum event_type type;\n"
+                         "        uint24_t arg;\n"
+                         "        uint64_t lock_id;\n");
+        m += event_class("log", EventKind::Log,
+                         "        enum log_level level;\n"
+                         "        uint8_t reserved[3];\n"
+                         "        uint32_t message_string_id;\n"
+                         "        uint32_t reserved2;\n");
+        m += event_class("span", EventKind::Span,
+                         "        enum span_phase phase;\n"
+                         "        uint8_t reserved[3];\n"
+                         "        uint32_t name_id;\n"
+                         "        uint32_t reserved2;\n");
+        m += event_class("counter", EventKind::Counter,
+                         "        uint32_t name_id;\n"
+                         "        int64_t value;\n");
+        return m;
+    }
+
+private:
+    static constexpr size_t PACKET_OVERHEAD = sizeof(CtfPacketHeader) + sizeof(CtfPacketContext);
+
+    struct Stream {
+        std::vector<uint8_t> events;
+        timestamp_t timestamp_begin = 0;
+        timestamp_t timestamp_end = 0;
+    };
+
+    static std::string event_class(const char* name, EventKind kind, const char* fields) {
+        return std::string("event {\n    name = \"") + name + "\";\n    id = " +
+               std::to_string(static_cast<unsigned>(kind)) + ";\n    stream_id = 0;\n" +
+               "    fields := struct {\n" + fields + "    };\n};\n\n";
+    }
+
+    static std::string format_uuid(const uint8_t (&uuid)[16]) {
+        char text[40];
+        std::snprintf(text, sizeof(text),
+                      "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+                      uuid[0], uuid[1], uuid[2], uuid[3], uuid[4], uuid[5], uuid[6], uuid[7],
+                      uuid[8], uuid[9], uuid[10], uuid[11], uuid[12], uuid[13], uuid[14], uuid[15]);
+        return text;
+    }
+
+    static std::string quote(const std::string& value) {
+        std::string out = "\"";
+        for (char c : value) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                out += ' ';
+            } else {
+                out += c;
+            }
+        }
+        return out + "\"";
+    }
+
+    // Stream files left by a previous trace would carry a different uuid
+    void remove_streams() {
+        DIR* dir = ::opendir(directory_.c_str());
+        if (!dir) {
+            return;
+        }
+        while (dirent* entry = ::readdir(dir)) {
+            if (std::strncmp(entry->d_name, "stream_", 7) == 0) {
+                ::unlinkat(::dirfd(dir), entry->d_name, 0);
+            }
+        }
+        ::closedir(dir);
+    }
+
+    bool write_metadata() {
+        std::vector<std::pair<std::string, std::string>> env;
+        for (const auto& [thread_id, name] : thread_names_) {
+            env.emplace_back("thread_name_" + std::to_string(thread_id), name);
+        }
+        for (size_t id = 0; id < strings_.size(); ++id) {
+            env.emplace_back("string_" + std::to_string(id), strings_[id]);
+        }
+        std::string text = metadata(uuid_, env);
+        std::string path = directory_ + "/metadata";
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            return false;
+        }
+        bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+        return std::fclose(file) == 0 && ok;
+    }
+
+    void write_packet(thread_id_t thread_id, Stream& stream) {
+        if (stream.events.empty()) {
+            return;
+        }
+        CtfPacketHeader header{};
+        header.magic = CTF_MAGIC;
+        std::memcpy(header.uuid, uuid_, sizeof(uuid_));
+        header.stream_id = 0;
+        CtfPacketContext context{};
+        context.timestamp_begin = stream.timestamp_begin;
+        context.timestamp_end = stream.timestamp_end;
+        context.content_size = (PACKET_OVERHEAD + stream.events.size()) * 8;
+        context.packet_size = context.content_size;
+        context.thread_id = thread_id;
+
+        std::string path = directory_ + "/stream_" + std::to_string(thread_id);
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            failed_ = true;
+        } else {
+            failed_ |= !write_all(fd, &header, sizeof(header)) || !write_all(fd, &context, sizeof(context)) ||
+                       !write_all(fd, stream.events.data(), stream.events.size());
+            failed_ |= ::close(fd) != 0;
+        }
+        stream.events.clear();
+    }
+
+    static bool write_all(int fd, const void* data, size_t size) {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        while (size > 0) {
+            ssize_t n = ::write(fd, bytes, size);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            bytes += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    size_t packet_bytes_;
+    bool open_ = false;
+    bool failed_ = false;
+    std::string directory_;
+    uint8_t uuid_[16] = {};
+    std::unordered_map<thread_id_t, Stream> streams_;
+    std::unordered_map<thread_id_t, std::string> thread_names_;
+    std::vector<std::string> strings_;
+};
+
+} // namespace ucdbg
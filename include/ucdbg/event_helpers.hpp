@@ -2,6 +2,7 @@
 
 #include <ucdbg/trace_types.hpp>
 #include <ucdbg/fast_timestamp.hpp>
+#include <atomic>
 #include <cstring>
 
 namespace ucdbg {
@@ -11,7 +12,18 @@ namespace ucdbg {
 namespace ucdbg {
 namespace internal {
 
-    inline TraceEvent make_concurrency_event(EventType type, lock_id_t lock_id = 0) {
+    /**
+     * Process-unique ordinal of the calling thread, assigned on first use
+     * and starting at 1. Unlike the kernel thread ID it is never reused
+     * after the thread exits, so IDs built from it stay unique.
+     */
+    inline uint64_t thread_ordinal() {
+        static std::atomic<uint64_t> next{1};
+        static thread_local uint64_t ordinal = next.fetch_add(1, std::memory_order_relaxed);
+        return ordinal;
+    }
+
+    inline TraceEvent make_concurrency_event(EventType type, lock_id_t lock_id = 0, uint32_t arg = 0) {
         TraceEvent event;
         event.timestamp_ns = FastTimestamp::now_ns();
         event.thread_id = get_thread_id();
@@ -21,7 +33,7 @@ namespace internal {
         event.reserved[1] = 0;
         event.concurrency.type = type;
         event.concurrency.lock_id = lock_id;
-        std::memset(event.concurrency.reserved, 0, 3);
+        event.set_concurrency_arg(arg);
         return event;
     }
 
@@ -41,5 +53,33 @@ namespace internal {
         return event;
     }
 
+    inline TraceEvent make_span_event(SpanPhase phase, string_id_t name_id) {
+        TraceEvent event;
+        event.timestamp_ns = FastTimestamp::now_ns();
+        event.thread_id = get_thread_id();
+        event.format_version = TRACE_FORMAT_VERSION;
+        event.kind = EventKind::Span;
+        event.reserved[0] = 0;
+        event.reserved[1] = 0;
+        event.span.phase = phase;
+        std::memset(event.span.reserved, 0, 3);
+        event.span.name_id = name_id;
+        event.span.reserved2 = 0;
+        return event;
+    }
+
+    inline TraceEvent make_counter_event(string_id_t name_id, int64_t value) {
+        TraceEvent event;
+        event.timestamp_ns = FastTimestamp::now_ns();
+        event.thread_id = get_thread_id();
+        event.format_version = TRACE_FORMAT_VERSION;
+        event.kind = EventKind::Counter;
+        event.reserved[0] = 0;
+        event.reserved[1] = 0;
+        event.counter.name_id = name_id;
+        event.counter.value = value;
+        return event;
+    }
+
 } // namespace internal
 } // namespace ucdbg
\ No newline at end of file
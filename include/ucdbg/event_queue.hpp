@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <ucdbg/trace_types.hpp>
+#include <ucdbg/event_helpers.hpp>
+#include <ucdbg/concurrentqueue.h>
+
+namespace ucdbg {
+namespace internal {
+
+using EventQueue = moodycamel::ConcurrentQueue<TraceEvent>;
+
+/**
+ * Process-wide event queue shared by all guards.
+ *
+ * Each producing thread enqueues through its own ProducerToken, which gives
+ * it a private sub-queue inside the MPMC queue (per-thread buffer). The
+ * tracer's drain thread is the only consumer.
+ */
+inline EventQueue& event_queue() {
+    static EventQueue queue;
+    return queue;
+}
+
+// Set while the tracer is initialized; guards drop events otherwise
+inline std::atomic<bool> tracing_active{false};
+
+// Set by ucdbg::set_auto_thread_events(); see ThreadRegistration
+inline std::atomic<bool> auto_thread_events{false};
+
+// True once this thread's ThreadStart has been emitted (automatically or by ThreadGuard)
+inline thread_local bool thread_registered = false;
+
+// The calling thread's producer token
+inline moodycamel::ProducerToken& producer_token() {
+    static thread_local moodycamel::ProducerToken token(event_queue());
+    return token;
+}
+
+/**
+ * Automatic thread lifecycle: created by the first event a thread emits
+ * while auto_thread_events is set, it emits ThreadStart ahead of that event
+ * and ThreadEnd when the thread exits. It is destroyed before the thread's
+ * producer token, whose destruction hands the token's sub-queue back to the
+ * queue for reuse by later threads once the drain thread has emptied it.
+ * Nothing needs flushing at exit: an enqueue through the token is visible
+ * to the drain thread as soon as it returns, and the sub-queue keeps its
+ * events after the token is gone.
+ */
+class ThreadRegistration {
+public:
+    static void ensure() {
+        if (!thread_registered) {
+            static thread_local ThreadRegistration registration;
+        }
+    }
+
+    ThreadRegistration() {
+        thread_registered = true;
+        event_queue().enqueue(producer_token(), make_concurrency_event(EventType::ThreadStart));
+    }
+
+    ~ThreadRegistration() {
+        if (tracing_active.load(std::memory_order_relaxed)) {
+            event_queue().enqueue(producer_token(), make_concurrency_event(EventType::ThreadEnd));
+        }
+    }
+
+    ThreadRegistration(const ThreadRegistration&) = delete;
+    ThreadRegistration& operator=(const ThreadRegistration&) = delete;
+};
+
+/**
+ * Sets up the calling thread's emit state (producer token, automatic
+ * registration). Thread-locals that emit from their destructor call this in
+ * their constructor, so that state is destroyed after them.
+ */
+inline void prepare_thread() {
+    producer_token();
+    if (auto_thread_events.load(std::memory_order_relaxed) && tracing_active.load(std::memory_order_relaxed)) {
+        ThreadRegistration::ensure();
+    }
+}
+
+inline void emit(const TraceEvent& event) {
+    if (!tracing_active.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (!thread_registered && auto_thread_events.load(std::memory_order_relaxed)) {
+        ThreadRegistration::ensure();
+    }
+    event_queue().enqueue(producer_token(), event);
+}
+
+} // namespace internal
+} // namespace ucdbg
@@ -9,33 +9,24 @@ namespace internal {
 /**
  * Fast timestamp for hot paths (lock acquire/release, etc.)
  *
+ * steady_clock (CLOCK_MONOTONIC through the vDSO, no system call) read on
+ * every call, so hold and wait times computed from event pairs are real
+ * durations. Timestamps are strictly increasing per thread: two events of
+ * a thread never share a timestamp, which keeps per-thread order
+ * recoverable after a merge.
  */
 class FastTimestamp {
 public:
 
     static uint64_t now_ns() {
-        static thread_local uint64_t cached = 0;
-        static thread_local std::chrono::steady_clock::time_point last_update;
-        static thread_local uint32_t micro_seq = 0;
-        
-        auto now = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
-            now - last_update).count();
-        
-        // Update cache every 100μs (100,000 ns) or on first call
-        if (elapsed > 100'000 || cached == 0) {
-            cached = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                now.time_since_epoch()
-            ).count();
-            last_update = now;
-            micro_seq = 0;
-        }
-        
-        // Add micro-sequence for ordering within same cache period
-        return cached + (++micro_seq & 0xFFFF);
+        static thread_local uint64_t last = 0;
+
+        uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+        last = now > last ? now : last + 1;
+        return last;
     }
 };
 
 } // namespace internal
 } // namespace ucdbg
-
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <ucdbg/event_helpers.hpp>
+#include <ucdbg/event_queue.hpp>
+
+namespace ucdbg {
+
+using flow_id_t = uint64_t;
+
+namespace internal {
+
+// Bits of a flow ID holding the creating thread's sequence number
+constexpr unsigned FLOW_SEQUENCE_BITS = 40;
+
+// New flow ID, laid out like task IDs: creating thread's ordinal high, sequence low. Never 0.
+inline flow_id_t next_flow_id() {
+    static thread_local uint64_t sequence = 0;
+    return (thread_ordinal() << FLOW_SEQUENCE_BITS) | (++sequence & ((1ull << FLOW_SEQUENCE_BITS) - 1));
+}
+
+} // namespace internal
+
+/**
+ * Flow events link points on different threads that handle the same piece
+ * of work. All carry the flow ID in lock_id and an optional tag (24 bits)
+ * in arg; a timeline draws an arrow between consecutive events of a flow,
+ * and FlowEnd minus FlowBegin is the end-to-end latency of the work.
+ *
+ *   flow_begin()  FlowBegin: work is created (e.g. a request arrives)
+ *   flow_step()   FlowStep: work is handed off or picked up by a thread
+ *   flow_end()    FlowEnd: work is complete
+ */
+inline flow_id_t flow_begin(uint32_t tag = 0) {
+    flow_id_t id = internal::next_flow_id();
+    internal::emit(internal::make_concurrency_event(EventType::FlowBegin, id, tag));
+    return id;
+}
+
+inline void flow_step(flow_id_t id, uint32_t tag = 0) {
+    internal::emit(internal::make_concurrency_event(EventType::FlowStep, id, tag));
+}
+
+inline void flow_end(flow_id_t id, uint32_t tag = 0) {
+    internal::emit(internal::make_concurrency_event(EventType::FlowEnd, id, tag));
+}
+
+/**
+ * A queued item carrying its flow. Constructing one marks the send point on
+ * the producer thread: FlowBegin for a new flow, or FlowStep when it
+ * continues the flow of an item received earlier. The consumer marks the
+ * receive point with receive() (FlowStep), or complete() (FlowEnd) when the
+ * work ends on that thread.
+ *
+ * Usage:
+ *   std::deque<ucdbg::Flowed<Request>> queue;
+ *   queue.push_back(ucdbg::with_flow(request));        // thread A
+ *   Request& r = queue.front().receive();              // thread B
+ *   next.push_back(ucdbg::continue_flow(std::move(r), queue.front().flow_id()));
+ *   Request& done = next.front().complete();           // thread C
+ */
+template <class T>
+class Flowed {
+public:
+    explicit Flowed(T value, uint32_t tag = 0)
+        : value_(std::move(value)), id_(flow_begin(tag)), tag_(tag) {}
+
+    Flowed(T value, flow_id_t id, uint32_t tag)
+        : value_(std::move(value)), id_(id), tag_(tag) {
+        flow_step(id_, tag_);
+    }
+
+    T& receive() {
+        flow_step(id_, tag_);
+        return value_;
+    }
+
+    T& complete() {
+        flow_end(id_, tag_);
+        return value_;
+    }
+
+    // Access without a flow event
+    T& get() {
+        return value_;
+    }
+
+    const T& get() const {
+        return value_;
+    }
+
+    flow_id_t flow_id() const {
+        return id_;
+    }
+
+    uint32_t tag() const {
+        return tag_;
+    }
+
+private:
+    T value_;
+    flow_id_t id_;
+    uint32_t tag_;
+};
+
+// Wraps value in a new flow (FlowBegin)
+template <class T>
+Flowed<std::decay_t<T>> with_flow(T&& value, uint32_t tag = 0) {
+    return Flowed<std::decay_t<T>>(std::forward<T>(value), tag);
+}
+
+// Wraps value in an existing flow (FlowStep), for the next hop of a pipeline
+template <class T>
+Flowed<std::decay_t<T>> continue_flow(T&& value, flow_id_t id, uint32_t tag = 0) {
+    return Flowed<std::decay_t<T>>(std::forward<T>(value), id, tag);
+}
+
+} // namespace ucdbg
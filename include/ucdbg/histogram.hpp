@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ucdbg {
+
+/**
+ * Log-linear latency histogram (HDR-style) over nanosecond values.
+ *
+ * Values below 2^SUB_BUCKET_BITS are counted exactly; above that, each
+ * power of two is split into 2^SUB_BUCKET_BITS equal sub-buckets, so a
+ * recorded value is known to within 1/8 (12.5%) of itself. Values of
+ * 2^MAX_EXPONENT ns (about 4.9 hours) and above share the last bucket.
+ * Fixed size (BUCKETS counters), so per-lock histograms keep memory
+ * proportional to the number of locks, whatever the event count.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 3;
+    static constexpr unsigned SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_EXPONENT = 44;
+    static constexpr size_t BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static size_t bucket_of(uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return static_cast<size_t>(value);
+        }
+        unsigned exponent = 63u - static_cast<unsigned>(__builtin_clzll(value));
+        if (exponent >= MAX_EXPONENT) {
+            return BUCKETS - 1;
+        }
+        unsigned shift = exponent - SUB_BUCKET_BITS;
+        return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + ((value >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    // Smallest value counted in bucket
+    static uint64_t bucket_low(size_t bucket) {
+        if (bucket < SUB_BUCKETS) {
+            return bucket;
+        }
+        unsigned exponent = static_cast<unsigned>(bucket / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+        uint64_t sub = bucket % SUB_BUCKETS;
+        return (SUB_BUCKETS + sub) << (exponent - SUB_BUCKET_BITS);
+    }
+
+    // Largest value counted in bucket (the last bucket is open-ended)
+    static uint64_t bucket_high(size_t bucket) {
+        return bucket + 1 < BUCKETS ? bucket_low(bucket + 1) - 1 : UINT64_MAX;
+    }
+
+    void record(uint64_t value, uint64_t count = 1) {
+        counts_[bucket_of(value)] += count;
+        total_count_ += count;
+        sum_ += value * count;
+        min_ = value < min_ ? value : min_;
+        max_ = value > max_ ? value : max_;
+    }
+
+    /**
+     * Adds count values known only by their bucket (e.g. rebuilt from
+     * summary records); they count as the bucket's upper edge, so
+     * percentiles still never under-report.
+     */
+    void record_bucket(size_t bucket, uint64_t count) {
+        record(bucket + 1 < BUCKETS ? bucket_high(bucket) : bucket_low(bucket), count);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        total_count_ += other.total_count_;
+        sum_ += other.sum_;
+        min_ = other.min_ < min_ ? other.min_ : min_;
+        max_ = other.max_ > max_ ? other.max_ : max_;
+    }
+
+    void clear() {
+        *this = LatencyHistogram();
+    }
+
+    uint64_t count() const {
+        return total_count_;
+    }
+
+    uint64_t sum() const {
+        return sum_;
+    }
+
+    uint64_t min() const {
+        return total_count_ ? min_ : 0;
+    }
+
+    uint64_t max() const {
+        return max_;
+    }
+
+    uint64_t bucket_count(size_t bucket) const {
+        return counts_[bucket];
+    }
+
+    /**
+     * Value at quantile q (0..1): the upper edge of the bucket holding the
+     * q-th value, clamped to [min(), max()]; never under-reports.
+     */
+    uint64_t percentile(double q) const {
+        if (total_count_ == 0) {
+            return 0;
+        }
+        double wanted = q * static_cast<double>(total_count_);
+        uint64_t rank = wanted <= 1.0 ? 1 : static_cast<uint64_t>(wanted + 0.999999);
+        rank = rank < total_count_ ? rank : total_count_;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += counts_[i];
+            if (seen >= rank) {
+                uint64_t value = bucket_high(i);
+                value = value < max_ ? value : max_;
+                return value > min_ ? value : min_;
+            }
+        }
+        return max_;
+    }
+
+private:
+    uint64_t counts_[BUCKETS] = {};
+    uint64_t total_count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = UINT64_MAX;
+    uint64_t max_ = 0;
+};
+
+} // namespace ucdbg
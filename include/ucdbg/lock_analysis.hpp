@@ -0,0 +1,463 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <ucdbg/histogram.hpp>
+#include <ucdbg/lock_histograms.hpp>
+#include <ucdbg/trace_types.hpp>
+
+namespace ucdbg {
+
+struct LockStats {
+    uint64_t acquisitions = 0;          // Exclusive and shared
+    uint64_t shared_acquisitions = 0;
+    uint64_t contentions = 0;           // Acquisitions that had to wait
+    uint64_t handoffs = 0;              // Exclusive acquisitions by a thread other than the previous owner
+    LatencyHistogram hold_ns;           // Acquire -> release on the same thread
+    LatencyHistogram wait_ns;           // Contended -> acquire on the same thread
+    // From in-process summary records (set_lock_histograms), kept apart from
+    // the event-derived histograms so tracing both ways never counts twice
+    LatencyHistogram summary_hold_ns;
+    LatencyHistogram summary_wait_ns;
+    std::vector<thread_id_t> threads;   // Distinct threads that acquired the lock
+    thread_id_t first_owner = 0;        // First and latest exclusive owners
+    thread_id_t last_owner = 0;
+};
+
+// (held, acquired): a thread acquired the second lock while holding the first
+using LockOrderEdge = std::pair<lock_id_t, lock_id_t>;
+
+struct LockOrderEdgeHash {
+    size_t operator()(const LockOrderEdge& edge) const {
+        uint64_t h = edge.first * 0x9E3779B97F4A7C15ull ^ edge.second * 0xC2B2AE3D27D4EB4Full;
+        return static_cast<size_t>(h ^ (h >> 31));
+    }
+};
+
+struct ThreadBlockedStats {
+    uint64_t events = 0;                // Concurrency events of the thread
+    uint64_t lock_waits = 0;
+    uint64_t lock_wait_ns = 0;
+    uint64_t cond_waits = 0;
+    uint64_t cond_wait_ns = 0;
+    uint64_t sync_waits = 0;            // Semaphore, latch and barrier waits
+    uint64_t sync_wait_ns = 0;
+    timestamp_t first_ts = 0;
+    timestamp_t last_ts = 0;
+
+    uint64_t blocked_ns() const {
+        return lock_wait_ns + cond_wait_ns + sync_wait_ns;
+    }
+};
+
+/**
+ * Single-pass lock contention analysis.
+ *
+ * Feed every event of a trace in timestamp order (BlockTraceReader::
+ * for_each_event_ordered); per-lock and per-thread statistics are updated
+ * as events arrive. Besides the statistics, only the holds and waits in
+ * progress are kept, so memory is proportional to the number of locks and
+ * threads, not to the number of events.
+ *
+ * Pairs are matched per thread: a release ends the same thread's most
+ * recent acquire of that lock (recursive locking nests), and an acquire
+ * ends the same thread's pending contention on it. Ends without a start
+ * (the trace began mid-hold) are ignored.
+ *
+ * Analyzers of consecutive time ranges can be combined with merge(), which
+ * pairs holds and waits crossing the boundary; see parallel_analysis.hpp.
+ */
+class LockAnalyzer {
+public:
+    void add(const TraceEvent& event) {
+        if (!event.is_valid() || event.kind != EventKind::Concurrency) {
+            return;
+        }
+        thread_id_t tid = event.thread_id;
+        lock_id_t id = event.concurrency.lock_id;
+        timestamp_t ts = event.timestamp_ns;
+        ++event_count_;
+        if (event.concurrency.type == EventType::LockHoldHistogram ||
+            event.concurrency.type == EventType::LockWaitHistogram) {
+            // Written by the drain thread: says nothing about that thread
+            LockStats& lock = locks_[id];
+            uint32_t arg = event.concurrency_arg();
+            (event.concurrency.type == EventType::LockWaitHistogram ? lock.summary_wait_ns : lock.summary_hold_ns)
+                .record_bucket(internal::lock_histogram_bucket(arg), internal::lock_histogram_count(arg));
+            return;
+        }
+        if (event.concurrency.type == EventType::LockClassName) {
+            lock_classes_[id] = event.concurrency_arg();
+            return;
+        }
+        ThreadBlockedStats& thread = threads_[tid];
+        if (thread.events++ == 0 || ts < thread.first_ts) {
+            thread.first_ts = ts;
+        }
+        thread.last_ts = ts > thread.last_ts ? ts : thread.last_ts;
+
+        switch (event.concurrency.type) {
+            case EventType::LockContended:
+            case EventType::SharedLockContended:
+                open_[{tid, id, Pending::LockWait}].push_back(ts);
+                break;
+            case EventType::LockAcquire:
+            case EventType::SharedLockAcquire: {
+                bool shared = event.concurrency.type == EventType::SharedLockAcquire;
+                LockStats& lock = locks_[id];
+                ++lock.acquisitions;
+                lock.shared_acquisitions += shared;
+                timestamp_t start;
+                bool waited = close({tid, id, Pending::LockWait}, start);
+                if (waited) {
+                    finish({tid, id, Pending::LockWait}, start, ts);
+                }
+                // Without a wait here, a first acquire may end a wait begun before this range
+                first_acquires_[tid].try_emplace(id, FirstAcquire{ts, waited});
+                if (!shared) {
+                    if (lock.first_owner == 0) {
+                        lock.first_owner = tid;
+                    }
+                    lock.handoffs += lock.last_owner != 0 && lock.last_owner != tid;
+                    lock.last_owner = tid;
+                }
+                if (std::find(lock.threads.begin(), lock.threads.end(), tid) == lock.threads.end()) {
+                    lock.threads.push_back(tid);
+                }
+                std::vector<lock_id_t>& held = held_[tid];
+                for (lock_id_t other : held) {
+                    if (other != id) {
+                        lock_order_.insert({other, id});
+                    }
+                }
+                held.push_back(id);
+                open_[{tid, id, shared ? Pending::SharedHold : Pending::Hold}].push_back(ts);
+                break;
+            }
+            case EventType::LockRelease:
+            case EventType::SharedLockRelease: {
+                bool shared = event.concurrency.type == EventType::SharedLockRelease;
+                end({tid, id, shared ? Pending::SharedHold : Pending::Hold}, ts);
+                break;
+            }
+            case EventType::CondWaitBegin:
+                open_[{tid, id, Pending::CondWait}].push_back(ts);
+                break;
+            case EventType::CondWaitEnd:
+                end({tid, id, Pending::CondWait}, ts);
+                break;
+            case EventType::SemaphoreContended:
+            case EventType::LatchWaitBegin:
+            case EventType::BarrierWaitBegin:
+                open_[{tid, id, Pending::SyncWait}].push_back(ts);
+                break;
+            case EventType::SemaphoreAcquire:
+            case EventType::LatchWaitEnd:
+            case EventType::BarrierWaitEnd:
+                end({tid, id, Pending::SyncWait}, ts);
+                break;
+            default:
+                break;
+        }
+    }
+
+    /**
+     * Appends the analysis of the time range that follows this one's.
+     * Holds and waits still open here are ended by later's unmatched ends
+     * (and a wait by the thread's first uncontended acquire there), and
+     * locks held across the boundary gain lock-order edges to the locks
+     * the thread acquired in later. For well-formed traces the result
+     * equals analyzing both ranges with one analyzer.
+     */
+    void merge(LockAnalyzer&& later) {
+        for (auto it = open_.begin(); it != open_.end();) {
+            const PendingKey& key = it->first;
+            std::vector<timestamp_t>& starts = it->second;
+            auto acquires = later.first_acquires_.find(key.thread_id);
+            if (key.pending == Pending::LockWait) {
+                // A thread waits for one lock at a time: only its next acquire can end the wait
+                if (acquires != later.first_acquires_.end()) {
+                    auto first = acquires->second.find(key.id);
+                    if (first != acquires->second.end() && !first->second.waited) {
+                        finish(key, starts.back(), first->second.ts);
+                        starts.pop_back();
+                        first->second.waited = true;
+                    }
+                }
+            } else {
+                timestamp_t released = UINT64_MAX;
+                auto ends = later.unmatched_ends_.find(key);
+                if (ends != later.unmatched_ends_.end()) {
+                    size_t matched = 0;
+                    for (; matched < ends->second.size() && !starts.empty(); ++matched) {
+                        finish(key, starts.back(), ends->second[matched]);
+                        starts.pop_back();
+                    }
+                    if (starts.empty()) {
+                        released = ends->second[matched - 1];
+                    }
+                    ends->second.erase(ends->second.begin(), ends->second.begin() + matched);
+                    if (ends->second.empty()) {
+                        later.unmatched_ends_.erase(ends);
+                    }
+                }
+                bool hold = key.pending == Pending::Hold || key.pending == Pending::SharedHold;
+                if (hold && acquires != later.first_acquires_.end()) {
+                    for (const auto& [other, first] : acquires->second) {
+                        if (other != key.id && first.ts < released) {
+                            lock_order_.insert({key.id, other});
+                        }
+                    }
+                }
+            }
+            it = starts.empty() ? open_.erase(it) : std::next(it);
+        }
+
+        for (auto& [id, theirs] : later.locks_) {
+            LockStats& lock = locks_[id];
+            lock.acquisitions += theirs.acquisitions;
+            lock.shared_acquisitions += theirs.shared_acquisitions;
+            lock.contentions += theirs.contentions;
+            lock.handoffs += theirs.handoffs;
+            if (theirs.first_owner != 0) {
+                lock.handoffs += lock.last_owner != 0 && lock.last_owner != theirs.first_owner;
+                lock.first_owner = lock.first_owner ? lock.first_owner : theirs.first_owner;
+                lock.last_owner = theirs.last_owner;
+            }
+            lock.hold_ns.merge(theirs.hold_ns);
+            lock.wait_ns.merge(theirs.wait_ns);
+            lock.summary_hold_ns.merge(theirs.summary_hold_ns);
+            lock.summary_wait_ns.merge(theirs.summary_wait_ns);
+            for (thread_id_t tid : theirs.threads) {
+                if (std::find(lock.threads.begin(), lock.threads.end(), tid) == lock.threads.end()) {
+                    lock.threads.push_back(tid);
+                }
+            }
+        }
+        for (const auto& [tid, theirs] : later.threads_) {
+            ThreadBlockedStats& thread = threads_[tid];
+            if (thread.events == 0 || (theirs.events != 0 && theirs.first_ts < thread.first_ts)) {
+                thread.first_ts = theirs.first_ts;
+            }
+            thread.last_ts = theirs.last_ts > thread.last_ts ? theirs.last_ts : thread.last_ts;
+            thread.events += theirs.events;
+            thread.lock_waits += theirs.lock_waits;
+            thread.lock_wait_ns += theirs.lock_wait_ns;
+            thread.cond_waits += theirs.cond_waits;
+            thread.cond_wait_ns += theirs.cond_wait_ns;
+            thread.sync_waits += theirs.sync_waits;
+            thread.sync_wait_ns += theirs.sync_wait_ns;
+        }
+
+        // Later's starts nest inside whatever is still open here
+        for (auto& [key, starts] : later.open_) {
+            std::vector<timestamp_t>& mine = open_[key];
+            mine.insert(mine.end(), starts.begin(), starts.end());
+        }
+        for (auto& [key, ends] : later.unmatched_ends_) {
+            std::vector<timestamp_t>& mine = unmatched_ends_[key];
+            mine.insert(mine.end(), ends.begin(), ends.end());
+        }
+        for (auto& [tid, acquires] : later.first_acquires_) {
+            std::unordered_map<lock_id_t, FirstAcquire>& mine = first_acquires_[tid];
+            for (const auto& [id, first] : acquires) {
+                mine.try_emplace(id, first);
+            }
+        }
+        lock_order_.insert(later.lock_order_.begin(), later.lock_order_.end());
+        lock_classes_.insert(later.lock_classes_.begin(), later.lock_classes_.end());
+        event_count_ += later.event_count_;
+
+        held_.clear();
+        for (const auto& [key, starts] : open_) {
+            if (key.pending == Pending::Hold || key.pending == Pending::SharedHold) {
+                held_[key.thread_id].insert(held_[key.thread_id].end(), starts.size(), key.id);
+            }
+        }
+    }
+
+    const std::unordered_map<lock_id_t, LockStats>& locks() const {
+        return locks_;
+    }
+
+    const std::unordered_map<thread_id_t, ThreadBlockedStats>& threads() const {
+        return threads_;
+    }
+
+    // Lock-order graph: both (a, b) and (b, a) present is a potential deadlock
+    const std::unordered_set<LockOrderEdge, LockOrderEdgeHash>& lock_order() const {
+        return lock_order_;
+    }
+
+    // Names of lock classes (LockClassName records): lock_class_key(class) -> string ID
+    const std::unordered_map<lock_id_t, string_id_t>& lock_classes() const {
+        return lock_classes_;
+    }
+
+    // Concurrency events seen
+    uint64_t event_count() const {
+        return event_count_;
+    }
+
+    // Holds and waits still open (not released by the end of the trace)
+    size_t open_count() const {
+        size_t total = 0;
+        for (const auto& [key, starts] : open_) {
+            total += starts.size();
+        }
+        return total;
+    }
+
+private:
+    enum class Pending : uint8_t {
+        Hold,
+        SharedHold,
+        LockWait,
+        CondWait,
+        SyncWait
+    };
+
+    struct PendingKey {
+        thread_id_t thread_id;
+        lock_id_t id;
+        Pending pending;
+
+        bool operator==(const PendingKey& other) const {
+            return thread_id == other.thread_id && id == other.id && pending == other.pending;
+        }
+    };
+
+    struct PendingKeyHash {
+        size_t operator()(const PendingKey& key) const {
+            uint64_t h = key.id * 0x9E3779B97F4A7C15ull;
+            h ^= (key.thread_id + static_cast<uint64_t>(key.pending)) * 0xC2B2AE3D27D4EB4Full;
+            return static_cast<size_t>(h ^ (h >> 29));
+        }
+    };
+
+    struct FirstAcquire {
+        timestamp_t ts;
+        bool waited;                    // Ended a wait begun in this range
+    };
+
+    // Records a completed hold or wait
+    void finish(const PendingKey& key, timestamp_t start, timestamp_t end) {
+        uint64_t duration = end - start;
+        switch (key.pending) {
+            case Pending::Hold:
+            case Pending::SharedHold: {
+                locks_[key.id].hold_ns.record(duration);
+                std::vector<lock_id_t>& held = held_[key.thread_id];
+                auto it = std::find(held.rbegin(), held.rend(), key.id);
+                if (it != held.rend()) {
+                    held.erase(std::next(it).base());
+                }
+                break;
+            }
+            case Pending::LockWait: {
+                LockStats& lock = locks_[key.id];
+                ++lock.contentions;
+                lock.wait_ns.record(duration);
+                ThreadBlockedStats& thread = threads_[key.thread_id];
+                ++thread.lock_waits;
+                thread.lock_wait_ns += duration;
+                break;
+            }
+            case Pending::CondWait: {
+                ThreadBlockedStats& thread = threads_[key.thread_id];
+                ++thread.cond_waits;
+                thread.cond_wait_ns += duration;
+                break;
+            }
+            case Pending::SyncWait: {
+                ThreadBlockedStats& thread = threads_[key.thread_id];
+                ++thread.sync_waits;
+                thread.sync_wait_ns += duration;
+                break;
+            }
+        }
+    }
+
+    // Ends the innermost start for key, or keeps the end for merge()
+    void end(const PendingKey& key, timestamp_t ts) {
+        timestamp_t start;
+        if (close(key, start)) {
+            finish(key, start, ts);
+        } else {
+            unmatched_ends_[key].push_back(ts);
+        }
+    }
+
+    // Pops the innermost start for key
+    bool close(const PendingKey& key, timestamp_t& start) {
+        auto it = open_.find(key);
+        if (it == open_.end()) {
+            return false;
+        }
+        start = it->second.back();
+        it->second.pop_back();
+        if (it->second.empty()) {
+            open_.erase(it);
+        }
+        return true;
+    }
+
+    std::unordered_map<lock_id_t, LockStats> locks_;
+    std::unordered_map<thread_id_t, ThreadBlockedStats> threads_;
+    std::unordered_map<PendingKey, std::vector<timestamp_t>, PendingKeyHash> open_;
+    std::unordered_map<PendingKey, std::vector<timestamp_t>, PendingKeyHash> unmatched_ends_;
+    std::unordered_map<thread_id_t, std::unordered_map<lock_id_t, FirstAcquire>> first_acquires_;
+    std::unordered_map<thread_id_t, std::vector<lock_id_t>> held_;
+    std::unordered_set<LockOrderEdge, LockOrderEdgeHash> lock_order_;
+    std::unordered_map<lock_id_t, string_id_t> lock_classes_;
+    uint64_t event_count_ = 0;
+};
+
+// The event with its lock class as lock ID (lock_class_key) if it is a lock event with a class
+inline TraceEvent to_lock_class(const TraceEvent& event) {
+    TraceEvent result = event;
+    if (event.kind != EventKind::Concurrency || event.lock_class() == 0) {
+        return result;
+    }
+    switch (event.concurrency.type) {
+        case EventType::LockAcquire:
+        case EventType::LockRelease:
+        case EventType::LockContended:
+        case EventType::SharedLockAcquire:
+        case EventType::SharedLockRelease:
+        case EventType::SharedLockContended:
+            result.concurrency.lock_id = lock_class_key(event.lock_class());
+            break;
+        default:
+            break;
+    }
+    return result;
+}
+
+/**
+ * LockAnalyzer over lock classes (lockdep-style): every lock whose guard
+ * named a class (UCDBG_LOCK_GUARD_CLASS) is analyzed as the one lock
+ * lock_class_key(class), so thousands of per-object mutexes become a few
+ * entries in locks() and the lock-order graph, and memory stays bounded
+ * by the number of classes. Locks without a class are kept per instance.
+ *
+ * Per class, hold and wait times pool every instance, and handoffs count
+ * changes of owner between acquisitions of any instance. Nesting two locks
+ * of one class adds no lock-order edge.
+ */
+class LockClassAnalyzer : public LockAnalyzer {
+public:
+    void add(const TraceEvent& event) {
+        LockAnalyzer::add(to_lock_class(event));
+    }
+
+    void merge(LockClassAnalyzer&& later) {
+        LockAnalyzer::merge(std::move(later));
+    }
+};
+
+} // namespace ucdbg
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <ucdbg/event_helpers.hpp>
+#include <ucdbg/string_table.hpp>
+
+namespace ucdbg {
+namespace internal {
+
+/**
+ * Process-wide lock class registry (lockdep-style lock grouping).
+ *
+ * A lock class names what many lock instances have in common, e.g. every
+ * Account::mutex, or every lock taken at one call site. Guards given a
+ * class put it in their events' header (TraceEvent::lock_class()), so
+ * LockClassAnalyzer can aggregate contention and check lock order per
+ * class instead of per address. Classes are numbered densely from 1 in
+ * first-use order; names are interned in the string table and tied to
+ * their numbers by LockClassName records the tracer writes at shutdown.
+ */
+class LockClasses {
+public:
+    static constexpr size_t MAX_CLASSES = 0xFFFF;
+
+    static LockClasses& instance() {
+        static LockClasses classes;
+        return classes;
+    }
+
+    // Class named name, registering it if needed; 0 (no class) once MAX_CLASSES are taken
+    lock_class_t get(std::string_view name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = ids_.find(std::string(name));
+        if (it != ids_.end()) {
+            return it->second;
+        }
+        if (names_.size() >= MAX_CLASSES) {
+            return 0;
+        }
+        names_.push_back(ucdbg::intern(name));
+        lock_class_t id = static_cast<lock_class_t>(names_.size());
+        ids_.emplace(std::string(name), id);
+        return id;
+    }
+
+    // One LockClassName record per class, stamped on the calling thread
+    std::vector<TraceEvent> definitions() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<TraceEvent> records;
+        records.reserve(names_.size());
+        for (size_t i = 0; i < names_.size(); ++i) {
+            records.push_back(make_concurrency_event(
+                EventType::LockClassName, lock_class_key(static_cast<lock_class_t>(i + 1)), names_[i]));
+        }
+        return records;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, lock_class_t> ids_;
+    std::vector<string_id_t> names_;    // String ID of class i + 1
+};
+
+} // namespace internal
+
+// Lock class named name (registered on first use); pass to a guard or UCDBG_LOCK_GUARD_CLASS
+inline lock_class_t lock_class(std::string_view name) {
+    return internal::LockClasses::instance().get(name);
+}
+
+} // namespace ucdbg
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <atomic>
 #include <concepts>
+#include <cstddef>
 #include <ucdbg/event_helpers.hpp>
-#include <ucdbg/concurrentqueue.h>
+#include <ucdbg/event_queue.hpp>
+#include <ucdbg/lock_histograms.hpp>
 
 namespace ucdbg {
 namespace internal {
@@ -13,33 +16,246 @@ concept Lockable = requires(T& t) {
     { t.unlock() } -> std::same_as<void>;
 };
 
+template <class T>
+concept SharedLockable = Lockable<T> && requires(T& t) {
+    { t.lock_shared() } -> std::same_as<void>;
+    { t.unlock_shared() } -> std::same_as<void>;
+};
+
+/**
+ * Number of readers currently holding each shared lock, keyed by lock_id.
+ *
+ * Fixed-size open-addressed table; slots are claimed on first use and never
+ * freed, each on its own cache line so unrelated locks do not false-share.
+ * Lookups give up after MAX_PROBE slots, so a crowded table costs a few
+ * cache lines per lock rather than a scan of the whole table; locks that
+ * find no slot, and all locks while tracing is off, read as 0 readers.
+ * Counts are only ever approximate: a reader that started while tracing was
+ * off is not counted, and a count never drops below 0 when it leaves.
+ */
+class ReaderCounts {
+public:
+    static constexpr size_t CAPACITY = 1024;
+    static constexpr size_t MAX_PROBE = 16;
+
+    static ReaderCounts& instance() {
+        static ReaderCounts counts;
+        return counts;
+    }
+
+    // Counter for lock_id, claiming a slot if needed; nullptr if tracing is off or no slot is free
+    std::atomic<uint32_t>* find_or_insert(lock_id_t lock_id) {
+        if (!tracing_active.load(std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        for (size_t probe = 0; probe < MAX_PROBE; ++probe) {
+            Slot& slot = slots_[(hash(lock_id) + probe) % CAPACITY];
+            lock_id_t key = slot.key.load(std::memory_order_acquire);
+            if (key == 0) {
+                if (slot.key.compare_exchange_strong(key, lock_id, std::memory_order_acq_rel)) {
+                    return &slot.readers;
+                }
+            }
+            if (key == lock_id) {
+                return &slot.readers;
+            }
+        }
+        return nullptr;
+    }
+
+    uint32_t readers(lock_id_t lock_id) const {
+        if (!tracing_active.load(std::memory_order_relaxed)) {
+            return 0;
+        }
+        for (size_t probe = 0; probe < MAX_PROBE; ++probe) {
+            const Slot& slot = slots_[(hash(lock_id) + probe) % CAPACITY];
+            lock_id_t key = slot.key.load(std::memory_order_acquire);
+            if (key == lock_id) {
+                return slot.readers.load(std::memory_order_relaxed);
+            }
+            if (key == 0) {
+                break;
+            }
+        }
+        return 0;
+    }
+
+    // Count after a reader arrives at counter (from find_or_insert); 0 for no counter
+    static uint32_t add_reader(std::atomic<uint32_t>* counter) {
+        return counter ? counter->fetch_add(1, std::memory_order_relaxed) + 1 : 0;
+    }
+
+    // Count after a reader leaves; stays at 0 for a reader that was never counted
+    static uint32_t remove_reader(std::atomic<uint32_t>* counter) {
+        if (!counter) {
+            return 0;
+        }
+        uint32_t count = counter->load(std::memory_order_relaxed);
+        while (count > 0 && !counter->compare_exchange_weak(count, count - 1, std::memory_order_relaxed)) {
+        }
+        return count > 0 ? count - 1 : 0;
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<lock_id_t> key{0};
+        std::atomic<uint32_t> readers{0};
+    };
+
+    static size_t hash(lock_id_t lock_id) {
+        return static_cast<size_t>((lock_id * 0x9E3779B97F4A7C15ull) >> 32);
+    }
+
+    Slot slots_[CAPACITY];
+};
+
+// Lock event carrying the guard's lock class in its header
+inline TraceEvent make_lock_event(EventType type, lock_id_t lock_id, uint32_t arg, lock_class_t lock_class) {
+    TraceEvent event = make_concurrency_event(type, lock_id, arg);
+    event.set_lock_class(lock_class);
+    return event;
+}
+
+/**
+ * Emits a guard's lock event (unless lock histograms replace lock events)
+ * and returns its timestamp when lock histograms are on, else 0.
+ */
+inline timestamp_t lock_event(const TraceEvent& event) {
+    if (!lock_histograms_active.load(std::memory_order_relaxed)) {
+        emit(event);
+        return 0;
+    }
+    if (lock_events_active.load(std::memory_order_relaxed)) {
+        emit(event);
+    }
+    return event.timestamp_ns;
+}
+
+inline timestamp_t lock_event(EventType type, lock_id_t lock_id, uint32_t arg = 0, lock_class_t lock_class = 0) {
+    return lock_event(make_lock_event(type, lock_id, arg, lock_class));
+}
+
+// Records a completed hold or wait if both ends were timed
+inline void lock_latency_sample(lock_id_t lock_id, bool wait, timestamp_t start, timestamp_t end) {
+    if (start && end) {
+        wait ? LockHistograms::instance().record_wait(lock_id, end - start)
+             : LockHistograms::instance().record_hold(lock_id, end - start);
+    }
+}
+
+/**
+ * Exclusive lock guard. lock_id defaults to the lock's address; lock_class
+ * (lock_class.hpp), if given, is carried in every event, and in-process
+ * histograms then aggregate the class instead of the instance.
+ */
 template<Lockable L>
 class LockGuard {
 public:
-    explicit LockGuard(L& lockable,uint64_t lock_id = 0) 
-        : lockable_(lockable), 
-        lock_id_(lock_id ? lock_id : reinterpret_cast<uint64_t>(&lockable)) {        
-        lockable_.lock();
-        event_queue_.enqueue(make_concurrency_event(EventType::LockAcquire, lock_id_));
+    explicit LockGuard(L& lockable, uint64_t lock_id = 0, lock_class_t lock_class = 0)
+        : lockable_(lockable),
+        lock_id_(lock_id ? lock_id : reinterpret_cast<uint64_t>(&lockable)),
+        lock_class_(lock_class) {
+        // Only a failed try_lock costs an extra event; uncontended acquires stay at one
+        timestamp_t contended_at = 0;
+        if constexpr (requires { { lockable_.try_lock() } -> std::convertible_to<bool>; }) {
+            if (!lockable_.try_lock()) {
+                contended_at = lock_event(EventType::LockContended, lock_id_, readers_holding(), lock_class_);
+                lockable_.lock();
+            }
+        } else {
+            lockable_.lock();
+        }
+        acquired_at_ = lock_event(EventType::LockAcquire, lock_id_, 0, lock_class_);
+        lock_latency_sample(histogram_key(), true, contended_at, acquired_at_);
     }
 
     ~LockGuard() noexcept {
+        // Stamped before the unlock, so it sorts before the next owner's acquire
+        TraceEvent release = make_lock_event(EventType::LockRelease, lock_id_, 0, lock_class_);
         lockable_.unlock();
-        event_queue_.enqueue(make_concurrency_event(EventType::LockRelease, lock_id_));
+        lock_latency_sample(histogram_key(), false, acquired_at_, lock_event(release));
     }
 
-
-
     LockGuard(const LockGuard&) = delete;
     LockGuard& operator=(const LockGuard&) = delete;
     LockGuard(LockGuard&&) = delete;
     LockGuard& operator=(LockGuard&&) = delete;
 
 private:
+    // Readers in the way of this writer, for writer-starvation analysis
+    uint32_t readers_holding() const {
+        if constexpr (SharedLockable<L>) {
+            return ReaderCounts::instance().readers(lock_id_);
+        } else {
+            return 0;
+        }
+    }
+
+    lock_id_t histogram_key() const {
+        return lock_class_ ? lock_class_key(lock_class_) : lock_id_;
+    }
+
     L& lockable_;
     uint64_t lock_id_;
-    moodycamel::ConcurrentQueue<ucdbg::TraceEvent> event_queue_;
-};    
+    lock_class_t lock_class_;
+    timestamp_t acquired_at_ = 0;   // Set only while lock histograms are on
+};
+
+/**
+ * Shared (reader) counterpart of LockGuard for std::shared_mutex and other
+ * SharedLockable types. Emits SharedLockAcquire/SharedLockRelease, plus
+ * SharedLockContended when try_lock_shared fails, and maintains the
+ * per-lock reader count reported in those events' arg.
+ */
+template<SharedLockable L>
+class SharedLockGuard {
+public:
+    explicit SharedLockGuard(L& lockable, uint64_t lock_id = 0, lock_class_t lock_class = 0)
+        : lockable_(lockable),
+        lock_id_(lock_id ? lock_id : reinterpret_cast<uint64_t>(&lockable)),
+        lock_class_(lock_class),
+        readers_(ReaderCounts::instance().find_or_insert(lock_id_)) {
+        timestamp_t contended_at = 0;
+        if constexpr (requires { { lockable_.try_lock_shared() } -> std::convertible_to<bool>; }) {
+            if (!lockable_.try_lock_shared()) {
+                contended_at = lock_event(EventType::SharedLockContended, lock_id_, load_readers(), lock_class_);
+                lockable_.lock_shared();
+            }
+        } else {
+            lockable_.lock_shared();
+        }
+        uint32_t readers = ReaderCounts::add_reader(readers_);
+        acquired_at_ = lock_event(EventType::SharedLockAcquire, lock_id_, readers, lock_class_);
+        lock_latency_sample(histogram_key(), true, contended_at, acquired_at_);
+    }
+
+    ~SharedLockGuard() noexcept {
+        uint32_t readers = ReaderCounts::remove_reader(readers_);
+        TraceEvent release = make_lock_event(EventType::SharedLockRelease, lock_id_, readers, lock_class_);
+        lockable_.unlock_shared();
+        lock_latency_sample(histogram_key(), false, acquired_at_, lock_event(release));
+    }
+
+    SharedLockGuard(const SharedLockGuard&) = delete;
+    SharedLockGuard& operator=(const SharedLockGuard&) = delete;
+    SharedLockGuard(SharedLockGuard&&) = delete;
+    SharedLockGuard& operator=(SharedLockGuard&&) = delete;
+
+private:
+    uint32_t load_readers() const {
+        return readers_ ? readers_->load(std::memory_order_relaxed) : 0;
+    }
+
+    lock_id_t histogram_key() const {
+        return lock_class_ ? lock_class_key(lock_class_) : lock_id_;
+    }
+
+    L& lockable_;
+    uint64_t lock_id_;
+    lock_class_t lock_class_;
+    std::atomic<uint32_t>* readers_;
+    timestamp_t acquired_at_ = 0;
+};
 
-}  // namespace internal 
+}  // namespace internal
 } // namespace ucdbg
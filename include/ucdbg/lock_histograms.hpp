@@ -0,0 +1,307 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <ucdbg/event_helpers.hpp>
+#include <ucdbg/histogram.hpp>
+#include <ucdbg/trace_types.hpp>
+
+namespace ucdbg {
+
+// Hold and wait time distributions of one lock
+struct LockLatency {
+    LatencyHistogram hold_ns;
+    LatencyHistogram wait_ns;           // Contended acquisitions only
+};
+
+namespace internal {
+
+// Set by ucdbg::set_lock_histograms(): lock guards record hold/wait times
+inline std::atomic<bool> lock_histograms_active{false};
+// Cleared by ucdbg::set_lock_histograms(true, false): guards emit no lock events
+inline std::atomic<bool> lock_events_active{true};
+
+// LockHoldHistogram/LockWaitHistogram arg: bucket in the low 9 bits, count above
+constexpr unsigned LOCK_HISTOGRAM_BUCKET_BITS = 9;
+constexpr uint32_t LOCK_HISTOGRAM_MAX_COUNT = CONCURRENCY_ARG_MAX >> LOCK_HISTOGRAM_BUCKET_BITS;
+static_assert(LatencyHistogram::BUCKETS <= (1u << LOCK_HISTOGRAM_BUCKET_BITS),
+              "histogram bucket must fit in a summary record");
+
+inline uint32_t lock_histogram_arg(size_t bucket, uint32_t count) {
+    return static_cast<uint32_t>(bucket) | count << LOCK_HISTOGRAM_BUCKET_BITS;
+}
+
+inline size_t lock_histogram_bucket(uint32_t arg) {
+    return arg & ((1u << LOCK_HISTOGRAM_BUCKET_BITS) - 1);
+}
+
+inline uint32_t lock_histogram_count(uint32_t arg) {
+    return arg >> LOCK_HISTOGRAM_BUCKET_BITS;
+}
+
+/**
+ * One thread's hold and wait histograms, keyed by lock_id.
+ *
+ * Only the owning thread writes, so a record is a relaxed load and store of
+ * one bucket counter (no read-modify-write, no shared cache line). The
+ * collector reads the counters concurrently and folds in the difference
+ * from what it saw last time; nothing is ever reset. A lock's slot is
+ * allocated on its first use by the thread and published with a release
+ * store. Each slot is a separate ~5 KB allocation, so lookups give up after
+ * MAX_PROBE slots rather than touching every one of them.
+ */
+class ThreadLockHistograms {
+public:
+    static constexpr size_t CAPACITY = 256;
+    static constexpr size_t MAX_PROBE = 8;
+
+    struct Slot {
+        explicit Slot(lock_id_t id) : lock_id(id) {}
+
+        const lock_id_t lock_id;
+        std::atomic<uint32_t> hold[LatencyHistogram::BUCKETS] = {};
+        std::atomic<uint32_t> wait[LatencyHistogram::BUCKETS] = {};
+        // Collector only: counts already folded in (differences wrap)
+        uint32_t seen_hold[LatencyHistogram::BUCKETS] = {};
+        uint32_t seen_wait[LatencyHistogram::BUCKETS] = {};
+    };
+
+    ThreadLockHistograms() = default;
+
+    ~ThreadLockHistograms() {
+        for (auto& slot : slots_) {
+            delete slot.load(std::memory_order_relaxed);
+        }
+    }
+
+    ThreadLockHistograms(const ThreadLockHistograms&) = delete;
+    ThreadLockHistograms& operator=(const ThreadLockHistograms&) = delete;
+
+    // Owning thread only; false if no slot was free within MAX_PROBE
+    bool record(lock_id_t lock_id, bool wait, uint64_t ns) {
+        Slot* slot = find(lock_id);
+        if (!slot) {
+            return false;
+        }
+        std::atomic<uint32_t>& count = (wait ? slot->wait : slot->hold)[LatencyHistogram::bucket_of(ns)];
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * Collector only: calls on_delta(lock_id, wait, bucket, count) for every
+     * bucket that gained count records since the previous call.
+     */
+    template <class F>
+    void collect(F&& on_delta) {
+        for (auto& published : slots_) {
+            Slot* slot = published.load(std::memory_order_acquire);
+            if (!slot) {
+                continue;
+            }
+            for (size_t b = 0; b < LatencyHistogram::BUCKETS; ++b) {
+                uint32_t hold = slot->hold[b].load(std::memory_order_relaxed);
+                if (hold != slot->seen_hold[b]) {
+                    on_delta(slot->lock_id, false, b, hold - slot->seen_hold[b]);
+                    slot->seen_hold[b] = hold;
+                }
+                uint32_t wait = slot->wait[b].load(std::memory_order_relaxed);
+                if (wait != slot->seen_wait[b]) {
+                    on_delta(slot->lock_id, true, b, wait - slot->seen_wait[b]);
+                    slot->seen_wait[b] = wait;
+                }
+            }
+        }
+    }
+
+    // Set (release) by the owning thread after its last record
+    std::atomic<bool> exited{false};
+
+private:
+    Slot* find(lock_id_t lock_id) {
+        if (last_ && last_->lock_id == lock_id) {
+            return last_;
+        }
+        size_t start = static_cast<size_t>((lock_id * 0x9E3779B97F4A7C15ull) >> 56);
+        for (size_t probe = 0; probe < MAX_PROBE; ++probe) {
+            std::atomic<Slot*>& published = slots_[(start + probe) % CAPACITY];
+            Slot* slot = published.load(std::memory_order_relaxed);
+            if (!slot) {
+                slot = new Slot(lock_id);
+                published.store(slot, std::memory_order_release);
+            }
+            if (slot->lock_id == lock_id) {
+                last_ = slot;
+                return slot;
+            }
+        }
+        return nullptr;
+    }
+
+    std::atomic<Slot*> slots_[CAPACITY] = {};
+    Slot* last_ = nullptr;
+};
+
+/**
+ * Process-wide registry of the per-thread lock histograms.
+ *
+ * Guards record into the calling thread's table. collect() (run by the
+ * tracer's drain thread every LOCK_SUMMARY_INTERVAL, or by latency queries)
+ * folds every table's new counts into per-lock cumulative and interval
+ * histograms; take_summary() turns the interval histograms into compact
+ * summary records. Tables of exited threads are dropped after their final
+ * collection.
+ *
+ * Memory stays bounded however many locks a program creates: cumulative
+ * histograms (for latency()) are kept for the first MAX_TRACKED_LOCKS locks
+ * only, and interval histograms only while summaries are being taken
+ * (set_summaries(), on while the tracer runs), which empties them each time.
+ * Guards with a lock class record under the class, so classes are the way
+ * to cover many lock instances.
+ */
+class LockHistograms {
+public:
+    // Locks with cumulative histograms; each LockLatency is ~5 KB
+    static constexpr size_t MAX_TRACKED_LOCKS = 1024;
+
+    static LockHistograms& instance() {
+        static LockHistograms histograms;
+        return histograms;
+    }
+
+    void record_hold(lock_id_t lock_id, uint64_t ns) {
+        record(lock_id, false, ns);
+    }
+
+    void record_wait(lock_id_t lock_id, uint64_t ns) {
+        record(lock_id, true, ns);
+    }
+
+    void collect() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        collect_locked();
+    }
+
+    // Keep interval histograms for take_summary(); turning this off discards them
+    void set_summaries(bool enabled) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        collect_locked();
+        summaries_ = enabled;
+        interval_.clear();
+    }
+
+    /**
+     * Summary records for everything recorded since the previous call
+     * (and since set_summaries(true); empty while summaries are off): per
+     * lock, one LockHoldHistogram/LockWaitHistogram event per non-empty
+     * bucket (more when its count exceeds LOCK_HISTOGRAM_MAX_COUNT), stamped
+     * on the calling thread.
+     */
+    std::vector<TraceEvent> take_summary() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        collect_locked();
+        std::vector<TraceEvent> records;
+        for (const auto& [lock_id, latency] : interval_) {
+            append_records(records, EventType::LockHoldHistogram, lock_id, latency.hold_ns);
+            append_records(records, EventType::LockWaitHistogram, lock_id, latency.wait_ns);
+        }
+        interval_.clear();
+        return records;
+    }
+
+    // Everything recorded for lock_id so far
+    LockLatency latency(lock_id_t lock_id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        collect_locked();
+        auto it = cumulative_.find(lock_id);
+        return it == cumulative_.end() ? LockLatency() : it->second;
+    }
+
+    // Records lost because a thread's table had no free slot for the lock
+    uint64_t dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    // Records left out of latency() because MAX_TRACKED_LOCKS other locks were tracked first
+    uint64_t untracked() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return untracked_;
+    }
+
+private:
+    struct Registration {
+        explicit Registration(LockHistograms& owner) : table(std::make_shared<ThreadLockHistograms>()) {
+            std::lock_guard<std::mutex> lock(owner.mutex_);
+            owner.tables_.push_back(table);
+        }
+
+        ~Registration() {
+            table->exited.store(true, std::memory_order_release);
+        }
+
+        std::shared_ptr<ThreadLockHistograms> table;
+    };
+
+    void record(lock_id_t lock_id, bool wait, uint64_t ns) {
+        static thread_local Registration registration(*this);
+        if (!registration.table->record(lock_id, wait, ns)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void collect_locked() {
+        auto fold = [this](lock_id_t lock_id, bool wait, size_t bucket, uint32_t count) {
+            auto total = cumulative_.find(lock_id);
+            if (total == cumulative_.end() && cumulative_.size() < MAX_TRACKED_LOCKS) {
+                total = cumulative_.emplace(lock_id, LockLatency()).first;
+            }
+            if (total != cumulative_.end()) {
+                (wait ? total->second.wait_ns : total->second.hold_ns).record_bucket(bucket, count);
+            } else {
+                untracked_ += count;
+            }
+            if (summaries_) {
+                LockLatency& interval = interval_[lock_id];
+                (wait ? interval.wait_ns : interval.hold_ns).record_bucket(bucket, count);
+            }
+        };
+        for (size_t i = 0; i < tables_.size();) {
+            // Read exited first: if set, every record of the thread is visible below
+            bool exited = tables_[i]->exited.load(std::memory_order_acquire);
+            tables_[i]->collect(fold);
+            if (exited) {
+                tables_[i] = std::move(tables_.back());
+                tables_.pop_back();
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    static void append_records(std::vector<TraceEvent>& records, EventType type, lock_id_t lock_id,
+                               const LatencyHistogram& histogram) {
+        for (size_t b = 0; b < LatencyHistogram::BUCKETS && histogram.count(); ++b) {
+            for (uint64_t left = histogram.bucket_count(b); left > 0;) {
+                uint32_t count = left < LOCK_HISTOGRAM_MAX_COUNT ? static_cast<uint32_t>(left)
+                                                                  : LOCK_HISTOGRAM_MAX_COUNT;
+                records.push_back(make_concurrency_event(type, lock_id, lock_histogram_arg(b, count)));
+                left -= count;
+            }
+        }
+    }
+
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<ThreadLockHistograms>> tables_;
+    std::unordered_map<lock_id_t, LockLatency> cumulative_;
+    std::unordered_map<lock_id_t, LockLatency> interval_;
+    bool summaries_ = false;
+    uint64_t untracked_ = 0;
+    std::atomic<uint64_t> dropped_{0};
+};
+
+} // namespace internal
+} // namespace ucdbg
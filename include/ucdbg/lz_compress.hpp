@@ -0,0 +1,212 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace ucdbg {
+namespace internal {
+
+/**
+ * Self-contained LZ77 block compressor (LZ4-style sequence layout).
+ *
+ * Each sequence is:
+ *   u8      token        high nibble literal length, low nibble match length - 4
+ *   [u8*]   literal length extension (255-continued) if high nibble is 15
+ *   bytes   literals
+ *   u16     match offset (1..65535), omitted in the final literal-only sequence
+ *   [u8*]   match length extension (255-continued) if low nibble is 15
+ *
+ * Tuned for trace blocks: single-probe hash table, no entropy stage. The
+ * decoder is fully bounds-checked, so corrupt input cannot overrun buffers.
+ */
+
+constexpr size_t LZ_MIN_MATCH = 4;
+constexpr size_t LZ_MAX_OFFSET = 65535;
+constexpr unsigned LZ_HASH_BITS = 12;
+
+// Upper bound for lz_compress output (incompressible input)
+constexpr size_t lz_compress_bound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+inline uint32_t lz_read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t lz_hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+inline uint8_t* lz_write_length(uint8_t* out, size_t length) {
+    while (length >= 255) {
+        *out++ = 255;
+        length -= 255;
+    }
+    *out++ = static_cast<uint8_t>(length);
+    return out;
+}
+
+inline uint8_t* lz_write_sequence(uint8_t* out, const uint8_t* literals, size_t literal_length,
+                                  size_t offset, size_t match_length) {
+    uint8_t* token = out++;
+    *token = static_cast<uint8_t>((literal_length < 15 ? literal_length : 15) << 4);
+    if (literal_length >= 15) {
+        out = lz_write_length(out, literal_length - 15);
+    }
+    std::memcpy(out, literals, literal_length);
+    out += literal_length;
+    if (match_length == 0) {
+        return out;  // Final sequence
+    }
+    *out++ = static_cast<uint8_t>(offset);
+    *out++ = static_cast<uint8_t>(offset >> 8);
+    size_t code = match_length - LZ_MIN_MATCH;
+    *token |= static_cast<uint8_t>(code < 15 ? code : 15);
+    if (code >= 15) {
+        out = lz_write_length(out, code - 15);
+    }
+    return out;
+}
+
+/**
+ * Compresses src into dst (capacity >= lz_compress_bound(size)).
+ * Returns the compressed size.
+ */
+inline size_t lz_compress(const uint8_t* src, size_t size, uint8_t* dst) {
+    uint32_t table[1u << LZ_HASH_BITS] = {};
+    const uint8_t* ip = src;
+    const uint8_t* anchor = src;
+    const uint8_t* end = src + size;
+    const uint8_t* match_limit = size >= LZ_MIN_MATCH ? end - LZ_MIN_MATCH : src;
+    uint8_t* out = dst;
+
+    // Position 0 cannot be stored in the table (0 means empty), so start at 1
+    if (size > LZ_MIN_MATCH) {
+        ++ip;
+    }
+    unsigned misses = 0;
+    while (ip < match_limit) {
+        uint32_t sequence = lz_read32(ip);
+        uint32_t& slot = table[lz_hash(sequence)];
+        const uint8_t* candidate = src + slot;
+        slot = static_cast<uint32_t>(ip - src);
+
+        if (candidate == src || ip - candidate > static_cast<ptrdiff_t>(LZ_MAX_OFFSET) ||
+            lz_read32(candidate) != sequence) {
+            // Skip faster through incompressible regions
+            ip += 1 + (misses++ >> 5);
+            continue;
+        }
+        misses = 0;
+
+        // Extend backwards over pending literals, then forwards
+        while (ip > anchor && candidate > src && ip[-1] == candidate[-1]) {
+            --ip;
+            --candidate;
+        }
+        const uint8_t* match_end = ip + LZ_MIN_MATCH;
+        const uint8_t* candidate_end = candidate + LZ_MIN_MATCH;
+        while (end - match_end >= 8) {
+            uint64_t a, b;
+            std::memcpy(&a, match_end, sizeof(a));
+            std::memcpy(&b, candidate_end, sizeof(b));
+            if (a != b) {
+                // Little-endian: lowest differing byte is the first mismatch
+                size_t same = static_cast<size_t>(__builtin_ctzll(a ^ b)) / 8;
+                match_end += same;
+                candidate_end += same;
+                break;
+            }
+            match_end += 8;
+            candidate_end += 8;
+        }
+        if (end - match_end < 8) {
+            while (match_end < end && *match_end == *candidate_end) {
+                ++match_end;
+                ++candidate_end;
+            }
+        }
+
+        out = lz_write_sequence(out, anchor, static_cast<size_t>(ip - anchor),
+                                static_cast<size_t>(ip - candidate),
+                                static_cast<size_t>(match_end - ip));
+        ip = match_end;
+        anchor = ip;
+        if (ip - 2 > src && ip < match_limit) {
+            table[lz_hash(lz_read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - src);
+        }
+    }
+    return static_cast<size_t>(
+        lz_write_sequence(out, anchor, static_cast<size_t>(end - anchor), 0, 0) - dst);
+}
+
+/**
+ * Decompresses src into dst, which must be exactly dst_size bytes long.
+ * Returns false if the input is corrupt or does not produce dst_size bytes.
+ */
+inline bool lz_decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dst_size) {
+    const uint8_t* ip = src;
+    const uint8_t* ip_end = src + size;
+    uint8_t* op = dst;
+    uint8_t* op_end = dst + dst_size;
+
+    auto read_length = [&](size_t& length) {
+        uint8_t byte;
+        do {
+            if (ip >= ip_end) return false;
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+
+    while (ip < ip_end) {
+        uint8_t token = *ip++;
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !read_length(literal_length)) {
+            return false;
+        }
+        if (literal_length > static_cast<size_t>(ip_end - ip) ||
+            literal_length > static_cast<size_t>(op_end - op)) {
+            return false;
+        }
+        std::memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+        if (ip == ip_end) {
+            break;  // Final literal-only sequence
+        }
+
+        if (ip_end - ip < 2) {
+            return false;
+        }
+        size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        size_t match_length = token & 0x0F;
+        if (match_length == 15 && !read_length(match_length)) {
+            return false;
+        }
+        match_length += LZ_MIN_MATCH;
+        if (offset == 0 || offset > static_cast<size_t>(op - dst) ||
+            match_length > static_cast<size_t>(op_end - op)) {
+            return false;
+        }
+        // Byte-wise copy: overlapping matches (offset < length) replicate runs
+        const uint8_t* match = op - offset;
+        if (offset >= match_length) {
+            std::memcpy(op, match, match_length);
+            op += match_length;
+        } else {
+            for (size_t i = 0; i < match_length; ++i) {
+                *op++ = match[i];
+            }
+        }
+    }
+    return op == op_end;
+}
+
+} // namespace internal
+} // namespace ucdbg
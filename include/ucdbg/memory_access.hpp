@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <ucdbg/event_helpers.hpp>
+#include <ucdbg/event_queue.hpp>
+
+namespace ucdbg {
+
+/**
+ * Accesses to annotated shared variables, for the happens-before race
+ * detector (race_detector.hpp). Each call emits one MemoryRead/MemoryWrite
+ * event with the address in lock_id and the access site in arg: a string
+ * ID (ucdbg::intern, 24 bits) naming it, as UCDBG_READ/UCDBG_WRITE pass
+ * "file:line". Only annotated accesses are traced, so annotate the
+ * variables under suspicion rather than every load and store.
+ */
+
+// Site of an access without one (string ID 0 is a real string)
+constexpr string_id_t NO_ACCESS_SITE = CONCURRENCY_ARG_MAX;
+
+inline void traced_read(const volatile void* address, string_id_t site = NO_ACCESS_SITE) {
+    internal::emit(internal::make_concurrency_event(EventType::MemoryRead,
+                                                    reinterpret_cast<uint64_t>(address), site));
+}
+
+inline void traced_write(const volatile void* address, string_id_t site = NO_ACCESS_SITE) {
+    internal::emit(internal::make_concurrency_event(EventType::MemoryWrite,
+                                                    reinterpret_cast<uint64_t>(address), site));
+}
+
+} // namespace ucdbg
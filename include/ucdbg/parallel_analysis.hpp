@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include <ucdbg/block_reader.hpp>
+
+namespace ucdbg {
+namespace internal {
+
+// Target events per slice: bounds the memory each worker holds decoded
+constexpr size_t ANALYSIS_SLICE_EVENTS = 1u << 20;
+
+/**
+ * Runs task(i) for every i in [0, count) on `workers` threads.
+ *
+ * Tasks are dealt round-robin into per-worker deques. A worker takes its
+ * own tasks from the front (lowest index first) and, once its deque is
+ * empty, steals from the back of the others', so slices of uneven cost
+ * still keep every worker busy.
+ */
+template <class F>
+void run_work_stealing(size_t count, unsigned workers, F&& task) {
+    if (workers <= 1 || count <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+    std::vector<WorkQueue> queues(workers);
+    for (size_t i = 0; i < count; ++i) {
+        queues[i % workers].tasks.push_back(i);
+    }
+
+    auto next_task = [&](unsigned self, size_t& out) {
+        for (unsigned n = 0; n < workers; ++n) {
+            WorkQueue& queue = queues[(self + n) % workers];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                if (n == 0) {
+                    out = queue.tasks.front();
+                    queue.tasks.pop_front();
+                } else {
+                    out = queue.tasks.back();
+                    queue.tasks.pop_back();
+                }
+                return true;
+            }
+        }
+        return false;  // No task is ever added after start
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for (unsigned w = 0; w < workers; ++w) {
+        threads.emplace_back([&, w] {
+            size_t i;
+            while (next_task(w, i)) {
+                task(i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+/**
+ * Cut points c[0] = 0 < c[1] < ... < c[n] = UINT64_MAX splitting a trace
+ * into n time slices [c[i], c[i+1]) of about equal event counts. Cuts fall
+ * on block start timestamps, so most blocks belong to one slice.
+ */
+inline std::vector<timestamp_t> slice_bounds(const std::vector<BlockIndexEntry>& blocks, size_t slices) {
+    std::vector<const BlockIndexEntry*> by_start;
+    by_start.reserve(blocks.size());
+    uint64_t total = 0;
+    for (const auto& entry : blocks) {
+        by_start.push_back(&entry);
+        total += entry.event_count;
+    }
+    std::sort(by_start.begin(), by_start.end(), [](const BlockIndexEntry* a, const BlockIndexEntry* b) {
+        return a->first_ts < b->first_ts;
+    });
+
+    std::vector<timestamp_t> cuts{0};
+    uint64_t seen = 0;
+    size_t next = 1;
+    for (const BlockIndexEntry* entry : by_start) {
+        if (next < slices && seen >= total * next / slices && entry->first_ts > cuts.back()) {
+            cuts.push_back(entry->first_ts);
+            ++next;
+        }
+        seen += entry->event_count;
+    }
+    cuts.push_back(UINT64_MAX);
+    return cuts;
+}
+
+/**
+ * Feeds analyzer the events with timestamps in [begin, end) in timestamp
+ * order: decodes the blocks overlapping the slice and merges the per-thread
+ * runs they form.
+ */
+template <class Analyzer>
+bool analyze_slice(const BlockTraceReader& reader, timestamp_t begin, timestamp_t end, Analyzer& analyzer) {
+    std::vector<TraceEvent> events;
+    std::vector<size_t> runs;  // Start of each thread's run in events
+    thread_id_t run_thread = 0;
+    for (size_t block : reader.blocks_in_window(begin, end - 1)) {
+        thread_id_t tid = reader.blocks()[block].thread_id;
+        if (runs.empty() || tid != run_thread) {
+            runs.push_back(events.size());
+            run_thread = tid;
+        }
+        size_t first = events.size();
+        if (!reader.read_block(block, events)) {
+            return false;
+        }
+        events.erase(std::remove_if(events.begin() + first, events.end(),
+                                    [&](const TraceEvent& e) {
+                                        return e.timestamp_ns < begin || e.timestamp_ns >= end;
+                                    }),
+                     events.end());
+    }
+    runs.push_back(events.size());
+
+    using Entry = std::pair<timestamp_t, size_t>;  // (timestamp, run)
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+    std::vector<size_t> position(runs.begin(), runs.end() - 1);
+    for (size_t r = 0; r + 1 < runs.size(); ++r) {
+        if (position[r] < runs[r + 1]) {
+            heap.emplace(events[position[r]].timestamp_ns, r);
+        }
+    }
+    while (!heap.empty()) {
+        size_t r = heap.top().second;
+        heap.pop();
+        analyzer.add(static_cast<const TraceEvent&>(events[position[r]]));
+        if (++position[r] < runs[r + 1]) {
+            heap.emplace(events[position[r]].timestamp_ns, r);
+        }
+    }
+    return true;
+}
+
+} // namespace internal
+
+/**
+ * Partitioned parallel analysis of a block trace.
+ *
+ * The trace is cut into time slices of about ANALYSIS_SLICE_EVENTS events
+ * (at least four per worker), each slice is analyzed independently on a
+ * work-stealing pool, and the per-slice partial results are merged in time
+ * order as soon as the slices before them are done, so only slices that
+ * finished out of order wait in memory.
+ *
+ * Analyzer needs add(const TraceEvent&) and merge(Analyzer&& later), where
+ * later covers the time range that follows; LockAnalyzer is one. result
+ * should be freshly constructed. workers = 0 uses every hardware thread.
+ * Returns false if a block is corrupt.
+ */
+template <class Analyzer>
+bool analyze_parallel(const BlockTraceReader& reader, Analyzer& result, unsigned workers = 0) {
+    if (workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    size_t slices = std::max<size_t>(size_t{workers} * 4,
+                                     (reader.event_count() + internal::ANALYSIS_SLICE_EVENTS - 1) /
+                                         internal::ANALYSIS_SLICE_EVENTS);
+    std::vector<timestamp_t> cuts = internal::slice_bounds(reader.blocks(), slices);
+    size_t count = cuts.size() - 1;
+
+    std::vector<std::unique_ptr<Analyzer>> done(count);
+    size_t next_merge = 0;
+    std::mutex merge_mutex;
+    std::atomic<bool> corrupt{false};
+    internal::run_work_stealing(count, workers, [&](size_t i) {
+        auto partial = std::make_unique<Analyzer>();
+        if (!internal::analyze_slice(reader, cuts[i], cuts[i + 1], *partial)) {
+            corrupt.store(true);
+        }
+        std::lock_guard<std::mutex> lock(merge_mutex);
+        done[i] = std::move(partial);
+        while (next_merge < count && done[next_merge]) {
+            result.merge(std::move(*done[next_merge]));
+            done[next_merge++].reset();
+        }
+    });
+    return !corrupt.load();
+}
+
+} // namespace ucdbg
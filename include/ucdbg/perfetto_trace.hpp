@@ -0,0 +1,609 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <ucdbg/trace_types.hpp>
+#include <ucdbg/varint.hpp>
+
+namespace ucdbg {
+namespace internal {
+
+// Field numbers of the Perfetto trace protos used by PerfettoTraceWriter
+namespace perfetto {
+    // Trace
+    constexpr uint32_t TRACE_PACKET = 1;
+    // TracePacket
+    constexpr uint32_t PACKET_TIMESTAMP = 8;
+    constexpr uint32_t PACKET_SEQUENCE_ID = 10;       // trusted_packet_sequence_id
+    constexpr uint32_t PACKET_TRACK_EVENT = 11;
+    constexpr uint32_t PACKET_INTERNED_DATA = 12;
+    constexpr uint32_t PACKET_SEQUENCE_FLAGS = 13;
+    constexpr uint32_t PACKET_DEFAULTS = 59;          // trace_packet_defaults
+    constexpr uint32_t PACKET_TRACK_DESCRIPTOR = 60;
+    // TracePacketDefaults
+    constexpr uint32_t DEFAULTS_CLOCK_ID = 58;        // timestamp_clock_id
+    // TrackDescriptor
+    constexpr uint32_t TRACK_UUID = 1;
+    constexpr uint32_t TRACK_NAME = 2;
+    constexpr uint32_t TRACK_PROCESS = 3;
+    constexpr uint32_t TRACK_THREAD = 4;
+    constexpr uint32_t TRACK_PARENT_UUID = 5;
+    constexpr uint32_t TRACK_COUNTER = 8;
+    // ProcessDescriptor / ThreadDescriptor
+    constexpr uint32_t PROCESS_PID = 1;
+    constexpr uint32_t PROCESS_NAME = 6;
+    constexpr uint32_t THREAD_PID = 1;
+    constexpr uint32_t THREAD_TID = 2;
+    constexpr uint32_t THREAD_NAME = 5;
+    // TrackEvent
+    constexpr uint32_t EVENT_CATEGORY_IIDS = 3;
+    constexpr uint32_t EVENT_TYPE = 9;
+    constexpr uint32_t EVENT_NAME_IID = 10;
+    constexpr uint32_t EVENT_TRACK_UUID = 11;
+    constexpr uint32_t EVENT_COUNTER_VALUE = 30;
+    constexpr uint32_t EVENT_FLOW_IDS = 47;
+    constexpr uint32_t EVENT_TERMINATING_FLOW_IDS = 48;
+    // InternedData, EventCategory / EventName
+    constexpr uint32_t INTERNED_CATEGORIES = 1;
+    constexpr uint32_t INTERNED_EVENT_NAMES = 2;
+    constexpr uint32_t INTERNED_IID = 1;
+    constexpr uint32_t INTERNED_NAME = 2;
+
+    // TrackEvent.Type
+    constexpr uint64_t TYPE_SLICE_BEGIN = 1;
+    constexpr uint64_t TYPE_SLICE_END = 2;
+    constexpr uint64_t TYPE_INSTANT = 3;
+    constexpr uint64_t TYPE_COUNTER = 4;
+    // TracePacket.SequenceFlags
+    constexpr uint64_t SEQ_INCREMENTAL_STATE_CLEARED = 1;
+    constexpr uint64_t SEQ_NEEDS_INCREMENTAL_STATE = 2;
+    // BuiltinClock: the tracer stamps events with steady_clock
+    constexpr uint64_t BUILTIN_CLOCK_MONOTONIC = 3;
+}
+
+// Protobuf wire-format encoder appending to a byte string
+class ProtoBuffer {
+public:
+    static constexpr uint32_t WIRE_VARINT = 0;
+    static constexpr uint32_t WIRE_FIXED64 = 1;
+    static constexpr uint32_t WIRE_BYTES = 2;
+
+    void varint(uint32_t field, uint64_t value) {
+        tag(field, WIRE_VARINT);
+        raw_varint(value);
+    }
+
+    void fixed64(uint32_t field, uint64_t value) {
+        tag(field, WIRE_FIXED64);
+        uint8_t bytes[8];
+        std::memcpy(bytes, &value, sizeof(bytes));  // Little-endian, as the rest of the format
+        data_.append(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+    }
+
+    void bytes(uint32_t field, std::string_view value) {
+        tag(field, WIRE_BYTES);
+        raw_varint(value.size());
+        data_.append(value.data(), value.size());
+    }
+
+    void message(uint32_t field, const ProtoBuffer& nested) {
+        bytes(field, nested.data_);
+    }
+
+    void clear() {
+        data_.clear();
+    }
+
+    bool empty() const {
+        return data_.empty();
+    }
+
+    const std::string& data() const {
+        return data_;
+    }
+
+private:
+    void tag(uint32_t field, uint32_t wire_type) {
+        raw_varint((static_cast<uint64_t>(field) << 3) | wire_type);
+    }
+
+    void raw_varint(uint64_t value) {
+        uint8_t buffer[MAX_VARINT_BYTES];
+        uint8_t* end = write_varint(buffer, value);
+        data_.append(reinterpret_cast<const char*>(buffer), end - buffer);
+    }
+
+    std::string data_;
+};
+
+} // namespace internal
+
+/**
+ * Streaming writer for Perfetto's binary trace format (a Trace message of
+ * TracePackets), encoded by hand so there is no protobuf dependency.
+ *
+ * Events must be appended in timestamp order. Each traced thread becomes a
+ * thread track (described once, on first use) carrying its lock holds,
+ * blocked waits, tasks and spans as slices; counters get one counter track
+ * per name; flow events, task queueing and coroutine resumption become
+ * flows; other events are instants.
+ *
+ * All packets share one sequence with incremental state: event names such
+ * as "lock 0x7f..." and categories are interned on first use and later
+ * packets refer to them by iid, so a lock's name is written once no matter
+ * how often it is taken. Memory is proportional to the distinct names,
+ * threads and open slices, not to the number of events.
+ *
+ * Perfetto requires slices on a track to nest. Lock holds that do not
+ * (hand-over-hand locking) are split: releasing an outer lock ends the
+ * slices above it and begins them again at the same timestamp.
+ */
+class PerfettoTraceWriter {
+public:
+    PerfettoTraceWriter() = default;
+
+    ~PerfettoTraceWriter() {
+        close();
+    }
+
+    PerfettoTraceWriter(const PerfettoTraceWriter&) = delete;
+    PerfettoTraceWriter& operator=(const PerfettoTraceWriter&) = delete;
+
+    bool open(const char* path) {
+        namespace pf = internal::perfetto;
+        if (file_) {
+            return false;
+        }
+        file_ = std::fopen(path, "wb");
+        if (!file_) {
+            return false;
+        }
+        buffer_.resize(1 << 20);
+        std::setvbuf(file_, buffer_.data(), _IOFBF, buffer_.size());
+        bytes_written_ = 0;
+        packets_written_ = 0;
+        names_.clear();
+        threads_.clear();
+        counters_.clear();
+        stacks_.clear();
+        pending_interned_.clear();
+        next_iid_ = 1;
+
+        // First packet: clears incremental state and sets the clock for the sequence
+        internal::ProtoBuffer defaults;
+        defaults.varint(pf::DEFAULTS_CLOCK_ID, pf::BUILTIN_CLOCK_MONOTONIC);
+        internal::ProtoBuffer process;
+        process.varint(pf::PROCESS_PID, PID);
+        process.bytes(pf::PROCESS_NAME, "ucdbg");
+        track_.clear();
+        track_.varint(pf::TRACK_UUID, PROCESS_TRACK);
+        track_.message(pf::TRACK_PROCESS, process);
+        packet_.clear();
+        packet_.varint(pf::PACKET_SEQUENCE_ID, SEQUENCE_ID);
+        packet_.varint(pf::PACKET_SEQUENCE_FLAGS, pf::SEQ_INCREMENTAL_STATE_CLEARED);
+        packet_.message(pf::PACKET_DEFAULTS, defaults);
+        packet_.message(pf::PACKET_TRACK_DESCRIPTOR, track_);
+        write_packet();
+        return true;
+    }
+
+    // Names for span, counter and log events, indexed by string_id_t
+    void set_strings(const std::vector<std::string>& strings) {
+        strings_ = strings;
+    }
+
+    // Describes the thread's track with its name (before or after its events)
+    void thread_name(thread_id_t thread_id, std::string_view name) {
+        threads_.insert(thread_id);
+        describe_thread(thread_id, name);
+    }
+
+    void append(const TraceEvent& event) {
+        if (!file_ || !event.is_valid()) {
+            return;
+        }
+        if (threads_.insert(event.thread_id).second) {
+            describe_thread(event.thread_id, std::string_view());
+        }
+        switch (event.kind) {
+            case EventKind::Concurrency:
+                append_concurrency(event);
+                break;
+            case EventKind::Span:
+                if (event.span.phase == SpanPhase::Begin) {
+                    begin_slice(event.thread_id, {NameKind::Span, event.span.name_id}, event.timestamp_ns);
+                } else {
+                    end_slice(event.thread_id, {NameKind::Span, event.span.name_id}, event.timestamp_ns);
+                }
+                break;
+            case EventKind::Counter:
+                append_counter(event);
+                break;
+            case EventKind::Log:
+                track_event(event.timestamp_ns, thread_track(event.thread_id), internal::perfetto::TYPE_INSTANT,
+                            {NameKind::Log, event.log.message_string_id});
+                break;
+            default:
+                break;  // Unknown kind from a newer writer
+        }
+    }
+
+    // Closes the file; slices still open show as unfinished in the UI. Returns false if any write failed.
+    bool close() {
+        if (!file_) {
+            return false;
+        }
+        bool ok = !std::ferror(file_);
+        ok = std::fclose(file_) == 0 && ok;
+        file_ = nullptr;
+        return ok;
+    }
+
+    uint64_t bytes_written() const {
+        return bytes_written_;
+    }
+
+    uint64_t packets_written() const {
+        return packets_written_;
+    }
+
+private:
+    static constexpr uint32_t SEQUENCE_ID = 1;
+    static constexpr int32_t PID = 1;
+    static constexpr uint64_t PROCESS_TRACK = 1;
+    static constexpr uint64_t THREAD_TRACK_BASE = 1ull << 62;
+    static constexpr uint64_t COUNTER_TRACK_BASE = 2ull << 62;
+
+    // What an interned event name refers to; the id's meaning depends on the kind
+    enum class NameKind : uint8_t {
+        Hold,           // id: lock
+        SharedHold,
+        Wait,
+        SharedWait,
+        SemaphoreWait,
+        CondWait,
+        LatchWait,
+        BarrierWait,
+        Task,           // id unused
+        Span,           // id: string_id_t
+        Log,            // id: string_id_t
+        Instant,        // id: EventType
+        Flow,           // id: FlowCategory
+        Category        // id: category index (interned as a category, not a name)
+    };
+
+    enum FlowCategory : uint64_t {
+        FLOW_EVENTS = 0,
+        FLOW_TASK = 1,
+        FLOW_CORO = 2
+    };
+
+    struct NameKey {
+        NameKind kind;
+        uint64_t id;
+
+        bool operator==(const NameKey& other) const {
+            return kind == other.kind && id == other.id;
+        }
+    };
+
+    struct NameKeyHash {
+        size_t operator()(const NameKey& key) const {
+            uint64_t h = (key.id ^ (static_cast<uint64_t>(key.kind) << 56)) * 0x9E3779B97F4A7C15ull;
+            return static_cast<size_t>(h ^ (h >> 31));
+        }
+    };
+
+    struct OpenSlice {
+        NameKey key;
+        uint64_t name_iid;
+    };
+
+    static uint64_t thread_track(thread_id_t thread_id) {
+        return THREAD_TRACK_BASE | thread_id;
+    }
+
+    // Flow IDs of different sources must not collide: task IDs and frame addresses may coincide
+    static uint64_t flow_id(FlowCategory category, uint64_t id) {
+        return id ^ (static_cast<uint64_t>(category) * 0x9E3779B97F4A7C15ull);
+    }
+
+    void append_concurrency(const TraceEvent& event) {
+        thread_id_t tid = event.thread_id;
+        lock_id_t id = event.concurrency.lock_id;
+        timestamp_t ts = event.timestamp_ns;
+        switch (event.concurrency.type) {
+            case EventType::LockContended:
+                begin_slice(tid, {NameKind::Wait, id}, ts);
+                return;
+            case EventType::LockAcquire:
+                end_slice(tid, {NameKind::Wait, id}, ts);
+                begin_slice(tid, {NameKind::Hold, id}, ts);
+                return;
+            case EventType::LockRelease:
+                end_slice(tid, {NameKind::Hold, id}, ts);
+                return;
+            case EventType::SharedLockContended:
+                begin_slice(tid, {NameKind::SharedWait, id}, ts);
+                return;
+            case EventType::SharedLockAcquire:
+                end_slice(tid, {NameKind::SharedWait, id}, ts);
+                begin_slice(tid, {NameKind::SharedHold, id}, ts);
+                return;
+            case EventType::SharedLockRelease:
+                end_slice(tid, {NameKind::SharedHold, id}, ts);
+                return;
+            case EventType::SemaphoreContended:
+                begin_slice(tid, {NameKind::SemaphoreWait, id}, ts);
+                return;
+            case EventType::SemaphoreAcquire:
+                end_slice(tid, {NameKind::SemaphoreWait, id}, ts);
+                return;
+            case EventType::CondWaitBegin:
+                begin_slice(tid, {NameKind::CondWait, id}, ts);
+                return;
+            case EventType::CondWaitEnd:
+                end_slice(tid, {NameKind::CondWait, id}, ts);
+                return;
+            case EventType::LatchWaitBegin:
+                begin_slice(tid, {NameKind::LatchWait, id}, ts);
+                return;
+            case EventType::LatchWaitEnd:
+                end_slice(tid, {NameKind::LatchWait, id}, ts);
+                return;
+            case EventType::BarrierWaitBegin:
+                begin_slice(tid, {NameKind::BarrierWait, id}, ts);
+                return;
+            case EventType::BarrierWaitEnd:
+                end_slice(tid, {NameKind::BarrierWait, id}, ts);
+                return;
+            case EventType::LockHoldHistogram:
+            case EventType::LockWaitHistogram:
+            case EventType::LockClassName:
+            case EventType::AtomicCounterOwner:
+                return;  // Summary records (ucdbg-analyze), not points in time
+            case EventType::TaskEnqueue:
+                flow_point(event, FLOW_TASK, false);
+                return;
+            case EventType::TaskBegin:
+                // Slice first, so the flow ends inside the task slice
+                begin_slice(tid, {NameKind::Task, 0}, ts, id);
+                return;
+            case EventType::TaskEnd:
+                end_slice(tid, {NameKind::Task, 0}, ts);
+                return;
+            case EventType::CoroSuspend:
+                flow_point(event, FLOW_CORO, false);
+                return;
+            case EventType::CoroResume:
+                flow_point(event, FLOW_CORO, true);
+                return;
+            case EventType::FlowBegin:
+            case EventType::FlowStep:
+                flow_point(event, FLOW_EVENTS, false);
+                return;
+            case EventType::FlowEnd:
+                flow_point(event, FLOW_EVENTS, true);
+                return;
+            default:
+                track_event(ts, thread_track(tid), internal::perfetto::TYPE_INSTANT,
+                            {NameKind::Instant, static_cast<uint64_t>(event.concurrency.type)});
+                return;
+        }
+    }
+
+    void append_counter(const TraceEvent& event) {
+        namespace pf = internal::perfetto;
+        uint64_t track = COUNTER_TRACK_BASE | event.counter.name_id;
+        if (counters_.insert(event.counter.name_id).second) {
+            internal::ProtoBuffer counter;
+            track_.clear();
+            track_.varint(pf::TRACK_UUID, track);
+            track_.varint(pf::TRACK_PARENT_UUID, PROCESS_TRACK);
+            track_.bytes(pf::TRACK_NAME, string_name(event.counter.name_id));
+            track_.message(pf::TRACK_COUNTER, counter);
+            packet_.clear();
+            packet_.varint(pf::PACKET_SEQUENCE_ID, SEQUENCE_ID);
+            packet_.message(pf::PACKET_TRACK_DESCRIPTOR, track_);
+            write_packet();
+        }
+        event_.clear();
+        event_.varint(pf::EVENT_TYPE, pf::TYPE_COUNTER);
+        event_.varint(pf::EVENT_TRACK_UUID, track);
+        event_.varint(pf::EVENT_COUNTER_VALUE, static_cast<uint64_t>(event.counter.value));
+        write_event(event.timestamp_ns);
+    }
+
+    void describe_thread(thread_id_t thread_id, std::string_view name) {
+        namespace pf = internal::perfetto;
+        internal::ProtoBuffer thread;
+        thread.varint(pf::THREAD_PID, PID);
+        thread.varint(pf::THREAD_TID, static_cast<uint32_t>(thread_id));
+        if (!name.empty()) {
+            thread.bytes(pf::THREAD_NAME, name);
+        }
+        track_.clear();
+        track_.varint(pf::TRACK_UUID, thread_track(thread_id));
+        track_.varint(pf::TRACK_PARENT_UUID, PROCESS_TRACK);
+        track_.message(pf::TRACK_THREAD, thread);
+        packet_.clear();
+        packet_.varint(pf::PACKET_SEQUENCE_ID, SEQUENCE_ID);
+        packet_.message(pf::PACKET_TRACK_DESCRIPTOR, track_);
+        write_packet();
+    }
+
+    // Instant carrying a flow ID: continues the flow, or terminates it
+    void flow_point(const TraceEvent& event, FlowCategory category, bool terminating) {
+        namespace pf = internal::perfetto;
+        uint64_t id = flow_id(category, event.concurrency.lock_id);
+        event_.clear();
+        event_.varint(pf::EVENT_TYPE, pf::TYPE_INSTANT);
+        event_.varint(pf::EVENT_TRACK_UUID, thread_track(event.thread_id));
+        event_.varint(pf::EVENT_NAME_IID, intern({NameKind::Flow, category}));
+        event_.fixed64(terminating ? pf::EVENT_TERMINATING_FLOW_IDS : pf::EVENT_FLOW_IDS, id);
+        write_event(event.timestamp_ns);
+    }
+
+    void begin_slice(thread_id_t tid, const NameKey& key, timestamp_t ts, uint64_t task_id = 0) {
+        namespace pf = internal::perfetto;
+        uint64_t iid = intern(key);
+        stacks_[tid].push_back({key, iid});
+        event_.clear();
+        event_.varint(pf::EVENT_TYPE, pf::TYPE_SLICE_BEGIN);
+        event_.varint(pf::EVENT_TRACK_UUID, thread_track(tid));
+        event_.varint(pf::EVENT_CATEGORY_IIDS, intern({NameKind::Category, category_of(key.kind)}));
+        event_.varint(pf::EVENT_NAME_IID, iid);
+        if (key.kind == NameKind::Task) {
+            event_.fixed64(pf::EVENT_TERMINATING_FLOW_IDS, flow_id(FLOW_TASK, task_id));
+        }
+        write_event(ts);
+    }
+
+    // Ends the innermost open slice for key, splitting the slices above it; unmatched ends are dropped
+    void end_slice(thread_id_t tid, const NameKey& key, timestamp_t ts) {
+        namespace pf = internal::perfetto;
+        auto it = stacks_.find(tid);
+        if (it == stacks_.end()) {
+            return;
+        }
+        std::vector<OpenSlice>& stack = it->second;
+        size_t depth = stack.size();
+        while (depth > 0 && !(stack[depth - 1].key == key)) {
+            --depth;
+        }
+        if (depth == 0) {
+            return;
+        }
+        for (size_t i = stack.size(); i >= depth; --i) {
+            event_.clear();
+            event_.varint(pf::EVENT_TYPE, pf::TYPE_SLICE_END);
+            event_.varint(pf::EVENT_TRACK_UUID, thread_track(tid));
+            write_event(ts);
+        }
+        stack.erase(stack.begin() + (depth - 1));
+        for (size_t i = depth - 1; i < stack.size(); ++i) {
+            event_.clear();
+            event_.varint(pf::EVENT_TYPE, pf::TYPE_SLICE_BEGIN);
+            event_.varint(pf::EVENT_TRACK_UUID, thread_track(tid));
+            event_.varint(pf::EVENT_CATEGORY_IIDS, intern({NameKind::Category, category_of(stack[i].key.kind)}));
+            event_.varint(pf::EVENT_NAME_IID, stack[i].name_iid);
+            write_event(ts);
+        }
+        if (stack.empty()) {
+            stacks_.erase(it);
+        }
+    }
+
+    void track_event(timestamp_t ts, uint64_t track, uint64_t type, const NameKey& key) {
+        namespace pf = internal::perfetto;
+        event_.clear();
+        event_.varint(pf::EVENT_TYPE, type);
+        event_.varint(pf::EVENT_TRACK_UUID, track);
+        event_.varint(pf::EVENT_NAME_IID, intern(key));
+        write_event(ts);
+    }
+
+    static uint64_t category_of(NameKind kind) {
+        switch (kind) {
+            case NameKind::Task: return 1;
+            case NameKind::Span: return 2;
+            default: return 0;
+        }
+    }
+
+    // iid for key; a new name is queued for the next packet's interned_data
+    uint64_t intern(const NameKey& key) {
+        namespace pf = internal::perfetto;
+        auto [it, inserted] = names_.try_emplace(key, next_iid_);
+        if (inserted) {
+            ++next_iid_;
+            internal::ProtoBuffer entry;
+            entry.varint(pf::INTERNED_IID, it->second);
+            entry.bytes(pf::INTERNED_NAME, name_of(key));
+            pending_interned_.message(
+                key.kind == NameKind::Category ? pf::INTERNED_CATEGORIES : pf::INTERNED_EVENT_NAMES, entry);
+        }
+        return it->second;
+    }
+
+    std::string name_of(const NameKey& key) const {
+        switch (key.kind) {
+            case NameKind::Hold: return "lock " + hex(key.id);
+            case NameKind::SharedHold: return "shared lock " + hex(key.id);
+            case NameKind::Wait: return "wait lock " + hex(key.id);
+            case NameKind::SharedWait: return "wait shared lock " + hex(key.id);
+            case NameKind::SemaphoreWait: return "wait semaphore " + hex(key.id);
+            case NameKind::CondWait: return "cond wait " + hex(key.id);
+            case NameKind::LatchWait: return "wait latch " + hex(key.id);
+            case NameKind::BarrierWait: return "wait barrier " + hex(key.id);
+            case NameKind::Task: return "task";
+            case NameKind::Span: return string_name(static_cast<string_id_t>(key.id));
+            case NameKind::Log: return "log: " + string_name(static_cast<string_id_t>(key.id));
+            case NameKind::Instant: return event_type_to_string(static_cast<EventType>(key.id));
+            case NameKind::Flow:
+                return key.id == FLOW_TASK ? "enqueue" : key.id == FLOW_CORO ? "coro" : "flow";
+            case NameKind::Category:
+                return key.id == 1 ? "task" : key.id == 2 ? "span" : "lock";
+        }
+        return "?";
+    }
+
+    const std::string& string_name(string_id_t id) const {
+        static const std::string unknown = "?";
+        return id < strings_.size() ? strings_[id] : unknown;
+    }
+
+    static std::string hex(uint64_t value) {
+        char text[24];
+        std::snprintf(text, sizeof(text), "0x%" PRIx64, value);
+        return text;
+    }
+
+    // Wraps event_ in a packet, with any names interned since the last one
+    void write_event(timestamp_t ts) {
+        namespace pf = internal::perfetto;
+        packet_.clear();
+        packet_.varint(pf::PACKET_TIMESTAMP, ts);
+        packet_.varint(pf::PACKET_SEQUENCE_ID, SEQUENCE_ID);
+        packet_.varint(pf::PACKET_SEQUENCE_FLAGS, pf::SEQ_NEEDS_INCREMENTAL_STATE);
+        if (!pending_interned_.empty()) {
+            packet_.message(pf::PACKET_INTERNED_DATA, pending_interned_);
+            pending_interned_.clear();
+        }
+        packet_.message(pf::PACKET_TRACK_EVENT, event_);
+        write_packet();
+    }
+
+    void write_packet() {
+        frame_.clear();
+        frame_.message(internal::perfetto::TRACE_PACKET, packet_);
+        std::fwrite(frame_.data().data(), 1, frame_.data().size(), file_);
+        bytes_written_ += frame_.data().size();
+        ++packets_written_;
+    }
+
+    std::FILE* file_ = nullptr;
+    std::vector<char> buffer_;
+    uint64_t bytes_written_ = 0;
+    uint64_t packets_written_ = 0;
+    uint64_t next_iid_ = 1;
+    std::vector<std::string> strings_;
+    std::unordered_map<NameKey, uint64_t, NameKeyHash> names_;
+    std::unordered_set<thread_id_t> threads_;
+    std::unordered_set<string_id_t> counters_;
+    std::unordered_map<thread_id_t, std::vector<OpenSlice>> stacks_;
+    // Scratch buffers reused across packets
+    internal::ProtoBuffer pending_interned_;
+    internal::ProtoBuffer event_;
+    internal::ProtoBuffer track_;
+    internal::ProtoBuffer packet_;
+    internal::ProtoBuffer frame_;
+};
+
+} // namespace ucdbg
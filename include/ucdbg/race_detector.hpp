@@ -0,0 +1,379 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <ucdbg/trace_types.hpp>
+
+namespace ucdbg {
+
+// One side of a data race
+struct RaceAccess {
+    thread_id_t thread_id = 0;
+    timestamp_t ts = 0;
+    string_id_t site = 0;               // arg of the MemoryRead/MemoryWrite event
+    bool write = false;
+};
+
+/**
+ * Two conflicting accesses to an annotated variable (at least one a write)
+ * with no happens-before order between them. count is how often the same
+ * pair of sites raced on the address.
+ */
+struct DataRace {
+    uint64_t address = 0;
+    RaceAccess previous;
+    RaceAccess current;
+    uint64_t count = 1;
+};
+
+namespace internal {
+
+/**
+ * Vector clock over dense thread slots. Slots past the end are zero, so a
+ * clock only stores entries up to the highest thread it has heard of.
+ */
+class VectorClock {
+public:
+    uint64_t get(uint32_t slot) const {
+        return slot < clocks_.size() ? clocks_[slot] : 0;
+    }
+
+    void set(uint32_t slot, uint64_t value) {
+        if (slot >= clocks_.size()) {
+            clocks_.resize(slot + 1, 0);
+        }
+        clocks_[slot] = value;
+    }
+
+    void join(const VectorClock& other) {
+        if (other.clocks_.size() > clocks_.size()) {
+            clocks_.resize(other.clocks_.size(), 0);
+        }
+        for (size_t i = 0; i < other.clocks_.size(); ++i) {
+            clocks_[i] = other.clocks_[i] > clocks_[i] ? other.clocks_[i] : clocks_[i];
+        }
+    }
+
+private:
+    std::vector<uint64_t> clocks_;
+};
+
+} // namespace internal
+
+/**
+ * Streaming happens-before data race detector (FastTrack-style).
+ *
+ * Feed every event in timestamp order (BlockTraceReader::
+ * for_each_event_ordered). Each thread carries a vector clock, advanced at
+ * each release. Happens-before edges come from:
+ *   - lock release -> acquire of the same lock_id (a shared release orders
+ *     only later exclusive acquires; a condition wait releases and
+ *     reacquires its mutex)
+ *   - semaphore release -> acquire, latch and barrier arrival -> wait end
+ *   - ThreadSpawn -> ThreadStart and ThreadEnd -> ThreadJoin (ucdbg::jthread)
+ *   - TaskEnqueue -> TaskBegin, flow and coroutine suspend/resume hand-offs
+ *
+ * MemoryRead/MemoryWrite events (memory_access.hpp) are checked against
+ * the last write and the reads since it. Variables keep epochs (one
+ * thread's clock value) rather than vector clocks: a read-shared vector is
+ * kept only while reads by several threads are concurrent, so the common
+ * cases cost O(1) and memory stays proportional to the annotated
+ * variables. Acquire/release costs O(threads seen).
+ *
+ * Releases must be stamped before the unlock (the guards and the preload
+ * interposer do) or the acquire that follows could sort ahead of them.
+ */
+class RaceDetector {
+public:
+    // Distinct races kept; later ones are only counted (see dropped())
+    static constexpr size_t RACE_REPORT_LIMIT = 10000;
+
+    void add(const TraceEvent& event) {
+        if (!event.is_valid() || event.kind != EventKind::Concurrency) {
+            return;
+        }
+        uint64_t id = event.concurrency.lock_id;
+        switch (event.concurrency.type) {
+            case EventType::ThreadStart: {
+                ThreadState& thread = thread_state(event.thread_id, true);
+                if (id) {
+                    acquire(thread, {id, SyncKind::Spawn});
+                }
+                break;
+            }
+            case EventType::ThreadEnd: {
+                ThreadState& thread = thread_state(event.thread_id);
+                if (id) {
+                    release(thread, {id, SyncKind::Spawn});
+                }
+                thread.ended = true;
+                break;
+            }
+            case EventType::ThreadSpawn:
+                release(thread_state(event.thread_id), {id, SyncKind::Spawn});
+                break;
+            case EventType::ThreadJoin:
+                acquire(thread_state(event.thread_id), {id, SyncKind::Spawn});
+                break;
+            case EventType::LockAcquire: {
+                ThreadState& thread = thread_state(event.thread_id);
+                acquire(thread, {id, SyncKind::Lock});
+                acquire(thread, {id, SyncKind::SharedLock});
+                break;
+            }
+            case EventType::SharedLockAcquire:
+            case EventType::CondWaitEnd:
+                acquire(thread_state(event.thread_id), {id, SyncKind::Lock});
+                break;
+            case EventType::LockRelease:
+            case EventType::CondWaitBegin:
+                release(thread_state(event.thread_id), {id, SyncKind::Lock});
+                break;
+            case EventType::SharedLockRelease:
+                release(thread_state(event.thread_id), {id, SyncKind::SharedLock});
+                break;
+            case EventType::SemaphoreRelease:
+            case EventType::LatchArrive:
+            case EventType::BarrierArrive:
+                release(thread_state(event.thread_id), {id, SyncKind::Sync});
+                break;
+            case EventType::SemaphoreAcquire:
+            case EventType::LatchWaitEnd:
+            case EventType::BarrierWaitEnd:
+                acquire(thread_state(event.thread_id), {id, SyncKind::Sync});
+                break;
+            case EventType::TaskEnqueue:
+                release(thread_state(event.thread_id), {id, SyncKind::Task});
+                break;
+            case EventType::TaskBegin:
+                acquire(thread_state(event.thread_id), {id, SyncKind::Task});
+                break;
+            case EventType::FlowBegin:
+                release(thread_state(event.thread_id), {id, SyncKind::Flow});
+                break;
+            case EventType::FlowStep: {
+                ThreadState& thread = thread_state(event.thread_id);
+                acquire(thread, {id, SyncKind::Flow});
+                release(thread, {id, SyncKind::Flow});
+                break;
+            }
+            case EventType::FlowEnd:
+                acquire(thread_state(event.thread_id), {id, SyncKind::Flow});
+                break;
+            case EventType::CoroSuspend:
+                release(thread_state(event.thread_id), {id, SyncKind::Coro});
+                break;
+            case EventType::CoroResume:
+                acquire(thread_state(event.thread_id), {id, SyncKind::Coro});
+                break;
+            case EventType::MemoryRead:
+                read(thread_state(event.thread_id), id, event);
+                break;
+            case EventType::MemoryWrite:
+                write(thread_state(event.thread_id), id, event);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Distinct races, in the order they were detected
+    const std::vector<DataRace>& races() const {
+        return races_;
+    }
+
+    // Races past RACE_REPORT_LIMIT distinct ones
+    uint64_t dropped() const {
+        return dropped_;
+    }
+
+    uint64_t access_count() const {
+        return accesses_;
+    }
+
+    size_t variable_count() const {
+        return variables_.size();
+    }
+
+    // Thread incarnations seen (a reused thread ID counts again after ThreadEnd)
+    size_t thread_count() const {
+        return slot_threads_.size();
+    }
+
+private:
+    enum class SyncKind : uint8_t { Lock, SharedLock, Sync, Spawn, Task, Flow, Coro };
+
+    struct SyncKey {
+        uint64_t id;
+        SyncKind kind;
+
+        bool operator==(const SyncKey& other) const {
+            return id == other.id && kind == other.kind;
+        }
+    };
+
+    struct SyncKeyHash {
+        size_t operator()(const SyncKey& key) const {
+            uint64_t h = key.id * 0x9E3779B97F4A7C15ull ^ static_cast<uint64_t>(key.kind);
+            return static_cast<size_t>(h ^ (h >> 31));
+        }
+    };
+
+    struct ThreadState {
+        uint32_t slot = 0;
+        bool ended = false;
+        internal::VectorClock clock;
+
+        uint64_t epoch() const {
+            return clock.get(slot);
+        }
+    };
+
+    // An access at epoch clock@slot; clock 0 = none
+    struct Access {
+        uint32_t slot = 0;
+        string_id_t site = 0;
+        uint64_t clock = 0;
+        timestamp_t ts = 0;
+    };
+
+    struct VariableState {
+        Access write;
+        Access read;                    // Last read, unless reads are shared
+        std::vector<Access> shared_reads;   // Concurrent reads, one per thread
+    };
+
+    struct RaceKey {
+        uint64_t address;
+        string_id_t previous_site;
+        string_id_t current_site;
+        uint8_t kinds;
+
+        bool operator==(const RaceKey& other) const {
+            return address == other.address && previous_site == other.previous_site &&
+                   current_site == other.current_site && kinds == other.kinds;
+        }
+    };
+
+    struct RaceKeyHash {
+        size_t operator()(const RaceKey& key) const {
+            uint64_t h = key.address * 0x9E3779B97F4A7C15ull ^
+                         (static_cast<uint64_t>(key.previous_site) << 32 | key.current_site) * 0xC2B2AE3D27D4EB4Full ^
+                         key.kinds;
+            return static_cast<size_t>(h ^ (h >> 31));
+        }
+    };
+
+    // restart: ThreadStart, which begins a new incarnation if the ID had ended
+    ThreadState& thread_state(thread_id_t tid, bool restart = false) {
+        auto [it, inserted] = threads_.try_emplace(tid);
+        ThreadState& thread = it->second;
+        if (inserted || (restart && thread.ended)) {
+            thread = ThreadState();
+            thread.slot = static_cast<uint32_t>(slot_threads_.size());
+            thread.clock.set(thread.slot, 1);
+            slot_threads_.push_back(tid);
+        }
+        return thread;
+    }
+
+    void acquire(ThreadState& thread, const SyncKey& key) {
+        auto it = sync_.find(key);
+        if (it != sync_.end()) {
+            thread.clock.join(it->second);
+        }
+    }
+
+    void release(ThreadState& thread, const SyncKey& key) {
+        sync_[key].join(thread.clock);
+        thread.clock.set(thread.slot, thread.epoch() + 1);
+    }
+
+    // True if the access happened before everything thread does now
+    static bool ordered(const Access& access, const ThreadState& thread) {
+        return access.clock == 0 || access.slot == thread.slot || access.clock <= thread.clock.get(access.slot);
+    }
+
+    void read(ThreadState& thread, uint64_t address, const TraceEvent& event) {
+        ++accesses_;
+        VariableState& var = variables_[address];
+        Access now{thread.slot, static_cast<string_id_t>(event.concurrency_arg()), thread.epoch(), event.timestamp_ns};
+        if (var.shared_reads.empty() && var.read.slot == now.slot && var.read.clock == now.clock) {
+            return;  // Same epoch: nothing new to check
+        }
+        if (!ordered(var.write, thread)) {
+            report(address, var.write, true, now, false);
+        }
+        if (!var.shared_reads.empty()) {
+            for (Access& read : var.shared_reads) {
+                if (read.slot == now.slot) {
+                    read = now;
+                    return;
+                }
+            }
+            var.shared_reads.push_back(now);
+        } else if (ordered(var.read, thread)) {
+            var.read = now;
+        } else {
+            var.shared_reads = {var.read, now};
+        }
+    }
+
+    void write(ThreadState& thread, uint64_t address, const TraceEvent& event) {
+        ++accesses_;
+        VariableState& var = variables_[address];
+        Access now{thread.slot, static_cast<string_id_t>(event.concurrency_arg()), thread.epoch(), event.timestamp_ns};
+        if (var.write.slot == now.slot && var.write.clock == now.clock) {
+            var.write = now;
+            return;  // Same epoch: checked by the first write of the epoch
+        }
+        if (!ordered(var.write, thread)) {
+            report(address, var.write, true, now, true);
+        }
+        if (!var.shared_reads.empty()) {
+            for (const Access& read : var.shared_reads) {
+                if (!ordered(read, thread)) {
+                    report(address, read, false, now, true);
+                }
+            }
+            var.shared_reads.clear();
+            var.read = Access();
+        } else if (!ordered(var.read, thread)) {
+            report(address, var.read, false, now, true);
+        }
+        var.write = now;
+    }
+
+    void report(uint64_t address, const Access& previous, bool previous_write, const Access& current,
+                bool current_write) {
+        RaceKey key{address, previous.site, current.site,
+                    static_cast<uint8_t>(previous_write << 1 | static_cast<uint8_t>(current_write))};
+        auto it = reported_.find(key);
+        if (it != reported_.end()) {
+            ++races_[it->second].count;
+            return;
+        }
+        if (races_.size() >= RACE_REPORT_LIMIT) {
+            ++dropped_;
+            return;
+        }
+        reported_.emplace(key, races_.size());
+        DataRace race;
+        race.address = address;
+        race.previous = {slot_threads_[previous.slot], previous.ts, previous.site, previous_write};
+        race.current = {slot_threads_[current.slot], current.ts, current.site, current_write};
+        races_.push_back(race);
+    }
+
+    std::unordered_map<thread_id_t, ThreadState> threads_;
+    std::vector<thread_id_t> slot_threads_;
+    std::unordered_map<SyncKey, internal::VectorClock, SyncKeyHash> sync_;
+    std::unordered_map<uint64_t, VariableState> variables_;
+    std::unordered_map<RaceKey, size_t, RaceKeyHash> reported_;
+    std::vector<DataRace> races_;
+    uint64_t dropped_ = 0;
+    uint64_t accesses_ = 0;
+};
+
+} // namespace ucdbg
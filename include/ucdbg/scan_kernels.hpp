@@ -0,0 +1,361 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <ucdbg/columnar.hpp>
+#include <ucdbg/trace_types.hpp>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define UCDBG_HAVE_AVX2_KERNELS 1
+#endif
+
+namespace ucdbg {
+
+/**
+ * Scan kernels over TraceEvent arrays and columnar blocks.
+ *
+ * Both kernels only consider events a TraceReader view would yield (valid
+ * format version) of kind Concurrency:
+ *   select_lock_window  lock_id == X and begin <= timestamp_ns <= end,
+ *                       written as a selection bitmap (bit i = event i)
+ *   count_by_type       per-EventType counts, accumulated into counts[256]
+ *
+ * On x86-64 the AVX2 versions are chosen at runtime when the CPU supports
+ * them; everything else uses the scalar versions, which define the results.
+ */
+
+// Number of uint64_t words a selection bitmap over count events needs
+constexpr size_t bitmap_words(size_t count) {
+    return (count + 63) / 64;
+}
+
+namespace internal {
+
+constexpr uint64_t SIGN_BIT = 0x8000000000000000ull;
+
+// Bytes 16-23 of a serialized TraceEvent as one little-endian word
+inline uint64_t header_word(const TraceEvent& event) {
+    uint64_t word;
+    std::memcpy(&word, reinterpret_cast<const uint8_t*>(&event) + 16, sizeof(word));
+    return word;
+}
+
+inline bool selectable(uint8_t version, uint8_t kind) {
+    return version <= TRACE_FORMAT_VERSION && kind == static_cast<uint8_t>(EventKind::Concurrency);
+}
+
+inline size_t select_lock_window_scalar(const TraceEvent* events, size_t count, lock_id_t lock_id,
+                                        timestamp_t begin, timestamp_t end, uint64_t* bitmap) {
+    std::memset(bitmap, 0, bitmap_words(count) * sizeof(uint64_t));
+    size_t selected = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const TraceEvent& e = events[i];
+        uint64_t header = header_word(e);
+        bool hit = selectable(static_cast<uint8_t>(header), static_cast<uint8_t>(header >> 8)) &&
+                   e.concurrency.lock_id == lock_id && e.timestamp_ns >= begin && e.timestamp_ns <= end;
+        bitmap[i / 64] |= static_cast<uint64_t>(hit) << (i % 64);
+        selected += hit;
+    }
+    return selected;
+}
+
+inline size_t select_lock_window_scalar(const uint64_t* timestamps, const uint64_t* lock_ids,
+                                        const uint8_t* versions, const uint8_t* kinds, size_t count,
+                                        lock_id_t lock_id, timestamp_t begin, timestamp_t end,
+                                        uint64_t* bitmap) {
+    std::memset(bitmap, 0, bitmap_words(count) * sizeof(uint64_t));
+    size_t selected = 0;
+    for (size_t i = 0; i < count; ++i) {
+        bool hit = selectable(versions[i], kinds[i]) && lock_ids[i] == lock_id &&
+                   timestamps[i] >= begin && timestamps[i] <= end;
+        bitmap[i / 64] |= static_cast<uint64_t>(hit) << (i % 64);
+        selected += hit;
+    }
+    return selected;
+}
+
+inline void count_by_type_scalar(const TraceEvent* events, size_t count, uint64_t* counts) {
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t header = header_word(events[i]);
+        if (selectable(static_cast<uint8_t>(header), static_cast<uint8_t>(header >> 8))) {
+            counts[static_cast<uint8_t>(header >> 32)]++;
+        }
+    }
+}
+
+inline void count_by_type_scalar(const uint8_t* versions, const uint8_t* kinds, const uint8_t* types,
+                                 size_t count, uint64_t* counts) {
+    for (size_t i = 0; i < count; ++i) {
+        if (selectable(versions[i], kinds[i])) {
+            counts[types[i]]++;
+        }
+    }
+}
+
+#ifdef UCDBG_HAVE_AVX2_KERNELS
+
+inline bool cpu_has_avx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+// Lanes where begin <= ts <= end (unsigned), given sign-flipped bounds
+__attribute__((target("avx2")))
+inline __m256i avx2_in_window(__m256i ts, __m256i begin_flipped, __m256i end_flipped) {
+    __m256i flipped = _mm256_xor_si256(ts, _mm256_set1_epi64x(static_cast<long long>(SIGN_BIT)));
+    __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi64(begin_flipped, flipped),
+                                      _mm256_cmpgt_epi64(flipped, end_flipped));
+    return _mm256_xor_si256(outside, _mm256_set1_epi64x(-1));
+}
+
+// Lanes whose header word has kind Concurrency and a supported version
+__attribute__((target("avx2")))
+inline __m256i avx2_selectable(__m256i header) {
+    __m256i kind_is_zero = _mm256_cmpeq_epi64(_mm256_and_si256(header, _mm256_set1_epi64x(0xFF00)),
+                                              _mm256_setzero_si256());
+    __m256i version = _mm256_and_si256(header, _mm256_set1_epi64x(0xFF));
+    __m256i version_ok = _mm256_cmpgt_epi64(_mm256_set1_epi64x(TRACE_FORMAT_VERSION + 1), version);
+    return _mm256_and_si256(kind_is_zero, version_ok);
+}
+
+/**
+ * Array-of-structs: each 32-byte event is one ymm register. Four events are
+ * transposed so timestamps, header words and lock IDs each fill a register:
+ *   e = [ts, tid, header, lock_id]
+ *   unpacklo(a,b) = [a.ts, b.ts, a.hdr, b.hdr]   unpackhi(a,b) = [a.tid, b.tid, a.lock, b.lock]
+ */
+__attribute__((target("avx2")))
+inline size_t select_lock_window_avx2(const TraceEvent* events, size_t count, lock_id_t lock_id,
+                                      timestamp_t begin, timestamp_t end, uint64_t* bitmap) {
+    const __m256i lock = _mm256_set1_epi64x(static_cast<long long>(lock_id));
+    const __m256i begin_flipped = _mm256_set1_epi64x(static_cast<long long>(begin ^ SIGN_BIT));
+    const __m256i end_flipped = _mm256_set1_epi64x(static_cast<long long>(end ^ SIGN_BIT));
+    const auto* base = reinterpret_cast<const __m256i*>(events);
+
+    size_t selected = 0;
+    size_t full_words = count / 64;
+    for (size_t w = 0; w < full_words; ++w) {
+        uint64_t word = 0;
+        for (size_t j = 0; j < 64; j += 4) {
+            const __m256i* p = base + w * 64 + j;
+            __m256i a = _mm256_loadu_si256(p);
+            __m256i b = _mm256_loadu_si256(p + 1);
+            __m256i c = _mm256_loadu_si256(p + 2);
+            __m256i d = _mm256_loadu_si256(p + 3);
+            __m256i lo_ab = _mm256_unpacklo_epi64(a, b);
+            __m256i lo_cd = _mm256_unpacklo_epi64(c, d);
+            __m256i hi_ab = _mm256_unpackhi_epi64(a, b);
+            __m256i hi_cd = _mm256_unpackhi_epi64(c, d);
+            __m256i ts = _mm256_permute2x128_si256(lo_ab, lo_cd, 0x20);
+            __m256i header = _mm256_permute2x128_si256(lo_ab, lo_cd, 0x31);
+            __m256i locks = _mm256_permute2x128_si256(hi_ab, hi_cd, 0x31);
+
+            __m256i hit = _mm256_and_si256(_mm256_cmpeq_epi64(locks, lock),
+                                           avx2_in_window(ts, begin_flipped, end_flipped));
+            hit = _mm256_and_si256(hit, avx2_selectable(header));
+            word |= static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(hit))) << j;
+        }
+        bitmap[w] = word;
+        selected += static_cast<size_t>(__builtin_popcountll(word));
+    }
+    size_t done = full_words * 64;
+    if (done < count) {
+        selected += select_lock_window_scalar(events + done, count - done, lock_id, begin, end, bitmap + full_words);
+    }
+    return selected;
+}
+
+__attribute__((target("avx2")))
+inline size_t select_lock_window_avx2(const uint64_t* timestamps, const uint64_t* lock_ids,
+                                      const uint8_t* versions, const uint8_t* kinds, size_t count,
+                                      lock_id_t lock_id, timestamp_t begin, timestamp_t end,
+                                      uint64_t* bitmap) {
+    const __m256i lock = _mm256_set1_epi64x(static_cast<long long>(lock_id));
+    const __m256i begin_flipped = _mm256_set1_epi64x(static_cast<long long>(begin ^ SIGN_BIT));
+    const __m256i end_flipped = _mm256_set1_epi64x(static_cast<long long>(end ^ SIGN_BIT));
+
+    size_t selected = 0;
+    size_t full_words = count / 64;
+    for (size_t w = 0; w < full_words; ++w) {
+        uint64_t word = 0;
+        for (size_t j = 0; j < 64; j += 4) {
+            size_t i = w * 64 + j;
+            __m256i ts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(timestamps + i));
+            __m256i locks = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lock_ids + i));
+            // Rebuild a header word (version | kind << 8) per lane from the byte columns
+            uint32_t v4, k4;
+            std::memcpy(&v4, versions + i, sizeof(v4));
+            std::memcpy(&k4, kinds + i, sizeof(k4));
+            __m256i header = _mm256_or_si256(
+                _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(static_cast<int>(v4))),
+                _mm256_slli_epi64(_mm256_cvtepu8_epi64(_mm_cvtsi32_si128(static_cast<int>(k4))), 8));
+
+            __m256i hit = _mm256_and_si256(_mm256_cmpeq_epi64(locks, lock),
+                                           avx2_in_window(ts, begin_flipped, end_flipped));
+            hit = _mm256_and_si256(hit, avx2_selectable(header));
+            word |= static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(hit))) << j;
+        }
+        bitmap[w] = word;
+        selected += static_cast<size_t>(__builtin_popcountll(word));
+    }
+    size_t done = full_words * 64;
+    if (done < count) {
+        selected += select_lock_window_scalar(timestamps + done, lock_ids + done, versions + done, kinds + done,
+                                              count - done, lock_id, begin, end, bitmap + full_words);
+    }
+    return selected;
+}
+
+/**
+ * Array-of-structs: the version, kind and type bytes sit in one header word
+ * per event, so this is the scalar loop made branch-free: rejected events
+ * are redirected to a discard slot, spread over four tables to avoid
+ * store-forwarding stalls on repeated types. The scan is bound by memory
+ * bandwidth (32 bytes per event), which a transpose into registers does not
+ * change.
+ */
+__attribute__((target("avx2")))
+inline void count_by_type_avx2(const TraceEvent* events, size_t count, uint64_t* counts) {
+    uint64_t tables[4][257] = {};
+    auto slot = [](const TraceEvent& e) -> size_t {
+        uint64_t header = header_word(e);
+        return selectable(static_cast<uint8_t>(header), static_cast<uint8_t>(header >> 8))
+                   ? static_cast<uint8_t>(header >> 32) : 256;
+    };
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        tables[0][slot(events[i])]++;
+        tables[1][slot(events[i + 1])]++;
+        tables[2][slot(events[i + 2])]++;
+        tables[3][slot(events[i + 3])]++;
+    }
+    for (size_t t = 0; t < 256; ++t) {
+        counts[t] += tables[0][t] + tables[1][t] + tables[2][t] + tables[3][t];
+    }
+    count_by_type_scalar(events + i, count - i, counts);
+}
+
+/**
+ * Columnar: 32 events per iteration. The version and kind columns are
+ * checked with byte compares and rejected lanes get type 0xFF; the 32 type
+ * bytes then index four 256-entry tables, so the work per event does not
+ * grow with the number of event types. Rejected lanes are counted from the
+ * mask and taken back out of slot 0xFF at the end.
+ */
+__attribute__((target("avx2")))
+inline void count_by_type_avx2(const uint8_t* versions, const uint8_t* kinds, const uint8_t* types,
+                               size_t count, uint64_t* counts) {
+    // 32-bit tables keep all four in 4 KB of L1; flushed before they can overflow
+    constexpr size_t FLUSH_EVENTS = size_t{1} << 30;
+    uint32_t tables[4][256] = {};
+    uint64_t rejected = 0;
+    const __m256i max_version = _mm256_set1_epi8(static_cast<char>(TRACE_FORMAT_VERSION));
+    const __m256i all_ones = _mm256_set1_epi8(-1);
+    auto flush = [&] {
+        for (size_t t = 0; t < 256; ++t) {
+            counts[t] += uint64_t{tables[0][t]} + tables[1][t] + tables[2][t] + tables[3][t];
+            tables[0][t] = tables[1][t] = tables[2][t] = tables[3][t] = 0;
+        }
+    };
+
+    size_t i = 0;
+    size_t since_flush = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(versions + i));
+        __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kinds + i));
+        __m256i t = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(types + i));
+        __m256i valid = _mm256_and_si256(_mm256_cmpeq_epi8(k, _mm256_setzero_si256()),
+                                         _mm256_cmpeq_epi8(_mm256_max_epu8(v, max_version), max_version));
+        rejected += static_cast<uint64_t>(
+            __builtin_popcount(~static_cast<uint32_t>(_mm256_movemask_epi8(valid))));
+        alignas(32) uint64_t slots[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(slots),
+                           _mm256_or_si256(t, _mm256_xor_si256(valid, all_ones)));
+        for (uint64_t word : slots) {
+            tables[0][word & 0xFF]++;
+            tables[1][(word >> 8) & 0xFF]++;
+            tables[2][(word >> 16) & 0xFF]++;
+            tables[3][(word >> 24) & 0xFF]++;
+            tables[0][(word >> 32) & 0xFF]++;
+            tables[1][(word >> 40) & 0xFF]++;
+            tables[2][(word >> 48) & 0xFF]++;
+            tables[3][word >> 56]++;
+        }
+        if ((since_flush += 32) >= FLUSH_EVENTS) {
+            flush();
+            since_flush = 0;
+        }
+    }
+    flush();
+    counts[0xFF] -= rejected;
+    count_by_type_scalar(versions + i, kinds + i, types + i, count - i, counts);
+}
+
+#else
+
+inline bool cpu_has_avx2() {
+    return false;
+}
+
+#endif // UCDBG_HAVE_AVX2_KERNELS
+
+} // namespace internal
+
+/**
+ * Marks events of lock_id within [begin, end] in bitmap, which must hold
+ * bitmap_words(events.size()) words. Returns the number of selected events.
+ */
+inline size_t select_lock_window(std::span<const TraceEvent> events, lock_id_t lock_id,
+                                 timestamp_t begin, timestamp_t end, uint64_t* bitmap) {
+#ifdef UCDBG_HAVE_AVX2_KERNELS
+    if (internal::cpu_has_avx2()) {
+        return internal::select_lock_window_avx2(events.data(), events.size(), lock_id, begin, end, bitmap);
+    }
+#endif
+    return internal::select_lock_window_scalar(events.data(), events.size(), lock_id, begin, end, bitmap);
+}
+
+// Columnar variant; block needs the Timestamp, LockId, Version and Kind columns
+inline size_t select_lock_window(const ColumnBlock& block, lock_id_t lock_id,
+                                 timestamp_t begin, timestamp_t end, uint64_t* bitmap) {
+    const uint64_t* ts = block.timestamps().data();
+    const uint64_t* locks = block.lock_ids().data();
+    const uint8_t* versions = block.versions().data();
+    const uint8_t* kinds = block.kinds().data();
+#ifdef UCDBG_HAVE_AVX2_KERNELS
+    if (internal::cpu_has_avx2()) {
+        return internal::select_lock_window_avx2(ts, locks, versions, kinds, block.size(), lock_id, begin, end, bitmap);
+    }
+#endif
+    return internal::select_lock_window_scalar(ts, locks, versions, kinds, block.size(), lock_id, begin, end, bitmap);
+}
+
+// Adds per-EventType counts of the events to counts[256]
+inline void count_by_type(std::span<const TraceEvent> events, uint64_t* counts) {
+#ifdef UCDBG_HAVE_AVX2_KERNELS
+    if (internal::cpu_has_avx2()) {
+        internal::count_by_type_avx2(events.data(), events.size(), counts);
+        return;
+    }
+#endif
+    internal::count_by_type_scalar(events.data(), events.size(), counts);
+}
+
+// Columnar variant; block needs the Version, Kind and Type columns
+inline void count_by_type(const ColumnBlock& block, uint64_t* counts) {
+    const uint8_t* versions = block.versions().data();
+    const uint8_t* kinds = block.kinds().data();
+    const uint8_t* types = block.types().data();
+#ifdef UCDBG_HAVE_AVX2_KERNELS
+    if (internal::cpu_has_avx2()) {
+        internal::count_by_type_avx2(versions, kinds, types, block.size(), counts);
+        return;
+    }
+#endif
+    internal::count_by_type_scalar(versions, kinds, types, block.size(), counts);
+}
+
+} // namespace ucdbg
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <ucdbg/event_helpers.hpp>
+#include <ucdbg/event_queue.hpp>
+#include <ucdbg/string_table.hpp>
+
+namespace ucdbg {
+namespace internal {
+
+// Emits Span Begin/End events around the enclosing scope (see UCDBG_SCOPE)
+class SpanGuard {
+public:
+    explicit SpanGuard(string_id_t name_id) : name_id_(name_id) {
+        emit(make_span_event(SpanPhase::Begin, name_id_));
+    }
+
+    ~SpanGuard() noexcept {
+        emit(make_span_event(SpanPhase::End, name_id_));
+    }
+
+    SpanGuard(const SpanGuard&) = delete;
+    SpanGuard& operator=(const SpanGuard&) = delete;
+    SpanGuard(SpanGuard&&) = delete;
+    SpanGuard& operator=(SpanGuard&&) = delete;
+
+private:
+    string_id_t name_id_;
+};
+
+} // namespace internal
+
+// Records a counter sample; name_id from ucdbg::intern() (see UCDBG_COUNTER)
+inline void counter(string_id_t name_id, int64_t value) {
+    internal::emit(internal::make_counter_event(name_id, value));
+}
+
+} // namespace ucdbg
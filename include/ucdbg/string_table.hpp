@@ -0,0 +1,59 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <ucdbg/trace_types.hpp>
+
+namespace ucdbg {
+namespace internal {
+
+/**
+ * Process-wide string interning for span, counter and log names.
+ *
+ * intern() takes a mutex, so hot paths intern once and cache the ID
+ * (UCDBG_SCOPE/UCDBG_COUNTER keep it in a function-local static). IDs are
+ * indexes into strings(), assigned in first-use order; the tracer writes the
+ * table into the trace at shutdown.
+ */
+class StringTable {
+public:
+    static StringTable& instance() {
+        static StringTable table;
+        return table;
+    }
+
+    string_id_t intern(std::string_view text) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = ids_.find(std::string(text));
+        if (it != ids_.end()) {
+            return it->second;
+        }
+        string_id_t id = static_cast<string_id_t>(strings_.size());
+        strings_.emplace_back(text);
+        ids_.emplace(strings_.back(), id);
+        return id;
+    }
+
+    // Copy of the table, indexed by string_id_t
+    std::vector<std::string> strings() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return strings_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::string> strings_;
+    std::unordered_map<std::string, string_id_t> ids_;
+};
+
+} // namespace internal
+
+// Interns text in the trace's string table, for spans/counters with runtime names
+inline string_id_t intern(std::string_view text) {
+    return internal::StringTable::instance().intern(text);
+}
+
+} // namespace ucdbg
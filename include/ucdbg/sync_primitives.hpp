@@ -0,0 +1,238 @@
+#pragma once
+
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <latch>
+#include <semaphore>
+#include <utility>
+#include <ucdbg/event_helpers.hpp>
+#include <ucdbg/event_queue.hpp>
+
+namespace ucdbg {
+namespace internal {
+
+/**
+ * std::counting_semaphore with tracing. Acquires try first, so only a
+ * blocking acquire costs SemaphoreContended before its SemaphoreAcquire.
+ */
+template <std::ptrdiff_t LeastMaxValue>
+class TracedCountingSemaphore {
+public:
+    explicit TracedCountingSemaphore(std::ptrdiff_t desired) : semaphore_(desired) {}
+
+    TracedCountingSemaphore(const TracedCountingSemaphore&) = delete;
+    TracedCountingSemaphore& operator=(const TracedCountingSemaphore&) = delete;
+
+    static constexpr std::ptrdiff_t max() noexcept {
+        return std::counting_semaphore<LeastMaxValue>::max();
+    }
+
+    void release(std::ptrdiff_t update = 1) {
+        emit(make_concurrency_event(EventType::SemaphoreRelease, id(), static_cast<uint32_t>(update)));
+        semaphore_.release(update);
+    }
+
+    void acquire() {
+        if (!semaphore_.try_acquire()) {
+            emit(make_concurrency_event(EventType::SemaphoreContended, id()));
+            semaphore_.acquire();
+        }
+        emit(make_concurrency_event(EventType::SemaphoreAcquire, id()));
+    }
+
+    bool try_acquire() noexcept {
+        if (!semaphore_.try_acquire()) {
+            return false;
+        }
+        emit(make_concurrency_event(EventType::SemaphoreAcquire, id()));
+        return true;
+    }
+
+    template <class Rep, class Period>
+    bool try_acquire_for(const std::chrono::duration<Rep, Period>& timeout) {
+        return try_acquire_until(std::chrono::steady_clock::now() + timeout);
+    }
+
+    // A SemaphoreContended without a matching SemaphoreAcquire is a timeout
+    template <class Clock, class Duration>
+    bool try_acquire_until(const std::chrono::time_point<Clock, Duration>& deadline) {
+        if (!semaphore_.try_acquire()) {
+            emit(make_concurrency_event(EventType::SemaphoreContended, id()));
+            if (!semaphore_.try_acquire_until(deadline)) {
+                return false;
+            }
+        }
+        emit(make_concurrency_event(EventType::SemaphoreAcquire, id()));
+        return true;
+    }
+
+private:
+    lock_id_t id() const {
+        return reinterpret_cast<lock_id_t>(this);
+    }
+
+    std::counting_semaphore<LeastMaxValue> semaphore_;
+};
+
+/**
+ * std::latch with tracing. The last LatchArrive is the straggler every
+ * waiter was held up by.
+ */
+class TracedLatch {
+public:
+    explicit TracedLatch(std::ptrdiff_t expected) : latch_(expected) {}
+
+    TracedLatch(const TracedLatch&) = delete;
+    TracedLatch& operator=(const TracedLatch&) = delete;
+
+    static constexpr std::ptrdiff_t max() noexcept {
+        return std::latch::max();
+    }
+
+    void count_down(std::ptrdiff_t update = 1) {
+        emit(make_concurrency_event(EventType::LatchArrive, id(), static_cast<uint32_t>(update)));
+        latch_.count_down(update);
+    }
+
+    bool try_wait() const noexcept {
+        return latch_.try_wait();
+    }
+
+    void wait() const {
+        emit(make_concurrency_event(EventType::LatchWaitBegin, id()));
+        latch_.wait();
+        emit(make_concurrency_event(EventType::LatchWaitEnd, id()));
+    }
+
+    void arrive_and_wait(std::ptrdiff_t update = 1) {
+        emit(make_concurrency_event(EventType::LatchArrive, id(), static_cast<uint32_t>(update)));
+        latch_.arrive_and_wait(update);
+        emit(make_concurrency_event(EventType::LatchWaitEnd, id()));
+    }
+
+private:
+    lock_id_t id() const {
+        return reinterpret_cast<lock_id_t>(this);
+    }
+
+    std::latch latch_;
+};
+
+struct NoCompletion {
+    void operator()() noexcept {}
+};
+
+/**
+ * std::barrier with tracing. Barrier events carry the phase number, so the
+ * analyzer can group each phase's arrivals: the last BarrierArrive of a
+ * phase is its straggler, and BarrierWaitEnd minus the thread's own arrival
+ * (or BarrierWaitBegin, for split arrive/wait) is its blocked time.
+ *
+ * The phase is counted by wrapping the completion function, which runs once
+ * per phase after the last arrival and before any waiter is released.
+ */
+template <class CompletionFunction = NoCompletion>
+class TracedBarrier {
+    struct PhaseCompletion {
+        std::atomic<uint32_t>* phase;
+        CompletionFunction completion;
+
+        void operator()() noexcept {
+            phase->fetch_add(1, std::memory_order_release);
+            completion();
+        }
+    };
+
+    using Barrier = std::barrier<PhaseCompletion>;
+
+public:
+    class arrival_token {
+    public:
+        arrival_token(arrival_token&&) = default;
+        arrival_token& operator=(arrival_token&&) = default;
+
+    private:
+        friend class TracedBarrier;
+
+        arrival_token(typename Barrier::arrival_token&& token, uint32_t phase)
+            : token_(std::move(token)), phase_(phase) {}
+
+        typename Barrier::arrival_token token_;
+        uint32_t phase_;
+    };
+
+    explicit TracedBarrier(std::ptrdiff_t expected, CompletionFunction completion = CompletionFunction())
+        : barrier_(expected, PhaseCompletion{&phase_, std::move(completion)}) {}
+
+    TracedBarrier(const TracedBarrier&) = delete;
+    TracedBarrier& operator=(const TracedBarrier&) = delete;
+
+    static constexpr std::ptrdiff_t max() noexcept {
+        return Barrier::max();
+    }
+
+    [[nodiscard]] arrival_token arrive(std::ptrdiff_t update = 1) {
+        uint32_t phase = arrive_event();
+        return arrival_token(barrier_.arrive(update), phase);
+    }
+
+    void wait(arrival_token&& token) const {
+        emit(make_concurrency_event(EventType::BarrierWaitBegin, id(), token.phase_));
+        barrier_.wait(std::move(token.token_));
+        emit(make_concurrency_event(EventType::BarrierWaitEnd, id(), token.phase_));
+    }
+
+    void arrive_and_wait() {
+        uint32_t phase = arrive_event();
+        barrier_.arrive_and_wait();
+        emit(make_concurrency_event(EventType::BarrierWaitEnd, id(), phase));
+    }
+
+    void arrive_and_drop() {
+        arrive_event();
+        barrier_.arrive_and_drop();
+    }
+
+    // Phases completed so far
+    uint32_t phase() const {
+        return phase_.load(std::memory_order_acquire);
+    }
+
+private:
+    uint32_t arrive_event() {
+        // Phase p cannot complete before this thread's arrival, so this is the phase it joins
+        uint32_t phase = phase_.load(std::memory_order_acquire) & CONCURRENCY_ARG_MAX;
+        emit(make_concurrency_event(EventType::BarrierArrive, id(), phase));
+        return phase;
+    }
+
+    lock_id_t id() const {
+        return reinterpret_cast<lock_id_t>(this);
+    }
+
+    std::atomic<uint32_t> phase_{0};  // Before barrier_: the completion points at it
+    Barrier barrier_;
+};
+
+} // namespace internal
+
+/**
+ * Traced replacements for the C++20 synchronization primitives, with the
+ * same interface as std::counting_semaphore, std::latch and std::barrier.
+ * The primitive's address is used as the events' lock_id.
+ *
+ * Usage:
+ *   ucdbg::Barrier<> sync_point(workers);
+ *   sync_point.arrive_and_wait();  // BarrierArrive ... BarrierWaitEnd
+ */
+template <std::ptrdiff_t LeastMaxValue = std::counting_semaphore<>::max()>
+using CountingSemaphore = internal::TracedCountingSemaphore<LeastMaxValue>;
+using BinarySemaphore = internal::TracedCountingSemaphore<1>;
+using Latch = internal::TracedLatch;
+template <class CompletionFunction = internal::NoCompletion>
+using Barrier = internal::TracedBarrier<CompletionFunction>;
+
+} // namespace ucdbg
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <ucdbg/event_helpers.hpp>
+#include <ucdbg/event_queue.hpp>
+
+namespace ucdbg {
+
+using task_id_t = uint64_t;
+
+namespace internal {
+
+// Bits of a task ID holding the submitting thread's sequence number
+constexpr unsigned TASK_SEQUENCE_BITS = 40;
+
+/**
+ * New task ID: the submitting thread's ordinal in the high bits and a
+ * per-thread sequence number in the low TASK_SEQUENCE_BITS, so submits do
+ * not share a global counter. The ordinal, not the thread ID, keeps IDs
+ * unique when the kernel reuses a thread ID. Never 0.
+ */
+inline task_id_t next_task_id() {
+    static thread_local uint64_t sequence = 0;
+    return (thread_ordinal() << TASK_SEQUENCE_BITS) | (++sequence & ((1ull << TASK_SEQUENCE_BITS) - 1));
+}
+
+// Emits TaskBegin/TaskEnd around the enclosing scope
+class TaskScope {
+public:
+    TaskScope(task_id_t id, uint32_t tag) : id_(id), tag_(tag) {
+        emit(make_concurrency_event(EventType::TaskBegin, id_, tag_));
+    }
+
+    ~TaskScope() noexcept {
+        emit(make_concurrency_event(EventType::TaskEnd, id_, tag_));
+    }
+
+    TaskScope(const TaskScope&) = delete;
+    TaskScope& operator=(const TaskScope&) = delete;
+
+private:
+    task_id_t id_;
+    uint32_t tag_;
+};
+
+/**
+ * Callable wrapper returned by traced_task(). Construction emits
+ * TaskEnqueue; each invocation runs the callable between TaskBegin and
+ * TaskEnd on the executing thread. Copyable when F is, so it fits
+ * std::function-based pools; copies share the task ID.
+ */
+template <class F>
+class TracedTask {
+public:
+    TracedTask(F f, uint32_t tag) : f_(std::move(f)), id_(next_task_id()), tag_(tag) {
+        emit(make_concurrency_event(EventType::TaskEnqueue, id_, tag_));
+    }
+
+    template <class... Args>
+    decltype(auto) operator()(Args&&... args) {
+        TaskScope scope(id_, tag_);
+        return std::invoke(f_, std::forward<Args>(args)...);
+    }
+
+    task_id_t id() const {
+        return id_;
+    }
+
+private:
+    F f_;
+    task_id_t id_;
+    uint32_t tag_;
+};
+
+} // namespace internal
+
+/**
+ * Wraps a callable at submit time for task tracing. The events carry the
+ * task ID in lock_id and the optional tag (e.g. a task type, 24 bits) in
+ * arg, so the analyzer can derive queueing delay (TaskEnqueue ->
+ * TaskBegin), execution time (TaskBegin -> TaskEnd) and the lock events
+ * each task issued (between its TaskBegin and TaskEnd on that thread).
+ *
+ * Usage:
+ *   pool.submit(ucdbg::traced_task([=] { handle(request); }, REQUEST_TASK));
+ */
+template <class F>
+internal::TracedTask<std::decay_t<F>> traced_task(F&& f, uint32_t tag = 0) {
+    return internal::TracedTask<std::decay_t<F>>(std::forward<F>(f), tag);
+}
+
+} // namespace ucdbg
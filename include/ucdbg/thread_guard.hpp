@@ -1,21 +1,39 @@
 #pragma once
 
+#include <functional>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <ucdbg/event_helpers.hpp>
-#include <ucdbg/concurrentqueue.h>
+#include <ucdbg/event_queue.hpp>
+#include <ucdbg/flow.hpp>
 
 
 namespace ucdbg {
 namespace internal {
 
+/**
+ * Emits ThreadStart/ThreadEnd for the enclosing scope. A no-op if the
+ * thread was already registered automatically (see ThreadRegistration).
+ * The thread counts as unregistered again once the guard ends, so a later
+ * guard on the same thread emits its own pair. spawn_id links both to the
+ * parent's ThreadSpawn and the joiner's ThreadJoin (see ucdbg::jthread).
+ */
 class ThreadGuard {
 public:
-    ThreadGuard() {
-        event_queue_.enqueue(make_concurrency_event(EventType::ThreadStart));
-
+    explicit ThreadGuard(uint64_t spawn_id = 0) : owns_(!thread_registered), spawn_id_(spawn_id) {
+        thread_registered = true;
+        if (owns_) {
+            emit(make_concurrency_event(EventType::ThreadStart, spawn_id_));
+        }
     }
 
     ~ThreadGuard() noexcept {
-        event_queue_.enqueue(make_concurrency_event(EventType::ThreadEnd));
+        if (owns_) {
+            emit(make_concurrency_event(EventType::ThreadEnd, spawn_id_));
+            thread_registered = false;
+        }
     }
 
     ThreadGuard(const ThreadGuard&) = delete;
@@ -23,10 +41,142 @@ public:
     ThreadGuard(ThreadGuard&&) = delete;
     ThreadGuard& operator=(ThreadGuard&&) = delete;
 
+private:
+    bool owns_;
+    uint64_t spawn_id_;
+};
+
+}  // namespace internal
+
+/**
+ * std::jthread that traces its thread's lifetime: the callable runs inside
+ * a ThreadGuard, so ThreadStart/ThreadEnd bracket it without
+ * UCDBG_THREAD_START. Callables taking a std::stop_token first receive the
+ * thread's stop token, as with std::jthread.
+ *
+ * The parent emits ThreadSpawn before creating the thread and join() (or
+ * the destructor) emits ThreadJoin once it returns; all four events carry
+ * the same spawn ID, giving analyses the fork and join edges. The
+ * std::jthread is a private member rather than a base, so it cannot be
+ * joined or swapped behind the wrapper's back.
+ */
+class jthread {
+    // Tag type: the spawn ID is taken (and ThreadSpawn emitted) before the thread starts
+    struct Spawned {
+        uint64_t id;
+    };
+
+public:
+    using id = std::jthread::id;
+    using native_handle_type = std::jthread::native_handle_type;
+
+    jthread() noexcept = default;
+
+    template <class F, class... Args>
+        requires(!std::is_same_v<std::remove_cvref_t<F>, jthread> &&
+                 !std::is_same_v<std::remove_cvref_t<F>, Spawned>)
+    explicit jthread(F&& f, Args&&... args)
+        : jthread(spawn(), std::forward<F>(f), std::forward<Args>(args)...) {}
+
+    jthread(jthread&& other) noexcept
+        : thread_(std::move(other.thread_)), spawn_id_(std::exchange(other.spawn_id_, 0)) {}
+
+    jthread& operator=(jthread&& other) noexcept {
+        if (this != &other) {
+            finish();
+            thread_ = std::move(other.thread_);
+            spawn_id_ = std::exchange(other.spawn_id_, 0);
+        }
+        return *this;
+    }
+
+    jthread(const jthread&) = delete;
+    jthread& operator=(const jthread&) = delete;
+
+    ~jthread() {
+        finish();
+    }
+
+    void swap(jthread& other) noexcept {
+        thread_.swap(other.thread_);
+        std::swap(spawn_id_, other.spawn_id_);
+    }
+
+    friend void swap(jthread& a, jthread& b) noexcept {
+        a.swap(b);
+    }
+
+    bool joinable() const noexcept {
+        return thread_.joinable();
+    }
+
+    void join() {
+        thread_.join();
+        internal::emit(internal::make_concurrency_event(EventType::ThreadJoin, spawn_id_));
+        spawn_id_ = 0;
+    }
+
+    // No ThreadJoin will follow: the spawn's join edge is lost
+    void detach() {
+        thread_.detach();
+        spawn_id_ = 0;
+    }
+
+    id get_id() const noexcept {
+        return thread_.get_id();
+    }
+
+    native_handle_type native_handle() {
+        return thread_.native_handle();
+    }
+
+    std::stop_source get_stop_source() noexcept {
+        return thread_.get_stop_source();
+    }
+
+    std::stop_token get_stop_token() const noexcept {
+        return thread_.get_stop_token();
+    }
+
+    bool request_stop() noexcept {
+        return thread_.request_stop();
+    }
+
+    static unsigned int hardware_concurrency() noexcept {
+        return std::jthread::hardware_concurrency();
+    }
 
 private:
-    moodycamel::ConcurrentQueue<ucdbg::TraceEvent> event_queue_;
+    static Spawned spawn() {
+        uint64_t id = internal::next_flow_id();  // Spawn IDs share the flow ID sequence
+        internal::emit(internal::make_concurrency_event(EventType::ThreadSpawn, id));
+        return {id};
+    }
+
+    template <class F, class... Args>
+    jthread(Spawned spawned, F&& f, Args&&... args)
+        : thread_(
+              [f = std::forward<F>(f), id = spawned.id](std::stop_token stop, std::decay_t<Args>... params) mutable {
+                  internal::ThreadGuard guard(id);
+                  if constexpr (std::is_invocable_v<std::decay_t<F>, std::stop_token, std::decay_t<Args>...>) {
+                      std::invoke(std::move(f), std::move(stop), std::move(params)...);
+                  } else {
+                      std::invoke(std::move(f), std::move(params)...);
+                  }
+              },
+              std::forward<Args>(args)...),
+          spawn_id_(spawned.id) {}
+
+    // What std::jthread's destructor and move assignment do, with the join traced
+    void finish() {
+        if (joinable()) {
+            request_stop();
+            join();
+        }
+    }
+
+    std::jthread thread_;
+    uint64_t spawn_id_ = 0;
 };
 
-}  // namespace internal 
-} // namespace ucdbg
\ No newline at end of file
+} // namespace ucdbg
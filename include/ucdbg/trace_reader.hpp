@@ -0,0 +1,211 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <span>
+#include <ucdbg/trace_types.hpp>
+
+namespace ucdbg {
+
+/**
+ * Event filter for TraceReader views. Unset fields match everything;
+ * the time range is inclusive on both ends.
+ */
+struct TraceFilter {
+    std::optional<thread_id_t> thread_id;
+    std::optional<EventKind> kind;
+    timestamp_t begin = 0;
+    timestamp_t end = std::numeric_limits<timestamp_t>::max();
+
+    bool matches(const TraceEvent& event) const {
+        return event.timestamp_ns >= begin && event.timestamp_ns <= end &&
+               (!thread_id || event.thread_id == *thread_id) &&
+               (!kind || event.kind == *kind);
+    }
+};
+
+/**
+ * Zero-copy reader for raw traces: a file of consecutive 32-byte
+ * TraceEvent records as produced by TraceEvent::serialize_to().
+ *
+ * The file is mmap'd read-only and events are handed out as references into
+ * the mapping (TraceEvent is packed, so any offset is suitably aligned).
+ * Views skip records that fail TraceEvent::is_valid() and those rejected by
+ * the filter. A trailing partial record is ignored.
+ *
+ * Usage:
+ *   TraceReader reader;
+ *   reader.open("trace.raw");
+ *   TraceFilter filter;
+ *   filter.thread_id = tid;
+ *   for (const TraceEvent& e : reader.view(filter)) { ... }
+ */
+class TraceReader {
+public:
+    class View;
+
+    TraceReader() = default;
+
+    ~TraceReader() {
+        close();
+    }
+
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    bool open(const char* path) {
+        close();
+        int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        size_t bytes = static_cast<size_t>(st.st_size);
+        if (bytes >= sizeof(TraceEvent)) {
+            void* mapping = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                ::close(fd);
+                return false;
+            }
+            // Sequential scans dominate; let the kernel read ahead aggressively
+            ::madvise(mapping, bytes, MADV_SEQUENTIAL);
+            mapping_ = mapping;
+            mapping_size_ = bytes;
+            count_ = bytes / sizeof(TraceEvent);
+        }
+        ::close(fd);  // The mapping keeps the file alive
+        open_ = true;
+        return true;
+    }
+
+    void close() {
+        if (mapping_) {
+            ::munmap(mapping_, mapping_size_);
+        }
+        mapping_ = nullptr;
+        mapping_size_ = 0;
+        count_ = 0;
+        open_ = false;
+    }
+
+    bool is_open() const {
+        return open_;
+    }
+
+    // Number of complete records, including ones that fail is_valid()
+    size_t size() const {
+        return count_;
+    }
+
+    // All records, unvalidated
+    std::span<const TraceEvent> events() const {
+        return {static_cast<const TraceEvent*>(mapping_), count_};
+    }
+
+    const TraceEvent& operator[](size_t i) const {
+        return events()[i];
+    }
+
+    View view(TraceFilter filter = {}) const;
+
+private:
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    size_t count_ = 0;
+    bool open_ = false;
+};
+
+/**
+ * Filtered range over a TraceReader's mapping. Iterators yield references
+ * into the mapped file; they refer to the view's filter, so keep the view
+ * alive while iterating (range-for over reader.view(...) does).
+ */
+class TraceReader::View {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = TraceEvent;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const TraceEvent*;
+        using reference = const TraceEvent&;
+
+        iterator() = default;
+
+        reference operator*() const { return *current_; }
+        pointer operator->() const { return current_; }
+
+        iterator& operator++() {
+            ++current_;
+            skip();
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        bool operator==(const iterator& other) const { return current_ == other.current_; }
+
+    private:
+        friend class View;
+
+        iterator(const TraceEvent* current, const TraceEvent* end, const TraceFilter* filter)
+            : current_(current), end_(end), filter_(filter) {
+            skip();
+        }
+
+        void skip() {
+            while (current_ != end_ && !(current_->is_valid() && filter_->matches(*current_))) {
+                ++current_;
+            }
+        }
+
+        const TraceEvent* current_ = nullptr;
+        const TraceEvent* end_ = nullptr;
+        const TraceFilter* filter_ = nullptr;
+    };
+
+    View(std::span<const TraceEvent> events, TraceFilter filter)
+        : events_(events), filter_(filter) {}
+
+    iterator begin() const {
+        return iterator(events_.data(), events_.data() + events_.size(), &filter_);
+    }
+
+    iterator end() const {
+        const TraceEvent* last = events_.data() + events_.size();
+        return iterator(last, last, &filter_);
+    }
+
+    // Number of matching events (full pass over the view)
+    size_t count() const {
+        size_t total = 0;
+        for (auto it = begin(); it != end(); ++it) {
+            ++total;
+        }
+        return total;
+    }
+
+private:
+    std::span<const TraceEvent> events_;
+    TraceFilter filter_;
+};
+
+inline TraceReader::View TraceReader::view(TraceFilter filter) const {
+    return View(events(), filter);
+}
+
+} // namespace ucdbg
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <cstring>
@@ -9,25 +10,96 @@ namespace ucdbg {
 // Binary format version (increment when format changes)
 constexpr uint8_t TRACE_FORMAT_VERSION = 1;
 
+// Largest value the 24-bit concurrency argument can hold
+constexpr uint32_t CONCURRENCY_ARG_MAX = 0xFFFFFF;
+
 // Fixed-size type aliases for ABI independence
 using timestamp_t = uint64_t;      // Nanoseconds since epoch
 using thread_id_t = uint64_t;      // Thread identifier
 using lock_id_t = uint64_t;        // Lock identifier
 using string_id_t = uint32_t;      // String table index (for log messages)
+using lock_class_t = uint16_t;     // Lock class (lock_class.hpp), 0 = none
+
+// lock_class_key(): lock_id standing for a whole lock class. User-space
+// addresses never have the top bit set, so keys cannot collide with locks
+// identified by address.
+constexpr lock_id_t LOCK_CLASS_KEY_BIT = 1ull << 63;
+
+constexpr lock_id_t lock_class_key(lock_class_t lock_class) {
+    return LOCK_CLASS_KEY_BIT | lock_class;
+}
 
 // Event kind discriminator (explicit uint8_t for binary format)
 enum class EventKind : uint8_t {
     Concurrency = 0,
-    Log = 1
+    Log = 1,
+    Span = 2,       // UCDBG_SCOPE begin/end
+    Counter = 3     // UCDBG_COUNTER sample
+};
+
+// Span event phase (explicit uint8_t for binary format)
+enum class SpanPhase : uint8_t {
+    Begin = 0,
+    End = 1
 };
 
 // Event type (explicit uint8_t for binary format)
 enum class EventType : uint8_t {
-    ThreadStart = 0,
-    ThreadEnd = 1,
+    ThreadStart = 0,            // lock_id: spawn ID (ucdbg::jthread), else 0
+    ThreadEnd = 1,              // lock_id: as in ThreadStart
     LockAcquire = 2,
-    LockRelease = 3
+    LockRelease = 3,
+    SharedLockAcquire = 4,      // arg: readers holding the lock, including this one
+    SharedLockRelease = 5,      // arg: readers still holding the lock
+    LockContended = 6,          // Exclusive waiter about to block; arg: readers holding
+    SharedLockContended = 7,    // Shared waiter about to block; arg: readers holding
+    CondWaitBegin = 8,          // lock_id: associated mutex (released while waiting)
+    CondWaitEnd = 9,            // Mutex reacquired; arg: WakeReason
+    CondNotifyOne = 10,         // lock_id: mutex of the last wait; arg: waiters
+    CondNotifyAll = 11,         // lock_id: mutex of the last wait; arg: waiters
+    SemaphoreAcquire = 12,      // lock_id: semaphore
+    SemaphoreRelease = 13,      // arg: update
+    SemaphoreContended = 14,    // try_acquire failed, about to block
+    LatchArrive = 15,           // count_down; arg: update
+    LatchWaitBegin = 16,        // wait() only; arrive_and_wait waits from LatchArrive
+    LatchWaitEnd = 17,
+    BarrierArrive = 18,         // arg: phase (low 24 bits)
+    BarrierWaitBegin = 19,      // wait(token) only; arrive_and_wait waits from BarrierArrive
+    BarrierWaitEnd = 20,        // arg: phase (low 24 bits)
+    AtomicOps = 21,             // Per-thread interval counters for a traced_atomic;
+    AtomicCasFailures = 22,     //   lock_id: its address, arg: count in the interval
+    AtomicMaxRetries = 23,      //   (AtomicMaxRetries: longest CAS failure run)
+    AtomicOwnerChanges = 24,
+    TaskEnqueue = 25,           // Task submitted; lock_id: task ID, arg: task tag
+    TaskBegin = 26,             // Task starts running on this thread
+    TaskEnd = 27,
+    CoroSuspend = 28,           // lock_id: coroutine frame address, arg: awaiter tag (string ID)
+    CoroResume = 29,            // Emitted on the resuming thread
+    FlowBegin = 30,             // lock_id: flow ID, arg: flow tag
+    FlowStep = 31,              // Flow handed off to / picked up by this thread
+    FlowEnd = 32,
+    LockHoldHistogram = 33,     // In-process summary (lock_histograms.hpp); lock_id: lock,
+    LockWaitHistogram = 34,     //   arg: histogram bucket and count (lock_histogram_arg)
+    ThreadSpawn = 35,           // On the parent before the thread is created; lock_id: spawn ID
+    ThreadJoin = 36,            // On the joiner once the join returned; lock_id: spawn ID
+    MemoryRead = 37,            // Annotated shared variable access (memory_access.hpp);
+    MemoryWrite = 38,           //   lock_id: address, arg: access site
+    LockClassName = 39,         // Lock class definition (drain thread, at shutdown);
+                                //   lock_id: lock_class_key(class), arg: name string ID
+    AtomicCounterOwner = 40,    // Drain thread; lock_id: thread ID whose traced_atomic counts the
+                                //   Atomic* records after it on the same thread report
     // Add new types here - old readers will skip unknown types
+    // (and bump EVENT_TYPE_COUNT below)
+};
+
+// Number of EventType values known to this build (scan kernels size tables by it)
+constexpr size_t EVENT_TYPE_COUNT = 41;
+
+// Why a condition variable wait returned (arg of CondWaitEnd)
+enum class WakeReason : uint8_t {
+    Notified = 0,
+    Timeout = 1,
+    Spurious = 2
 };
 
 // Log level (explicit uint8_t for binary format)
@@ -56,15 +128,13 @@ enum class LogLevel : uint8_t {
  *   8       8     thread_id
  *   16      1     format_version
  *   17      1     kind (EventKind)
- *   18      1     reserved (for future use)
- *   19      1     reserved (for future use)
+ *   18      2     lock class of lock events (lock_class_t), else reserved
  *   20      4     payload (union - see below)
  * 
  * Payload layout by kind:
  *   Concurrency (EventKind::Concurrency):
  *     20      1     type (EventType)
- *     21      1     reserved
- *     22      2     reserved
+ *     21      3     arg (24-bit, meaning depends on type; 0 if unused)
  *     24      8     lock_id
  *     Total: 32 bytes
  * 
@@ -74,6 +144,16 @@ enum class LogLevel : uint8_t {
  *     22      2     reserved
  *     24      4     message_string_id (string_id_t)
  *     Total: 28 bytes (rounded to 32 for alignment)
+ *
+ *   Span (EventKind::Span):
+ *     20      1     phase (SpanPhase)
+ *     21      3     reserved
+ *     24      4     name_id (string_id_t)
+ *     28      4     reserved
+ *
+ *   Counter (EventKind::Counter):
+ *     20      4     name_id (string_id_t)
+ *     24      8     value (int64_t)
  */
 #pragma pack(push, 1)  // No padding - critical for binary format
 struct TraceEvent {
@@ -88,13 +168,13 @@ struct TraceEvent {
     // Header (4 bytes)
     uint8_t format_version;         // 16: Format version (for forward compatibility)
     EventKind kind;                 // 17: Event kind discriminator
-    uint8_t reserved[2];            // 18-19: Reserved for future use
+    uint8_t reserved[2];            // 18-19: Lock class of lock events (lock_class()), else reserved
     
     // Payload union (12 bytes)
     union {
         struct {
             EventType type;         // 20: Event type
-            uint8_t reserved[3];    // 21-23: Reserved
+            uint8_t arg[3];         // 21-23: Type-specific argument (little-endian)
             lock_id_t lock_id;      // 24-31: Lock ID
         } concurrency;
         
@@ -104,6 +184,18 @@ struct TraceEvent {
             string_id_t message_string_id;  // 24-27: String table index
             uint32_t reserved2;     // 28-31: Reserved
         } log;
+
+        struct {
+            SpanPhase phase;        // 20: Begin/End
+            uint8_t reserved[3];    // 21-23: Reserved
+            string_id_t name_id;    // 24-27: String table index
+            uint32_t reserved2;     // 28-31: Reserved
+        } span;
+
+        struct {
+            string_id_t name_id;    // 20-23: String table index
+            int64_t value;          // 24-31: Sampled value
+        } counter;
     };
     
     // ============================================================================
@@ -126,6 +218,28 @@ struct TraceEvent {
         // Note: Endianness conversion would happen here if needed
     }
     
+    // Concurrency argument accessors (24-bit, values are saturated on store)
+    uint32_t concurrency_arg() const {
+        return concurrency.arg[0] | (concurrency.arg[1] << 8) | (concurrency.arg[2] << 16);
+    }
+
+    void set_concurrency_arg(uint32_t value) {
+        value = value < CONCURRENCY_ARG_MAX ? value : CONCURRENCY_ARG_MAX;
+        concurrency.arg[0] = static_cast<uint8_t>(value);
+        concurrency.arg[1] = static_cast<uint8_t>(value >> 8);
+        concurrency.arg[2] = static_cast<uint8_t>(value >> 16);
+    }
+
+    // Lock class carried by lock events (header bytes 18-19), 0 if none
+    lock_class_t lock_class() const {
+        return static_cast<lock_class_t>(reserved[0] | (reserved[1] << 8));
+    }
+
+    void set_lock_class(lock_class_t lock_class) {
+        reserved[0] = static_cast<uint8_t>(lock_class);
+        reserved[1] = static_cast<uint8_t>(lock_class >> 8);
+    }
+
     // Validation: Check if event format is supported
     // Usage: if (!event.is_valid()) { skip event; }
     bool is_valid() const {
@@ -150,6 +264,52 @@ inline std::string event_type_to_string(EventType event_type) {
         case EventType::ThreadEnd: return "ThreadEnd";
         case EventType::LockAcquire: return "LockAcquire";
         case EventType::LockRelease: return "LockRelease";
+        case EventType::SharedLockAcquire: return "SharedLockAcquire";
+        case EventType::SharedLockRelease: return "SharedLockRelease";
+        case EventType::LockContended: return "LockContended";
+        case EventType::SharedLockContended: return "SharedLockContended";
+        case EventType::CondWaitBegin: return "CondWaitBegin";
+        case EventType::CondWaitEnd: return "CondWaitEnd";
+        case EventType::CondNotifyOne: return "CondNotifyOne";
+        case EventType::CondNotifyAll: return "CondNotifyAll";
+        case EventType::SemaphoreAcquire: return "SemaphoreAcquire";
+        case EventType::SemaphoreRelease: return "SemaphoreRelease";
+        case EventType::SemaphoreContended: return "SemaphoreContended";
+        case EventType::LatchArrive: return "LatchArrive";
+        case EventType::LatchWaitBegin: return "LatchWaitBegin";
+        case EventType::LatchWaitEnd: return "LatchWaitEnd";
+        case EventType::BarrierArrive: return "BarrierArrive";
+        case EventType::BarrierWaitBegin: return "BarrierWaitBegin";
+        case EventType::BarrierWaitEnd: return "BarrierWaitEnd";
+        case EventType::AtomicOps: return "AtomicOps";
+        case EventType::AtomicCasFailures: return "AtomicCasFailures";
+        case EventType::AtomicMaxRetries: return "AtomicMaxRetries";
+        case EventType::AtomicOwnerChanges: return "AtomicOwnerChanges";
+        case EventType::TaskEnqueue: return "TaskEnqueue";
+        case EventType::TaskBegin: return "TaskBegin";
+        case EventType::TaskEnd: return "TaskEnd";
+        case EventType::CoroSuspend: return "CoroSuspend";
+        case EventType::CoroResume: return "CoroResume";
+        case EventType::FlowBegin: return "FlowBegin";
+        case EventType::FlowStep: return "FlowStep";
+        case EventType::FlowEnd: return "FlowEnd";
+        case EventType::LockHoldHistogram: return "LockHoldHistogram";
+        case EventType::LockWaitHistogram: return "LockWaitHistogram";
+        case EventType::ThreadSpawn: return "ThreadSpawn";
+        case EventType::ThreadJoin: return "ThreadJoin";
+        case EventType::MemoryRead: return "MemoryRead";
+        case EventType::MemoryWrite: return "MemoryWrite";
+        case EventType::LockClassName: return "LockClassName";
+        case EventType::AtomicCounterOwner: return "AtomicCounterOwner";
+        default: return "Unknown";
+    }
+}
+
+inline std::string wake_reason_to_string(WakeReason reason) {
+    switch (reason) {
+        case WakeReason::Notified: return "Notified";
+        case WakeReason::Timeout: return "Timeout";
+        case WakeReason::Spurious: return "Spurious";
         default: return "Unknown";
     }
 }
@@ -0,0 +1,404 @@
+#pragma once
+
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <ucdbg/event_helpers.hpp>
+#include <ucdbg/event_queue.hpp>
+
+namespace ucdbg {
+namespace internal {
+
+/**
+ * Per-thread contention counters for traced_atomic, keyed by address.
+ *
+ * Operations only touch this thread-local table; nothing is emitted per
+ * operation. Every ATOMIC_FLUSH_OPS operations of a thread (and when the
+ * thread exits or flush() is called) each address's counters for the
+ * interval are emitted as AtomicOps, AtomicCasFailures, AtomicMaxRetries
+ * and AtomicOwnerChanges events with lock_id = address; zero counters other
+ * than AtomicOps are skipped. Summing an address's events over all threads
+ * gives its totals.
+ *
+ * Threads that stop using atomics are not left holding counts: every table
+ * is registered with AtomicStatsRegistry, whose collect() (run by the
+ * tracer's drain thread periodically and at shutdown) reports what each
+ * thread counted since its last report, as records of the collecting
+ * thread after an AtomicCounterOwner record naming the owner. Only the owning thread writes the
+ * counters, with relaxed loads and stores, so collection never slows an
+ * operation down; reports and slot reuse are serialized by the table's
+ * mutex, which an operation takes only when it flushes.
+ */
+class AtomicStats {
+public:
+    static constexpr size_t CAPACITY = 64;
+    // Bounds every per-interval counter well below CONCURRENCY_ARG_MAX
+    static constexpr uint32_t ATOMIC_FLUSH_OPS = 1u << 16;
+
+    struct Slot {
+        std::atomic<const void*> address{nullptr};
+        std::atomic<uint32_t> ops{0};
+        std::atomic<uint32_t> cas_failures{0};
+        std::atomic<uint32_t> max_retries{0};
+        std::atomic<uint32_t> owner_changes{0};
+        uint32_t retries = 0;  // Owner only: consecutive CAS failures in the current loop
+        // Counts already reported (under the table mutex)
+        uint32_t seen_ops = 0;
+        uint32_t seen_cas_failures = 0;
+        uint32_t seen_max_retries = 0;
+        uint32_t seen_owner_changes = 0;
+    };
+
+    static AtomicStats& local();
+
+    explicit AtomicStats(thread_id_t thread_id) : thread_id_(thread_id) {}
+
+    AtomicStats(const AtomicStats&) = delete;
+    AtomicStats& operator=(const AtomicStats&) = delete;
+
+    // Owner only: a relaxed load and store, never a read-modify-write
+    static void add(std::atomic<uint32_t>& counter, uint32_t n = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // Counts one operation on address; flushes first if the interval is over
+    Slot& record(const void* address) {
+        if (++interval_ops_ > ATOMIC_FLUSH_OPS) {
+            flush();
+            interval_ops_ = 1;
+        }
+        if (last_ && last_->address.load(std::memory_order_relaxed) == address) {
+            add(last_->ops);
+            return *last_;
+        }
+        Slot* slot = find(address);
+        if (!slot) {
+            flush();
+            slot = find(address);
+        }
+        if (!slot->address.load(std::memory_order_relaxed)) {
+            slot->address.store(address, std::memory_order_release);
+        }
+        add(slot->ops);
+        last_ = slot;
+        return *slot;
+    }
+
+    void cas_result(Slot& slot, bool success) {
+        if (success) {
+            if (slot.retries > slot.max_retries.load(std::memory_order_relaxed)) {
+                slot.max_retries.store(slot.retries, std::memory_order_relaxed);
+            }
+            slot.retries = 0;
+        } else {
+            add(slot.cas_failures);
+            ++slot.retries;
+        }
+    }
+
+    // Owner only: emits everything not yet reported and frees every slot
+    void flush() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (Slot& slot : slots_) {
+            if (!slot.address.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            report(slot, slot.retries, [](EventType type, lock_id_t id, uint32_t arg) {
+                emit(make_concurrency_event(type, id, arg));
+            });
+            slot.address.store(nullptr, std::memory_order_relaxed);
+            slot.ops.store(0, std::memory_order_relaxed);
+            slot.cas_failures.store(0, std::memory_order_relaxed);
+            slot.max_retries.store(0, std::memory_order_relaxed);
+            slot.owner_changes.store(0, std::memory_order_relaxed);
+            slot.retries = 0;
+            slot.seen_ops = slot.seen_cas_failures = slot.seen_max_retries = slot.seen_owner_changes = 0;
+        }
+        last_ = nullptr;
+        interval_ops_ = 0;
+    }
+
+    /**
+     * Any thread: appends records of what the owner counted since the last
+     * report, stamped on the calling thread (the owner's own events may still
+     * be queued, so they cannot carry its ID without breaking its timestamp
+     * order). An AtomicCounterOwner record naming the owner comes first. The
+     * owner's current CAS retry run is left for its own flush.
+     */
+    void collect(std::vector<TraceEvent>& records) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t owner = records.size();
+        for (Slot& slot : slots_) {
+            if (!slot.address.load(std::memory_order_acquire)) {
+                continue;
+            }
+            report(slot, 0, [&](EventType type, lock_id_t id, uint32_t arg) {
+                if (records.size() == owner) {
+                    records.push_back(make_concurrency_event(EventType::AtomicCounterOwner, thread_id_, 0));
+                }
+                records.push_back(make_concurrency_event(type, id, arg));
+            });
+        }
+    }
+
+    // Set (release) by the owning thread after its final flush
+    std::atomic<bool> exited{false};
+
+private:
+    // Reports slot's counts since the last report (table mutex held); nothing if it had no operations
+    template <class F>
+    static void report(Slot& slot, uint32_t retries, F&& sink) {
+        uint32_t ops = slot.ops.load(std::memory_order_relaxed);
+        if (ops == slot.seen_ops) {
+            return;
+        }
+        lock_id_t id = reinterpret_cast<lock_id_t>(slot.address.load(std::memory_order_relaxed));
+        uint32_t cas_failures = slot.cas_failures.load(std::memory_order_relaxed);
+        uint32_t max_retries = slot.max_retries.load(std::memory_order_relaxed);
+        max_retries = retries > max_retries ? retries : max_retries;
+        uint32_t owner_changes = slot.owner_changes.load(std::memory_order_relaxed);
+        sink(EventType::AtomicOps, id, ops - slot.seen_ops);
+        if (cas_failures != slot.seen_cas_failures) {
+            sink(EventType::AtomicCasFailures, id, cas_failures - slot.seen_cas_failures);
+        }
+        if (max_retries > slot.seen_max_retries) {
+            sink(EventType::AtomicMaxRetries, id, max_retries);
+        }
+        if (owner_changes != slot.seen_owner_changes) {
+            sink(EventType::AtomicOwnerChanges, id, owner_changes - slot.seen_owner_changes);
+        }
+        slot.seen_ops = ops;
+        slot.seen_cas_failures = cas_failures;
+        slot.seen_max_retries = max_retries > slot.seen_max_retries ? max_retries : slot.seen_max_retries;
+        slot.seen_owner_changes = owner_changes;
+    }
+
+    // Slot for address, or a free one; nullptr if the table is full
+    Slot* find(const void* address) {
+        size_t start = (reinterpret_cast<uintptr_t>(address) >> 3) * 0x9E3779B97F4A7C15ull >> 58;
+        for (size_t probe = 0; probe < CAPACITY; ++probe) {
+            Slot& slot = slots_[(start + probe) % CAPACITY];
+            const void* key = slot.address.load(std::memory_order_relaxed);
+            if (key == address || !key) {
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+
+    const thread_id_t thread_id_;
+    std::mutex mutex_;
+    Slot slots_[CAPACITY];
+    Slot* last_ = nullptr;
+    uint32_t interval_ops_ = 0;
+};
+
+/**
+ * Process-wide registry of the per-thread AtomicStats tables, so counts of
+ * threads that are idle, or still running at shutdown, reach the trace
+ * (see AtomicStats).
+ */
+class AtomicStatsRegistry {
+public:
+    static AtomicStatsRegistry& instance() {
+        static AtomicStatsRegistry registry;
+        return registry;
+    }
+
+    void add(std::shared_ptr<AtomicStats> table) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        drop_exited();  // Bounded by live threads even if never collected
+        tables_.push_back(std::move(table));
+    }
+
+    // Records of everything counted since the last report, one thread at a time
+    std::vector<TraceEvent> collect() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        drop_exited();
+        std::vector<TraceEvent> records;
+        for (const auto& table : tables_) {
+            table->collect(records);
+        }
+        return records;
+    }
+
+private:
+    // Exited threads flushed everything themselves
+    void drop_exited() {
+        for (size_t i = 0; i < tables_.size();) {
+            if (tables_[i]->exited.load(std::memory_order_acquire)) {
+                tables_[i] = std::move(tables_.back());
+                tables_.pop_back();
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<AtomicStats>> tables_;
+};
+
+inline AtomicStats& AtomicStats::local() {
+    struct Registration {
+        Registration() {
+            prepare_thread();  // Still alive in our destructor
+            table = std::make_shared<AtomicStats>(get_thread_id());
+            AtomicStatsRegistry::instance().add(table);
+        }
+
+        ~Registration() {
+            table->flush();
+            table->exited.store(true, std::memory_order_release);
+        }
+
+        std::shared_ptr<AtomicStats> table;
+    };
+    static thread_local Registration registration;
+    return *registration.table;
+}
+
+} // namespace internal
+
+/**
+ * std::atomic<T> wrapper that measures contention on the variable:
+ * failed compare_exchange calls, the longest run of consecutive failures
+ * by one thread (its retry loop), and writes that take the variable over
+ * from a different thread (cache-line ownership changes).
+ *
+ * Counters are aggregated per thread and address (see AtomicStats), so the
+ * per-operation cost is a thread-local update plus, for writes, a relaxed
+ * load of the last writer stored next to the value. That field makes a
+ * traced_atomic 8 bytes larger than std::atomic<T>.
+ *
+ * Usage:
+ *   ucdbg::traced_atomic<uint64_t> head{0};
+ *   uint64_t expected = head.load();
+ *   while (!head.compare_exchange_weak(expected, expected + 1)) {}
+ */
+template <class T>
+class traced_atomic {
+public:
+    using value_type = T;
+
+    constexpr traced_atomic() noexcept = default;
+    constexpr traced_atomic(T desired) noexcept : value_(desired) {}
+
+    traced_atomic(const traced_atomic&) = delete;
+    traced_atomic& operator=(const traced_atomic&) = delete;
+
+    bool is_lock_free() const noexcept {
+        return value_.is_lock_free();
+    }
+
+    T load(std::memory_order order = std::memory_order_seq_cst) const noexcept {
+        internal::AtomicStats::local().record(this);
+        return value_.load(order);
+    }
+
+    operator T() const noexcept {
+        return load();
+    }
+
+    void store(T desired, std::memory_order order = std::memory_order_seq_cst) noexcept {
+        track_owner(internal::AtomicStats::local().record(this));
+        value_.store(desired, order);
+    }
+
+    T operator=(T desired) noexcept {
+        store(desired);
+        return desired;
+    }
+
+    T exchange(T desired, std::memory_order order = std::memory_order_seq_cst) noexcept {
+        track_owner(internal::AtomicStats::local().record(this));
+        return value_.exchange(desired, order);
+    }
+
+    bool compare_exchange_weak(T& expected, T desired, std::memory_order success,
+                               std::memory_order failure) noexcept {
+        return traced_cas(value_.compare_exchange_weak(expected, desired, success, failure));
+    }
+
+    bool compare_exchange_weak(T& expected, T desired,
+                               std::memory_order order = std::memory_order_seq_cst) noexcept {
+        return traced_cas(value_.compare_exchange_weak(expected, desired, order));
+    }
+
+    bool compare_exchange_strong(T& expected, T desired, std::memory_order success,
+                                 std::memory_order failure) noexcept {
+        return traced_cas(value_.compare_exchange_strong(expected, desired, success, failure));
+    }
+
+    bool compare_exchange_strong(T& expected, T desired,
+                                 std::memory_order order = std::memory_order_seq_cst) noexcept {
+        return traced_cas(value_.compare_exchange_strong(expected, desired, order));
+    }
+
+    T fetch_add(T arg, std::memory_order order = std::memory_order_seq_cst) noexcept
+        requires std::integral<T> {
+        track_owner(internal::AtomicStats::local().record(this));
+        return value_.fetch_add(arg, order);
+    }
+
+    T fetch_sub(T arg, std::memory_order order = std::memory_order_seq_cst) noexcept
+        requires std::integral<T> {
+        track_owner(internal::AtomicStats::local().record(this));
+        return value_.fetch_sub(arg, order);
+    }
+
+    T fetch_and(T arg, std::memory_order order = std::memory_order_seq_cst) noexcept
+        requires std::integral<T> {
+        track_owner(internal::AtomicStats::local().record(this));
+        return value_.fetch_and(arg, order);
+    }
+
+    T fetch_or(T arg, std::memory_order order = std::memory_order_seq_cst) noexcept
+        requires std::integral<T> {
+        track_owner(internal::AtomicStats::local().record(this));
+        return value_.fetch_or(arg, order);
+    }
+
+    T fetch_xor(T arg, std::memory_order order = std::memory_order_seq_cst) noexcept
+        requires std::integral<T> {
+        track_owner(internal::AtomicStats::local().record(this));
+        return value_.fetch_xor(arg, order);
+    }
+
+    T operator++() noexcept requires std::integral<T> { return fetch_add(1) + 1; }
+    T operator++(int) noexcept requires std::integral<T> { return fetch_add(1); }
+    T operator--() noexcept requires std::integral<T> { return fetch_sub(1) - 1; }
+    T operator--(int) noexcept requires std::integral<T> { return fetch_sub(1); }
+    T operator+=(T arg) noexcept requires std::integral<T> { return fetch_add(arg) + arg; }
+    T operator-=(T arg) noexcept requires std::integral<T> { return fetch_sub(arg) - arg; }
+
+private:
+    bool traced_cas(bool success) {
+        internal::AtomicStats& stats = internal::AtomicStats::local();
+        internal::AtomicStats::Slot& slot = stats.record(this);
+        stats.cas_result(slot, success);
+        if (success) {
+            track_owner(slot);
+        }
+        return success;
+    }
+
+    // Only written when the writer changes, i.e. when the line is already bouncing
+    void track_owner(internal::AtomicStats::Slot& slot) {
+        thread_id_t self = get_thread_id();
+        thread_id_t owner = owner_.load(std::memory_order_relaxed);
+        if (owner != self) {
+            owner_.store(self, std::memory_order_relaxed);
+            internal::AtomicStats::add(slot.owner_changes, owner != 0);
+        }
+    }
+
+    std::atomic<T> value_{};
+    std::atomic<thread_id_t> owner_{0};
+};
+
+} // namespace ucdbg
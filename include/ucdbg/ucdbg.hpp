@@ -10,6 +10,7 @@
 
 #include <cstdint>
 #include <unistd.h> 
+#include <pthread.h>
 #include <sys/syscall.h> 
 #include <thread>
 #include <atomic>
@@ -19,10 +20,25 @@
 #include <string_view>
 #include <unordered_map>
 #include <memory>
+#include <new>
 #include <mutex>
+#include <vector>
+#include <chrono>
 #include <ucdbg/fast_timestamp.hpp>
+#include <ucdbg/event_queue.hpp>
+#include <ucdbg/block_writer.hpp>
+#include <ucdbg/ctf_writer.hpp>
 #include <ucdbg/thread_guard.hpp>
 #include <ucdbg/lock_guard.hpp>
+#include <ucdbg/lock_class.hpp>
+#include <ucdbg/condition_variable.hpp>
+#include <ucdbg/sync_primitives.hpp>
+#include <ucdbg/traced_atomic.hpp>
+#include <ucdbg/task.hpp>
+#include <ucdbg/flow.hpp>
+#include <ucdbg/coroutine.hpp>
+#include <ucdbg/scope.hpp>
+#include <ucdbg/memory_access.hpp>
 
 
 namespace ucdbg {
@@ -32,12 +48,19 @@ namespace internal {
     class TracerImpl;
 }
 
+// Output written by the drain thread
+enum class TraceFormat {
+    Block,  // Single block trace file (block_format.hpp)
+    Ctf     // CTF 1.8 directory: metadata plus one stream per thread (ctf_writer.hpp)
+};
+
 /**
  * Initialize the tracer system
- * @param transport_path Path to Unix Domain Socket or file
+ * @param transport_path Path to Unix Domain Socket or file (directory for TraceFormat::Ctf)
+ * @param format Trace output format
  * @return true if initialization succeeded
  */
-bool init(const char* transport_path = "/tmp/ucdbg.sock");
+bool init(const char* transport_path = "/tmp/ucdbg.sock", TraceFormat format = TraceFormat::Block);
 
 /**
  * Shutdown the tracer system
@@ -59,6 +82,35 @@ std::string get_thread_name();
  */
 uint64_t get_thread_id(); // Not implemented
 
+/**
+ * Automatic thread lifecycle capture: when enabled, the first event a
+ * thread emits is preceded by ThreadStart, and ThreadEnd is emitted when
+ * the thread exits, without UCDBG_THREAD_START. Off by default.
+ */
+void set_auto_thread_events(bool enabled);
+
+/**
+ * In-process lock latency histograms: LockGuard and SharedLockGuard record
+ * each hold and contended wait into per-thread histograms, which the drain
+ * thread merges every second and writes as LockHoldHistogram /
+ * LockWaitHistogram summary records. With lock_events = false the guards
+ * emit no per-acquire events at all, so p50/p99/p999 lock latency is
+ * available continuously without shipping every event. Off by default.
+ */
+void set_lock_histograms(bool enabled, bool lock_events = true);
+
+/**
+ * Hold and wait time histograms of a lock recorded so far (see
+ * set_lock_histograms); works with or without an initialized tracer.
+ * Guards with a lock class record under lock_class_key(class) instead.
+ */
+LockLatency lock_latency(lock_id_t lock_id);
+
+template <internal::Lockable L>
+LockLatency lock_latency(const L& lockable) {
+    return lock_latency(reinterpret_cast<lock_id_t>(&lockable));
+}
+
 } // namespace ucdbg
 
 // ============================================================================
@@ -85,6 +137,82 @@ uint64_t get_thread_id(); // Not implemented
 #define UCDBG_THREAD_START() \
     ucdbg::internal::ThreadGuard _ucdbg_thread_guard;
 
+#define UCDBG_CONCAT_IMPL(a, b) a##b
+#define UCDBG_CONCAT(a, b) UCDBG_CONCAT_IMPL(a, b)
+#define UCDBG_STRINGIZE_IMPL(x) #x
+#define UCDBG_STRINGIZE(x) UCDBG_STRINGIZE_IMPL(x)
+
+// "file:line" of the expansion, as a string literal
+#define UCDBG_CALL_SITE __FILE__ ":" UCDBG_STRINGIZE(__LINE__)
+
+/**
+ * Lock for the rest of the scope, tracing LockAcquire/LockRelease
+ * (and LockContended if the lock was busy)
+ * Usage: UCDBG_LOCK_GUARD(mtx)
+ */
+#define UCDBG_LOCK_GUARD(lockable) \
+    ucdbg::internal::LockGuard UCDBG_CONCAT(_ucdbg_lock_guard_, __LINE__)(lockable)
+
+/**
+ * Shared (reader) lock for the rest of the scope, tracing
+ * SharedLockAcquire/SharedLockRelease with the current reader count
+ * Usage: UCDBG_SHARED_LOCK_GUARD(shared_mtx)
+ */
+#define UCDBG_SHARED_LOCK_GUARD(lockable) \
+    ucdbg::internal::SharedLockGuard UCDBG_CONCAT(_ucdbg_shared_lock_guard_, __LINE__)(lockable)
+
+// Interns a string literal once per call site
+#define UCDBG_STATIC_STRING_ID(name) \
+    ([] { static const ucdbg::string_id_t _ucdbg_id = ucdbg::intern(name); return _ucdbg_id; }())
+
+// Registers a lock class (string literal name) once per call site
+#define UCDBG_STATIC_LOCK_CLASS(name) \
+    ([] { static const ucdbg::lock_class_t _ucdbg_class = ucdbg::lock_class(name); return _ucdbg_class; }())
+
+/**
+ * UCDBG_LOCK_GUARD / UCDBG_SHARED_LOCK_GUARD whose events carry a lock
+ * class, so analysis can group all locks of the class (lock_class.hpp).
+ * name is a string literal: a declared class shared by every lock of a
+ * kind, or UCDBG_CALL_SITE for one class per call site.
+ * Usage: UCDBG_LOCK_GUARD_CLASS(account.mtx, "Account::mtx")
+ *        UCDBG_LOCK_GUARD_CLASS(node->mtx, UCDBG_CALL_SITE)
+ */
+#define UCDBG_LOCK_GUARD_CLASS(lockable, name) \
+    ucdbg::internal::LockGuard UCDBG_CONCAT(_ucdbg_lock_guard_, __LINE__)( \
+        lockable, 0, UCDBG_STATIC_LOCK_CLASS(name))
+
+#define UCDBG_SHARED_LOCK_GUARD_CLASS(lockable, name) \
+    ucdbg::internal::SharedLockGuard UCDBG_CONCAT(_ucdbg_shared_lock_guard_, __LINE__)( \
+        lockable, 0, UCDBG_STATIC_LOCK_CLASS(name))
+
+/**
+ * Span covering the rest of the scope: Span Begin now, Span End at scope exit.
+ * name must be a string literal (use SpanGuard with ucdbg::intern() for
+ * runtime names).
+ * Usage: UCDBG_SCOPE("parse_request")
+ */
+#define UCDBG_SCOPE(name) \
+    ucdbg::internal::SpanGuard UCDBG_CONCAT(_ucdbg_scope_, __LINE__)(UCDBG_STATIC_STRING_ID(name))
+
+/**
+ * Counter sample (64-bit signed value); name must be a string literal
+ * Usage: UCDBG_COUNTER("queue_depth", queue.size())
+ */
+#define UCDBG_COUNTER(name, value) \
+    ucdbg::counter(UCDBG_STATIC_STRING_ID(name), static_cast<int64_t>(value))
+
+/**
+ * Annotated shared-variable access for the race detector, with "file:line"
+ * as the access site. Place next to the access itself, inside the same
+ * critical section.
+ * Usage: UCDBG_WRITE(balance); balance += amount;
+ */
+#define UCDBG_READ(var) \
+    ucdbg::traced_read(&(var), UCDBG_STATIC_STRING_ID(UCDBG_CALL_SITE))
+
+#define UCDBG_WRITE(var) \
+    ucdbg::traced_write(&(var), UCDBG_STATIC_STRING_ID(UCDBG_CALL_SITE))
+
 // ============================================================================
 // Internal Implementation
 // ============================================================================
@@ -94,28 +222,61 @@ namespace internal {
 
 /**
  * Internal tracer implementation
- * This will be expanded in later stages
+ *
+ * Owns the drain thread, which moves events from the shared event queue
+ * into a BlockTraceWriter (or CtfTraceWriter) streaming to transport_path.
  */
 class TracerImpl {
 public:
+    static constexpr size_t DRAIN_BATCH_SIZE = 1024;
+    static constexpr auto DRAIN_IDLE_SLEEP = std::chrono::milliseconds(1);
+    // Run first on the drain thread if set, e.g. to exempt it from the preload interposer
+    static inline void (*drain_thread_start)() = nullptr;
+    // How often lock histogram summaries (set_lock_histograms) and atomic counters are written
+    static constexpr auto LOCK_SUMMARY_INTERVAL = std::chrono::seconds(1);
+
     static TracerImpl& instance() {
         static TracerImpl inst;
         return inst;
     }
 
-    bool initialize(const char* transport_path) {
+    TracerImpl() {
+        // Construct the queue and string table first so they outlive this static instance
+        event_queue();
+        StringTable::instance();
+    }
+
+    ~TracerImpl() {
+        shutdown();
+    }
+
+    bool initialize(const char* transport_path, TraceFormat format = TraceFormat::Block) {
         if (initialized_.load()) {
             return false;  // Already initialized
         }
         
         transport_path_ = transport_path ? transport_path : "/tmp/ucdbg.sock";
+        format_ = format;
 
-        // TODO: Open transport connection
-        
-        bool success = true; // replace with real check
-        if (success) initialized_.store(true);
+        bool opened = format_ == TraceFormat::Ctf ? ctf_writer_.open(transport_path_.c_str())
+                                                  : writer_.open(transport_path_.c_str());
+        if (!opened) {
+            return false;
+        }
+
+        static const bool fork_handler_registered = [] {
+            pthread_atfork(nullptr, nullptr, [] { TracerImpl::instance().abandon_after_fork(); });
+            return true;
+        }();
+        (void)fork_handler_registered;
 
-        return success;
+        LockHistograms::instance().set_summaries(true);
+        running_.store(true);
+        drain_thread_ = std::thread([this] { drain_loop(); });
+        tracing_active.store(true);
+        initialized_.store(true);
+
+        return true;
     }
 
     void shutdown() {
@@ -123,7 +284,45 @@ public:
             return;
         }
         
-        // TODO: Close transport connection
+        tracing_active.store(false);
+        running_.store(false);
+        if (drain_thread_.joinable()) {
+            drain_thread_.join();
+        }
+        LockHistograms::instance().set_summaries(false);
+        {
+            std::lock_guard<std::mutex> lock(thread_name_map_mutex_);
+            for (const auto& [thread_id, name] : thread_name_map_) {
+                writer_.set_thread_name(thread_id, name);
+                ctf_writer_.set_thread_name(thread_id, name);
+            }
+        }
+        if (format_ == TraceFormat::Ctf) {
+            ctf_writer_.set_strings(StringTable::instance().strings());
+            ctf_writer_.close();
+        } else {
+            writer_.set_strings(StringTable::instance().strings());
+            writer_.close();
+        }
+        initialized_.store(false);
+    }
+
+    /**
+     * pthread_atfork child handler. The drain thread does not exist in the
+     * child, and the open trace belongs to the parent: anything the child
+     * wrote to it (buffered blocks, a trailer at exit) would corrupt it. So
+     * the child stops tracing and drops the writer without flushing or
+     * closing the trace; it may init() again with a path of its own.
+     */
+    void abandon_after_fork() {
+        tracing_active.store(false);
+        if (!initialized_.load()) {
+            return;
+        }
+        running_.store(false);
+        writer_.abandon();
+        ctf_writer_.abandon();
+        new (&drain_thread_) std::thread();  // Forget the parent's thread; it cannot be joined here
         initialized_.store(false);
     }
 
@@ -137,7 +336,13 @@ public:
 
 private:
     std::atomic<bool> initialized_{false};
+    std::atomic<bool> running_{false};
     std::string transport_path_;
+    std::thread drain_thread_;
+    TraceFormat format_ = TraceFormat::Block;
+    // Sidecar index: a trace cut short by a crash still opens without a full scan
+    BlockTraceWriter writer_{BlockTraceWriter::DEFAULT_BLOCK_EVENTS, BlockCodec::LZ, true};
+    CtfTraceWriter ctf_writer_;
     inline static std::mutex thread_name_map_mutex_;
     inline static thread_local std::string thread_name_;  
     inline static std::unordered_map<uint64_t, std::string> thread_name_map_;
@@ -151,6 +356,61 @@ private:
         std::lock_guard<std::mutex> lock(thread_name_map_mutex_);
         thread_name_map_[get_thread_id()] = thread_name_;
     }
+
+    // Runs on drain_thread_; the only consumer of event_queue()
+    void drain_loop() {
+        if (drain_thread_start) {
+            drain_thread_start();
+        }
+        std::vector<TraceEvent> batch(DRAIN_BATCH_SIZE);
+        moodycamel::ConsumerToken token(event_queue());
+        auto next_summary = std::chrono::steady_clock::now() + LOCK_SUMMARY_INTERVAL;
+        while (running_.load(std::memory_order_acquire)) {
+            size_t count = event_queue().try_dequeue_bulk(token, batch.data(), batch.size());
+            if (count > 0) {
+                write(batch.data(), count);
+            } else {
+                std::this_thread::sleep_for(DRAIN_IDLE_SLEEP);
+            }
+            if (std::chrono::steady_clock::now() >= next_summary) {
+                write_lock_summary();
+                write_atomic_stats();
+                next_summary += LOCK_SUMMARY_INTERVAL;
+            }
+        }
+        // Final drain after producers have been switched off
+        size_t count;
+        while ((count = event_queue().try_dequeue_bulk(token, batch.data(), batch.size())) > 0) {
+            write(batch.data(), count);
+        }
+        write_lock_summary();
+        write_atomic_stats();
+        // Lock class names, like the string table, are only needed once the trace is read
+        std::vector<TraceEvent> classes = LockClasses::instance().definitions();
+        write(classes.data(), classes.size());
+    }
+
+    // Merged per-thread lock histograms since the last summary, written directly (never queued)
+    void write_lock_summary() {
+        if (lock_histograms_active.load(std::memory_order_relaxed)) {
+            std::vector<TraceEvent> records = LockHistograms::instance().take_summary();
+            write(records.data(), records.size());
+        }
+    }
+
+    // Every thread's traced_atomic counters since the last report, written directly
+    void write_atomic_stats() {
+        std::vector<TraceEvent> records = AtomicStatsRegistry::instance().collect();
+        write(records.data(), records.size());
+    }
+
+    void write(const TraceEvent* events, size_t count) {
+        if (format_ == TraceFormat::Ctf) {
+            ctf_writer_.append(events, count);
+        } else {
+            writer_.append(events, count);
+        }
+    }
 };
 
 
@@ -160,10 +420,10 @@ private:
 // Public API Implementation
 // ============================================================================
 
-inline bool init(const char* transport_path) {
+inline bool init(const char* transport_path, TraceFormat format) {
     auto& tracer_instance = internal::TracerImpl::instance();
     if(tracer_instance.is_initialized()) { return true; }
-    return tracer_instance.initialize(transport_path);
+    return tracer_instance.initialize(transport_path, format);
 }
 
 inline void shutdown() {
@@ -181,6 +441,19 @@ inline std::string get_thread_name() {
     return internal::TracerImpl::instance().get_thread_name();
 }
 
+inline void set_auto_thread_events(bool enabled) {
+    internal::auto_thread_events.store(enabled);
+}
+
+inline void set_lock_histograms(bool enabled, bool lock_events) {
+    internal::lock_events_active.store(lock_events || !enabled);
+    internal::lock_histograms_active.store(enabled);
+}
+
+inline LockLatency lock_latency(lock_id_t lock_id) {
+    return internal::LockHistograms::instance().latency(lock_id);
+}
+
 inline uint64_t get_thread_id() {
     static thread_local uint64_t cached = static_cast<uint64_t>(syscall(SYS_gettid));
     return cached;
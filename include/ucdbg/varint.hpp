@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ucdbg {
+namespace internal {
+
+// LEB128 varints need at most 10 bytes for a 64-bit value
+constexpr size_t MAX_VARINT_BYTES = 10;
+
+// Map signed values to unsigned so small magnitudes encode in few bytes
+inline uint64_t zigzag_encode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzag_decode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Writes value as LEB128; caller guarantees MAX_VARINT_BYTES of space
+inline uint8_t* write_varint(uint8_t* out, uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = static_cast<uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+    *out++ = static_cast<uint8_t>(value);
+    return out;
+}
+
+// Returns pointer past the varint, or nullptr if truncated/overlong
+inline const uint8_t* read_varint(const uint8_t* in, const uint8_t* end, uint64_t& value) {
+    uint64_t result = 0;
+    for (unsigned shift = 0; shift < 64 && in < end; shift += 7) {
+        uint8_t byte = *in++;
+        result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            value = result;
+            return in;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace internal
+} // namespace ucdbg
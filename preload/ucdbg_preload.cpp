@@ -0,0 +1,468 @@
+/**
+ * ucdbg LD_PRELOAD interposer
+ *
+ * Traces an unmodified binary by interposing the pthread synchronization
+ * and thread creation calls and feeding the same event pipeline as
+ * LockGuard/SharedLockGuard/ConditionVariable/ThreadGuard:
+ *
+ *   UCDBG_TRACE_PATH=/tmp/app.trace LD_PRELOAD=libucdbg_preload.so ./app
+ *
+ * With UCDBG_TRACE_FORMAT=ctf, UCDBG_TRACE_PATH names a CTF trace directory.
+ *
+ * Mutex and rwlock lock_ids are the lock's address, which matches the
+ * default LockGuard id for std::mutex/std::shared_mutex. Condition variable
+ * events use the mutex passed to the wait, as ConditionVariable does.
+ *
+ * Not traced: pthread_*_timed{rd,wr}lock, pthread_spin_*, calls made
+ * while the tracer itself is running (reentrancy guard) and anything the
+ * drain thread does.
+ */
+
+#include <ucdbg/ucdbg.hpp>
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using ucdbg::EventType;
+using ucdbg::TraceEvent;
+using ucdbg::lock_id_t;
+using ucdbg::internal::emit;
+using ucdbg::internal::make_concurrency_event;
+
+struct RealFunctions {
+    decltype(&::pthread_mutex_lock) mutex_lock;
+    decltype(&::pthread_mutex_trylock) mutex_trylock;
+    decltype(&::pthread_mutex_timedlock) mutex_timedlock;
+    decltype(&::pthread_mutex_unlock) mutex_unlock;
+    decltype(&::pthread_rwlock_rdlock) rwlock_rdlock;
+    decltype(&::pthread_rwlock_tryrdlock) rwlock_tryrdlock;
+    decltype(&::pthread_rwlock_wrlock) rwlock_wrlock;
+    decltype(&::pthread_rwlock_trywrlock) rwlock_trywrlock;
+    decltype(&::pthread_rwlock_unlock) rwlock_unlock;
+    decltype(&::pthread_cond_wait) cond_wait;
+    decltype(&::pthread_cond_timedwait) cond_timedwait;
+    decltype(&::pthread_cond_signal) cond_signal;
+    decltype(&::pthread_cond_broadcast) cond_broadcast;
+    decltype(&::pthread_create) create;
+};
+
+template <class F>
+void resolve(F& function, const char* name, const char* version = nullptr) {
+    void* symbol = nullptr;
+#ifdef __GLIBC__
+    // Plain dlsym returns the oldest version of pthread_cond_*, with the pre-2.3.2 layout
+    if (version) {
+        symbol = dlvsym(RTLD_NEXT, name, version);
+    }
+#else
+    (void)version;
+#endif
+    if (!symbol) {
+        symbol = dlsym(RTLD_NEXT, name);
+    }
+    if (!symbol) {
+        std::abort();  // Nothing sensible to forward to
+    }
+    function = reinterpret_cast<F>(symbol);
+}
+
+const RealFunctions& real() {
+    static const RealFunctions functions = [] {
+        RealFunctions f;
+        resolve(f.mutex_lock, "pthread_mutex_lock");
+        resolve(f.mutex_trylock, "pthread_mutex_trylock");
+        resolve(f.mutex_timedlock, "pthread_mutex_timedlock");
+        resolve(f.mutex_unlock, "pthread_mutex_unlock");
+        resolve(f.rwlock_rdlock, "pthread_rwlock_rdlock");
+        resolve(f.rwlock_tryrdlock, "pthread_rwlock_tryrdlock");
+        resolve(f.rwlock_wrlock, "pthread_rwlock_wrlock");
+        resolve(f.rwlock_trywrlock, "pthread_rwlock_trywrlock");
+        resolve(f.rwlock_unlock, "pthread_rwlock_unlock");
+        resolve(f.cond_wait, "pthread_cond_wait", "GLIBC_2.3.2");
+        resolve(f.cond_timedwait, "pthread_cond_timedwait", "GLIBC_2.3.2");
+        resolve(f.cond_signal, "pthread_cond_signal", "GLIBC_2.3.2");
+        resolve(f.cond_broadcast, "pthread_cond_broadcast", "GLIBC_2.3.2");
+        resolve(f.create, "pthread_create");
+        return f;
+    }();
+    return functions;
+}
+
+// Set while inside a hook, so locks taken by the tracer itself (or by
+// malloc, if it uses pthread mutexes) are forwarded untraced
+thread_local bool in_hook __attribute__((tls_model("initial-exec"))) = false;
+
+class HookScope {
+public:
+    HookScope() { in_hook = true; }
+    ~HookScope() { in_hook = false; }
+    HookScope(const HookScope&) = delete;
+    HookScope& operator=(const HookScope&) = delete;
+};
+
+lock_id_t id_of(const void* object) {
+    return reinterpret_cast<lock_id_t>(object);
+}
+
+#ifdef __GLIBC__
+// pthread_rwlock_unlock does not say which mode it releases; glibc keeps the
+// writer's TID in the lock and uses it the same way to tell the two apart
+bool held_for_writing(const pthread_rwlock_t* rwlock) {
+    return static_cast<uint64_t>(__atomic_load_n(&rwlock->__data.__cur_writer, __ATOMIC_RELAXED)) ==
+           ucdbg::get_thread_id();
+}
+#else
+// rwlocks this thread holds for reading; pthread_rwlock_unlock does not say which mode it releases
+class HeldReadLocks {
+public:
+    void add(const void* rwlock) {
+        locks_.push_back(rwlock);
+    }
+
+    bool remove(const void* rwlock) {
+        for (size_t i = locks_.size(); i-- > 0;) {
+            if (locks_[i] == rwlock) {
+                locks_[i] = locks_.back();
+                locks_.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    std::vector<const void*> locks_;
+};
+
+thread_local HeldReadLocks held_read_locks;
+#endif
+
+/**
+ * Per-condition-variable state: the mutex of the last wait (for notify
+ * events) and the waiter/signal counts used to classify wakeups, as in
+ * TracedConditionVariable. Fixed-size, open-addressed, never freed.
+ * Lookups give up after MAX_PROBE entries, so once short-lived conditions
+ * have filled the table a hook costs a few cache lines, not a scan of all
+ * of it; conditions that find no entry are untracked: their wakeups are
+ * reported as Notified and their notifies name no mutex.
+ */
+class CondTable {
+public:
+    static constexpr size_t CAPACITY = 1024;
+    static constexpr size_t MAX_PROBE = 16;
+
+    struct alignas(64) Entry {
+        std::atomic<const void*> cond{nullptr};
+        std::atomic<lock_id_t> mutex{0};
+        std::atomic<uint32_t> waiters{0};
+        std::atomic<uint32_t> signals{0};
+    };
+
+    Entry* find_or_insert(const void* cond) {
+        size_t start = static_cast<size_t>((id_of(cond) * 0x9E3779B97F4A7C15ull) >> 32);
+        for (size_t probe = 0; probe < MAX_PROBE; ++probe) {
+            Entry& entry = entries_[(start + probe) % CAPACITY];
+            const void* key = entry.cond.load(std::memory_order_acquire);
+            if (key == nullptr && entry.cond.compare_exchange_strong(key, cond, std::memory_order_acq_rel)) {
+                return &entry;
+            }
+            if (key == cond) {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    Entry entries_[CAPACITY];
+};
+
+CondTable cond_table;
+
+void cond_wait_begin(CondTable::Entry* entry, pthread_mutex_t* mutex) {
+    if (entry) {
+        entry->mutex.store(id_of(mutex), std::memory_order_relaxed);
+        entry->waiters.fetch_add(1, std::memory_order_acq_rel);
+    }
+    emit(make_concurrency_event(EventType::CondWaitBegin, id_of(mutex)));
+}
+
+void cond_wait_end(CondTable::Entry* entry, pthread_mutex_t* mutex, bool timed_out) {
+    ucdbg::WakeReason reason = timed_out ? ucdbg::WakeReason::Timeout : ucdbg::WakeReason::Notified;
+    if (entry) {
+        if (!timed_out) {
+            uint32_t signals = entry->signals.load(std::memory_order_acquire);
+            while (signals > 0 &&
+                   !entry->signals.compare_exchange_weak(signals, signals - 1, std::memory_order_acq_rel)) {
+            }
+            reason = signals > 0 ? ucdbg::WakeReason::Notified : ucdbg::WakeReason::Spurious;
+        }
+        uint32_t waiters = entry->waiters.fetch_sub(1, std::memory_order_acq_rel) - 1;
+        uint32_t signals = entry->signals.load(std::memory_order_relaxed);
+        while (signals > waiters &&
+               !entry->signals.compare_exchange_weak(signals, waiters, std::memory_order_acq_rel)) {
+        }
+    }
+    emit(make_concurrency_event(EventType::CondWaitEnd, id_of(mutex), static_cast<uint32_t>(reason)));
+}
+
+struct StartArgs {
+    void* (*routine)(void*);
+    void* arg;
+};
+
+void* traced_start(void* p) {
+    StartArgs args = *static_cast<StartArgs*>(p);
+    delete static_cast<StartArgs*>(p);
+    ucdbg::internal::ThreadGuard guard;  // ThreadEnd also runs on pthread_exit (forced unwind)
+    return args.routine(args.arg);
+}
+
+__attribute__((constructor(101))) void preload_init() {
+    HookScope scope;  // Locks taken while starting the tracer stay untraced
+    real();
+    // in_hook is per thread: the drain thread sets it for good, so its locks are never traced
+    ucdbg::internal::TracerImpl::drain_thread_start = [] { in_hook = true; };
+    const char* format = std::getenv("UCDBG_TRACE_FORMAT");
+    ucdbg::init(std::getenv("UCDBG_TRACE_PATH"),
+                format && std::strcmp(format, "ctf") == 0 ? ucdbg::TraceFormat::Ctf : ucdbg::TraceFormat::Block);
+    // Shutdown happens in TracerImpl's static destructor at exit
+}
+
+} // namespace
+
+extern "C" {
+
+int pthread_mutex_lock(pthread_mutex_t* mutex) {
+    if (in_hook) {
+        return real().mutex_lock(mutex);
+    }
+    HookScope scope;
+    int result = real().mutex_trylock(mutex);
+    if (result == EBUSY) {
+        emit(make_concurrency_event(EventType::LockContended, id_of(mutex)));
+        result = real().mutex_lock(mutex);
+    }
+    if (result == 0) {
+        emit(make_concurrency_event(EventType::LockAcquire, id_of(mutex)));
+    }
+    return result;
+}
+
+int pthread_mutex_trylock(pthread_mutex_t* mutex) {
+    if (in_hook) {
+        return real().mutex_trylock(mutex);
+    }
+    HookScope scope;
+    int result = real().mutex_trylock(mutex);
+    if (result == 0) {
+        emit(make_concurrency_event(EventType::LockAcquire, id_of(mutex)));
+    }
+    return result;
+}
+
+int pthread_mutex_timedlock(pthread_mutex_t* mutex, const struct timespec* deadline) {
+    if (in_hook) {
+        return real().mutex_timedlock(mutex, deadline);
+    }
+    HookScope scope;
+    int result = real().mutex_trylock(mutex);
+    if (result == EBUSY) {
+        emit(make_concurrency_event(EventType::LockContended, id_of(mutex)));
+        result = real().mutex_timedlock(mutex, deadline);
+    }
+    if (result == 0) {
+        emit(make_concurrency_event(EventType::LockAcquire, id_of(mutex)));
+    }
+    return result;
+}
+
+int pthread_mutex_unlock(pthread_mutex_t* mutex) {
+    if (in_hook) {
+        return real().mutex_unlock(mutex);
+    }
+    HookScope scope;
+    // Stamped before the unlock, so it sorts before the next owner's acquire
+    TraceEvent release = make_concurrency_event(EventType::LockRelease, id_of(mutex));
+    int result = real().mutex_unlock(mutex);
+    if (result == 0) {
+        emit(release);
+    }
+    return result;
+}
+
+int pthread_rwlock_rdlock(pthread_rwlock_t* rwlock) {
+    if (in_hook) {
+        return real().rwlock_rdlock(rwlock);
+    }
+    HookScope scope;
+    auto* readers = ucdbg::internal::ReaderCounts::instance().find_or_insert(id_of(rwlock));
+    int result = real().rwlock_tryrdlock(rwlock);
+    if (result == EBUSY) {
+        uint32_t holding = readers ? readers->load(std::memory_order_relaxed) : 0;
+        emit(make_concurrency_event(EventType::SharedLockContended, id_of(rwlock), holding));
+        result = real().rwlock_rdlock(rwlock);
+    }
+    if (result == 0) {
+#ifndef __GLIBC__
+        held_read_locks.add(rwlock);
+#endif
+        uint32_t count = ucdbg::internal::ReaderCounts::add_reader(readers);
+        emit(make_concurrency_event(EventType::SharedLockAcquire, id_of(rwlock), count));
+    }
+    return result;
+}
+
+int pthread_rwlock_tryrdlock(pthread_rwlock_t* rwlock) {
+    if (in_hook) {
+        return real().rwlock_tryrdlock(rwlock);
+    }
+    HookScope scope;
+    int result = real().rwlock_tryrdlock(rwlock);
+    if (result == 0) {
+        auto* readers = ucdbg::internal::ReaderCounts::instance().find_or_insert(id_of(rwlock));
+#ifndef __GLIBC__
+        held_read_locks.add(rwlock);
+#endif
+        uint32_t count = ucdbg::internal::ReaderCounts::add_reader(readers);
+        emit(make_concurrency_event(EventType::SharedLockAcquire, id_of(rwlock), count));
+    }
+    return result;
+}
+
+int pthread_rwlock_wrlock(pthread_rwlock_t* rwlock) {
+    if (in_hook) {
+        return real().rwlock_wrlock(rwlock);
+    }
+    HookScope scope;
+    int result = real().rwlock_trywrlock(rwlock);
+    if (result == EBUSY) {
+        uint32_t holding = ucdbg::internal::ReaderCounts::instance().readers(id_of(rwlock));
+        emit(make_concurrency_event(EventType::LockContended, id_of(rwlock), holding));
+        result = real().rwlock_wrlock(rwlock);
+    }
+    if (result == 0) {
+        emit(make_concurrency_event(EventType::LockAcquire, id_of(rwlock)));
+    }
+    return result;
+}
+
+int pthread_rwlock_trywrlock(pthread_rwlock_t* rwlock) {
+    if (in_hook) {
+        return real().rwlock_trywrlock(rwlock);
+    }
+    HookScope scope;
+    int result = real().rwlock_trywrlock(rwlock);
+    if (result == 0) {
+        emit(make_concurrency_event(EventType::LockAcquire, id_of(rwlock)));
+    }
+    return result;
+}
+
+int pthread_rwlock_unlock(pthread_rwlock_t* rwlock) {
+    if (in_hook) {
+        return real().rwlock_unlock(rwlock);
+    }
+    HookScope scope;
+#ifdef __GLIBC__
+    bool shared = !held_for_writing(rwlock);
+#else
+    bool shared = held_read_locks.remove(rwlock);
+#endif
+    if (!shared) {
+        TraceEvent release = make_concurrency_event(EventType::LockRelease, id_of(rwlock));
+        int result = real().rwlock_unlock(rwlock);
+        if (result == 0) {
+            emit(release);
+        }
+        return result;
+    }
+    auto* readers = ucdbg::internal::ReaderCounts::instance().find_or_insert(id_of(rwlock));
+    uint32_t count = ucdbg::internal::ReaderCounts::remove_reader(readers);
+    TraceEvent release = make_concurrency_event(EventType::SharedLockRelease, id_of(rwlock), count);
+    int result = real().rwlock_unlock(rwlock);
+    emit(release);
+    return result;
+}
+
+// The default-versioned (GLIBC_2.3.2) pthread_cond_* are the ones programs link against
+int pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex) {
+    if (in_hook) {
+        return real().cond_wait(cond, mutex);
+    }
+    HookScope scope;
+    CondTable::Entry* entry = cond_table.find_or_insert(cond);
+    cond_wait_begin(entry, mutex);
+    int result = real().cond_wait(cond, mutex);
+    cond_wait_end(entry, mutex, false);
+    return result;
+}
+
+int pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* deadline) {
+    if (in_hook) {
+        return real().cond_timedwait(cond, mutex, deadline);
+    }
+    HookScope scope;
+    CondTable::Entry* entry = cond_table.find_or_insert(cond);
+    cond_wait_begin(entry, mutex);
+    int result = real().cond_timedwait(cond, mutex, deadline);
+    cond_wait_end(entry, mutex, result == ETIMEDOUT);
+    return result;
+}
+
+int pthread_cond_signal(pthread_cond_t* cond) {
+    if (in_hook) {
+        return real().cond_signal(cond);
+    }
+    HookScope scope;
+    CondTable::Entry* entry = cond_table.find_or_insert(cond);
+    uint32_t waiters = 0;
+    lock_id_t mutex = 0;
+    if (entry) {
+        waiters = entry->waiters.load(std::memory_order_acquire);
+        mutex = entry->mutex.load(std::memory_order_relaxed);
+        uint32_t signals = entry->signals.load(std::memory_order_relaxed);
+        while (signals < waiters &&
+               !entry->signals.compare_exchange_weak(signals, signals + 1, std::memory_order_acq_rel)) {
+        }
+    }
+    emit(make_concurrency_event(EventType::CondNotifyOne, mutex, waiters));
+    return real().cond_signal(cond);
+}
+
+int pthread_cond_broadcast(pthread_cond_t* cond) {
+    if (in_hook) {
+        return real().cond_broadcast(cond);
+    }
+    HookScope scope;
+    CondTable::Entry* entry = cond_table.find_or_insert(cond);
+    uint32_t waiters = 0;
+    lock_id_t mutex = 0;
+    if (entry) {
+        waiters = entry->waiters.load(std::memory_order_acquire);
+        mutex = entry->mutex.load(std::memory_order_relaxed);
+        entry->signals.store(waiters, std::memory_order_release);
+    }
+    emit(make_concurrency_event(EventType::CondNotifyAll, mutex, waiters));
+    return real().cond_broadcast(cond);
+}
+
+int pthread_create(pthread_t* thread, const pthread_attr_t* attr, void* (*routine)(void*), void* arg) {
+    if (in_hook) {
+        return real().create(thread, attr, routine, arg);
+    }
+    HookScope scope;
+    auto* args = new StartArgs{routine, arg};
+    int result = real().create(thread, attr, traced_start, args);
+    if (result != 0) {
+        delete args;
+    }
+    return result;
+}
+
+} // extern "C"
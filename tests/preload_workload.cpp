@@ -0,0 +1,83 @@
+/**
+ * Uninstrumented workload for test_preload: uses only std:: threads and
+ * synchronization, and prints the addresses of its locks and its PID on
+ * stdout. Also forks a child that locks and exits normally, which must
+ * leave the parent's trace intact, notifies more condition variables than
+ * the interposer tracks, and runs past the tracer's first periodic summary.
+ */
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+int main() {
+    constexpr int THREADS = 4;
+    constexpr int ITERATIONS = 100;
+    std::mutex mtx;
+    std::shared_mutex rw;
+    std::mutex cv_mtx;
+    std::condition_variable cv;
+    bool ready = false;
+    long total = 0;
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < THREADS; ++t) {
+        workers.emplace_back([&] {
+            for (int i = 0; i < ITERATIONS; ++i) {
+                std::lock_guard<std::mutex> lock(mtx);
+                ++total;
+            }
+            for (int i = 0; i < ITERATIONS / 10; ++i) {
+                std::shared_lock<std::shared_mutex> lock(rw);
+            }
+        });
+    }
+    std::thread waiter([&] {
+        std::unique_lock<std::mutex> lock(cv_mtx);
+        cv.wait(lock, [&] { return ready; });
+    });
+    for (auto& w : workers) w.join();
+    {
+        std::lock_guard<std::mutex> lock(cv_mtx);
+        ready = true;
+    }
+    cv.notify_one();
+    waiter.join();
+
+    // More condition variables than the interposer's table holds
+    std::vector<std::condition_variable> many(2000);
+    for (auto& c : many) c.notify_one();
+
+    // More read locks held at once than a small fixed table would track
+    std::array<std::shared_mutex, 20> nested;
+    for (auto& m : nested) m.lock_shared();
+    for (auto& m : nested) m.unlock_shared();
+
+    pid_t child = fork();
+    if (child == 0) {
+        for (int i = 0; i < ITERATIONS; ++i) {
+            std::lock_guard<std::mutex> lock(mtx);
+            ++total;
+        }
+        std::exit(0);  // Runs static destructors, including the tracer's
+    }
+    int status = 0;
+    if (child < 0 || waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return 1;
+    }
+
+    // Outlive the tracer's one-second summary interval, so the drain thread takes its locks
+    std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+
+    std::printf("%p %p %p %ld %p %ld\n", static_cast<void*>(&mtx), static_cast<void*>(&rw),
+                static_cast<void*>(&cv_mtx), total, static_cast<void*>(nested.data()), static_cast<long>(getpid()));
+    return 0;
+}
@@ -0,0 +1,389 @@
+/**
+ * Block trace format test
+ *
+ * This test verifies:
+ * 1. Events of every kind round-trip losslessly through the block format
+ * 2. The block index answers time-window queries, per thread and in
+ *    timestamp order
+ * 3. A file without a trailer is recovered by scanning block headers, or
+ *    from the sidecar index plus a scan of the blocks it does not list
+ * 4. Events emitted by guards reach the trace file through the drain thread
+ * 5. The LZ block compressor round-trips and rejects corrupt input
+ * 6. Encoders of ended threads and flushed encoders are dropped, so the
+ *    writer's memory does not grow with every thread ID ever seen
+ */
+
+#include <ucdbg/ucdbg.hpp>
+#include <ucdbg/block_reader.hpp>
+#include <ucdbg/block_writer.hpp>
+#include <ucdbg/lz_compress.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "test_common.hpp"
+
+static ucdbg::TraceEvent make_event(uint64_t ts, uint64_t tid, ucdbg::EventType type, uint64_t lock_id) {
+    ucdbg::TraceEvent event;
+    std::memset(&event, 0, sizeof(event));
+    event.timestamp_ns = ts;
+    event.thread_id = tid;
+    event.format_version = ucdbg::TRACE_FORMAT_VERSION;
+    event.kind = ucdbg::EventKind::Concurrency;
+    event.concurrency.type = type;
+    event.concurrency.lock_id = lock_id;
+    return event;
+}
+
+static bool same_event(const ucdbg::TraceEvent& a, const ucdbg::TraceEvent& b) {
+    return std::memcmp(&a, &b, sizeof(ucdbg::TraceEvent)) == 0;
+}
+
+// Synthetic trace: 4 threads, each alternating acquire/release on a few locks
+static std::vector<ucdbg::TraceEvent> make_trace() {
+    std::vector<ucdbg::TraceEvent> events;
+    uint64_t ts = 1'000'000'000;
+    for (int i = 0; i < 20000; ++i) {
+        uint64_t tid = 100 + (i % 4);
+        uint64_t lock = 0x7f0000001000ull + 64 * ((i / 8) % 3);
+        auto type = (i / 4) % 2 ? ucdbg::EventType::LockRelease : ucdbg::EventType::LockAcquire;
+        ts += 50 + (i % 7);
+        events.push_back(make_event(ts, tid, type, lock));
+    }
+    // A log event with non-zero reserved bytes and a foreign format version
+    ucdbg::TraceEvent log;
+    std::memset(&log, 0, sizeof(log));
+    log.timestamp_ns = ts + 10;
+    log.thread_id = 100;
+    log.format_version = 0;
+    log.kind = ucdbg::EventKind::Log;
+    log.reserved[1] = 7;
+    log.log.level = ucdbg::LogLevel::Warning;
+    log.log.reserved[2] = 3;
+    log.log.message_string_id = 42;
+    events.push_back(log);
+    return events;
+}
+
+static void test_round_trip_and_index(const char* path, ucdbg::BlockCodec codec) {
+    std::vector<ucdbg::TraceEvent> events = make_trace();
+
+    ucdbg::BlockTraceWriter writer(1000, codec);
+    CHECK(writer.open(path));
+    writer.append(events.data(), events.size());
+    writer.set_thread_name(100, "worker_0");
+    writer.close();
+
+    uint64_t raw_size = events.size() * sizeof(ucdbg::TraceEvent);
+    std::cout << "Raw " << raw_size << " bytes -> block format " << writer.bytes_written()
+              << " bytes" << std::endl;
+    CHECK(writer.bytes_written() * 6 < raw_size);
+
+    ucdbg::BlockTraceReader reader;
+    CHECK(reader.open(path));
+    CHECK(!reader.recovered());
+    CHECK(reader.event_count() == events.size());
+    CHECK(reader.thread_names().count(100) == 1 && reader.thread_names().at(100) == "worker_0");
+
+    // Per-thread order must be preserved exactly
+    std::map<uint64_t, std::vector<ucdbg::TraceEvent>> expected, actual;
+    for (const auto& e : events) expected[e.thread_id].push_back(e);
+    CHECK(reader.for_each_event([&](const ucdbg::TraceEvent& e) { actual[e.thread_id].push_back(e); }));
+    CHECK(expected.size() == actual.size());
+    for (const auto& [tid, list] : expected) {
+        const auto& got = actual[tid];
+        CHECK(got.size() == list.size());
+        for (size_t i = 0; i < list.size() && i < got.size(); ++i) {
+            if (!same_event(list[i], got[i])) {
+                CHECK(same_event(list[i], got[i]));
+                break;
+            }
+        }
+    }
+
+    // Window query touches only overlapping blocks and returns exact events
+    uint64_t begin = events[5000].timestamp_ns;
+    uint64_t end = events[6000].timestamp_ns;
+    size_t in_window = 0;
+    for (const auto& e : events) {
+        in_window += e.timestamp_ns >= begin && e.timestamp_ns <= end;
+    }
+    size_t seen = 0;
+    CHECK(reader.for_each_event(begin, end, [&](const ucdbg::TraceEvent&) { ++seen; }));
+    CHECK(seen == in_window);
+    CHECK(reader.blocks_in_window(begin, end).size() < reader.blocks().size());
+    CHECK(reader.blocks_in_window(0, 1).empty());
+
+    // One thread's window, and the whole window in timestamp order
+    size_t thread_in_window = 0;
+    for (const auto& e : events) {
+        thread_in_window += e.thread_id == 101 && e.timestamp_ns >= begin && e.timestamp_ns <= end;
+    }
+    std::vector<ucdbg::TraceEvent> window;
+    CHECK(reader.for_each_event(begin, end, 101, [&](const ucdbg::TraceEvent& e) { window.push_back(e); }));
+    CHECK(window.size() == thread_in_window);
+    CHECK(std::all_of(window.begin(), window.end(), [](const ucdbg::TraceEvent& e) { return e.thread_id == 101; }));
+    for (size_t block : reader.blocks_in_window(begin, end, 101)) {
+        CHECK(reader.blocks()[block].thread_id == 101);
+    }
+    CHECK(reader.blocks_in_window(begin, end, 999).empty());
+    window.clear();
+    CHECK(reader.for_each_event_ordered(begin, end, [&](const ucdbg::TraceEvent& e) { window.push_back(e); }));
+    CHECK(window.size() == in_window);
+    CHECK(std::is_sorted(window.begin(), window.end(), [](const ucdbg::TraceEvent& a, const ucdbg::TraceEvent& b) {
+        return a.timestamp_ns < b.timestamp_ns;
+    }));
+}
+
+static void test_recovery_without_trailer(const char* path) {
+    std::vector<ucdbg::TraceEvent> events = make_trace();
+    {
+        ucdbg::BlockTraceWriter writer(1000);
+        CHECK(writer.open(path));
+        writer.append(events.data(), events.size());
+        writer.close();
+    }
+    // Chop off the index and trailer, plus half of the last block
+    std::FILE* file = std::fopen(path, "rb");
+    std::vector<char> bytes;
+    char buffer[4096];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) bytes.insert(bytes.end(), buffer, buffer + n);
+    std::fclose(file);
+
+    ucdbg::BlockTraceReader full;
+    CHECK(full.open(path));
+    const auto& last = full.blocks().back();
+    size_t cut = last.offset + 20;
+    file = std::fopen(path, "wb");
+    std::fwrite(bytes.data(), 1, cut, file);
+    std::fclose(file);
+
+    ucdbg::BlockTraceReader reader;
+    CHECK(reader.open(path));
+    CHECK(reader.recovered());
+    CHECK(reader.blocks().size() == full.blocks().size() - 1);
+    CHECK(reader.event_count() == events.size() - last.event_count);
+}
+
+static std::vector<char> read_file(const std::string& path) {
+    std::vector<char> bytes;
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return bytes;
+    }
+    char buffer[4096];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) bytes.insert(bytes.end(), buffer, buffer + n);
+    std::fclose(file);
+    return bytes;
+}
+
+static void write_file(const std::string& path, const std::vector<char>& bytes, size_t size) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    std::fwrite(bytes.data(), 1, std::min(size, bytes.size()), file);
+    std::fclose(file);
+}
+
+static void test_recovery_from_sidecar(const char* path) {
+    std::vector<ucdbg::TraceEvent> events = make_trace();
+    std::string sidecar = std::string(path) + ucdbg::BLOCK_SIDECAR_SUFFIX;
+    std::string crashed = std::string(path) + ".crashed";
+    std::string crashed_sidecar = crashed + ucdbg::BLOCK_SIDECAR_SUFFIX;
+    std::vector<char> trace_bytes, sidecar_bytes;
+    {
+        ucdbg::BlockTraceWriter writer(1000, ucdbg::BlockCodec::LZ, true);
+        CHECK(writer.open(path));
+        writer.append(events.data(), events.size());
+        writer.flush();
+        // What a crash at this point would leave on disk
+        trace_bytes = read_file(path);
+        sidecar_bytes = read_file(sidecar);
+        writer.close();
+    }
+    CHECK(read_file(sidecar).empty());  // Deleted once the trailer is written
+
+    ucdbg::BlockTraceReader full;
+    CHECK(full.open(path));
+    CHECK(sidecar_bytes.size() == sizeof(ucdbg::BlockFileHeader) + full.blocks().size() * sizeof(ucdbg::BlockIndexEntry));
+
+    // Sidecar lagging by three entries and a torn fourth: only those blocks are scanned
+    write_file(crashed, trace_bytes, trace_bytes.size());
+    write_file(crashed_sidecar, sidecar_bytes, sidecar_bytes.size() - 3 * sizeof(ucdbg::BlockIndexEntry) - 7);
+    {
+        ucdbg::BlockTraceReader reader;
+        CHECK(reader.open(crashed.c_str()));
+        CHECK(reader.recovered());
+        CHECK(reader.scanned_blocks() == 4);
+        CHECK(reader.blocks().size() == full.blocks().size());
+        CHECK(reader.event_count() == events.size());
+        for (size_t i = 0; i < reader.blocks().size() && i < full.blocks().size(); ++i) {
+            CHECK(reader.blocks()[i].offset == full.blocks()[i].offset);
+        }
+    }
+
+    // Trace torn inside its last block, sidecar complete: the torn block is dropped
+    const auto& last = full.blocks().back();
+    write_file(crashed, trace_bytes, last.offset + 20);
+    write_file(crashed_sidecar, sidecar_bytes, sidecar_bytes.size());
+    {
+        ucdbg::BlockTraceReader reader;
+        CHECK(reader.open(crashed.c_str()));
+        CHECK(reader.scanned_blocks() == 0);
+        CHECK(reader.blocks().size() == full.blocks().size() - 1);
+        CHECK(reader.event_count() == events.size() - last.event_count);
+    }
+
+    // A sidecar describing another trace is ignored in favour of a full scan
+    std::vector<char> stale(sidecar_bytes.begin(), sidecar_bytes.begin() + sizeof(ucdbg::BlockFileHeader));
+    ucdbg::BlockIndexEntry other = full.blocks().front();
+    other.thread_id = 12345;
+    stale.insert(stale.end(), reinterpret_cast<char*>(&other), reinterpret_cast<char*>(&other) + sizeof(other));
+    write_file(crashed, trace_bytes, trace_bytes.size());
+    write_file(crashed_sidecar, stale, stale.size());
+    {
+        ucdbg::BlockTraceReader reader;
+        CHECK(reader.open(crashed.c_str()));
+        CHECK(reader.scanned_blocks() == full.blocks().size());
+        CHECK(reader.event_count() == events.size());
+    }
+
+    // Opening a writer removes a stale sidecar even when it keeps none
+    {
+        ucdbg::BlockTraceWriter writer(1000);
+        CHECK(writer.open(crashed.c_str()));
+        CHECK(read_file(crashed_sidecar).empty());
+    }
+    std::remove(crashed.c_str());
+}
+
+static bool lz_round_trip(const std::vector<uint8_t>& input) {
+    std::vector<uint8_t> compressed(ucdbg::internal::lz_compress_bound(input.size()));
+    compressed.resize(ucdbg::internal::lz_compress(input.data(), input.size(), compressed.data()));
+    std::vector<uint8_t> output(input.size());
+    return ucdbg::internal::lz_decompress(compressed.data(), compressed.size(), output.data(), output.size()) &&
+           output == input;
+}
+
+static void test_lz_compressor() {
+    std::mt19937 rng(7);
+    std::vector<uint8_t> random(100000), runs(100000, 0xAB), mixed;
+    for (auto& b : random) b = static_cast<uint8_t>(rng());
+    for (int i = 0; i < 5000; ++i) {
+        const char* text = i % 3 ? "LockAcquire" : "LockRelease";
+        mixed.insert(mixed.end(), text, text + 11);
+        mixed.push_back(static_cast<uint8_t>(rng() % 4));
+    }
+    CHECK(lz_round_trip({}));
+    CHECK(lz_round_trip({1, 2, 3}));
+    CHECK(lz_round_trip(random));
+    CHECK(lz_round_trip(runs));
+    CHECK(lz_round_trip(mixed));
+
+    std::vector<uint8_t> compressed(ucdbg::internal::lz_compress_bound(mixed.size()));
+    compressed.resize(ucdbg::internal::lz_compress(mixed.data(), mixed.size(), compressed.data()));
+    CHECK(compressed.size() * 2 < mixed.size());
+
+    // Corrupt or truncated input must be rejected, never overrun the output
+    std::vector<uint8_t> output(mixed.size());
+    CHECK(!ucdbg::internal::lz_decompress(compressed.data(), compressed.size() / 2, output.data(), output.size()));
+    CHECK(!ucdbg::internal::lz_decompress(compressed.data(), compressed.size(), output.data(), output.size() - 1));
+    for (size_t i = 0; i < compressed.size(); i += 17) {
+        std::vector<uint8_t> corrupt = compressed;
+        corrupt[i] ^= 0x5A;
+        ucdbg::internal::lz_decompress(corrupt.data(), corrupt.size(), output.data(), output.size());
+    }
+}
+
+static void test_encoder_lifetime(const char* path) {
+    constexpr uint64_t THREADS = 1000;
+    ucdbg::BlockTraceWriter writer;
+    CHECK(writer.open(path));
+    uint64_t ts = 1'000'000;
+    for (uint64_t tid = 1; tid <= THREADS; ++tid) {
+        writer.append(make_event(++ts, tid, ucdbg::EventType::ThreadStart, 0));
+        writer.append(make_event(++ts, tid, ucdbg::EventType::LockAcquire, 0x1000));
+        writer.append(make_event(++ts, tid, ucdbg::EventType::LockRelease, 0x1000));
+        writer.append(make_event(++ts, tid, ucdbg::EventType::ThreadEnd, 0));
+    }
+    CHECK(writer.pending_threads() == 0);
+    CHECK(writer.block_count() == THREADS);
+
+    // Threads without ThreadEnd keep their encoder until a flush
+    for (uint64_t tid = 1; tid <= 10; ++tid) {
+        writer.append(make_event(++ts, tid, ucdbg::EventType::LockAcquire, 0x2000));
+    }
+    CHECK(writer.pending_threads() == 10);
+    writer.flush();
+    CHECK(writer.pending_threads() == 0);
+    CHECK(writer.block_count() == THREADS + 10);
+    writer.append(make_event(++ts, 1, ucdbg::EventType::LockRelease, 0x2000));
+    writer.close();
+
+    ucdbg::BlockTraceReader reader;
+    CHECK(reader.open(path));
+    CHECK(reader.event_count() == 4 * THREADS + 11);
+    std::vector<ucdbg::TraceEvent> thread_one;
+    CHECK(reader.for_each_event_ordered([&](const ucdbg::TraceEvent& e) {
+        if (e.thread_id == 1) thread_one.push_back(e);
+    }));
+    CHECK(thread_one.size() == 6);
+    CHECK(thread_one.size() == 6 && thread_one[3].concurrency.type == ucdbg::EventType::ThreadEnd &&
+          thread_one[5].concurrency.type == ucdbg::EventType::LockRelease);
+}
+
+static std::mutex traced_mutex;
+
+static void test_tracer_pipeline(const char* path) {
+    CHECK(UCDBG_INIT(path));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([] {
+            UCDBG_THREAD_START();
+            for (int i = 0; i < 1000; ++i) {
+                ucdbg::internal::LockGuard<std::mutex> guard(traced_mutex);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    ucdbg::shutdown();
+
+    ucdbg::BlockTraceReader reader;
+    CHECK(reader.open(path));
+    std::map<ucdbg::EventType, size_t> counts;
+    CHECK(reader.for_each_event([&](const ucdbg::TraceEvent& e) { counts[e.concurrency.type]++; }));
+    CHECK(counts[ucdbg::EventType::ThreadStart] == 4);
+    CHECK(counts[ucdbg::EventType::ThreadEnd] == 4);
+    CHECK(counts[ucdbg::EventType::LockAcquire] == 4000);
+    CHECK(counts[ucdbg::EventType::LockRelease] == 4000);
+}
+
+int main() {
+    std::cout << "=== Block Trace Format Test ===" << std::endl;
+
+    test_round_trip_and_index("/tmp/ucdbg_test_blocks.bin", ucdbg::BlockCodec::None);
+    test_round_trip_and_index("/tmp/ucdbg_test_blocks.bin", ucdbg::BlockCodec::LZ);
+    test_lz_compressor();
+    test_recovery_without_trailer("/tmp/ucdbg_test_recover.bin");
+    test_recovery_from_sidecar("/tmp/ucdbg_test_sidecar.bin");
+    test_tracer_pipeline("/tmp/ucdbg_test_pipeline.bin");
+    test_encoder_lifetime("/tmp/ucdbg_test_encoders.bin");
+
+    std::remove("/tmp/ucdbg_test_blocks.bin");
+    std::remove("/tmp/ucdbg_test_recover.bin");
+    std::remove("/tmp/ucdbg_test_sidecar.bin");
+    std::remove("/tmp/ucdbg_test_pipeline.bin");
+    std::remove("/tmp/ucdbg_test_encoders.bin");
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All block format checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,190 @@
+/**
+ * Chrome trace export test
+ *
+ * This test verifies:
+ * 1. Lock waits and holds become complete slices with exact durations
+ * 2. Thread names, spans and counters use the name tables
+ * 3. Flow, task and unfinished-slice handling
+ * 4. The output is well-formed JSON (balanced, strings escaped)
+ * 5. Slices that do not nest (hand-over-hand locking, a lock held across the
+ *    end of a span) are split so that they do
+ */
+
+#include <ucdbg/chrome_trace.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "test_common.hpp"
+
+static ucdbg::TraceEvent event(uint64_t ts, uint64_t tid, ucdbg::EventKind kind) {
+    ucdbg::TraceEvent e;
+    std::memset(&e, 0, sizeof(e));
+    e.timestamp_ns = ts;
+    e.thread_id = tid;
+    e.format_version = ucdbg::TRACE_FORMAT_VERSION;
+    e.kind = kind;
+    return e;
+}
+
+static ucdbg::TraceEvent concurrency(uint64_t ts, uint64_t tid, ucdbg::EventType type,
+                                     uint64_t id, uint32_t arg = 0) {
+    ucdbg::TraceEvent e = event(ts, tid, ucdbg::EventKind::Concurrency);
+    e.concurrency.type = type;
+    e.concurrency.lock_id = id;
+    e.set_concurrency_arg(arg);
+    return e;
+}
+
+static bool contains(const std::string& text, const std::string& needle) {
+    return text.find(needle) != std::string::npos;
+}
+
+// Brackets balance outside strings and no string is left open
+static bool well_formed(const std::string& json) {
+    int depth = 0;
+    bool in_string = false;
+    for (size_t i = 0; i < json.size(); ++i) {
+        char c = json[i];
+        if (in_string) {
+            if (c == '\\') ++i;
+            else if (c == '"') in_string = false;
+            else if (static_cast<unsigned char>(c) < 0x20) return false;
+        } else if (c == '"') {
+            in_string = true;
+        } else if (c == '{' || c == '[') {
+            ++depth;
+        } else if (c == '}' || c == ']') {
+            if (--depth < 0) return false;
+        }
+    }
+    return depth == 0 && !in_string;
+}
+
+static std::string read_file(const char* path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+static void test_nesting() {
+    const char* path = "/tmp/ucdbg_test_chrome_nesting.json";
+    using ucdbg::EventType;
+    ucdbg::ChromeTraceWriter writer;
+    CHECK(writer.open(path));
+    writer.set_strings({"step"});
+    auto span = [](uint64_t ts, uint64_t tid, ucdbg::SpanPhase phase) {
+        ucdbg::TraceEvent e = event(ts, tid, ucdbg::EventKind::Span);
+        e.span.phase = phase;
+        e.span.name_id = 0;
+        return e;
+    };
+    // Hand-over-hand: 0xa is released while 0xb, taken later, is still held
+    writer.append(concurrency(10000, 1, EventType::LockAcquire, 0xa));
+    writer.append(concurrency(11000, 1, EventType::LockAcquire, 0xb));
+    writer.append(concurrency(12000, 1, EventType::LockRelease, 0xa));
+    writer.append(concurrency(13000, 1, EventType::LockRelease, 0xb));
+    // Lock taken inside a span and released after it ends
+    writer.append(span(14000, 2, ucdbg::SpanPhase::Begin));
+    writer.append(concurrency(14500, 2, EventType::LockAcquire, 0xc));
+    writer.append(span(15000, 2, ucdbg::SpanPhase::End));
+    writer.append(concurrency(16000, 2, EventType::LockRelease, 0xc));
+    // Span begun under a lock and ended after its release
+    writer.append(concurrency(17000, 3, EventType::LockAcquire, 0xd));
+    writer.append(span(17500, 3, ucdbg::SpanPhase::Begin));
+    writer.append(concurrency(18000, 3, EventType::LockRelease, 0xd));
+    writer.append(span(18500, 3, ucdbg::SpanPhase::End));
+    CHECK(writer.close());
+
+    std::string json = read_file(path);
+    CHECK(well_formed(json));
+    CHECK(contains(json, "\"ts\":0.000,\"dur\":2.000,\"cat\":\"lock\",\"name\":\"lock 0xa\""));
+    CHECK(contains(json, "\"ts\":1.000,\"dur\":1.000,\"cat\":\"lock\",\"name\":\"lock 0xb\""));
+    CHECK(contains(json, "\"ts\":2.000,\"dur\":1.000,\"cat\":\"lock\",\"name\":\"lock 0xb\""));
+    CHECK(contains(json, "\"ts\":4.500,\"dur\":0.500,\"cat\":\"lock\",\"name\":\"lock 0xc\""));
+    CHECK(contains(json, "\"ts\":5.000,\"dur\":1.000,\"cat\":\"lock\",\"name\":\"lock 0xc\""));
+    CHECK(contains(json, "{\"ph\":\"E\",\"pid\":1,\"tid\":2,\"ts\":5.000}"));
+    CHECK(contains(json, "\"ts\":7.000,\"dur\":1.000,\"cat\":\"lock\",\"name\":\"lock 0xd\""));
+    CHECK(contains(json, "{\"ph\":\"E\",\"pid\":1,\"tid\":3,\"ts\":8.000}"));
+    CHECK(contains(json, "{\"ph\":\"B\",\"pid\":1,\"tid\":3,\"ts\":8.000,\"cat\":\"span\",\"name\":\"step\"}"));
+    CHECK(contains(json, "{\"ph\":\"E\",\"pid\":1,\"tid\":3,\"ts\":8.500}"));
+    // The split E comes before the lock slice it makes room for, and the span is not begun twice on tid 2
+    CHECK(json.find("\"tid\":3,\"ts\":8.000}") < json.find("\"name\":\"lock 0xd\""));
+    CHECK(json.find("\"ph\":\"B\",\"pid\":1,\"tid\":2,\"ts\":5.000") == std::string::npos);
+    std::remove(path);
+}
+
+int main() {
+    std::cout << "=== Chrome Trace Export Test ===" << std::endl;
+    const char* path = "/tmp/ucdbg_test_chrome.json";
+    using ucdbg::EventType;
+
+    ucdbg::ChromeTraceWriter writer;
+    CHECK(writer.open(path));
+    CHECK(!writer.open(path));
+    writer.set_strings({"parse", "queue_depth"});
+    writer.thread_name(1, "main \"io\"\n");
+
+    writer.append(concurrency(1000, 1, EventType::LockContended, 0x10));
+    writer.append(concurrency(1500, 1, EventType::LockAcquire, 0x10));
+    ucdbg::TraceEvent span = event(1600, 1, ucdbg::EventKind::Span);
+    span.span.phase = ucdbg::SpanPhase::Begin;
+    span.span.name_id = 0;
+    writer.append(span);
+    ucdbg::TraceEvent sample = event(1700, 2, ucdbg::EventKind::Counter);
+    sample.counter.name_id = 1;
+    sample.counter.value = -5;
+    writer.append(sample);
+    writer.append(concurrency(1800, 2, EventType::FlowBegin, 0xabc));
+    span.timestamp_ns = 2000;
+    span.span.phase = ucdbg::SpanPhase::End;
+    writer.append(span);
+    writer.append(concurrency(2500, 1, EventType::FlowEnd, 0xabc));
+    writer.append(concurrency(4000, 1, EventType::LockRelease, 0x10));
+    writer.append(concurrency(4100, 2, EventType::TaskEnqueue, 0x77, 3));
+    writer.append(concurrency(4200, 1, EventType::TaskBegin, 0x77, 3));
+    writer.append(concurrency(4300, 1, EventType::CondWaitBegin, 0x20));
+    writer.append(concurrency(5300, 1, EventType::CondWaitEnd, 0x20,
+                              static_cast<uint32_t>(ucdbg::WakeReason::Timeout)));
+    writer.append(concurrency(5400, 1, EventType::TaskEnd, 0x77, 3));
+    writer.append(concurrency(5500, 2, EventType::LockRelease, 0x99));  // No acquire: dropped
+    writer.append(concurrency(6000, 2, EventType::LockAcquire, 0x30));
+    writer.append(concurrency(7000, 2, EventType::CondNotifyOne, 0x20, 1));
+    CHECK(writer.close());
+    CHECK(!writer.close());
+
+    std::string json = read_file(path);
+    CHECK(writer.bytes_written() == json.size());
+    CHECK(well_formed(json));
+    CHECK(json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0) == 0);
+
+    // Timestamps relative to the first event, microseconds with ns decimals
+    CHECK(contains(json, "\"ts\":0.000,\"dur\":0.500,\"cat\":\"lock\",\"name\":\"wait lock 0x10\""));
+    CHECK(contains(json, "\"ts\":0.500,\"dur\":2.500,\"cat\":\"lock\",\"name\":\"lock 0x10\""));
+    CHECK(!contains(json, "0x99"));
+    CHECK(contains(json, "\"name\":\"thread_name\",\"args\":{\"name\":\"main \\\"io\\\"\\n\"}"));
+    CHECK(contains(json, "{\"ph\":\"B\",\"pid\":1,\"tid\":1,\"ts\":0.600,\"cat\":\"span\",\"name\":\"parse\"}"));
+    CHECK(contains(json, "{\"ph\":\"E\",\"pid\":1,\"tid\":1,\"ts\":1.000}"));
+    CHECK(contains(json, "\"name\":\"queue_depth\",\"args\":{\"value\":-5}"));
+    CHECK(contains(json, "{\"ph\":\"s\",\"bp\":\"e\",\"pid\":1,\"tid\":2,\"ts\":0.800,\"cat\":\"flow\""));
+    CHECK(contains(json, "{\"ph\":\"f\",\"bp\":\"e\",\"pid\":1,\"tid\":1,\"ts\":1.500,\"cat\":\"flow\""));
+    CHECK(contains(json, "\"cat\":\"task\",\"name\":\"task\",\"id\":\"0x77\""));
+    CHECK(contains(json, "\"ts\":3.200,\"dur\":1.200,\"cat\":\"task\",\"name\":\"task\",\"args\":{\"id\":\"0x77\",\"tag\":3}"));
+    CHECK(contains(json, "\"name\":\"cond wait 0x20\",\"args\":{\"id\":\"0x20\",\"reason\":\"Timeout\"}"));
+    CHECK(contains(json, "\"name\":\"CondNotifyOne\",\"args\":{\"id\":\"0x20\",\"arg\":1}"));
+    // Held at the end of the trace: ends at the last timestamp
+    CHECK(contains(json, "\"ts\":5.000,\"dur\":1.000,\"cat\":\"lock\",\"name\":\"lock 0x30\",\"args\":{\"id\":\"0x30\",\"unfinished\":true}"));
+
+    std::remove(path);
+    test_nesting();
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All Chrome trace export checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,88 @@
+/**
+ * Columnar trace layout test
+ *
+ * This test verifies:
+ * 1. Events round-trip byte-for-byte through the columnar layout
+ * 2. Reading a subset of columns loads only those columns, 64-byte aligned
+ * 3. Block min/max timestamps let scans skip blocks outside a window
+ */
+
+#include <ucdbg/columnar.hpp>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "test_common.hpp"
+
+static std::vector<ucdbg::TraceEvent> make_trace(size_t count) {
+    std::vector<ucdbg::TraceEvent> events(count);
+    for (size_t i = 0; i < count; ++i) {
+        auto& e = events[i];
+        std::memset(&e, 0, sizeof(e));
+        e.timestamp_ns = 1000 + i * 10;
+        e.thread_id = 7 + i % 3;
+        e.format_version = ucdbg::TRACE_FORMAT_VERSION;
+        e.kind = ucdbg::EventKind::Concurrency;
+        e.reserved[0] = static_cast<uint8_t>(i);
+        e.concurrency.type = i % 2 ? ucdbg::EventType::LockRelease : ucdbg::EventType::LockAcquire;
+        e.set_concurrency_arg(static_cast<uint32_t>(i << 5));
+        e.concurrency.lock_id = 0x1000 + 64 * (i % 5);
+    }
+    return events;
+}
+
+static bool aligned(const void* p) {
+    return reinterpret_cast<uintptr_t>(p) % ucdbg::COLUMN_ALIGNMENT == 0;
+}
+
+int main() {
+    std::cout << "=== Columnar Layout Test ===" << std::endl;
+    const char* path = "/tmp/ucdbg_test_columnar.bin";
+    auto events = make_trace(10000);
+
+    ucdbg::ColumnarTraceWriter writer(3000);
+    CHECK(writer.open(path));
+    for (const auto& e : events) writer.append(e);
+    writer.close();
+
+    ucdbg::ColumnarTraceReader reader;
+    CHECK(reader.open(path));
+    CHECK(reader.blocks().size() == 4);
+    CHECK(reader.event_count() == events.size());
+
+    // Full reconstruction
+    size_t next = 0;
+    CHECK(reader.for_each_block(ucdbg::ALL_COLUMNS, [&](const ucdbg::ColumnBlock& block) {
+        for (size_t i = 0; i < block.size(); ++i, ++next) {
+            ucdbg::TraceEvent e = block.event(i);
+            CHECK(std::memcmp(&e, &events[next], sizeof(e)) == 0);
+        }
+    }));
+    CHECK(next == events.size());
+
+    // Single column scan
+    ucdbg::ColumnBlock block;
+    CHECK(reader.read_block(1, ucdbg::column_bit(ucdbg::Column::LockId), block));
+    CHECK(block.size() == 3000);
+    CHECK(block.lock_ids().size() == 3000);
+    CHECK(block.timestamps().empty());
+    CHECK(block.kinds().empty());
+    CHECK(aligned(block.lock_ids().data()));
+    CHECK(block.lock_ids()[0] == events[3000].concurrency.lock_id);
+
+    // Window skipping: only the block containing events 4000..4100
+    size_t blocks_seen = 0;
+    CHECK(reader.for_each_block(ucdbg::column_bit(ucdbg::Column::Timestamp),
+                                [&](const ucdbg::ColumnBlock&) { ++blocks_seen; },
+                                events[4000].timestamp_ns, events[4100].timestamp_ns));
+    CHECK(blocks_seen == 1);
+
+    std::remove(path);
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All columnar checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+/**
+ * Helpers shared by the test programs: a non-fatal CHECK that counts
+ * failures, access to the events enqueued while the drain thread is not
+ * running, and a way to run code on threads that share a thread ID.
+ */
+
+#include <ucdbg/event_queue.hpp>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+inline int failures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: "  \
+                      << #cond << std::endl;                                \
+            ++failures;                                                     \
+        }                                                                   \
+    } while (0)
+
+// Capture events straight from the queue, without the drain thread
+inline std::vector<ucdbg::TraceEvent> drain() {
+    std::vector<ucdbg::TraceEvent> events;
+    ucdbg::TraceEvent e;
+    while (ucdbg::internal::event_queue().try_dequeue(e)) events.push_back(e);
+    return events;
+}
+
+inline size_t count(const std::vector<ucdbg::TraceEvent>& events, ucdbg::EventType type) {
+    size_t n = 0;
+    for (const auto& e : events) n += e.concurrency.type == type;
+    return n;
+}
+
+/**
+ * Runs f on two successive threads that get the same kernel thread ID:
+ * steers the next ID through ns_last_pid where writable, otherwise creates
+ * threads until the ID comes around again. False if neither got there.
+ */
+template <class F>
+bool run_on_reused_thread_id(F f) {
+    ucdbg::thread_id_t first = 0;
+    std::thread([&] {
+        first = ucdbg::get_thread_id();
+        f();
+    }).join();
+    auto again = [&] {
+        bool reused = false;
+        std::thread([&] {
+            reused = ucdbg::get_thread_id() == first;
+            if (reused) f();
+        }).join();
+        return reused;
+    };
+    for (int attempt = 0; attempt < 10; ++attempt) {
+        std::ofstream last_pid("/proc/sys/kernel/ns_last_pid");
+        if (!(last_pid << first - 1 << std::flush)) break;
+        last_pid.close();
+        if (again()) return true;
+    }
+    for (int i = 0; i < 100000; ++i) {
+        if (again()) return true;
+    }
+    return false;
+}
@@ -0,0 +1,151 @@
+/**
+ * Condition variable tracing test
+ *
+ * This test verifies:
+ * 1. Waits emit CondWaitBegin/CondWaitEnd with the mutex lock_id
+ * 2. Wakeup reasons: notified, timeout and spurious (untraced native notify)
+ * 3. notify_all wakes every waiter as Notified and reports the waiter count
+ * 4. ConditionVariableAny traces the same events
+ */
+
+#include <ucdbg/ucdbg.hpp>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "test_common.hpp"
+
+static std::vector<ucdbg::WakeReason> wake_reasons(const std::vector<ucdbg::TraceEvent>& events) {
+    std::vector<ucdbg::WakeReason> reasons;
+    for (const auto& e : events) {
+        if (e.concurrency.type == ucdbg::EventType::CondWaitEnd) {
+            reasons.push_back(static_cast<ucdbg::WakeReason>(e.concurrency_arg()));
+        }
+    }
+    return reasons;
+}
+
+template <class CV>
+static void wait_until_waiting(CV& cv, uint32_t waiters) {
+    while (cv.waiters() != waiters) std::this_thread::yield();
+}
+
+int main() {
+    std::cout << "=== Condition Variable Test ===" << std::endl;
+    ucdbg::internal::tracing_active.store(true);
+
+    std::mutex mtx;
+    uint64_t mtx_id = reinterpret_cast<uint64_t>(&mtx);
+    ucdbg::ConditionVariable cv;
+
+    // Notified wakeup
+    {
+        bool ready = false;
+        std::thread waiter([&] {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [&] { return ready; });
+        });
+        wait_until_waiting(cv, 1);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            ready = true;
+            cv.notify_one();
+        }
+        waiter.join();
+    }
+    auto events = drain();
+    CHECK(events.size() == 3);
+    for (const auto& e : events) CHECK(e.concurrency.lock_id == mtx_id);
+    CHECK(count(events, ucdbg::EventType::CondWaitBegin) == 1);
+    CHECK(count(events, ucdbg::EventType::CondNotifyOne) == 1);
+    CHECK(wake_reasons(events) == std::vector<ucdbg::WakeReason>({ucdbg::WakeReason::Notified}));
+    for (const auto& e : events) {
+        if (e.concurrency.type == ucdbg::EventType::CondNotifyOne) CHECK(e.concurrency_arg() == 1);
+    }
+
+    // Timeout
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        CHECK(!cv.wait_for(lock, std::chrono::milliseconds(5), [] { return false; }));
+    }
+    events = drain();
+    CHECK(!wake_reasons(events).empty());
+    CHECK(wake_reasons(events).back() == ucdbg::WakeReason::Timeout);
+
+    // A wakeup without a traced notify is spurious
+    {
+        std::atomic<bool> woke{false};
+        std::thread waiter([&] {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock);
+            woke = true;
+        });
+        wait_until_waiting(cv, 1);
+        while (!woke) {
+            { std::lock_guard<std::mutex> lock(mtx); }
+            cv.native().notify_one();
+            std::this_thread::yield();
+        }
+        waiter.join();
+    }
+    events = drain();
+    CHECK(wake_reasons(events) == std::vector<ucdbg::WakeReason>({ucdbg::WakeReason::Spurious}));
+
+    // notify_all wakes every waiter as Notified
+    {
+        constexpr int WAITERS = 3;
+        bool go = false;
+        std::vector<std::thread> waiters;
+        for (int i = 0; i < WAITERS; ++i) {
+            waiters.emplace_back([&] {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [&] { return go; });
+            });
+        }
+        wait_until_waiting(cv, WAITERS);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            go = true;
+            cv.notify_all();
+        }
+        for (auto& t : waiters) t.join();
+    }
+    events = drain();
+    CHECK(count(events, ucdbg::EventType::CondNotifyAll) == 1);
+    for (const auto& e : events) {
+        if (e.concurrency.type == ucdbg::EventType::CondNotifyAll) CHECK(e.concurrency_arg() == 3);
+    }
+    CHECK(wake_reasons(events) == std::vector<ucdbg::WakeReason>(3, ucdbg::WakeReason::Notified));
+    CHECK(cv.waiters() == 0);
+
+    // condition_variable_any over a unique_lock
+    {
+        ucdbg::ConditionVariableAny cv_any;
+        bool ready = false;
+        std::thread waiter([&] {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv_any.wait(lock, [&] { return ready; });
+        });
+        wait_until_waiting(cv_any, 1);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            ready = true;
+        }
+        cv_any.notify_one();
+        waiter.join();
+    }
+    events = drain();
+    CHECK(events.size() == 3);
+    for (const auto& e : events) CHECK(e.concurrency.lock_id == mtx_id);
+    CHECK(wake_reasons(events) == std::vector<ucdbg::WakeReason>({ucdbg::WakeReason::Notified}));
+
+    ucdbg::internal::tracing_active.store(false);
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All condition variable checks passed" << std::endl;
+    return 0;
+}
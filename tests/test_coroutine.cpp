@@ -0,0 +1,159 @@
+/**
+ * Coroutine suspension/resumption tracing test
+ *
+ * This test verifies:
+ * 1. TracedPromise traces every co_await with the coroutine frame ID
+ * 2. CoroResume is emitted on the thread that resumed the coroutine
+ * 3. Events carry the awaiter tag (default: the interned type name, or explicit)
+ * 4. Ready awaiters emit nothing
+ * 5. CoroutineAnalyzer pairs suspends with resumes per tag, counting
+ *    migrations and ignoring resumes it never saw suspend
+ */
+
+#include <ucdbg/ucdbg.hpp>
+#include <ucdbg/coroutine_analysis.hpp>
+#include <algorithm>
+#include <coroutine>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "test_common.hpp"
+
+// Fire-and-forget coroutine whose co_awaits are all traced
+struct Job {
+    struct promise_type : ucdbg::TracedPromise {
+        Job get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// Suspends and hands the coroutine to a new thread, which resumes it
+struct ResumeOnNewThread {
+    std::thread* thread;
+
+    bool await_ready() { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+        *thread = std::thread([handle] { handle.resume(); });
+    }
+    int await_resume() { return 42; }
+};
+
+// Declines to suspend after all
+struct NotReallySuspending {
+    bool await_ready() { return false; }
+    bool await_suspend(std::coroutine_handle<>) { return false; }
+    void await_resume() {}
+};
+
+namespace io {
+struct ReadAwaiter {};
+}
+
+static uint64_t frame_seen = 0;
+static uint64_t resumed_on = 0;
+
+Job migrate(std::thread* thread, int* result) {
+    frame_seen = 0;
+    co_await std::suspend_never{};  // Ready: not traced
+    *result = co_await ResumeOnNewThread{thread};
+    resumed_on = ucdbg::get_thread_id();
+    co_await NotReallySuspending{};
+}
+
+Job explicit_tag(std::thread* thread) {
+    co_await ucdbg::traced_await(ResumeOnNewThread{thread}, 1234);
+}
+
+int main() {
+    std::cout << "=== Coroutine Tracing Test ===" << std::endl;
+    ucdbg::internal::tracing_active.store(true);
+    uint64_t main_tid = ucdbg::get_thread_id();
+
+    std::thread resumer;
+    int result = 0;
+    migrate(&resumer, &result);
+    resumer.join();
+    CHECK(result == 42);
+    CHECK(resumed_on != main_tid);
+
+    auto events = drain();
+
+    // Main: suspend. Resumer: resume, then the declined suspend's pair
+    CHECK(events.size() == 4);
+    uint64_t frame = 0;
+    size_t suspends = 0, resumes = 0;
+    for (const auto& ev : events) {
+        if (!frame) frame = ev.concurrency.lock_id;
+        CHECK(ev.concurrency.lock_id == frame);
+        if (ev.concurrency.type == ucdbg::EventType::CoroSuspend) {
+            ++suspends;
+            if (ev.thread_id == main_tid) {
+                CHECK(ev.concurrency_arg() == ucdbg::awaiter_tag<ResumeOnNewThread>());
+            }
+        }
+        if (ev.concurrency.type == ucdbg::EventType::CoroResume) {
+            ++resumes;
+            CHECK(ev.thread_id == resumed_on);
+        }
+    }
+    CHECK(frame != 0);
+    CHECK(suspends == 2 && resumes == 2);
+    CHECK(ucdbg::awaiter_tag<ResumeOnNewThread>() != ucdbg::awaiter_tag<NotReallySuspending>());
+    CHECK(ucdbg::awaiter_tag<ResumeOnNewThread>() <= ucdbg::CONCURRENCY_ARG_MAX);
+    auto strings = ucdbg::internal::StringTable::instance().strings();
+    CHECK(strings.at(ucdbg::awaiter_tag<ResumeOnNewThread>()) == "ResumeOnNewThread");
+    CHECK(strings.at(ucdbg::awaiter_tag<NotReallySuspending>()) == "NotReallySuspending");
+    CHECK(ucdbg::awaiter_tag<io::ReadAwaiter>() == ucdbg::intern("io::ReadAwaiter"));
+
+    // Per-tag resume latency: the first await migrated, the declined one did not
+    std::sort(events.begin(), events.end(), [](const auto& a, const auto& b) {
+        return a.timestamp_ns < b.timestamp_ns;
+    });
+    ucdbg::CoroutineAnalyzer analyzer;
+    for (const auto& ev : events) analyzer.add(ev);
+    CHECK(analyzer.awaiters().size() == 2 && analyzer.open_count() == 0);
+    if (analyzer.awaiters().size() == 2) {
+        const ucdbg::AwaiterStats& migrated = analyzer.awaiters().at(ucdbg::awaiter_tag<ResumeOnNewThread>());
+        const ucdbg::AwaiterStats& declined = analyzer.awaiters().at(ucdbg::awaiter_tag<NotReallySuspending>());
+        CHECK(migrated.suspends == 1 && migrated.resume_ns.count() == 1 && migrated.migrations == 1);
+        CHECK(declined.suspends == 1 && declined.resume_ns.count() == 1 && declined.migrations == 0);
+    }
+
+    // Explicit tag inside a TracedPromise coroutine: traced once, not twice
+    explicit_tag(&resumer);
+    resumer.join();
+    events = drain();
+    CHECK(events.size() == 2);
+    for (const auto& ev : events) CHECK(ev.concurrency_arg() == 1234);
+
+    // Synthetic frames: exact latencies, a stray resume and one left suspended
+    ucdbg::CoroutineAnalyzer synthetic;
+    auto coro = [](uint64_t ts, uint64_t tid, ucdbg::EventType type, uint64_t frame, uint32_t tag) {
+        ucdbg::TraceEvent ev = ucdbg::internal::make_concurrency_event(type, frame, tag);
+        ev.timestamp_ns = ts;
+        ev.thread_id = tid;
+        return ev;
+    };
+    synthetic.add(coro(100, 1, ucdbg::EventType::CoroResume, 0xf0, 7));
+    synthetic.add(coro(200, 1, ucdbg::EventType::CoroSuspend, 0xf1, 7));
+    synthetic.add(coro(300, 1, ucdbg::EventType::CoroSuspend, 0xf2, 7));
+    synthetic.add(coro(1200, 2, ucdbg::EventType::CoroResume, 0xf1, 7));
+    synthetic.add(coro(1300, 1, ucdbg::EventType::CoroSuspend, 0xf3, 8));
+    const ucdbg::AwaiterStats& seven = synthetic.awaiters().at(7);
+    CHECK(seven.suspends == 2 && seven.resume_ns.count() == 1 && seven.migrations == 1);
+    CHECK(seven.resume_ns.max() >= 1000 && seven.resume_ns.max() < 1125);
+    CHECK(synthetic.awaiters().at(8).resume_ns.count() == 0);
+    CHECK(synthetic.open_count() == 2);
+
+    ucdbg::internal::tracing_active.store(false);
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All coroutine tracing checks passed" << std::endl;
+    return 0;
+}
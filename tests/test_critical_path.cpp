@@ -0,0 +1,230 @@
+/**
+ * Critical path analysis test
+ *
+ * This test verifies:
+ * 1. A contended lock moves the path to the holder at its release, also
+ *    when the release is recorded after the waiter's acquire
+ * 2. Nested waits chain across threads, and lock time is charged to waits,
+ *    handoffs and critical sections on the path
+ * 3. Notified condition waits follow the notifier; timed-out ones stay blocked
+ * 4. Task edges jump to the enqueuing thread
+ * 5. The segments of a real multi-threaded trace partition the window
+ */
+
+#include <ucdbg/ucdbg.hpp>
+#include <ucdbg/critical_path.hpp>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "test_common.hpp"
+
+using Kind = ucdbg::CriticalPathSegment::Kind;
+
+static ucdbg::TraceEvent concurrency(uint64_t ts, uint64_t tid, ucdbg::EventType type, uint64_t id,
+                                     uint32_t arg = 0) {
+    ucdbg::TraceEvent e;
+    std::memset(&e, 0, sizeof(e));
+    e.timestamp_ns = ts;
+    e.thread_id = tid;
+    e.format_version = ucdbg::TRACE_FORMAT_VERSION;
+    e.kind = ucdbg::EventKind::Concurrency;
+    e.concurrency.type = type;
+    e.concurrency.lock_id = id;
+    e.set_concurrency_arg(arg);
+    return e;
+}
+
+static void feed(ucdbg::CriticalPathAnalyzer& analyzer, std::vector<ucdbg::TraceEvent> events) {
+    std::stable_sort(events.begin(), events.end(), [](const ucdbg::TraceEvent& a, const ucdbg::TraceEvent& b) {
+        return a.timestamp_ns < b.timestamp_ns;
+    });
+    for (const auto& e : events) analyzer.add(e);
+}
+
+static bool is_segment(const ucdbg::CriticalPathSegment& s, uint64_t tid, uint64_t begin, uint64_t end, Kind kind) {
+    return s.thread_id == tid && s.begin == begin && s.end == end && s.kind == kind;
+}
+
+// Segments are contiguous and cover [begin, end); thread totals add up
+static bool partitions(const ucdbg::CriticalPath& path) {
+    uint64_t t = path.begin, total = 0;
+    for (const auto& s : path.segments) {
+        if (s.begin != t || s.end <= s.begin) return false;
+        t = s.end;
+    }
+    for (const auto& [tid, stats] : path.threads) total += stats.total_ns();
+    return t == path.end && total == path.end - path.begin;
+}
+
+static void test_lock_chain() {
+    using T = ucdbg::EventType;
+    const uint64_t A = 1, B = 2, C = 3, L = 0x100, M = 0x200;
+    ucdbg::CriticalPathAnalyzer analyzer;
+    feed(analyzer, {
+        concurrency(10, C, T::LockAcquire, M),
+        concurrency(20, B, T::LockContended, M),
+        concurrency(35, C, T::LockRelease, M),
+        concurrency(40, B, T::LockAcquire, M),
+        concurrency(45, B, T::LockRelease, M),
+        concurrency(50, B, T::LockAcquire, L),
+        concurrency(100, A, T::LockContended, L),
+        concurrency(290, B, T::LockRelease, L),
+        concurrency(300, A, T::LockAcquire, L),
+        concurrency(350, A, T::LockRelease, L),
+    });
+
+    ucdbg::CriticalPath path = analyzer.critical_path(A, 0, 400);
+    CHECK(partitions(path));
+    CHECK(path.segments.size() == 5);
+    if (path.segments.size() == 5) {
+        CHECK(is_segment(path.segments[0], C, 0, 35, Kind::Running));
+        CHECK(is_segment(path.segments[1], B, 35, 40, Kind::Wakeup));
+        CHECK(is_segment(path.segments[2], B, 40, 290, Kind::Running));
+        CHECK(is_segment(path.segments[3], A, 290, 300, Kind::Wakeup));
+        CHECK(is_segment(path.segments[4], A, 300, 400, Kind::Running));
+        CHECK(path.segments[1].object == M && path.segments[3].object == L);
+    }
+    CHECK(path.waits.size() == 2);
+    if (path.waits.size() == 2) {
+        CHECK(path.waits[0].thread_id == B && path.waits[0].waker == C && path.waits[0].woken_at == 35);
+        CHECK(path.waits[1].thread_id == A && path.waits[1].waker == B && path.waits[1].begin == 100);
+    }
+    CHECK(path.threads[A].running_ns == 100 && path.threads[A].wakeup_ns == 10);
+    CHECK(path.threads[B].total_ns() == 255);
+    CHECK(path.locks[L].waits == 1 && path.locks[L].wait_ns == 200);
+    CHECK(path.locks[L].handoff_ns == 10);
+    CHECK(path.locks[L].held_ns == 240 + 50);     // B's hold from 50, A's until 350
+    CHECK(path.locks[M].held_ns == 25 + 5);       // C's hold from 10, B's 40..45
+    CHECK(path.locks[M].wait_ns == 20);
+
+    // Window starting mid-wait: clipped, and the path stops at the window start
+    path = analyzer.critical_path(A, 200, 400);
+    CHECK(partitions(path));
+    CHECK(path.segments.size() == 3 && path.segments.front().thread_id == B);
+    CHECK(path.waits.size() == 1 && path.waits[0].begin == 200);
+    CHECK(path.locks[L].held_ns == 90 + 50);
+}
+
+static void test_late_release() {
+    using T = ucdbg::EventType;
+    const uint64_t A = 1, B = 2, L = 0x100;
+    ucdbg::CriticalPathAnalyzer analyzer;
+    // B unlocks, A acquires and records it, and only then B records its release
+    feed(analyzer, {
+        concurrency(10, B, T::LockAcquire, L),
+        concurrency(100, A, T::LockContended, L),
+        concurrency(200, A, T::LockAcquire, L),
+        concurrency(205, B, T::LockRelease, L),
+        concurrency(250, A, T::LockRelease, L),
+    });
+    ucdbg::CriticalPath path = analyzer.critical_path(A, 0, 300);
+    CHECK(partitions(path));
+    CHECK(path.waits.size() == 1 && path.waits[0].woken && path.waits[0].waker == B);
+    CHECK(path.segments.size() == 2);
+    if (path.segments.size() == 2) {
+        CHECK(is_segment(path.segments[0], B, 0, 200, Kind::Running));
+        CHECK(is_segment(path.segments[1], A, 200, 300, Kind::Running));
+    }
+
+    // A waiter releasing before any other release was never woken by one
+    ucdbg::CriticalPathAnalyzer untraced;
+    feed(untraced, {
+        concurrency(100, A, T::LockContended, L),
+        concurrency(200, A, T::LockAcquire, L),
+        concurrency(250, A, T::LockRelease, L),
+        concurrency(260, B, T::LockAcquire, L),
+        concurrency(270, B, T::LockRelease, L),
+    });
+    path = untraced.critical_path(A, 0, 300);
+    CHECK(partitions(path));
+    CHECK(path.waits.size() == 1 && !path.waits[0].woken);
+    CHECK(path.threads.size() == 1 && path.threads[A].blocked_ns == 100);
+}
+
+static void test_condition_and_tasks() {
+    using T = ucdbg::EventType;
+    const uint64_t A = 1, B = 2, M = 0x300, TASK = 77;
+    ucdbg::CriticalPathAnalyzer analyzer;
+    feed(analyzer, {
+        concurrency(100, A, T::CondWaitBegin, M),
+        concurrency(200, B, T::CondNotifyOne, M, 1),
+        concurrency(210, A, T::CondWaitEnd, M, static_cast<uint32_t>(ucdbg::WakeReason::Notified)),
+        concurrency(300, A, T::CondWaitBegin, M),
+        concurrency(400, A, T::CondWaitEnd, M, static_cast<uint32_t>(ucdbg::WakeReason::Timeout)),
+        concurrency(450, B, T::TaskEnqueue, TASK),
+        concurrency(500, A, T::TaskBegin, TASK),
+        concurrency(550, A, T::TaskEnd, TASK),
+    });
+    ucdbg::CriticalPath path = analyzer.critical_path(A, 0, 250);
+    CHECK(partitions(path));
+    CHECK(path.waits.size() == 1 && path.waits[0].dependency == ucdbg::DependencyKind::Condition);
+    CHECK(path.waits.size() == 1 && path.waits[0].waker == B && path.waits[0].woken_at == 200);
+    CHECK(path.threads[A].wakeup_ns == 10 && path.threads[B].running_ns == 200);
+    CHECK(path.locks.empty());
+
+    // The task edge leaves A at 500 for B at 450, so A's waits before are off the path
+    path = analyzer.critical_path(A, 0, 600);
+    CHECK(partitions(path));
+    CHECK(path.waits.size() == 1 && path.waits[0].dependency == ucdbg::DependencyKind::Task);
+    CHECK(path.threads[A].blocked_ns == 0 && path.threads[A].wakeup_ns == 50);
+    CHECK(path.threads[B].running_ns == 450);
+
+    path = analyzer.critical_path(A, 250, 420);
+    CHECK(partitions(path));
+    CHECK(path.threads.size() == 1 && path.threads[A].blocked_ns == 100);
+    CHECK(path.segments.size() == 3 && path.segments[1].kind == Kind::Blocked);
+}
+
+static void test_traced_run() {
+    ucdbg::internal::tracing_active.store(true);
+    std::mutex a, b;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 500; ++i) {
+                if ((i + t) % 3 == 0) {
+                    UCDBG_LOCK_GUARD(a);
+                    UCDBG_LOCK_GUARD(b);
+                } else {
+                    UCDBG_LOCK_GUARD(t % 2 ? a : b);
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    ucdbg::internal::tracing_active.store(false);
+
+    auto events = drain();
+    CHECK(!events.empty());
+    ucdbg::CriticalPathAnalyzer analyzer;
+    feed(analyzer, events);
+    for (const auto& tid : {events.front().thread_id, events.back().thread_id}) {
+        ucdbg::CriticalPath path = analyzer.critical_path(tid);
+        CHECK(path.end > path.begin);
+        CHECK(partitions(path));
+        for (const auto& wait : path.waits) {
+            CHECK(wait.begin <= wait.end && wait.begin >= path.begin && wait.end <= path.end);
+            CHECK(!wait.woken || wait.waker != wait.thread_id);
+        }
+    }
+}
+
+int main() {
+    std::cout << "=== Critical Path Test ===" << std::endl;
+    test_lock_chain();
+    test_late_release();
+    test_condition_and_tasks();
+    test_traced_run();
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All critical path checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,206 @@
+/**
+ * CTF writer test
+ *
+ * This test verifies:
+ * 1. Each thread's events land in its own stream file as CTF packets whose
+ *    header and context (magic, uuid, sizes, timestamps, thread) are valid
+ * 2. Event records carry the kind, timestamp, lock class and unchanged payload bytes
+ * 3. The generated metadata declares the layout, event types and env
+ * 4. The tracer writes CTF directly from the drain thread
+ */
+
+#include <ucdbg/ucdbg.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "test_common.hpp"
+
+static std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+static bool contains(const std::string& text, const std::string& needle) {
+    return text.find(needle) != std::string::npos;
+}
+
+// Hex uuid from the metadata's trace block
+static std::vector<uint8_t> metadata_uuid(const std::string& metadata) {
+    std::vector<uint8_t> uuid;
+    size_t pos = metadata.find("uuid = \"");
+    if (pos == std::string::npos) return uuid;
+    for (pos += 8; metadata[pos] != '"'; ++pos) {
+        if (metadata[pos] == '-') continue;
+        uuid.push_back(static_cast<uint8_t>(std::stoi(metadata.substr(pos, 2), nullptr, 16)));
+        ++pos;
+    }
+    return uuid;
+}
+
+// Decodes a stream file; false on a malformed packet
+static bool read_stream(const std::string& data, const std::vector<uint8_t>& uuid, uint64_t thread_id,
+                        std::vector<ucdbg::TraceEvent>& out, size_t& packets) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        ucdbg::CtfPacketHeader header;
+        ucdbg::CtfPacketContext context;
+        if (data.size() - offset < sizeof(header) + sizeof(context)) return false;
+        std::memcpy(&header, data.data() + offset, sizeof(header));
+        std::memcpy(&context, data.data() + offset + sizeof(header), sizeof(context));
+        if (header.magic != ucdbg::CTF_MAGIC || header.stream_id != 0 ||
+            uuid.size() != 16 || std::memcmp(header.uuid, uuid.data(), 16) != 0 ||
+            context.thread_id != thread_id || context.packet_size != context.content_size ||
+            context.content_size % 8 != 0 || offset + context.content_size / 8 > data.size()) {
+            return false;
+        }
+        size_t end = offset + context.content_size / 8;
+        size_t pos = offset + sizeof(header) + sizeof(context);
+        size_t first = out.size();
+        for (; pos + ucdbg::CTF_EVENT_SIZE <= end; pos += ucdbg::CTF_EVENT_SIZE) {
+            ucdbg::CtfEventHeader eh;
+            std::memcpy(&eh, data.data() + pos, sizeof(eh));
+            ucdbg::TraceEvent e;
+            std::memset(&e, 0, sizeof(e));
+            e.timestamp_ns = eh.timestamp;
+            e.thread_id = thread_id;
+            e.format_version = ucdbg::TRACE_FORMAT_VERSION;
+            e.kind = static_cast<ucdbg::EventKind>(eh.id);
+            e.set_lock_class(eh.lock_class);
+            std::memcpy(reinterpret_cast<uint8_t*>(&e) + ucdbg::CTF_PAYLOAD_OFFSET,
+                        data.data() + pos + sizeof(eh), ucdbg::CTF_PAYLOAD_SIZE);
+            out.push_back(e);
+        }
+        if (pos != end || out.size() == first ||
+            out[first].timestamp_ns != context.timestamp_begin ||
+            out.back().timestamp_ns != context.timestamp_end) {
+            return false;
+        }
+        offset = end;
+        ++packets;
+    }
+    return true;
+}
+
+static bool braces_balanced(const std::string& text) {
+    int depth = 0;
+    for (char c : text) {
+        if (c == '{') ++depth;
+        if (c == '}' && --depth < 0) return false;
+    }
+    return depth == 0;
+}
+
+int main() {
+    std::cout << "=== CTF Writer Test ===" << std::endl;
+    const std::string dir = "/tmp/ucdbg_test_ctf";
+
+    // Direct writer, small packets so each stream spans several
+    std::map<uint64_t, std::vector<ucdbg::TraceEvent>> written;
+    {
+        ucdbg::CtfTraceWriter writer(256);
+        CHECK(writer.open(dir.c_str()));
+        for (uint64_t i = 0; i < 100; ++i) {
+            ucdbg::TraceEvent e;
+            std::memset(&e, 0, sizeof(e));
+            e.timestamp_ns = 1000 + i * 7;
+            e.thread_id = 11 + i % 2;
+            e.format_version = ucdbg::TRACE_FORMAT_VERSION;
+            if (i % 5 == 0) {
+                e.kind = ucdbg::EventKind::Counter;
+                e.counter.name_id = 0;
+                e.counter.value = -static_cast<int64_t>(i);
+            } else {
+                e.kind = ucdbg::EventKind::Concurrency;
+                e.concurrency.type = i % 2 ? ucdbg::EventType::LockRelease : ucdbg::EventType::LockAcquire;
+                e.set_concurrency_arg(static_cast<uint32_t>(i * 1000));
+                e.concurrency.lock_id = 0xdead0000 + i;
+                e.set_lock_class(static_cast<ucdbg::lock_class_t>(0x100 + i % 3));
+            }
+            writer.append(e);
+            written[e.thread_id].push_back(e);
+        }
+        writer.set_thread_name(11, "worker \"a\"");
+        writer.set_strings({"queue_depth"});
+        CHECK(writer.close());
+    }
+
+    std::string metadata = read_file(dir + "/metadata");
+    std::vector<uint8_t> uuid = metadata_uuid(metadata);
+    CHECK(metadata.rfind("/* CTF 1.8 */", 0) == 0);
+    CHECK(braces_balanced(metadata));
+    CHECK(uuid.size() == 16);
+    CHECK(contains(metadata, "byte_order = le;"));
+    CHECK(contains(metadata, "map = clock.monotonic.value;"));
+    CHECK(contains(metadata, "uint64_clock_monotonic_t timestamp;\n        uint16_t lock_class;\n"));
+    CHECK(contains(metadata, "    LockAcquire = 2,\n"));
+    CHECK(contains(metadata, "    " + ucdbg::event_type_to_string(
+        static_cast<ucdbg::EventType>(ucdbg::EVENT_TYPE_COUNT - 1)) + " = " +
+        std::to_string(ucdbg::EVENT_TYPE_COUNT - 1) + "\n};"));
+    CHECK(contains(metadata, "name = \"counter\";\n    id = 3;"));
+    CHECK(contains(metadata, "thread_name_11 = \"worker \\\"a\\\"\";"));
+    CHECK(contains(metadata, "string_0 = \"queue_depth\";"));
+
+    for (const auto& [tid, events] : written) {
+        std::vector<ucdbg::TraceEvent> decoded;
+        size_t packets = 0;
+        CHECK(read_stream(read_file(dir + "/stream_" + std::to_string(tid)), uuid, tid, decoded, packets));
+        CHECK(packets > 1);
+        CHECK(decoded.size() == events.size());
+        for (size_t i = 0; i < decoded.size() && i < events.size(); ++i) {
+            CHECK(std::memcmp(&decoded[i], &events[i], sizeof(ucdbg::TraceEvent)) == 0);
+        }
+    }
+
+    // Through the tracer
+    std::mutex mtx;
+    uint64_t tid = ucdbg::get_thread_id();
+    CHECK(ucdbg::init(dir.c_str(), ucdbg::TraceFormat::Ctf));
+    ucdbg::set_thread_name("ctf_main");
+    for (int i = 0; i < 10; ++i) {
+        UCDBG_LOCK_GUARD(mtx);
+    }
+    std::mutex classed;
+    ucdbg::lock_class_t cls = ucdbg::lock_class("ctf_class");
+    {
+        UCDBG_LOCK_GUARD_CLASS(classed, "ctf_class");
+    }
+    ucdbg::shutdown();
+
+    metadata = read_file(dir + "/metadata");
+    uuid = metadata_uuid(metadata);
+    CHECK(contains(metadata, "thread_name_" + std::to_string(tid) + " = \"ctf_main\";"));
+    CHECK(read_file(dir + "/stream_11").empty());  // Stale stream removed on open
+    std::vector<ucdbg::TraceEvent> decoded;
+    size_t packets = 0;
+    CHECK(read_stream(read_file(dir + "/stream_" + std::to_string(tid)), uuid, tid, decoded, packets));
+    size_t acquires = 0, classed_events = 0;
+    for (const auto& e : decoded) {
+        if (e.kind == ucdbg::EventKind::Concurrency &&
+            e.concurrency.lock_id == reinterpret_cast<uint64_t>(&classed)) {
+            CHECK(e.lock_class() == cls);
+            ++classed_events;
+        }
+        if (e.kind == ucdbg::EventKind::Concurrency && e.concurrency.type == ucdbg::EventType::LockAcquire &&
+            e.concurrency.lock_id == reinterpret_cast<uint64_t>(&mtx)) {
+            ++acquires;
+        }
+    }
+    CHECK(acquires == 10);
+    CHECK(classed_events >= 2);
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All CTF writer checks passed" << std::endl;
+    return 0;
+}
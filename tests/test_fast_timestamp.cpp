@@ -0,0 +1,76 @@
+/**
+ * FastTimestamp test
+ *
+ * This test verifies:
+ * 1. Timestamps are strictly increasing per thread, even when read faster
+ *    than the clock advances
+ * 2. Intervals shorter than any caching period are measured, so hold and
+ *    wait times computed from event pairs are real durations
+ * 3. Timestamps are steady_clock nanoseconds, comparable across threads
+ */
+
+#include <ucdbg/fast_timestamp.hpp>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+
+#include "test_common.hpp"
+
+using ucdbg::internal::FastTimestamp;
+
+static uint64_t steady_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Busy-waits for ns without sleeping, as a short critical section would
+static void spin_for(uint64_t ns) {
+    uint64_t until = steady_ns() + ns;
+    while (steady_ns() < until) {
+    }
+}
+
+int main() {
+    std::cout << "=== Fast Timestamp Test ===" << std::endl;
+
+    // Back-to-back reads never repeat or go back
+    constexpr int READS = 100000;
+    uint64_t previous = FastTimestamp::now_ns();
+    int inversions = 0;
+    for (int i = 0; i < READS; ++i) {
+        uint64_t now = FastTimestamp::now_ns();
+        inversions += now <= previous;
+        previous = now;
+    }
+    CHECK(inversions == 0);
+
+    // Short intervals: 20us and 50us spins measure at least that long
+    for (uint64_t ns : {20'000ull, 50'000ull}) {
+        uint64_t begin = FastTimestamp::now_ns();
+        spin_for(ns);
+        uint64_t end = FastTimestamp::now_ns();
+        CHECK(end - begin >= ns);
+        CHECK(end - begin < ns + 50'000'000);
+    }
+
+    // Long interval across a sleep
+    uint64_t before_sleep = FastTimestamp::now_ns();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    CHECK(FastTimestamp::now_ns() - before_sleep >= 2'000'000);
+
+    // A fresh thread reads the same clock: bracketed by steady_clock reads
+    std::thread([] {
+        uint64_t lower = steady_ns();
+        uint64_t now = FastTimestamp::now_ns();
+        uint64_t upper = steady_ns();
+        CHECK(lower <= now && now <= upper);
+    }).join();
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All fast timestamp checks passed" << std::endl;
+    return 0;
+}
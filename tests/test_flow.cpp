@@ -0,0 +1,157 @@
+/**
+ * Flow event test
+ *
+ * This test verifies:
+ * 1. with_flow emits FlowBegin with a fresh flow ID on the producer thread
+ * 2. receive/continue_flow emit FlowStep on each thread the item passes through
+ * 3. complete emits FlowEnd on the thread that finishes the work
+ * 4. Every flow crosses the three pipeline threads in order, with its tag
+ * 5. Flow IDs stay unique when a thread ID is reused
+ */
+
+#include <ucdbg/ucdbg.hpp>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "test_common.hpp"
+
+// Blocking queue of flowed items; pop() fails once closed and drained
+template <class T>
+class Channel {
+public:
+    void push(ucdbg::Flowed<T> item) {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            items_.push_back(std::move(item));
+        }
+        cv_.notify_one();
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            closed_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    bool pop(std::deque<ucdbg::Flowed<T>>& out) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        cv_.wait(lock, [this] { return closed_ || !items_.empty(); });
+        if (items_.empty()) return false;
+        out.push_back(std::move(items_.front()));
+        items_.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<ucdbg::Flowed<T>> items_;
+    bool closed_ = false;
+};
+
+static void test_reused_thread_id() {
+    std::vector<ucdbg::flow_id_t> ids;
+    if (!run_on_reused_thread_id([&] { ids.push_back(ucdbg::flow_begin()); })) {
+        std::cout << "Thread ID not reused, skipping" << std::endl;
+        return;
+    }
+    CHECK(ids.size() == 2);
+    CHECK(ids[0] != ids[1]);
+}
+
+int main() {
+    std::cout << "=== Flow Event Test ===" << std::endl;
+    ucdbg::internal::tracing_active.store(true);
+
+    constexpr int ITEMS = 32;
+    constexpr uint32_t TAG = 5;
+    Channel<int> parse, reply;
+    uint64_t producer_tid = 0, stage_tid = 0, sink_tid = 0;
+    int sum = 0;
+
+    std::thread producer([&] {
+        producer_tid = ucdbg::get_thread_id();
+        for (int i = 0; i < ITEMS; ++i) {
+            parse.push(ucdbg::with_flow(i, TAG));
+        }
+        parse.close();
+    });
+    std::thread stage([&] {
+        stage_tid = ucdbg::get_thread_id();
+        std::deque<ucdbg::Flowed<int>> got;
+        while (parse.pop(got)) {
+            int& value = got.back().receive();
+            reply.push(ucdbg::continue_flow(value * 2, got.back().flow_id(), TAG));
+        }
+        reply.close();
+    });
+    std::thread sink([&] {
+        sink_tid = ucdbg::get_thread_id();
+        std::deque<ucdbg::Flowed<int>> got;
+        while (reply.pop(got)) {
+            sum += got.back().complete();
+        }
+    });
+    producer.join();
+    stage.join();
+    sink.join();
+    CHECK(sum == ITEMS * (ITEMS - 1));
+
+    auto events = drain();
+
+    // Per flow, the threads of its events; per-thread order is preserved and
+    // each flow's events are causally ordered, so grouping by thread suffices
+    std::map<uint64_t, std::vector<std::pair<ucdbg::EventType, uint64_t>>> flows;
+    for (const auto& ev : events) {
+        ucdbg::EventType type = ev.concurrency.type;
+        if (type != ucdbg::EventType::FlowBegin && type != ucdbg::EventType::FlowStep &&
+            type != ucdbg::EventType::FlowEnd) {
+            continue;
+        }
+        CHECK(ev.concurrency.lock_id != 0);
+        CHECK(ev.concurrency_arg() == TAG);
+        flows[ev.concurrency.lock_id].emplace_back(type, ev.thread_id);
+    }
+    CHECK(flows.size() == ITEMS);
+    for (auto& [id, points] : flows) {
+        CHECK(points.size() == 4);
+        size_t begins = 0, steps_on_stage = 0, ends = 0;
+        for (const auto& [type, tid] : points) {
+            if (type == ucdbg::EventType::FlowBegin) {
+                ++begins;
+                CHECK(tid == producer_tid);
+            } else if (type == ucdbg::EventType::FlowStep) {
+                // Received on the stage thread and handed on from it
+                steps_on_stage += tid == stage_tid;
+            } else {
+                ++ends;
+                CHECK(tid == sink_tid);
+            }
+        }
+        CHECK(begins == 1 && steps_on_stage == 2 && ends == 1);
+    }
+
+    // Direct API
+    ucdbg::flow_id_t a = ucdbg::flow_begin();
+    ucdbg::flow_id_t b = ucdbg::flow_begin();
+    CHECK(a != 0 && b != 0 && a != b);
+    ucdbg::flow_end(a);
+    ucdbg::flow_end(b);
+    CHECK(ucdbg::event_type_to_string(ucdbg::EventType::FlowStep) == "FlowStep");
+
+    ucdbg::internal::tracing_active.store(false);
+    test_reused_thread_id();
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All flow event checks passed" << std::endl;
+    return 0;
+}
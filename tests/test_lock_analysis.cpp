@@ -0,0 +1,174 @@
+/**
+ * Lock analysis test
+ *
+ * This test verifies:
+ * 1. LatencyHistogram buckets are contiguous and percentiles stay within
+ *    one bucket (12.5%) above the exact value
+ * 2. LockAnalyzer pairs holds and waits per thread and counts
+ *    contentions, handoffs and distinct threads
+ * 3. Per-thread blocked time covers lock, condition variable and sync waits
+ * 4. Hold and wait times measured from a real trace match wall-clock time
+ */
+
+#include <ucdbg/ucdbg.hpp>
+#include <ucdbg/block_reader.hpp>
+#include <ucdbg/lock_analysis.hpp>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "test_common.hpp"
+
+static ucdbg::TraceEvent concurrency(uint64_t ts, uint64_t tid, ucdbg::EventType type, uint64_t id) {
+    ucdbg::TraceEvent e;
+    std::memset(&e, 0, sizeof(e));
+    e.timestamp_ns = ts;
+    e.thread_id = tid;
+    e.format_version = ucdbg::TRACE_FORMAT_VERSION;
+    e.kind = ucdbg::EventKind::Concurrency;
+    e.concurrency.type = type;
+    e.concurrency.lock_id = id;
+    return e;
+}
+
+static void test_histogram() {
+    using H = ucdbg::LatencyHistogram;
+    // Buckets tile the value range without gaps
+    for (size_t b = 0; b + 1 < H::BUCKETS; ++b) {
+        CHECK(H::bucket_high(b) + 1 == H::bucket_low(b + 1));
+        CHECK(H::bucket_of(H::bucket_low(b)) == b);
+        CHECK(H::bucket_of(H::bucket_high(b)) == b);
+    }
+    CHECK(H::bucket_of(UINT64_MAX) == H::BUCKETS - 1);
+
+    H h;
+    CHECK(h.percentile(0.5) == 0 && h.min() == 0);
+    for (uint64_t v = 1; v <= 100000; ++v) h.record(v);
+    CHECK(h.count() == 100000);
+    CHECK(h.sum() == 100000ull * 100001 / 2);
+    CHECK(h.min() == 1 && h.max() == 100000);
+    for (double q : {0.5, 0.9, 0.99, 0.999}) {
+        uint64_t exact = static_cast<uint64_t>(q * 100000);
+        uint64_t p = h.percentile(q);
+        CHECK(p >= exact && p <= exact + exact / 8);
+    }
+    CHECK(h.percentile(1.0) == 100000);
+    CHECK(h.percentile(0.0) == 1);
+
+    H other;
+    other.record(7, 3);
+    other.record(1ull << 50);
+    h.merge(other);
+    CHECK(h.count() == 100004);
+    CHECK(h.max() == 1ull << 50);
+    CHECK(h.bucket_count(7) == 4);
+}
+
+static void test_analyzer() {
+    using ucdbg::EventType;
+    const uint64_t L = 0x1000, S = 0x2000, CV = 0x3000;
+    ucdbg::LockAnalyzer a;
+    a.add(concurrency(0, 1, EventType::LockAcquire, L));
+    a.add(concurrency(50, 2, EventType::LockContended, L));
+    a.add(concurrency(100, 1, EventType::LockRelease, L));
+    a.add(concurrency(100, 2, EventType::LockAcquire, L));
+    a.add(concurrency(150, 2, EventType::LockAcquire, L));   // Recursive
+    a.add(concurrency(160, 2, EventType::LockRelease, L));
+    a.add(concurrency(300, 2, EventType::LockRelease, L));
+    a.add(concurrency(310, 2, EventType::LockAcquire, L));   // Same owner: no handoff
+    a.add(concurrency(320, 2, EventType::LockRelease, L));
+    a.add(concurrency(330, 1, EventType::LockRelease, 0x9999));  // Unmatched: ignored
+    a.add(concurrency(400, 1, EventType::SharedLockAcquire, S));
+    a.add(concurrency(410, 3, EventType::SharedLockContended, S));
+    a.add(concurrency(420, 3, EventType::SharedLockAcquire, S));
+    a.add(concurrency(500, 1, EventType::SharedLockRelease, S));
+    a.add(concurrency(600, 1, EventType::CondWaitBegin, CV));
+    a.add(concurrency(900, 1, EventType::CondWaitEnd, CV));
+    a.add(concurrency(1000, 3, EventType::BarrierWaitBegin, 0x4000));
+    a.add(concurrency(1250, 3, EventType::BarrierWaitEnd, 0x4000));
+
+    const ucdbg::LockStats& l = a.locks().at(L);
+    CHECK(l.acquisitions == 4);
+    CHECK(l.shared_acquisitions == 0);
+    CHECK(l.contentions == 1);
+    CHECK(l.handoffs == 1);
+    CHECK(l.threads.size() == 2);
+    CHECK(l.hold_ns.count() == 4);
+    CHECK(l.hold_ns.sum() == 100 + 10 + 200 + 10);
+    CHECK(l.hold_ns.max() == 200);
+    CHECK(l.wait_ns.count() == 1 && l.wait_ns.sum() == 50);
+    CHECK(!a.locks().count(0x9999));
+
+    const ucdbg::LockStats& s = a.locks().at(S);
+    CHECK(s.acquisitions == 2 && s.shared_acquisitions == 2);
+    CHECK(s.handoffs == 0);
+    CHECK(s.contentions == 1 && s.wait_ns.sum() == 10);
+    CHECK(s.hold_ns.count() == 1 && s.hold_ns.sum() == 100);
+    CHECK(a.open_count() == 1);  // Thread 3's shared hold
+
+    const ucdbg::ThreadBlockedStats& t1 = a.threads().at(1);
+    CHECK(t1.events == 7 && t1.lock_waits == 0);
+    CHECK(t1.cond_waits == 1 && t1.cond_wait_ns == 300);
+    CHECK(t1.first_ts == 0 && t1.last_ts == 900);
+    const ucdbg::ThreadBlockedStats& t2 = a.threads().at(2);
+    CHECK(t2.lock_waits == 1 && t2.lock_wait_ns == 50);
+    const ucdbg::ThreadBlockedStats& t3 = a.threads().at(3);
+    CHECK(t3.lock_wait_ns == 10);
+    CHECK(t3.sync_waits == 1 && t3.sync_wait_ns == 250);
+    CHECK(t3.blocked_ns() == 260);
+}
+
+// Holds measured from the tracer's own timestamps
+static void test_real_trace() {
+    const char* path = "/tmp/ucdbg_test_lock_analysis.trace";
+    constexpr auto HOLD = std::chrono::milliseconds(20);
+    std::mutex mtx;
+    CHECK(ucdbg::init(path));
+    {
+        std::thread holder([&] {
+            UCDBG_LOCK_GUARD(mtx);
+            std::this_thread::sleep_for(HOLD);
+        });
+        std::this_thread::sleep_for(HOLD / 4);
+        {
+            UCDBG_LOCK_GUARD(mtx);  // Waits for the rest of the hold
+        }
+        holder.join();
+    }
+    ucdbg::shutdown();
+
+    ucdbg::BlockTraceReader reader;
+    CHECK(reader.open(path));
+    ucdbg::LockAnalyzer a;
+    CHECK(reader.for_each_event_ordered([&](const ucdbg::TraceEvent& e) { a.add(e); }));
+    auto it = a.locks().find(reinterpret_cast<uint64_t>(&mtx));
+    CHECK(it != a.locks().end());
+    if (it == a.locks().end()) return;
+    const ucdbg::LockStats& l = it->second;
+    uint64_t hold_ns = std::chrono::nanoseconds(HOLD).count();
+    CHECK(l.acquisitions == 2);
+    CHECK(l.hold_ns.max() >= hold_ns);
+    CHECK(l.hold_ns.max() < hold_ns * 50);
+    CHECK(l.threads.size() == 2);
+    // The main thread normally blocks; if it was descheduled past the hold it did not wait
+    if (l.contentions == 1) {
+        CHECK(l.handoffs == 1);
+        CHECK(l.wait_ns.sum() > 0 && l.wait_ns.sum() <= l.hold_ns.max());
+    }
+    std::remove(path);
+}
+
+int main() {
+    std::cout << "=== Lock Analysis Test ===" << std::endl;
+    test_histogram();
+    test_analyzer();
+    test_real_trace();
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All lock analysis checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,205 @@
+/**
+ * Lock class test
+ *
+ * This test verifies:
+ * 1. Class names map to stable, distinct, non-zero classes
+ * 2. Class guards carry the class in every lock event, per declared name or
+ *    per call site, and keep the instance's lock_id
+ * 3. LockClassAnalyzer folds many instances into one entry per class and
+ *    finds a class-level lock-order inversion that no pair of instances shows
+ * 4. In-process histograms of class guards aggregate by class
+ * 5. Classes survive the block trace, named by LockClassName records
+ */
+
+#include <ucdbg/ucdbg.hpp>
+#include <ucdbg/block_reader.hpp>
+#include <ucdbg/lock_analysis.hpp>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "test_common.hpp"
+
+struct Account {
+    std::mutex mtx;
+    long balance = 0;
+};
+
+static void test_registry() {
+    ucdbg::lock_class_t account = ucdbg::lock_class("Account::mtx");
+    ucdbg::lock_class_t ledger = ucdbg::lock_class("Ledger::mtx");
+    CHECK(account != 0 && ledger != 0 && account != ledger);
+    CHECK(ucdbg::lock_class("Account::mtx") == account);
+
+    std::vector<ucdbg::TraceEvent> records = ucdbg::internal::LockClasses::instance().definitions();
+    bool found = false;
+    for (const auto& e : records) {
+        CHECK(e.concurrency.type == ucdbg::EventType::LockClassName);
+        if (e.concurrency.lock_id == ucdbg::lock_class_key(account)) {
+            found = ucdbg::internal::StringTable::instance().strings().at(e.concurrency_arg()) == "Account::mtx";
+        }
+    }
+    CHECK(found);
+    CHECK((ucdbg::lock_class_key(account) & ucdbg::LOCK_CLASS_KEY_BIT) != 0);
+}
+
+static void test_guards() {
+    ucdbg::internal::tracing_active.store(true);
+    std::vector<Account> accounts(3);
+    for (auto& a : accounts) {
+        UCDBG_LOCK_GUARD_CLASS(a.mtx, "Account::mtx");
+    }
+    for (auto& a : accounts) {
+        UCDBG_LOCK_GUARD_CLASS(a.mtx, UCDBG_CALL_SITE);
+    }
+    std::shared_mutex rw;
+    { UCDBG_SHARED_LOCK_GUARD_CLASS(rw, "Index::rw"); }
+    { UCDBG_LOCK_GUARD(accounts[0].mtx); }
+    std::vector<ucdbg::TraceEvent> events = drain();
+    ucdbg::internal::tracing_active.store(false);
+
+    CHECK(events.size() == 3 * 2 + 3 * 2 + 2 + 2);
+    if (events.size() == 16) {
+        ucdbg::lock_class_t account = ucdbg::lock_class("Account::mtx");
+        ucdbg::lock_class_t site = events[6].lock_class();
+        for (size_t i = 0; i < 6; ++i) {
+            CHECK(events[i].lock_class() == account);
+            CHECK(events[i].concurrency.lock_id == reinterpret_cast<ucdbg::lock_id_t>(&accounts[i / 2].mtx));
+        }
+        CHECK(site != 0 && site != account);
+        for (size_t i = 6; i < 12; ++i) CHECK(events[i].lock_class() == site);
+        CHECK(events[12].lock_class() == ucdbg::lock_class("Index::rw"));
+        CHECK(events[12].concurrency.type == ucdbg::EventType::SharedLockAcquire);
+        CHECK(events[13].lock_class() == ucdbg::lock_class("Index::rw"));
+        CHECK(events[14].lock_class() == 0 && events[15].lock_class() == 0);
+    }
+}
+
+static ucdbg::TraceEvent lock_event(uint64_t ts, uint64_t tid, ucdbg::EventType type, uint64_t id,
+                                    ucdbg::lock_class_t cls) {
+    ucdbg::TraceEvent e;
+    std::memset(&e, 0, sizeof(e));
+    e.timestamp_ns = ts;
+    e.thread_id = tid;
+    e.format_version = ucdbg::TRACE_FORMAT_VERSION;
+    e.kind = ucdbg::EventKind::Concurrency;
+    e.concurrency.type = type;
+    e.concurrency.lock_id = id;
+    e.set_lock_class(cls);
+    return e;
+}
+
+static void test_class_analysis() {
+    using T = ucdbg::EventType;
+    const ucdbg::lock_class_t A = 1, B = 2;
+    ucdbg::LockAnalyzer instances;
+    ucdbg::LockClassAnalyzer classes;
+    uint64_t ts = 0;
+    auto feed = [&](const ucdbg::TraceEvent& e) {
+        instances.add(e);
+        classes.add(e);
+    };
+    // Thread 1 takes an A lock then a B lock; thread 2 the other way round, on other instances
+    for (uint64_t i = 0; i < 500; ++i) {
+        uint64_t a = 0x10000 + i * 64, b = 0x90000 + i * 64;
+        uint64_t tid = i % 2 ? 1 : 2;
+        uint64_t first = tid == 1 ? a : b + 32, second = tid == 1 ? b : a + 32;
+        ucdbg::lock_class_t first_class = tid == 1 ? A : B, second_class = tid == 1 ? B : A;
+        feed(lock_event(++ts, tid, T::LockAcquire, first, first_class));
+        feed(lock_event(++ts, tid, T::LockAcquire, second, second_class));
+        feed(lock_event(++ts, tid, T::LockRelease, second, second_class));
+        feed(lock_event(++ts, tid, T::LockRelease, first, first_class));
+    }
+    feed(lock_event(++ts, 3, T::LockAcquire, 0x500, 0));
+    feed(lock_event(++ts, 3, T::LockRelease, 0x500, 0));
+
+    CHECK(instances.locks().size() == 1000 + 1);
+    CHECK(classes.locks().size() == 2 + 1);
+    const ucdbg::LockStats& a = classes.locks().at(ucdbg::lock_class_key(A));
+    CHECK(a.acquisitions == 500 && a.hold_ns.count() == 500 && a.threads.size() == 2);
+    CHECK(classes.locks().count(0x500) == 1);
+    CHECK(classes.open_count() == 0);
+
+    auto inverted = [](const ucdbg::LockAnalyzer& analyzer) {
+        for (const auto& [held, acquired] : analyzer.lock_order()) {
+            if (analyzer.lock_order().count({acquired, held})) return true;
+        }
+        return false;
+    };
+    CHECK(!inverted(instances));
+    CHECK(inverted(classes));
+    CHECK(classes.lock_order().size() == 2);
+
+    // Nested instances of one class add no self edge
+    ucdbg::LockClassAnalyzer nested;
+    nested.add(lock_event(1, 1, T::LockAcquire, 0x100, A));
+    nested.add(lock_event(2, 1, T::LockAcquire, 0x200, A));
+    nested.add(lock_event(3, 1, T::LockRelease, 0x200, A));
+    nested.add(lock_event(4, 1, T::LockRelease, 0x100, A));
+    CHECK(nested.lock_order().empty() && nested.open_count() == 0);
+    CHECK(nested.locks().at(ucdbg::lock_class_key(A)).hold_ns.count() == 2);
+}
+
+static void test_class_histograms() {
+    ucdbg::set_lock_histograms(true, false);
+    std::vector<std::unique_ptr<Account>> accounts;
+    for (int i = 0; i < 200; ++i) accounts.push_back(std::make_unique<Account>());
+    for (auto& a : accounts) {
+        UCDBG_LOCK_GUARD_CLASS(a->mtx, "Account::hist");
+        ++a->balance;
+    }
+    ucdbg::set_lock_histograms(false);
+    ucdbg::lock_class_t cls = ucdbg::lock_class("Account::hist");
+    CHECK(ucdbg::lock_latency(ucdbg::lock_class_key(cls)).hold_ns.count() == 200);
+    CHECK(ucdbg::lock_latency(accounts[0]->mtx).hold_ns.count() == 0);
+}
+
+static void test_traced_classes() {
+    const char* path = "/tmp/ucdbg_test_lock_class.trace";
+    std::vector<Account> accounts(64);
+    CHECK(UCDBG_INIT(path));
+    for (int round = 0; round < 4; ++round) {
+        for (auto& a : accounts) {
+            UCDBG_LOCK_GUARD_CLASS(a.mtx, "Account::traced");
+            ++a.balance;
+        }
+    }
+    ucdbg::shutdown();
+
+    ucdbg::BlockTraceReader reader;
+    CHECK(reader.open(path));
+    ucdbg::LockClassAnalyzer analyzer;
+    CHECK(reader.for_each_event_ordered([&](const ucdbg::TraceEvent& e) { analyzer.add(e); }));
+    ucdbg::lock_id_t key = ucdbg::lock_class_key(ucdbg::lock_class("Account::traced"));
+    auto it = analyzer.locks().find(key);
+    CHECK(it != analyzer.locks().end());
+    if (it != analyzer.locks().end()) {
+        CHECK(it->second.acquisitions == 4 * 64);
+    }
+    auto name = analyzer.lock_classes().find(key);
+    CHECK(name != analyzer.lock_classes().end());
+    if (name != analyzer.lock_classes().end()) {
+        CHECK(reader.string(name->second) == "Account::traced");
+    }
+    std::remove(path);
+}
+
+int main() {
+    std::cout << "=== Lock Class Test ===" << std::endl;
+    test_registry();
+    test_guards();
+    test_class_analysis();
+    test_class_histograms();
+    test_traced_classes();
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All lock class checks passed" << std::endl;
+    return 0;
+}
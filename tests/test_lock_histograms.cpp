@@ -0,0 +1,208 @@
+/**
+ * In-process lock histogram test
+ *
+ * This test verifies:
+ * 1. Summary record args round-trip bucket and count
+ * 2. With set_lock_histograms(true, false) guards emit no lock events,
+ *    yet lock_latency() reports every hold and contended wait
+ * 3. Records of threads that exited before collection are not lost
+ * 4. Bucket counts above LOCK_HISTOGRAM_MAX_COUNT span several records,
+ *    and LockAnalyzer rebuilds the same histograms from them
+ * 5. A traced run writes summary records alongside the lock events
+ * 6. Memory stays bounded: cumulative histograms for at most
+ *    MAX_TRACKED_LOCKS locks, interval histograms only while summarizing
+ */
+
+#include <ucdbg/ucdbg.hpp>
+#include <ucdbg/block_reader.hpp>
+#include <ucdbg/lock_analysis.hpp>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "test_common.hpp"
+
+static void test_record_encoding() {
+    using namespace ucdbg::internal;
+    for (size_t bucket : {size_t{0}, size_t{7}, size_t{200}, ucdbg::LatencyHistogram::BUCKETS - 1}) {
+        for (uint32_t count : {1u, 1000u, LOCK_HISTOGRAM_MAX_COUNT}) {
+            uint32_t arg = lock_histogram_arg(bucket, count);
+            CHECK(arg <= ucdbg::CONCURRENCY_ARG_MAX);
+            CHECK(lock_histogram_bucket(arg) == bucket);
+            CHECK(lock_histogram_count(arg) == count);
+        }
+    }
+}
+
+static void test_histograms_only() {
+    ucdbg::internal::tracing_active.store(true);
+    ucdbg::set_lock_histograms(true, false);
+    std::mutex mtx;
+    for (int i = 0; i < 20; ++i) {
+        UCDBG_LOCK_GUARD(mtx);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    {
+        std::unique_lock<std::mutex> held(mtx);
+        std::thread waiter([&] { UCDBG_LOCK_GUARD(mtx); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        held.unlock();
+        waiter.join();
+    }
+    CHECK(drain().empty());
+
+    ucdbg::LockLatency latency = ucdbg::lock_latency(mtx);
+    CHECK(latency.hold_ns.count() == 21);
+    CHECK(latency.hold_ns.percentile(0.5) >= 1'000'000);
+    CHECK(latency.wait_ns.count() == 1);
+    CHECK(latency.wait_ns.max() >= 10'000'000);
+
+    // Lock events come back once histograms are off
+    ucdbg::set_lock_histograms(false);
+    { UCDBG_LOCK_GUARD(mtx); }
+    CHECK(drain().size() == 2);
+    CHECK(ucdbg::lock_latency(mtx).hold_ns.count() == 21);
+    ucdbg::internal::tracing_active.store(false);
+}
+
+static void test_exited_threads() {
+    ucdbg::set_lock_histograms(true, false);
+    std::mutex mtx;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 1000; ++i) {
+                UCDBG_LOCK_GUARD(mtx);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    ucdbg::LockLatency latency = ucdbg::lock_latency(mtx);
+    CHECK(latency.hold_ns.count() == 4000);
+    CHECK(latency.hold_ns.count() == ucdbg::lock_latency(mtx).hold_ns.count());  // Collected once
+    CHECK(ucdbg::internal::LockHistograms::instance().dropped() == 0);
+    ucdbg::set_lock_histograms(false);
+}
+
+static void test_summary_records() {
+    using namespace ucdbg::internal;
+    const ucdbg::lock_id_t id = 0x5000;
+    auto& histograms = LockHistograms::instance();
+    histograms.set_summaries(true);
+    for (int i = 0; i < 40000; ++i) {
+        histograms.record_hold(id, 1500);
+    }
+    for (int i = 0; i < 100; ++i) {
+        histograms.record_hold(id, 90'000 + i);
+        histograms.record_wait(id, 250'000);
+    }
+    std::vector<ucdbg::TraceEvent> records = histograms.take_summary();
+    size_t hold_records = 0, wait_records = 0;
+    ucdbg::LockAnalyzer analyzer;
+    for (const auto& e : records) {
+        if (e.concurrency.lock_id != id) continue;
+        hold_records += e.concurrency.type == ucdbg::EventType::LockHoldHistogram;
+        wait_records += e.concurrency.type == ucdbg::EventType::LockWaitHistogram;
+        analyzer.add(e);
+    }
+    CHECK(hold_records == 3);  // 32767 + 7233 in one bucket, 100 in another
+    CHECK(wait_records == 1);
+    CHECK(analyzer.threads().empty());
+
+    const ucdbg::LockStats& stats = analyzer.locks().at(id);
+    ucdbg::LockLatency latency = ucdbg::lock_latency(id);
+    CHECK(stats.acquisitions == 0);
+    CHECK(stats.summary_hold_ns.count() == 40100);
+    CHECK(stats.summary_wait_ns.count() == 100);
+    for (double q : {0.5, 0.99, 0.999, 1.0}) {
+        CHECK(stats.summary_hold_ns.percentile(q) == latency.hold_ns.percentile(q));
+        CHECK(stats.summary_wait_ns.percentile(q) == latency.wait_ns.percentile(q));
+    }
+    CHECK(stats.summary_hold_ns.percentile(0.5) >= 1500);
+    CHECK(stats.summary_hold_ns.percentile(0.999) >= 90'000);
+
+    // Nothing new since: the next summary has no records for the lock
+    for (const auto& e : histograms.take_summary()) {
+        CHECK(e.concurrency.lock_id != id);
+    }
+
+    // Not summarizing: recorded for latency() only
+    histograms.set_summaries(false);
+    histograms.record_hold(id, 1500);
+    CHECK(histograms.take_summary().empty());
+    CHECK(ucdbg::lock_latency(id).hold_ns.count() == 40101);
+}
+
+static void test_bounds() {
+    using namespace ucdbg::internal;
+    auto& histograms = LockHistograms::instance();
+    constexpr int THREADS = 11, LOCKS = 100;  // 1100 locks, over MAX_TRACKED_LOCKS in all
+    uint64_t dropped = histograms.dropped(), untracked = histograms.untracked();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&histograms, t] {
+            for (int i = 0; i < LOCKS; ++i) {
+                histograms.record_hold(0x100000 + static_cast<ucdbg::lock_id_t>(t * LOCKS + i) * 64, 1000);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    histograms.collect();
+
+    uint64_t tracked = 0;
+    for (int i = 0; i < THREADS * LOCKS; ++i) {
+        tracked += ucdbg::lock_latency(0x100000 + static_cast<ucdbg::lock_id_t>(i) * 64).hold_ns.count();
+    }
+    uint64_t lost = histograms.dropped() - dropped;
+    CHECK(tracked <= LockHistograms::MAX_TRACKED_LOCKS);
+    CHECK(histograms.untracked() > untracked);
+    CHECK(tracked + (histograms.untracked() - untracked) + lost == THREADS * LOCKS);
+    CHECK(lost < THREADS * LOCKS / 10);
+}
+
+static void test_traced_summary() {
+    const char* path = "/tmp/ucdbg_test_lock_histograms.trace";
+    std::mutex mtx;
+    const ucdbg::lock_id_t id = reinterpret_cast<ucdbg::lock_id_t>(&mtx);
+    CHECK(UCDBG_INIT(path));
+    ucdbg::set_lock_histograms(true);
+    for (int i = 0; i < 100; ++i) {
+        UCDBG_LOCK_GUARD(mtx);
+    }
+    ucdbg::shutdown();
+    ucdbg::set_lock_histograms(false);
+
+    ucdbg::BlockTraceReader reader;
+    CHECK(reader.open(path));
+    ucdbg::LockAnalyzer analyzer;
+    CHECK(reader.for_each_event_ordered([&](const ucdbg::TraceEvent& e) { analyzer.add(e); }));
+    auto it = analyzer.locks().find(id);
+    CHECK(it != analyzer.locks().end());
+    if (it != analyzer.locks().end()) {
+        CHECK(it->second.acquisitions == 100);
+        CHECK(it->second.hold_ns.count() == 100);
+        CHECK(it->second.summary_hold_ns.count() == 100);  // Counted apart from the events
+        CHECK(it->second.summary_wait_ns.count() == 0);
+    }
+    std::remove(path);
+}
+
+int main() {
+    std::cout << "=== Lock Histogram Test ===" << std::endl;
+    test_record_encoding();
+    test_histograms_only();
+    test_exited_threads();
+    test_summary_records();
+    test_traced_summary();
+    test_bounds();
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All lock histogram checks passed" << std::endl;
+    return 0;
+}
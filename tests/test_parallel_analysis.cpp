@@ -0,0 +1,292 @@
+/**
+ * Parallel analysis test
+ *
+ * This test verifies:
+ * 1. The work-stealing pool runs every task exactly once
+ * 2. Slice cuts are increasing and split the events about evenly
+ * 3. LockAnalyzer records lock-order edges, including across merge()
+ * 4. Merging analyzers of consecutive ranges, split anywhere, and
+ *    analyze_parallel with any worker count both equal the serial analysis
+ */
+
+#include <ucdbg/block_reader.hpp>
+#include <ucdbg/block_writer.hpp>
+#include <ucdbg/lock_analysis.hpp>
+#include <ucdbg/parallel_analysis.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "test_common.hpp"
+
+using ucdbg::EventType;
+
+static ucdbg::TraceEvent concurrency(uint64_t ts, uint64_t tid, EventType type, uint64_t id) {
+    ucdbg::TraceEvent e;
+    std::memset(&e, 0, sizeof(e));
+    e.timestamp_ns = ts;
+    e.thread_id = tid;
+    e.format_version = ucdbg::TRACE_FORMAT_VERSION;
+    e.kind = ucdbg::EventKind::Concurrency;
+    e.concurrency.type = type;
+    e.concurrency.lock_id = id;
+    return e;
+}
+
+static bool same_histogram(const ucdbg::LatencyHistogram& a, const ucdbg::LatencyHistogram& b) {
+    for (size_t i = 0; i < ucdbg::LatencyHistogram::BUCKETS; ++i) {
+        if (a.bucket_count(i) != b.bucket_count(i)) {
+            return false;
+        }
+    }
+    return a.count() == b.count() && a.sum() == b.sum() && a.min() == b.min() && a.max() == b.max();
+}
+
+static bool same_analysis(const ucdbg::LockAnalyzer& a, const ucdbg::LockAnalyzer& b) {
+    if (a.locks().size() != b.locks().size() || a.threads().size() != b.threads().size() ||
+        a.lock_order() != b.lock_order() || a.event_count() != b.event_count() ||
+        a.open_count() != b.open_count()) {
+        return false;
+    }
+    for (const auto& [id, x] : a.locks()) {
+        auto it = b.locks().find(id);
+        if (it == b.locks().end()) {
+            return false;
+        }
+        const ucdbg::LockStats& y = it->second;
+        auto xt = x.threads, yt = y.threads;
+        std::sort(xt.begin(), xt.end());
+        std::sort(yt.begin(), yt.end());
+        if (x.acquisitions != y.acquisitions || x.shared_acquisitions != y.shared_acquisitions ||
+            x.contentions != y.contentions || x.handoffs != y.handoffs || xt != yt ||
+            !same_histogram(x.hold_ns, y.hold_ns) || !same_histogram(x.wait_ns, y.wait_ns) ||
+            !same_histogram(x.summary_hold_ns, y.summary_hold_ns) ||
+            !same_histogram(x.summary_wait_ns, y.summary_wait_ns)) {
+            return false;
+        }
+    }
+    for (const auto& [tid, x] : a.threads()) {
+        auto it = b.threads().find(tid);
+        if (it == b.threads().end()) {
+            return false;
+        }
+        const ucdbg::ThreadBlockedStats& y = it->second;
+        if (x.events != y.events || x.first_ts != y.first_ts || x.last_ts != y.last_ts ||
+            x.lock_waits != y.lock_waits || x.lock_wait_ns != y.lock_wait_ns || x.cond_waits != y.cond_waits ||
+            x.cond_wait_ns != y.cond_wait_ns || x.sync_waits != y.sync_waits || x.sync_wait_ns != y.sync_wait_ns) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Well-formed per-thread streams in global timestamp order (distinct
+ * timestamps): nested, recursive, shared and contended locking, condition
+ * and barrier waits, a hold begun before the trace and holds left open.
+ */
+static std::vector<ucdbg::TraceEvent> make_trace() {
+    const uint64_t THREADS = 6;
+    const uint64_t locks[] = {0x1000, 0x2000, 0x3000, 0x4000};
+    std::vector<std::vector<ucdbg::TraceEvent>> per_thread(THREADS);
+    std::mt19937_64 rng(7);
+    for (uint64_t t = 0; t < THREADS; ++t) {
+        uint64_t tid = 500 + t;
+        uint64_t step = 0;
+        auto& out = per_thread[t];
+        auto emit = [&](EventType type, uint64_t id) {
+            step += 1 + rng() % 20;
+            out.push_back(concurrency(step * THREADS + t, tid, type, id));
+        };
+        if (t == 0) {
+            emit(EventType::LockRelease, 0x9000);  // Trace began mid-hold
+        }
+        for (int op = 0; op < 600; ++op) {
+            uint64_t a = locks[rng() % 4];
+            uint64_t b = locks[rng() % 4];
+            switch (rng() % 6) {
+                case 0:
+                case 1:
+                    if (rng() % 3 == 0) emit(EventType::LockContended, a);
+                    emit(EventType::LockAcquire, a);
+                    if (b != a) {
+                        // Mostly in address order; thread 5 sometimes inverts
+                        uint64_t inner = t == 5 ? std::min(a, b) : std::max(a, b);
+                        uint64_t outer = inner == a ? b : a;
+                        if (outer != a) {
+                            emit(EventType::LockRelease, a);
+                            emit(EventType::LockAcquire, outer);
+                        }
+                        emit(EventType::LockAcquire, inner);
+                        emit(EventType::LockRelease, inner);
+                        emit(EventType::LockRelease, outer);
+                    } else {
+                        emit(EventType::LockRelease, a);
+                    }
+                    break;
+                case 2:
+                    emit(EventType::LockAcquire, a);
+                    emit(EventType::LockAcquire, a);
+                    emit(EventType::LockRelease, a);
+                    emit(EventType::LockRelease, a);
+                    break;
+                case 3:
+                    if (rng() % 2) emit(EventType::SharedLockContended, 0x5000);
+                    emit(EventType::SharedLockAcquire, 0x5000);
+                    emit(EventType::SharedLockRelease, 0x5000);
+                    break;
+                case 4:
+                    emit(EventType::LockAcquire, a);
+                    emit(EventType::CondWaitBegin, 0x6000);
+                    emit(EventType::CondWaitEnd, 0x6000);
+                    emit(EventType::LockRelease, a);
+                    break;
+                default:
+                    emit(EventType::BarrierWaitBegin, 0x7000);
+                    emit(EventType::BarrierWaitEnd, 0x7000);
+                    break;
+            }
+        }
+        if (t == 1) {
+            emit(EventType::LockAcquire, 0x1000);  // Still held at the end
+            emit(EventType::LockContended, 0x2000);
+        }
+    }
+    std::vector<ucdbg::TraceEvent> events;
+    for (const auto& list : per_thread) {
+        events.insert(events.end(), list.begin(), list.end());
+    }
+    std::sort(events.begin(), events.end(), [](const ucdbg::TraceEvent& x, const ucdbg::TraceEvent& y) {
+        return x.timestamp_ns < y.timestamp_ns;
+    });
+    return events;
+}
+
+static void test_work_stealing() {
+    for (unsigned workers : {1u, 3u, 8u}) {
+        std::vector<std::atomic<int>> runs(500);
+        ucdbg::internal::run_work_stealing(runs.size(), workers, [&](size_t i) {
+            if (i % 100 == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));  // Uneven cost
+            }
+            runs[i].fetch_add(1);
+        });
+        CHECK(std::all_of(runs.begin(), runs.end(), [](const std::atomic<int>& n) { return n.load() == 1; }));
+    }
+}
+
+static void test_slice_bounds() {
+    std::vector<ucdbg::BlockIndexEntry> blocks;
+    for (uint64_t i = 0; i < 100; ++i) {
+        ucdbg::BlockIndexEntry entry{};
+        entry.first_ts = 1000 + (i % 10) * 100 + i / 10;  // Ten threads, interleaved
+        entry.last_ts = entry.first_ts + 50;
+        entry.thread_id = i / 10;
+        entry.event_count = 64;
+        blocks.push_back(entry);
+    }
+    auto cuts = ucdbg::internal::slice_bounds(blocks, 8);
+    CHECK(cuts.size() == 9);
+    CHECK(cuts.front() == 0 && cuts.back() == UINT64_MAX);
+    CHECK(std::is_sorted(cuts.begin(), cuts.end()) &&
+          std::adjacent_find(cuts.begin(), cuts.end()) == cuts.end());
+    for (size_t i = 0; i + 1 < cuts.size(); ++i) {
+        uint64_t events = 0;
+        for (const auto& entry : blocks) {
+            events += entry.first_ts >= cuts[i] && entry.first_ts < cuts[i + 1] ? entry.event_count : 0;
+        }
+        CHECK(events >= 64 * 12 && events <= 64 * 13);
+    }
+    CHECK(ucdbg::internal::slice_bounds({}, 4).size() == 2);
+}
+
+static void test_lock_order() {
+    ucdbg::LockAnalyzer a;
+    a.add(concurrency(10, 1, EventType::LockAcquire, 0xA));
+    a.add(concurrency(20, 1, EventType::LockAcquire, 0xB));
+    a.add(concurrency(30, 1, EventType::LockRelease, 0xB));
+    a.add(concurrency(40, 2, EventType::SharedLockAcquire, 0xB));
+    CHECK(a.lock_order().size() == 1 && a.lock_order().count({0xA, 0xB}));
+
+    // Holds crossing into a later range: A released at 60 after C; B still held at D
+    ucdbg::LockAnalyzer later;
+    later.add(concurrency(50, 1, EventType::LockAcquire, 0xC));
+    later.add(concurrency(55, 1, EventType::LockRelease, 0xC));
+    later.add(concurrency(60, 1, EventType::LockRelease, 0xA));
+    later.add(concurrency(70, 1, EventType::LockAcquire, 0xD));
+    later.add(concurrency(80, 2, EventType::LockAcquire, 0xA));
+    later.add(concurrency(90, 2, EventType::LockRelease, 0xA));
+    later.add(concurrency(95, 2, EventType::SharedLockRelease, 0xB));
+    CHECK(later.lock_order().empty());
+    a.merge(std::move(later));
+    CHECK(a.lock_order().count({0xA, 0xC}));
+    CHECK(!a.lock_order().count({0xA, 0xD}));
+    CHECK(a.lock_order().count({0xB, 0xA}));  // Inverts A -> B
+    CHECK(a.lock_order().size() == 3);
+    CHECK(a.locks().at(0xA).hold_ns.sum() == 50 + 10);
+    CHECK(a.locks().at(0xA).handoffs == 1);
+    CHECK(a.locks().at(0xB).hold_ns.sum() == 10 + 55);
+    CHECK(a.open_count() == 1);  // D
+}
+
+static void test_split_merge(const std::vector<ucdbg::TraceEvent>& events) {
+    ucdbg::LockAnalyzer serial;
+    for (const auto& e : events) serial.add(e);
+    CHECK(serial.lock_order().count({0x1000, 0x2000}) && serial.lock_order().count({0x2000, 0x1000}));
+    CHECK(serial.open_count() == 2);
+
+    std::mt19937_64 rng(11);
+    for (int round = 0; round < 20; ++round) {
+        ucdbg::LockAnalyzer merged;
+        size_t begin = 0;
+        while (begin < events.size()) {
+            size_t end = std::min(events.size(), begin + 1 + rng() % (round < 10 ? 40 : 2000));
+            ucdbg::LockAnalyzer part;
+            for (size_t i = begin; i < end; ++i) part.add(events[i]);
+            merged.merge(std::move(part));
+            begin = end;
+        }
+        CHECK(same_analysis(serial, merged));
+    }
+}
+
+static void test_parallel_file(const std::vector<ucdbg::TraceEvent>& events) {
+    const char* path = "/tmp/ucdbg_test_parallel_analysis.trace";
+    {
+        ucdbg::BlockTraceWriter writer(32);  // Small blocks: many slices
+        CHECK(writer.open(path));
+        writer.append(events.data(), events.size());
+        writer.close();
+    }
+    ucdbg::BlockTraceReader reader;
+    CHECK(reader.open(path));
+    ucdbg::LockAnalyzer serial;
+    CHECK(reader.for_each_event_ordered([&](const ucdbg::TraceEvent& e) { serial.add(e); }));
+    CHECK(serial.event_count() == events.size());
+    for (unsigned workers : {1u, 2u, 4u, 16u}) {
+        ucdbg::LockAnalyzer parallel;
+        CHECK(ucdbg::analyze_parallel(reader, parallel, workers));
+        CHECK(same_analysis(serial, parallel));
+    }
+    std::remove(path);
+}
+
+int main() {
+    std::cout << "=== Parallel Analysis Test ===" << std::endl;
+    test_work_stealing();
+    test_slice_bounds();
+    test_lock_order();
+    auto events = make_trace();
+    test_split_merge(events);
+    test_parallel_file(events);
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All parallel analysis checks passed" << std::endl;
+    return 0;
+}
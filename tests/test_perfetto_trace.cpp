@@ -0,0 +1,231 @@
+/**
+ * Perfetto protobuf export test
+ *
+ * This test verifies, by decoding the output's wire format:
+ * 1. The first packet clears incremental state and describes the process
+ * 2. Thread and counter tracks are described once; thread names are kept
+ * 3. Event names are interned once and referenced by iid
+ * 4. Lock holds become slices; non-nested holds are split to keep nesting
+ * 5. Counter values and flow IDs (flows, tasks) are encoded
+ */
+
+#include <ucdbg/perfetto_trace.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "test_common.hpp"
+
+namespace pf = ucdbg::internal::perfetto;
+
+// Minimal protobuf decoder: field number -> values (varint/fixed64) or bytes
+struct Message {
+    std::multimap<uint32_t, uint64_t> values;
+    std::multimap<uint32_t, std::string> bytes;
+
+    bool parse(const std::string& data) {
+        const uint8_t* in = reinterpret_cast<const uint8_t*>(data.data());
+        const uint8_t* end = in + data.size();
+        while (in < end) {
+            uint64_t tag;
+            if (!(in = ucdbg::internal::read_varint(in, end, tag))) return false;
+            uint32_t field = static_cast<uint32_t>(tag >> 3);
+            uint64_t value;
+            switch (tag & 7) {
+                case 0:
+                    if (!(in = ucdbg::internal::read_varint(in, end, value))) return false;
+                    values.emplace(field, value);
+                    break;
+                case 1:
+                    if (end - in < 8) return false;
+                    std::memcpy(&value, in, 8);
+                    in += 8;
+                    values.emplace(field, value);
+                    break;
+                case 2:
+                    if (!(in = ucdbg::internal::read_varint(in, end, value)) ||
+                        value > static_cast<uint64_t>(end - in)) return false;
+                    bytes.emplace(field, std::string(reinterpret_cast<const char*>(in), value));
+                    in += value;
+                    break;
+                default:
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    bool has(uint32_t field) const {
+        return values.count(field) || bytes.count(field);
+    }
+
+    uint64_t value(uint32_t field) const {
+        auto it = values.find(field);
+        return it == values.end() ? 0 : it->second;
+    }
+
+    Message sub(uint32_t field) const {
+        Message m;
+        auto it = bytes.find(field);
+        if (it != bytes.end()) m.parse(it->second);
+        return m;
+    }
+};
+
+static ucdbg::TraceEvent event(uint64_t ts, uint64_t tid, ucdbg::EventKind kind) {
+    ucdbg::TraceEvent e;
+    std::memset(&e, 0, sizeof(e));
+    e.timestamp_ns = ts;
+    e.thread_id = tid;
+    e.format_version = ucdbg::TRACE_FORMAT_VERSION;
+    e.kind = kind;
+    return e;
+}
+
+static ucdbg::TraceEvent concurrency(uint64_t ts, uint64_t tid, ucdbg::EventType type, uint64_t id) {
+    ucdbg::TraceEvent e = event(ts, tid, ucdbg::EventKind::Concurrency);
+    e.concurrency.type = type;
+    e.concurrency.lock_id = id;
+    return e;
+}
+
+int main() {
+    std::cout << "=== Perfetto Trace Export Test ===" << std::endl;
+    const char* path = "/tmp/ucdbg_test_perfetto.pftrace";
+    using ucdbg::EventType;
+
+    ucdbg::PerfettoTraceWriter writer;
+    CHECK(writer.open(path));
+    writer.set_strings({"parse", "queue_depth"});
+    writer.thread_name(1, "main");
+
+    // Two holds of 0x10, the second hand-over-hand with 0x11
+    writer.append(concurrency(1000, 1, EventType::LockAcquire, 0x10));
+    writer.append(concurrency(2000, 1, EventType::LockRelease, 0x10));
+    writer.append(concurrency(3000, 1, EventType::LockAcquire, 0x10));
+    writer.append(concurrency(3100, 1, EventType::LockAcquire, 0x11));
+    writer.append(concurrency(3200, 1, EventType::LockRelease, 0x10));  // END, END, BEGIN 0x11
+    writer.append(concurrency(3300, 1, EventType::LockRelease, 0x11));
+    ucdbg::TraceEvent sample = event(3400, 2, ucdbg::EventKind::Counter);
+    sample.counter.name_id = 1;
+    sample.counter.value = -5;
+    writer.append(sample);
+    writer.append(concurrency(3500, 2, EventType::FlowBegin, 0xabc));
+    writer.append(concurrency(3600, 1, EventType::FlowEnd, 0xabc));
+    writer.append(concurrency(3700, 2, EventType::TaskEnqueue, 0x77));
+    writer.append(concurrency(3800, 1, EventType::TaskBegin, 0x77));
+    writer.append(concurrency(3900, 1, EventType::TaskEnd, 0x77));
+    writer.append(concurrency(4000, 2, EventType::LockRelease, 0x99));  // Unmatched: dropped
+    CHECK(writer.close());
+
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    Message trace;
+    CHECK(trace.parse(ss.str()));
+    CHECK(writer.bytes_written() == ss.str().size());
+
+    std::vector<Message> packets;
+    for (auto it = trace.bytes.lower_bound(pf::TRACE_PACKET); it != trace.bytes.upper_bound(pf::TRACE_PACKET); ++it) {
+        Message packet;
+        CHECK(packet.parse(it->second));
+        CHECK(packet.value(pf::PACKET_SEQUENCE_ID) == 1);
+        packets.push_back(packet);
+    }
+    CHECK(packets.size() == writer.packets_written());
+    CHECK(!packets.empty() && packets[0].value(pf::PACKET_SEQUENCE_FLAGS) == pf::SEQ_INCREMENTAL_STATE_CLEARED);
+    CHECK(!packets.empty() &&
+          packets[0].sub(pf::PACKET_DEFAULTS).value(pf::DEFAULTS_CLOCK_ID) == pf::BUILTIN_CLOCK_MONOTONIC);
+
+    std::map<uint64_t, std::string> names;  // iid -> name
+    std::map<uint64_t, Message> thread_tracks, counter_tracks;
+    struct Decoded {
+        uint64_t ts;
+        uint64_t type;
+        std::string name;
+        Message event;
+    };
+    std::vector<Decoded> events;
+    for (const Message& packet : packets) {
+        if (packet.has(pf::PACKET_TRACK_DESCRIPTOR)) {
+            Message track = packet.sub(pf::PACKET_TRACK_DESCRIPTOR);
+            if (track.has(pf::TRACK_THREAD)) {
+                Message thread = track.sub(pf::TRACK_THREAD);
+                CHECK(!thread_tracks.count(thread.value(pf::THREAD_TID)));
+                thread_tracks[thread.value(pf::THREAD_TID)] = track;
+            }
+            if (track.has(pf::TRACK_COUNTER)) {
+                counter_tracks[track.value(pf::TRACK_UUID)] = track;
+            }
+        }
+        Message interned = packet.sub(pf::PACKET_INTERNED_DATA);
+        for (auto it = interned.bytes.lower_bound(pf::INTERNED_EVENT_NAMES);
+             it != interned.bytes.upper_bound(pf::INTERNED_EVENT_NAMES); ++it) {
+            Message entry;
+            entry.parse(it->second);
+            std::string name = entry.bytes.find(pf::INTERNED_NAME)->second;
+            for (const auto& [iid, existing] : names) CHECK(existing != name);
+            CHECK(!names.count(entry.value(pf::INTERNED_IID)));
+            names[entry.value(pf::INTERNED_IID)] = name;
+        }
+        if (packet.has(pf::PACKET_TRACK_EVENT)) {
+            CHECK(packet.value(pf::PACKET_SEQUENCE_FLAGS) == pf::SEQ_NEEDS_INCREMENTAL_STATE);
+            Message ev = packet.sub(pf::PACKET_TRACK_EVENT);
+            std::string name;
+            if (ev.has(pf::EVENT_NAME_IID)) {
+                // Names are interned no later than the packet that first uses them
+                CHECK(names.count(ev.value(pf::EVENT_NAME_IID)));
+                name = names[ev.value(pf::EVENT_NAME_IID)];
+            }
+            events.push_back({packet.value(pf::PACKET_TIMESTAMP), ev.value(pf::EVENT_TYPE), name, ev});
+        }
+    }
+
+    CHECK(thread_tracks.size() == 2);
+    CHECK(thread_tracks[1].sub(pf::TRACK_THREAD).bytes.find(pf::THREAD_NAME)->second == "main");
+    CHECK(counter_tracks.size() == 1);
+    CHECK(counter_tracks.begin()->second.bytes.find(pf::TRACK_NAME)->second == "queue_depth");
+
+    // Slices: begin/end sequence on thread 1
+    std::vector<std::string> slices;
+    for (const auto& d : events) {
+        if (d.type == pf::TYPE_SLICE_BEGIN) slices.push_back("B " + d.name + " @" + std::to_string(d.ts));
+        if (d.type == pf::TYPE_SLICE_END) slices.push_back("E @" + std::to_string(d.ts));
+    }
+    std::vector<std::string> expected = {
+        "B lock 0x10 @1000", "E @2000",
+        "B lock 0x10 @3000", "B lock 0x11 @3100", "E @3200", "E @3200", "B lock 0x11 @3200", "E @3300",
+        "B task @3800", "E @3900"};
+    CHECK(slices == expected);
+
+    bool counter_seen = false;
+    uint64_t flow_begin = 0, flow_end = 0, task_flow = 0, task_terminate = 0;
+    for (const auto& d : events) {
+        if (d.type == pf::TYPE_COUNTER) {
+            counter_seen = true;
+            CHECK(static_cast<int64_t>(d.event.value(pf::EVENT_COUNTER_VALUE)) == -5);
+            CHECK(counter_tracks.count(d.event.value(pf::EVENT_TRACK_UUID)));
+        }
+        if (d.ts == 3500) flow_begin = d.event.value(pf::EVENT_FLOW_IDS);
+        if (d.ts == 3600) flow_end = d.event.value(pf::EVENT_TERMINATING_FLOW_IDS);
+        if (d.ts == 3700) task_flow = d.event.value(pf::EVENT_FLOW_IDS);
+        if (d.ts == 3800) task_terminate = d.event.value(pf::EVENT_TERMINATING_FLOW_IDS);
+        CHECK(d.ts != 4000);
+    }
+    CHECK(counter_seen);
+    CHECK(flow_begin != 0 && flow_begin == flow_end);
+    CHECK(task_flow != 0 && task_flow == task_terminate && task_flow != flow_begin);
+
+    std::remove(path);
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All Perfetto trace export checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,133 @@
+/**
+ * LD_PRELOAD interposer test
+ *
+ * Runs preload_workload (no ucdbg instrumentation) with libucdbg_preload
+ * preloaded and checks the trace it leaves behind.
+ *
+ * This test verifies:
+ * 1. pthread_create is traced with ThreadStart/ThreadEnd per thread
+ * 2. Mutex lock/unlock pairs are traced with the mutex address as lock_id
+ * 3. std::shared_mutex readers are traced as shared acquire/release
+ * 4. Condition variable waits and notifies are traced against their mutex
+ * 5. Read unlocks stay shared releases however many read locks a thread holds
+ * 6. A forked child neither traces into nor closes the parent's trace
+ * 7. Notifies on condition variables that no longer fit the interposer's
+ *    table are still traced
+ * 8. Over more than one summary interval, only the main thread and threads
+ *    it created emit lock events: the drain thread's own locks are untraced
+ *
+ * Usage: test_preload <libucdbg_preload.so> <preload_workload>
+ */
+
+#include <ucdbg/block_reader.hpp>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <set>
+#include <shared_mutex>
+#include <string>
+
+#include "test_common.hpp"
+
+// Runs the workload under the preload library; returns its stdout
+static std::string run_preloaded(const char* library, const char* workload, const char* trace_path) {
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+        return {};
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(pipe_fds[1], STDOUT_FILENO);
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        setenv("LD_PRELOAD", library, 1);
+        setenv("UCDBG_TRACE_PATH", trace_path, 1);
+        execl(workload, workload, static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    close(pipe_fds[1]);
+    std::string output;
+    char buffer[256];
+    ssize_t n;
+    while ((n = read(pipe_fds[0], buffer, sizeof(buffer))) > 0) {
+        output.append(buffer, static_cast<size_t>(n));
+    }
+    close(pipe_fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << "workload failed, status " << status << std::endl;
+        return {};
+    }
+    return output;
+}
+
+int main(int argc, char** argv) {
+    std::cout << "=== Preload Test ===" << std::endl;
+    if (argc != 3) {
+        std::cerr << "usage: test_preload <libucdbg_preload.so> <preload_workload>" << std::endl;
+        return 1;
+    }
+    const char* trace_path = "test_preload.trace";
+
+    std::string output = run_preloaded(argv[1], argv[2], trace_path);
+    void* mtx = nullptr;
+    void* rw = nullptr;
+    void* cv_mtx = nullptr;
+    long total = 0;
+    void* nested = nullptr;
+    long pid = 0;
+    CHECK(std::sscanf(output.c_str(), "%p %p %p %ld %p %ld", &mtx, &rw, &cv_mtx, &total, &nested, &pid) == 6);
+    CHECK(total == 400);
+
+    ucdbg::BlockTraceReader reader;
+    CHECK(reader.open(trace_path));
+    CHECK(!reader.recovered());
+
+    std::map<std::pair<ucdbg::EventType, uint64_t>, size_t> counts;
+    std::set<uint64_t> started, locking;
+    reader.for_each_event([&](const ucdbg::TraceEvent& e) {
+        if (e.kind == ucdbg::EventKind::Concurrency) {
+            ++counts[{e.concurrency.type, e.concurrency.lock_id}];
+            if (e.concurrency.type == ucdbg::EventType::ThreadStart) started.insert(e.thread_id);
+            if (e.concurrency.type == ucdbg::EventType::LockAcquire) locking.insert(e.thread_id);
+        }
+    });
+    auto count = [&](ucdbg::EventType type, void* lock) {
+        return counts[{type, reinterpret_cast<uint64_t>(lock)}];
+    };
+
+    CHECK(count(ucdbg::EventType::ThreadStart, nullptr) == 5);
+    CHECK(count(ucdbg::EventType::ThreadEnd, nullptr) == 5);
+    CHECK(count(ucdbg::EventType::LockAcquire, mtx) == 400);
+    CHECK(count(ucdbg::EventType::LockRelease, mtx) == 400);
+    CHECK(count(ucdbg::EventType::SharedLockAcquire, rw) == 40);
+    CHECK(count(ucdbg::EventType::SharedLockRelease, rw) == 40);
+    CHECK(count(ucdbg::EventType::CondNotifyOne, cv_mtx) == 1 ||
+          count(ucdbg::EventType::CondWaitBegin, cv_mtx) == 0);  // Waiter may never have waited
+    CHECK(count(ucdbg::EventType::CondWaitBegin, cv_mtx) == count(ucdbg::EventType::CondWaitEnd, cv_mtx));
+    CHECK(count(ucdbg::EventType::LockAcquire, cv_mtx) >= 2);
+    CHECK(count(ucdbg::EventType::CondNotifyOne, nullptr) == 2000);  // No waiter, so no mutex
+    for (size_t i = 0; i < 20; ++i) {
+        void* lock = static_cast<std::shared_mutex*>(nested) + i;
+        CHECK(count(ucdbg::EventType::SharedLockAcquire, lock) == 1);
+        CHECK(count(ucdbg::EventType::SharedLockRelease, lock) == 1);
+        CHECK(count(ucdbg::EventType::LockRelease, lock) == 0);
+    }
+
+    for (uint64_t tid : locking) {
+        CHECK(tid == static_cast<uint64_t>(pid) || started.count(tid));
+    }
+
+    reader.close();
+    std::remove(trace_path);
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All preload checks passed" << std::endl;
+    return 0;
+}
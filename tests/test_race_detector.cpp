@@ -0,0 +1,240 @@
+/**
+ * Happens-before race detector test
+ *
+ * This test verifies:
+ * 1. Accesses ordered by a lock do not race; unordered writes do
+ * 2. A write after concurrent reads reports each unordered reader, and a
+ *    shared release orders readers before a writer but not before each other
+ * 3. Spawn/join, semaphore and task edges order accesses across threads
+ * 4. Repeated races on the same sites are counted, not listed again
+ * 5. A traced run: lock-protected annotated writes are race-free, while an
+ *    unprotected counter is reported with its access sites
+ */
+
+#include <ucdbg/ucdbg.hpp>
+#include <ucdbg/race_detector.hpp>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include "test_common.hpp"
+
+static ucdbg::TraceEvent concurrency(uint64_t ts, uint64_t tid, ucdbg::EventType type, uint64_t id,
+                                     uint32_t arg = 0) {
+    ucdbg::TraceEvent e;
+    std::memset(&e, 0, sizeof(e));
+    e.timestamp_ns = ts;
+    e.thread_id = tid;
+    e.format_version = ucdbg::TRACE_FORMAT_VERSION;
+    e.kind = ucdbg::EventKind::Concurrency;
+    e.concurrency.type = type;
+    e.concurrency.lock_id = id;
+    e.set_concurrency_arg(arg);
+    return e;
+}
+
+static ucdbg::RaceDetector detect(const std::vector<ucdbg::TraceEvent>& events) {
+    ucdbg::RaceDetector detector;
+    for (const auto& e : events) detector.add(e);
+    return detector;
+}
+
+static void test_locks() {
+    using T = ucdbg::EventType;
+    const uint64_t A = 1, B = 2, L = 0x100, X = 0x1000;
+    ucdbg::RaceDetector ordered = detect({
+        concurrency(10, A, T::LockAcquire, L),
+        concurrency(11, A, T::MemoryRead, X, 1),
+        concurrency(12, A, T::MemoryWrite, X, 2),
+        concurrency(13, A, T::LockRelease, L),
+        concurrency(20, B, T::LockAcquire, L),
+        concurrency(21, B, T::MemoryWrite, X, 3),
+        concurrency(22, B, T::LockRelease, L),
+        concurrency(30, A, T::LockAcquire, L),
+        concurrency(31, A, T::MemoryRead, X, 1),
+        concurrency(32, A, T::LockRelease, L),
+    });
+    CHECK(ordered.races().empty());
+    CHECK(ordered.access_count() == 4 && ordered.variable_count() == 1 && ordered.thread_count() == 2);
+
+    // B writes outside the lock: races with A's write before it and A's read after
+    ucdbg::RaceDetector racy = detect({
+        concurrency(10, A, T::LockAcquire, L),
+        concurrency(12, A, T::MemoryWrite, X, 2),
+        concurrency(13, A, T::LockRelease, L),
+        concurrency(21, B, T::MemoryWrite, X, 3),
+        concurrency(30, A, T::LockAcquire, L),
+        concurrency(31, A, T::MemoryRead, X, 1),
+        concurrency(32, A, T::LockRelease, L),
+    });
+    CHECK(racy.races().size() == 2);
+    if (racy.races().size() == 2) {
+        const ucdbg::DataRace& ww = racy.races()[0];
+        CHECK(ww.address == X && ww.previous.write && ww.current.write);
+        CHECK(ww.previous.thread_id == A && ww.previous.site == 2 && ww.previous.ts == 12);
+        CHECK(ww.current.thread_id == B && ww.current.site == 3 && ww.current.ts == 21);
+        const ucdbg::DataRace& wr = racy.races()[1];
+        CHECK(wr.previous.thread_id == B && wr.previous.write);
+        CHECK(wr.current.thread_id == A && !wr.current.write && wr.current.site == 1);
+    }
+}
+
+static void test_shared_reads() {
+    using T = ucdbg::EventType;
+    const uint64_t A = 1, B = 2, C = 3, W = 4, RW = 0x200, X = 0x1000;
+    // A and B read concurrently; C writes without synchronizing with B
+    ucdbg::RaceDetector racy = detect({
+        concurrency(10, A, T::LockAcquire, RW),
+        concurrency(11, A, T::MemoryRead, X, 1),
+        concurrency(12, A, T::LockRelease, RW),
+        concurrency(20, B, T::MemoryRead, X, 2),
+        concurrency(30, C, T::LockAcquire, RW),
+        concurrency(31, C, T::MemoryWrite, X, 3),
+        concurrency(32, C, T::LockRelease, RW),
+    });
+    CHECK(racy.races().size() == 1);
+    if (racy.races().size() == 1) {
+        CHECK(racy.races()[0].previous.thread_id == B && !racy.races()[0].previous.write);
+        CHECK(racy.races()[0].current.thread_id == C && racy.races()[0].current.write);
+    }
+
+    // Readers under a shared lock, then a writer under the exclusive lock
+    ucdbg::RaceDetector readers = detect({
+        concurrency(10, A, T::SharedLockAcquire, RW, 1),
+        concurrency(11, B, T::SharedLockAcquire, RW, 2),
+        concurrency(12, A, T::MemoryRead, X, 1),
+        concurrency(13, B, T::MemoryRead, X, 2),
+        concurrency(14, A, T::SharedLockRelease, RW, 1),
+        concurrency(15, B, T::SharedLockRelease, RW),
+        concurrency(20, W, T::LockAcquire, RW),
+        concurrency(21, W, T::MemoryWrite, X, 3),
+        concurrency(22, W, T::LockRelease, RW),
+    });
+    CHECK(readers.races().empty());
+
+    // A reader that writes under the shared lock races with a later reader
+    ucdbg::RaceDetector shared_write = detect({
+        concurrency(10, A, T::SharedLockAcquire, RW, 1),
+        concurrency(11, A, T::MemoryWrite, X, 1),
+        concurrency(12, A, T::SharedLockRelease, RW),
+        concurrency(20, B, T::SharedLockAcquire, RW, 1),
+        concurrency(21, B, T::MemoryRead, X, 2),
+        concurrency(22, B, T::SharedLockRelease, RW),
+    });
+    CHECK(shared_write.races().size() == 1);
+}
+
+static void test_edges() {
+    using T = ucdbg::EventType;
+    const uint64_t P = 1, C = 2, D = 3, SPAWN = 7, SEM = 0x300, TASK = 9, X = 0x1000, Y = 0x2000;
+    ucdbg::RaceDetector detector = detect({
+        concurrency(10, P, T::MemoryWrite, X, 1),
+        concurrency(11, P, T::ThreadSpawn, SPAWN),
+        concurrency(20, C, T::ThreadStart, SPAWN),
+        concurrency(21, C, T::MemoryWrite, X, 2),
+        concurrency(22, C, T::MemoryWrite, Y, 2),
+        concurrency(23, C, T::SemaphoreRelease, SEM),
+        concurrency(24, C, T::TaskEnqueue, TASK),
+        concurrency(25, C, T::ThreadEnd, SPAWN),
+        concurrency(30, D, T::SemaphoreAcquire, SEM),
+        concurrency(31, D, T::MemoryRead, Y, 3),
+        concurrency(40, P, T::ThreadJoin, SPAWN),
+        concurrency(41, P, T::MemoryRead, X, 1),
+        concurrency(50, D, T::TaskBegin, TASK),
+        concurrency(51, D, T::MemoryRead, X, 3),
+    });
+    CHECK(detector.races().empty());
+
+    // Without the join, the parent's read races with the child's write
+    ucdbg::RaceDetector unjoined = detect({
+        concurrency(11, P, T::ThreadSpawn, SPAWN),
+        concurrency(20, C, T::ThreadStart, SPAWN),
+        concurrency(21, C, T::MemoryWrite, X, 2),
+        concurrency(25, C, T::ThreadEnd, SPAWN),
+        concurrency(41, P, T::MemoryRead, X, 1),
+    });
+    CHECK(unjoined.races().size() == 1);
+
+    // A thread ID reused after ThreadEnd is a new thread
+    ucdbg::RaceDetector reused = detect({
+        concurrency(10, C, T::ThreadStart, 0),
+        concurrency(11, C, T::MemoryWrite, X, 2),
+        concurrency(12, C, T::ThreadEnd, 0),
+        concurrency(20, C, T::ThreadStart, 0),
+        concurrency(21, C, T::MemoryWrite, X, 2),
+    });
+    CHECK(reused.thread_count() == 2 && reused.races().size() == 1);
+}
+
+static void test_counting() {
+    using T = ucdbg::EventType;
+    const uint64_t X = 0x1000;
+    std::vector<ucdbg::TraceEvent> events;
+    uint64_t ts = 0;
+    for (int i = 0; i < 100; ++i) {
+        for (uint64_t tid = 1; tid <= 16; ++tid) {
+            events.push_back(concurrency(++ts, tid, T::MemoryWrite, X, 5));
+        }
+    }
+    ucdbg::RaceDetector detector = detect(events);
+    CHECK(detector.races().size() == 1);
+    if (!detector.races().empty()) {
+        CHECK(detector.races()[0].count == 100 * 16 - 1);
+    }
+    CHECK(detector.thread_count() == 16 && detector.dropped() == 0);
+}
+
+static void test_traced_run() {
+    ucdbg::internal::tracing_active.store(true);
+    std::mutex mtx;
+    long guarded = 0, unguarded = 0;
+    auto work = [&] {
+        for (int i = 0; i < 200; ++i) {
+            {
+                UCDBG_LOCK_GUARD(mtx);
+                UCDBG_WRITE(guarded);
+                ++guarded;
+            }
+            UCDBG_WRITE(unguarded);
+        }
+    };
+    {
+        ucdbg::jthread a(work), b(work);
+    }
+    UCDBG_READ(guarded);
+    ucdbg::internal::tracing_active.store(false);
+
+    auto events = drain();
+    std::stable_sort(events.begin(), events.end(), [](const ucdbg::TraceEvent& x, const ucdbg::TraceEvent& y) {
+        return x.timestamp_ns < y.timestamp_ns;
+    });
+    ucdbg::RaceDetector detector = detect(events);
+    CHECK(detector.access_count() == 801);
+    CHECK(detector.variable_count() == 2);
+    CHECK(detector.races().size() == 1);
+    for (const auto& race : detector.races()) {
+        CHECK(race.address == reinterpret_cast<uint64_t>(&unguarded));
+        CHECK(race.previous.write && race.current.write);
+        CHECK(race.previous.thread_id != race.current.thread_id);
+        const std::string site = ucdbg::internal::StringTable::instance().strings().at(race.current.site);
+        CHECK(site.find("test_race_detector.cpp:") != std::string::npos);
+    }
+}
+
+int main() {
+    std::cout << "=== Race Detector Test ===" << std::endl;
+    test_locks();
+    test_shared_reads();
+    test_edges();
+    test_counting();
+    test_traced_run();
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All race detector checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,94 @@
+/**
+ * Scoped span and counter test
+ *
+ * This test verifies:
+ * 1. UCDBG_SCOPE emits Span Begin/End with an interned name ID
+ * 2. UCDBG_COUNTER emits Counter events with full 64-bit signed values
+ * 3. Call sites intern their name once; equal names share an ID
+ * 4. Names round-trip through the block trace's string table
+ */
+
+#include <ucdbg/ucdbg.hpp>
+#include <ucdbg/block_reader.hpp>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "test_common.hpp"
+
+static std::mutex mtx;
+
+static void handle_request(int64_t depth) {
+    UCDBG_SCOPE("handle_request");
+    UCDBG_COUNTER("queue_depth", depth);
+    {
+        UCDBG_SCOPE("critical_section");
+        UCDBG_LOCK_GUARD(mtx);
+    }
+}
+
+int main() {
+    std::cout << "=== Scope and Counter Test ===" << std::endl;
+    const char* path = "test_scope.trace";
+    if (!ucdbg::init(path)) {
+        std::cerr << "Failed to initialize tracer" << std::endl;
+        return 1;
+    }
+    for (int64_t i = 0; i < 3; ++i) {
+        handle_request(i - 1);
+    }
+    UCDBG_COUNTER("bytes", int64_t{1} << 40);
+    ucdbg::counter(ucdbg::intern("queue_depth"), -7);  // Same name, same ID
+    ucdbg::shutdown();
+
+    ucdbg::BlockTraceReader reader;
+    CHECK(reader.open(path));
+    std::vector<ucdbg::TraceEvent> events;
+    CHECK(reader.for_each_event([&](const ucdbg::TraceEvent& e) { events.push_back(e); }));
+
+    std::vector<std::string> stack;
+    std::vector<std::string> spans;
+    std::vector<int64_t> depths;
+    size_t locks_in_critical = 0;
+    for (const auto& e : events) {
+        switch (e.kind) {
+            case ucdbg::EventKind::Span:
+                if (e.span.phase == ucdbg::SpanPhase::Begin) {
+                    stack.push_back(reader.string(e.span.name_id));
+                    spans.push_back(stack.back());
+                } else {
+                    CHECK(!stack.empty() && stack.back() == reader.string(e.span.name_id));
+                    if (!stack.empty()) stack.pop_back();
+                }
+                break;
+            case ucdbg::EventKind::Counter:
+                if (reader.string(e.counter.name_id) == "queue_depth") depths.push_back(e.counter.value);
+                if (reader.string(e.counter.name_id) == "bytes") CHECK(e.counter.value == int64_t{1} << 40);
+                break;
+            case ucdbg::EventKind::Concurrency:
+                if (e.concurrency.type == ucdbg::EventType::LockAcquire) {
+                    CHECK(!stack.empty() && stack.back() == "critical_section");
+                    ++locks_in_critical;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    CHECK(stack.empty());
+    CHECK(spans.size() == 6);
+    CHECK(locks_in_critical == 3);
+    CHECK(depths == std::vector<int64_t>({-1, 0, 1, -7}));
+    // handle_request, queue_depth, critical_section, bytes: each interned once
+    CHECK(reader.strings().size() == 4);
+
+    reader.close();
+    std::remove(path);
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All scope and counter checks passed" << std::endl;
+    return 0;
+}
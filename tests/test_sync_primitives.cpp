@@ -0,0 +1,125 @@
+/**
+ * Semaphore, latch and barrier tracing test
+ *
+ * This test verifies:
+ * 1. Semaphores emit SemaphoreContended only when acquire blocks
+ * 2. Latch arrivals and waits are traced, with the update in arg
+ * 3. Barrier events carry the phase, and the straggler is the last arrival
+ * 4. Split arrive()/wait() emits BarrierWaitBegin
+ */
+
+#include <ucdbg/ucdbg.hpp>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "test_common.hpp"
+
+int main() {
+    std::cout << "=== Sync Primitives Test ===" << std::endl;
+    ucdbg::internal::tracing_active.store(true);
+
+    // Semaphore: one free acquire, one that blocks until released
+    std::vector<ucdbg::TraceEvent> events;
+    {
+        ucdbg::CountingSemaphore<4> sem(1);
+        sem.acquire();
+        CHECK(!sem.try_acquire());
+        std::thread waiter([&] { sem.acquire(); });
+        // Release only once the waiter has found the semaphore empty
+        while (count(events, ucdbg::EventType::SemaphoreContended) == 0) {
+            ucdbg::TraceEvent e;
+            if (ucdbg::internal::event_queue().try_dequeue(e)) {
+                events.push_back(e);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        sem.release(2);
+        waiter.join();
+        CHECK(sem.try_acquire());
+        CHECK(!sem.try_acquire_for(std::chrono::milliseconds(1)));
+    }
+    for (const auto& e : drain()) events.push_back(e);
+    CHECK(count(events, ucdbg::EventType::SemaphoreAcquire) == 3);
+    CHECK(count(events, ucdbg::EventType::SemaphoreContended) == 2);  // Blocking acquire + timeout
+    CHECK(count(events, ucdbg::EventType::SemaphoreRelease) == 1);
+    for (const auto& e : events) {
+        if (e.concurrency.type == ucdbg::EventType::SemaphoreRelease) CHECK(e.concurrency_arg() == 2);
+    }
+
+    // Latch: two workers count down, main waits
+    {
+        ucdbg::Latch latch(3);
+        std::thread a([&] { latch.count_down(); });
+        std::thread b([&] { latch.count_down(2); });
+        latch.wait();
+        a.join();
+        b.join();
+        CHECK(latch.try_wait());
+    }
+    events = drain();
+    CHECK(count(events, ucdbg::EventType::LatchArrive) == 2);
+    CHECK(count(events, ucdbg::EventType::LatchWaitBegin) == 1);
+    CHECK(count(events, ucdbg::EventType::LatchWaitEnd) == 1);
+
+    // Barrier: thread 0 straggles in phase 1
+    constexpr int THREADS = 3;
+    constexpr int PHASES = 3;
+    int completions = 0;
+    auto on_completion = [&completions]() noexcept { ++completions; };
+    ucdbg::Barrier<decltype(on_completion)> barrier(THREADS, on_completion);
+    std::vector<uint64_t> tids(THREADS);
+    {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < THREADS; ++t) {
+            workers.emplace_back([&, t] {
+                tids[t] = ucdbg::get_thread_id();
+                for (int phase = 0; phase < PHASES; ++phase) {
+                    if (phase == 1 && t == 0) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                    }
+                    if (t == 2) {
+                        barrier.wait(barrier.arrive());
+                    } else {
+                        barrier.arrive_and_wait();
+                    }
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+    }
+    CHECK(completions == PHASES);
+    CHECK(barrier.phase() == PHASES);
+
+    events = drain();
+    std::map<uint32_t, int> arrivals, releases;
+    std::map<uint32_t, const ucdbg::TraceEvent*> last_arrival;
+    for (const auto& e : events) {
+        CHECK(e.concurrency.lock_id == reinterpret_cast<uint64_t>(&barrier));
+        uint32_t phase = e.concurrency_arg();
+        if (e.concurrency.type == ucdbg::EventType::BarrierArrive) {
+            ++arrivals[phase];
+            if (!last_arrival[phase] || last_arrival[phase]->timestamp_ns < e.timestamp_ns) {
+                last_arrival[phase] = &e;
+            }
+        }
+        if (e.concurrency.type == ucdbg::EventType::BarrierWaitEnd) ++releases[phase];
+    }
+    for (uint32_t phase = 0; phase < PHASES; ++phase) {
+        CHECK(arrivals[phase] == THREADS);
+        CHECK(releases[phase] == THREADS);
+    }
+    CHECK(last_arrival[1] && last_arrival[1]->thread_id == tids[0]);
+    CHECK(count(events, ucdbg::EventType::BarrierWaitBegin) == PHASES);
+
+    ucdbg::internal::tracing_active.store(false);
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All sync primitive checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * Thread-pool task tracing test
+ *
+ * This test verifies:
+ * 1. traced_task emits TaskEnqueue at submit time with a unique task ID
+ * 2. Execution is bracketed by TaskBegin/TaskEnd on the worker thread
+ * 3. Lock events issued by a task fall between its TaskBegin and TaskEnd
+ * 4. The tag travels with every task event and return values pass through
+ * 5. Task IDs stay unique when a thread ID is reused
+ */
+
+#include <ucdbg/ucdbg.hpp>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "test_common.hpp"
+
+// Minimal std::function pool, as most pools are
+class Pool {
+public:
+    explicit Pool(int threads) {
+        for (int i = 0; i < threads; ++i) {
+            workers_.emplace_back([this] {
+                for (;;) {
+                    std::function<void()> job;
+                    {
+                        std::unique_lock<std::mutex> lock(mtx_);
+                        cv_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+                        if (jobs_.empty()) return;
+                        job = std::move(jobs_.front());
+                        jobs_.pop_front();
+                    }
+                    job();
+                }
+            });
+        }
+    }
+
+    ~Pool() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& w : workers_) w.join();
+    }
+
+    void submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            jobs_.push_back(std::move(job));
+        }
+        cv_.notify_one();
+    }
+
+private:
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> jobs_;
+    std::vector<std::thread> workers_;
+    bool stop_ = false;
+};
+
+static void test_reused_thread_id() {
+    std::vector<ucdbg::task_id_t> ids;
+    if (!run_on_reused_thread_id([&] { ids.push_back(ucdbg::traced_task([] {}).id()); })) {
+        std::cout << "Thread ID not reused, skipping" << std::endl;
+        return;
+    }
+    CHECK(ids.size() == 2);
+    CHECK(ids[0] != ids[1]);
+}
+
+int main() {
+    std::cout << "=== Task Tracing Test ===" << std::endl;
+    ucdbg::internal::tracing_active.store(true);
+
+    constexpr int TASKS = 64;
+    constexpr uint32_t TAG = 7;
+    std::mutex shared;
+    uint64_t shared_id = reinterpret_cast<uint64_t>(&shared);
+    int total = 0;
+    {
+        Pool pool(4);
+        for (int i = 0; i < TASKS; ++i) {
+            pool.submit(ucdbg::traced_task([&] {
+                UCDBG_LOCK_GUARD(shared);
+                ++total;
+            }, TAG));
+        }
+    }
+    CHECK(total == TASKS);
+
+    auto events = drain();
+
+    uint64_t main_tid = ucdbg::get_thread_id();
+    std::set<uint64_t> enqueued;
+    std::map<uint64_t, uint64_t> running;  // worker thread -> task currently running
+    std::map<uint64_t, int> locks_in_task;
+    size_t begins = 0, ends = 0;
+    // Per-thread order is preserved, so the scan below sees each worker's events in order
+    for (const auto& ev : events) {
+        switch (ev.concurrency.type) {
+            case ucdbg::EventType::TaskEnqueue:
+                CHECK(ev.thread_id == main_tid);
+                CHECK(ev.concurrency_arg() == TAG);
+                CHECK(enqueued.insert(ev.concurrency.lock_id).second);
+                break;
+            case ucdbg::EventType::TaskBegin:
+                ++begins;
+                CHECK(ev.thread_id != main_tid);
+                CHECK(ev.concurrency_arg() == TAG);
+                CHECK(!running.count(ev.thread_id));
+                running[ev.thread_id] = ev.concurrency.lock_id;
+                break;
+            case ucdbg::EventType::TaskEnd:
+                ++ends;
+                CHECK(running[ev.thread_id] == ev.concurrency.lock_id);
+                running.erase(ev.thread_id);
+                break;
+            case ucdbg::EventType::LockAcquire:
+                if (ev.concurrency.lock_id == shared_id) {
+                    CHECK(running.count(ev.thread_id) == 1);
+                    ++locks_in_task[running[ev.thread_id]];
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    CHECK(enqueued.size() == TASKS);
+    CHECK(begins == TASKS && ends == TASKS);
+    CHECK(locks_in_task.size() == TASKS);
+    for (const auto& [id, n] : locks_in_task) {
+        CHECK(enqueued.count(id) == 1);
+        CHECK(n == 1);
+    }
+
+    // Direct invocation with arguments and a result
+    auto square = ucdbg::traced_task([](int x) { return x * x; });
+    CHECK(square(9) == 81);
+    CHECK(square.id() != 0);
+
+    ucdbg::internal::tracing_active.store(false);
+    test_reused_thread_id();
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All task tracing checks passed" << std::endl;
+    return 0;
+}
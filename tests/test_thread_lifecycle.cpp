@@ -0,0 +1,171 @@
+/**
+ * Thread lifecycle capture test
+ *
+ * This test verifies:
+ * 1. Without automatic mode, threads without UCDBG_THREAD_START emit no lifecycle events
+ * 2. Automatic mode brackets a thread's events with ThreadStart/ThreadEnd
+ * 3. UCDBG_THREAD_START and automatic mode do not double-count a thread,
+ *    and a second UCDBG_THREAD_START after the first has ended emits again
+ * 4. ucdbg::jthread traces its thread and passes the stop token through,
+ *    and the spawning thread records ThreadSpawn/ThreadJoin with the same
+ *    spawn ID as the worker's ThreadStart/ThreadEnd, also across swaps
+ * 5. Spawn IDs stay unique when the spawning thread's ID is reused
+ */
+
+#include <ucdbg/ucdbg.hpp>
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "test_common.hpp"
+
+using ucdbg::EventType;
+
+// Types of the events captured straight from the queue
+static std::vector<EventType> drain_types() {
+    std::vector<EventType> types;
+    ucdbg::TraceEvent e;
+    while (ucdbg::internal::event_queue().try_dequeue(e)) types.push_back(e.concurrency.type);
+    return types;
+}
+
+static std::vector<EventType> types_of(const std::vector<ucdbg::TraceEvent>& events, ucdbg::thread_id_t tid) {
+    std::vector<EventType> types;
+    for (const auto& e : events) {
+        if (e.thread_id == tid) types.push_back(e.concurrency.type);
+    }
+    return types;
+}
+
+static std::mutex mtx;
+
+static void lock_twice() {
+    { UCDBG_LOCK_GUARD(mtx); }
+    { UCDBG_LOCK_GUARD(mtx); }
+}
+
+int main() {
+    std::cout << "=== Thread Lifecycle Test ===" << std::endl;
+    ucdbg::internal::tracing_active.store(true);
+
+    // Manual mode: no lifecycle events unless asked for
+    std::thread(lock_twice).join();
+    CHECK(drain_types() == std::vector<EventType>({EventType::LockAcquire, EventType::LockRelease,
+                                                   EventType::LockAcquire, EventType::LockRelease}));
+
+    // Automatic mode
+    ucdbg::set_auto_thread_events(true);
+    std::thread(lock_twice).join();
+    CHECK(drain_types() == std::vector<EventType>({EventType::ThreadStart, EventType::LockAcquire,
+                                                   EventType::LockRelease, EventType::LockAcquire,
+                                                   EventType::LockRelease, EventType::ThreadEnd}));
+
+    // Many short-lived threads, each registered exactly once
+    for (int i = 0; i < 50; ++i) {
+        std::thread(lock_twice).join();
+    }
+    auto types = drain_types();
+    CHECK(types.size() == 50 * 6);
+    size_t starts = 0, ends = 0;
+    for (EventType t : types) {
+        starts += t == EventType::ThreadStart;
+        ends += t == EventType::ThreadEnd;
+    }
+    CHECK(starts == 50 && ends == 50);
+
+    // Explicit guard in automatic mode: one ThreadStart, ended by the guard
+    std::thread([] {
+        UCDBG_THREAD_START();
+        lock_twice();
+    }).join();
+    CHECK(drain_types() == std::vector<EventType>({EventType::ThreadStart, EventType::LockAcquire,
+                                                   EventType::LockRelease, EventType::LockAcquire,
+                                                   EventType::LockRelease, EventType::ThreadEnd}));
+    ucdbg::set_auto_thread_events(false);
+
+    // Consecutive guards on one thread each bracket their own scope
+    std::thread([] {
+        { UCDBG_THREAD_START(); }
+        { UCDBG_THREAD_START(); }
+    }).join();
+    CHECK(drain_types() == std::vector<EventType>({EventType::ThreadStart, EventType::ThreadEnd,
+                                                   EventType::ThreadStart, EventType::ThreadEnd}));
+
+    // jthread: traced without automatic mode; stop token reaches the callable
+    bool saw_stop = false;
+    {
+        ucdbg::jthread worker([&](std::stop_token stop, int rounds) {
+            for (int i = 0; i < rounds; ++i) lock_twice();
+            while (!stop.stop_requested()) std::this_thread::yield();
+            saw_stop = true;
+        }, 1);
+    }  // Destructor requests stop and joins
+    CHECK(saw_stop);
+    const ucdbg::thread_id_t self = ucdbg::get_thread_id();
+    auto events = drain();
+    CHECK(types_of(events, self) == std::vector<EventType>({EventType::ThreadSpawn, EventType::ThreadJoin}));
+    ucdbg::thread_id_t worker_tid = 0;
+    for (const auto& e : events) {
+        if (e.thread_id != self) worker_tid = e.thread_id;
+    }
+    CHECK(types_of(events, worker_tid) == std::vector<EventType>({EventType::ThreadStart, EventType::LockAcquire,
+                                                                  EventType::LockRelease, EventType::LockAcquire,
+                                                                  EventType::LockRelease, EventType::ThreadEnd}));
+    CHECK(events.size() == 8);
+    uint64_t spawn_id = 0;
+    for (const auto& e : events) {
+        if (e.concurrency.type == EventType::ThreadSpawn) spawn_id = e.concurrency.lock_id;
+    }
+    CHECK(spawn_id != 0);
+    for (const auto& e : events) {
+        if (e.concurrency.type == EventType::ThreadSpawn || e.concurrency.type == EventType::ThreadJoin ||
+            e.concurrency.type == EventType::ThreadStart || e.concurrency.type == EventType::ThreadEnd) {
+            CHECK(e.concurrency.lock_id == spawn_id);
+        }
+    }
+
+    ucdbg::jthread plain(lock_twice);
+    plain.join();
+    CHECK(drain_types().size() == 8);
+
+    // Swapped jthreads keep each thread's spawn ID with it, so joins pair up
+    {
+        ucdbg::jthread a(lock_twice), b(lock_twice);
+        swap(a, b);
+        a.join();
+        std::swap(a, b);
+        a.join();
+        CHECK(!b.joinable());
+    }
+    events = drain();
+    std::vector<uint64_t> started, joined;
+    for (const auto& e : events) {
+        if (e.concurrency.type == EventType::ThreadStart) started.push_back(e.concurrency.lock_id);
+        if (e.concurrency.type == EventType::ThreadJoin) joined.push_back(e.concurrency.lock_id);
+    }
+    std::sort(started.begin(), started.end());
+    std::sort(joined.begin(), joined.end());
+    CHECK(started.size() == 2 && started == joined);
+
+    // Spawning threads that share a thread ID still get distinct spawn IDs
+    if (run_on_reused_thread_id([] { ucdbg::jthread(lock_twice).join(); })) {
+        std::vector<uint64_t> spawned;
+        for (const auto& e : drain()) {
+            if (e.concurrency.type == EventType::ThreadSpawn) spawned.push_back(e.concurrency.lock_id);
+        }
+        CHECK(spawned.size() == 2);
+        CHECK(spawned.size() == 2 && spawned[0] != spawned[1]);
+    } else {
+        drain();
+        std::cout << "Thread ID not reused, skipping" << std::endl;
+    }
+
+    ucdbg::internal::tracing_active.store(false);
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All thread lifecycle checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,112 @@
+/**
+ * Memory-mapped TraceReader test
+ *
+ * This test verifies:
+ * 1. Raw record files are exposed without copies (references into the mapping)
+ * 2. Views skip records that fail TraceEvent::is_valid()
+ * 3. Thread, kind and time range filters select the right events
+ * 4. The ordered block merge produces globally time-sorted output
+ */
+
+#include <ucdbg/trace_reader.hpp>
+#include <ucdbg/block_reader.hpp>
+#include <ucdbg/block_writer.hpp>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "test_common.hpp"
+
+static ucdbg::TraceEvent make_event(uint64_t ts, uint64_t tid, ucdbg::EventKind kind) {
+    ucdbg::TraceEvent e;
+    std::memset(&e, 0, sizeof(e));
+    e.timestamp_ns = ts;
+    e.thread_id = tid;
+    e.format_version = ucdbg::TRACE_FORMAT_VERSION;
+    e.kind = kind;
+    e.concurrency.type = ucdbg::EventType::LockAcquire;
+    e.concurrency.lock_id = ts * 3;
+    return e;
+}
+
+int main() {
+    std::cout << "=== TraceReader Test ===" << std::endl;
+    const char* raw_path = "/tmp/ucdbg_test_reader.raw";
+    const char* block_path = "/tmp/ucdbg_test_reader.trace";
+
+    std::vector<ucdbg::TraceEvent> events;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        events.push_back(make_event(100 + i, 1 + i % 4, i % 10 ? ucdbg::EventKind::Concurrency : ucdbg::EventKind::Log));
+    }
+    events[500].format_version = ucdbg::TRACE_FORMAT_VERSION + 1;  // From a newer writer
+
+    std::FILE* file = std::fopen(raw_path, "wb");
+    for (const auto& e : events) {
+        uint8_t record[sizeof(e)];
+        e.serialize_to(record);
+        std::fwrite(record, 1, sizeof(record), file);
+    }
+    std::fwrite("xx", 1, 2, file);  // Torn trailing record
+    std::fclose(file);
+
+    ucdbg::TraceReader reader;
+    CHECK(reader.open(raw_path));
+    CHECK(reader.size() == events.size());
+    CHECK(std::memcmp(&reader[10], &events[10], sizeof(ucdbg::TraceEvent)) == 0);
+    CHECK(reader.view().count() == events.size() - 1);
+
+    ucdbg::TraceFilter filter;
+    filter.thread_id = 2;
+    size_t thread_two = 0;
+    for (const ucdbg::TraceEvent& e : reader.view(filter)) {
+        CHECK(e.thread_id == 2);
+        CHECK(&e >= reader.events().data() && &e < reader.events().data() + reader.size());
+        ++thread_two;
+    }
+    CHECK(thread_two == 250);
+
+    filter = {};
+    filter.kind = ucdbg::EventKind::Log;
+    CHECK(reader.view(filter).count() == 99);  // Event 500 is invalid
+
+    filter = {};
+    filter.begin = 200;
+    filter.end = 299;
+    CHECK(reader.view(filter).count() == 100);
+
+    filter.thread_id = 1;
+    filter.kind = ucdbg::EventKind::Log;
+    CHECK(reader.view(filter).count() == 5);
+    reader.close();
+
+    CHECK(reader.open("/tmp/ucdbg_test_reader_missing.raw") == false);
+
+    // Per-thread blocks merged back into global time order
+    {
+        ucdbg::BlockTraceWriter writer(64);
+        CHECK(writer.open(block_path));
+        for (const auto& e : events) writer.append(e);
+        writer.close();
+    }
+    ucdbg::BlockTraceReader blocks;
+    CHECK(blocks.open(block_path));
+    std::vector<uint64_t> order;
+    CHECK(blocks.for_each_event_ordered([&](const ucdbg::TraceEvent& e) { order.push_back(e.timestamp_ns); }));
+    CHECK(order.size() == events.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (order[i] != events[i].timestamp_ns) {
+            CHECK(order[i] == events[i].timestamp_ns);
+            break;
+        }
+    }
+
+    std::remove(raw_path);
+    std::remove(block_path);
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All TraceReader checks passed" << std::endl;
+    return 0;
+}
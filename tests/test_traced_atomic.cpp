@@ -0,0 +1,207 @@
+/**
+ * traced_atomic contention counter test
+ *
+ * This test verifies:
+ * 1. Operations are aggregated per address, not emitted per operation
+ * 2. CAS failures and the longest retry run are counted
+ * 3. Writes alternating between threads count as ownership changes
+ * 4. Counters are flushed at thread exit and every ATOMIC_FLUSH_OPS operations
+ * 5. Counters of idle threads are collected on their behalf, once, and a
+ *    traced run includes those of threads still running at shutdown
+ * 6. Collected records do not break the owner's timestamp order in the trace
+ */
+
+#include <ucdbg/ucdbg.hpp>
+#include <ucdbg/block_reader.hpp>
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "test_common.hpp"
+
+// Sum of the counter events of one type for address
+static uint64_t total(const std::vector<ucdbg::TraceEvent>& events, ucdbg::EventType type, const void* address) {
+    uint64_t sum = 0;
+    for (const auto& e : events) {
+        if (e.concurrency.type == type && e.concurrency.lock_id == reinterpret_cast<uint64_t>(address)) {
+            sum += e.concurrency_arg();
+        }
+    }
+    return sum;
+}
+
+static void flush() {
+    ucdbg::internal::AtomicStats::local().flush();
+}
+
+// A thread that counts ops on address, then stays alive until released
+struct IdleWorker {
+    IdleWorker(ucdbg::traced_atomic<int>& target, int ops) {
+        thread = std::thread([&target, ops, this] {
+            for (int i = 0; i < ops; ++i) ++target;
+            tid.store(ucdbg::get_thread_id());
+            while (!release.load()) std::this_thread::yield();
+        });
+        while (!tid.load()) std::this_thread::yield();
+    }
+
+    ~IdleWorker() {
+        release.store(true);
+        thread.join();
+    }
+
+    std::atomic<ucdbg::thread_id_t> tid{0};
+    std::atomic<bool> release{false};
+    std::thread thread;
+};
+
+static void test_idle_threads() {
+    ucdbg::traced_atomic<int> shared{0};
+    ucdbg::thread_id_t worker_tid;
+    {
+        IdleWorker worker(shared, 40);
+        worker_tid = worker.tid.load();
+        auto records = ucdbg::internal::AtomicStatsRegistry::instance().collect();
+        CHECK(total(records, ucdbg::EventType::AtomicOps, &shared) == 40);
+        // Stamped on the collecting thread, after a record naming the owner
+        ucdbg::thread_id_t owner = 0;
+        for (const auto& e : records) {
+            CHECK(e.thread_id == ucdbg::get_thread_id());
+            if (e.concurrency.type == ucdbg::EventType::AtomicCounterOwner) owner = e.concurrency.lock_id;
+            if (e.concurrency.lock_id == reinterpret_cast<uint64_t>(&shared)) CHECK(owner == worker_tid);
+        }
+        records = ucdbg::internal::AtomicStatsRegistry::instance().collect();
+        CHECK(total(records, ucdbg::EventType::AtomicOps, &shared) == 0);
+    }
+    // Already reported: nothing more at thread exit
+    CHECK(total(drain(), ucdbg::EventType::AtomicOps, &shared) == 0);
+
+    const char* path = "/tmp/ucdbg_test_traced_atomic.trace";
+    CHECK(UCDBG_INIT(path));
+    {
+        IdleWorker worker(shared, 25);
+        ucdbg::shutdown();
+    }
+    ucdbg::BlockTraceReader reader;
+    CHECK(reader.open(path));
+    std::vector<ucdbg::TraceEvent> events;
+    CHECK(reader.for_each_event_ordered([&](const ucdbg::TraceEvent& e) { events.push_back(e); }));
+    CHECK(total(events, ucdbg::EventType::AtomicOps, &shared) == 25);
+    std::remove(path);
+}
+
+// A thread keeps emitting lock events while the drain thread collects its counters
+static void test_collection_order() {
+    const char* path = "/tmp/ucdbg_test_traced_atomic_order.trace";
+    ucdbg::traced_atomic<int> shared{0};
+    std::mutex mtx;
+    std::atomic<bool> stop{false};
+    std::atomic<ucdbg::thread_id_t> worker_tid{0};
+    CHECK(UCDBG_INIT(path));
+    std::thread worker([&] {
+        worker_tid.store(ucdbg::get_thread_id());
+        while (!stop.load()) {
+            ++shared;
+            UCDBG_LOCK_GUARD(mtx);
+        }
+    });
+    std::this_thread::sleep_for(ucdbg::internal::TracerImpl::LOCK_SUMMARY_INTERVAL + std::chrono::milliseconds(200));
+    ucdbg::shutdown();  // Final collection while the worker still runs
+    stop.store(true);
+    worker.join();
+
+    ucdbg::BlockTraceReader reader;
+    CHECK(reader.open(path));
+    std::unordered_map<ucdbg::thread_id_t, ucdbg::timestamp_t> last;
+    size_t inversions = 0, owners = 0;
+    CHECK(reader.for_each_event([&](const ucdbg::TraceEvent& e) {
+        inversions += e.timestamp_ns < last[e.thread_id];
+        last[e.thread_id] = e.timestamp_ns;
+        owners += e.concurrency.type == ucdbg::EventType::AtomicCounterOwner &&
+                  e.concurrency.lock_id == worker_tid.load();
+    }));
+    CHECK(inversions == 0);
+    CHECK(owners >= 1);
+    for (const auto& block : reader.blocks()) CHECK(block.first_ts <= block.last_ts);
+    std::remove(path);
+}
+
+int main() {
+    std::cout << "=== Traced Atomic Test ===" << std::endl;
+    ucdbg::internal::tracing_active.store(true);
+
+    // Uncontended: ops aggregated into a single event
+    ucdbg::traced_atomic<uint64_t> counter{0};
+    for (int i = 0; i < 100; ++i) {
+        ++counter;
+    }
+    CHECK(counter.load() == 100);
+    CHECK(drain().empty());
+    flush();
+    auto events = drain();
+    CHECK(events.size() == 1);
+    CHECK(total(events, ucdbg::EventType::AtomicOps, &counter) == 101);
+
+    // CAS failures: three stale expectations, then success
+    uint64_t stale = 7;
+    for (int i = 0; i < 3; ++i) {
+        CHECK(!counter.compare_exchange_strong(stale, 0));
+        stale = 7;
+    }
+    uint64_t expected = 100;
+    CHECK(counter.compare_exchange_strong(expected, 200));
+    stale = 7;
+    CHECK(!counter.compare_exchange_weak(stale, 0));
+    expected = 200;
+    CHECK(counter.compare_exchange_weak(expected, 300));
+    flush();
+    events = drain();
+    CHECK(total(events, ucdbg::EventType::AtomicOps, &counter) == 6);
+    CHECK(total(events, ucdbg::EventType::AtomicCasFailures, &counter) == 4);
+    CHECK(total(events, ucdbg::EventType::AtomicMaxRetries, &counter) == 3);
+    CHECK(total(events, ucdbg::EventType::AtomicOwnerChanges, &counter) == 0);
+
+    // Ping-pong: two threads take turns writing, counters flushed at thread exit
+    constexpr int ROUNDS = 50;
+    ucdbg::traced_atomic<int> ball{0};
+    std::atomic<int> turn{0};
+    auto player = [&](int me) {
+        for (int i = 0; i < ROUNDS; ++i) {
+            while (turn.load() != me) std::this_thread::yield();
+            ball.store(i);
+            turn.store(1 - me);
+        }
+    };
+    std::thread a(player, 0);
+    std::thread b(player, 1);
+    a.join();
+    b.join();
+    events = drain();
+    CHECK(total(events, ucdbg::EventType::AtomicOps, &ball) == 2 * ROUNDS);
+    CHECK(total(events, ucdbg::EventType::AtomicOwnerChanges, &ball) == 2 * ROUNDS - 1);
+
+    // Long runs are split into intervals that stay within the 24-bit arg
+    constexpr uint32_t OPS = 3 * ucdbg::internal::AtomicStats::ATOMIC_FLUSH_OPS + 5;
+    ucdbg::traced_atomic<uint32_t> busy{0};
+    for (uint32_t i = 0; i < OPS; ++i) {
+        busy.fetch_add(1, std::memory_order_relaxed);
+    }
+    CHECK(drain().size() == 3);
+    flush();
+    events = drain();
+    CHECK(total(events, ucdbg::EventType::AtomicOps, &busy) == OPS - 3 * ucdbg::internal::AtomicStats::ATOMIC_FLUSH_OPS);
+
+    ucdbg::internal::tracing_active.store(false);
+    test_idle_threads();
+    test_collection_order();
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All traced atomic checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,457 @@
+/**
+ * ucdbg-analyze - Lock contention report for a block trace
+ *
+ * Usage: ucdbg-analyze [--top N] [--sort wait|hold|acquisitions] [--jobs N] [--by-class] <input.trace>
+ *        ucdbg-analyze --critical-path TID [--from NS] [--to NS] [--top N] <input.trace>
+ *        ucdbg-analyze --races [--top N] <input.trace>
+ *        ucdbg-analyze --coroutines [--top N] <input.trace>
+ *
+ * Analyzes the trace (LockAnalyzer) in time slices on every core, or in one
+ * timestamp-ordered streaming pass with --jobs 1, and prints, per lock_id,
+ * acquisition/contention/handoff counts, distinct threads and hold/wait
+ * time totals and percentiles, the time each thread spent blocked, and
+ * lock pairs taken in both orders. Hold/wait histograms the traced process
+ * recorded itself (set_lock_histograms) are reported in their own table.
+ * With --by-class, locks whose guards named a lock class are reported per
+ * class (LockClassAnalyzer); classes are listed by name either way.
+ *
+ * --critical-path instead follows thread TID's critical path back through
+ * lock handoffs, notifies, task and flow edges (CriticalPathAnalyzer) and
+ * charges its time to threads and locks.
+ *
+ * --races replays the trace through the happens-before race detector
+ * (RaceDetector) and lists conflicting accesses to annotated variables
+ * (UCDBG_READ/UCDBG_WRITE) that no lock or other edge orders.
+ *
+ * --coroutines pairs each coroutine's CoroSuspend with its CoroResume
+ * (CoroutineAnalyzer) and reports resume latency and thread migrations per
+ * awaiter, named from the string table.
+ */
+
+#include <ucdbg/block_reader.hpp>
+#include <ucdbg/coroutine_analysis.hpp>
+#include <ucdbg/critical_path.hpp>
+#include <ucdbg/lock_analysis.hpp>
+#include <ucdbg/memory_access.hpp>
+#include <ucdbg/parallel_analysis.hpp>
+#include <ucdbg/race_detector.hpp>
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Events read before a critical-path window, so waits already in progress at its start are seen
+constexpr uint64_t CRITICAL_PATH_LEAD_IN_NS = 1000000000;
+
+static int usage() {
+    std::cerr << "Usage: ucdbg-analyze [--top N] [--sort wait|hold|acquisitions] [--jobs N] [--by-class] <input.trace>\n"
+              << "       ucdbg-analyze --critical-path TID [--from NS] [--to NS] [--top N] <input.trace>\n"
+              << "       ucdbg-analyze --races [--top N] <input.trace>\n"
+              << "       ucdbg-analyze --coroutines [--top N] <input.trace>\n"
+              << "  --top N     Locks and threads to list (default 20, 0 = all)\n"
+              << "  --sort KEY  Lock order: total wait (default), total hold or acquisitions\n"
+              << "  --jobs N    Analysis threads (default: all cores; 1 = single streaming pass)\n"
+              << "  --by-class  Group locks by lock class (UCDBG_LOCK_GUARD_CLASS)\n"
+              << "  --critical-path TID  Critical path of a thread, charged to threads and locks\n"
+              << "  --from/--to NS       Its window in ns from the start of the trace (default: the thread's lifetime)\n"
+              << "  --races     Data races between annotated accesses (UCDBG_READ/UCDBG_WRITE)\n"
+              << "  --coroutines  Coroutine resume latency per awaiter (ucdbg::traced_await)\n";
+    return 2;
+}
+
+// Duration with a unit, e.g. "1.25ms"
+static std::string format_ns(uint64_t ns) {
+    char text[32];
+    if (ns < 1000) {
+        std::snprintf(text, sizeof(text), "%" PRIu64 "ns", ns);
+    } else if (ns < 1000000) {
+        std::snprintf(text, sizeof(text), "%.2fus", ns / 1e3);
+    } else if (ns < 1000000000) {
+        std::snprintf(text, sizeof(text), "%.2fms", ns / 1e6);
+    } else {
+        std::snprintf(text, sizeof(text), "%.2fs", ns / 1e9);
+    }
+    return text;
+}
+
+// Runs a lock analyzer over the whole trace, in one ordered pass or in parallel slices
+template <class Analyzer>
+static bool analyze(const ucdbg::BlockTraceReader& reader, Analyzer& analyzer, unsigned jobs) {
+    return jobs == 1 ? reader.for_each_event_ordered([&](const ucdbg::TraceEvent& e) { analyzer.add(e); })
+                     : ucdbg::analyze_parallel(reader, analyzer, jobs);
+}
+
+// Lock ID in hex, or the name of a lock class (lock_class_key)
+static std::string lock_label(const ucdbg::LockAnalyzer& analyzer, const ucdbg::BlockTraceReader& reader,
+                              ucdbg::lock_id_t id) {
+    auto name = analyzer.lock_classes().find(id);
+    if (name != analyzer.lock_classes().end()) {
+        return reader.string(name->second);
+    }
+    char text[24];
+    std::snprintf(text, sizeof(text), "0x%" PRIx64, id);
+    return text;
+}
+
+static void print_locks(const ucdbg::LockAnalyzer& analyzer, const ucdbg::BlockTraceReader& reader, size_t top,
+                        const std::string& sort) {
+    std::vector<std::pair<ucdbg::lock_id_t, const ucdbg::LockStats*>> locks;
+    for (const auto& [id, stats] : analyzer.locks()) {
+        // Locks seen only in summary records go to print_summaries
+        if (stats.acquisitions || stats.wait_ns.count()) {
+            locks.emplace_back(id, &stats);
+        }
+    }
+    size_t total = locks.size();
+    auto key = [&](const ucdbg::LockStats& s) {
+        return sort == "hold" ? s.hold_ns.sum() : sort == "acquisitions" ? s.acquisitions : s.wait_ns.sum();
+    };
+    std::sort(locks.begin(), locks.end(), [&](const auto& a, const auto& b) {
+        return key(*a.second) != key(*b.second) ? key(*a.second) > key(*b.second) : a.first < b.first;
+    });
+    if (top && locks.size() > top) {
+        locks.resize(top);
+    }
+
+    std::printf("Locks (%zu, by %s):\n", total,
+                sort == "hold" ? "total hold" : sort == "acquisitions" ? "acquisitions" : "total wait");
+    std::printf("%-18s %10s %8s %9s %9s %7s %10s %9s %9s %9s %10s %9s %9s %9s\n", "lock_id", "acquires",
+                "shared", "contended", "handoffs", "threads", "hold_total", "hold_p50", "hold_p99", "hold_max",
+                "wait_total", "wait_p50", "wait_p99", "wait_max");
+    for (const auto& [id, s] : locks) {
+        std::printf("%-18.18s %10" PRIu64 " %8" PRIu64 " %9" PRIu64 " %9" PRIu64 " %7zu %10s %9s %9s %9s "
+                    "%10s %9s %9s %9s\n",
+                    lock_label(analyzer, reader, id).c_str(), s->acquisitions, s->shared_acquisitions, s->contentions, s->handoffs, s->threads.size(),
+                    format_ns(s->hold_ns.sum()).c_str(), format_ns(s->hold_ns.percentile(0.5)).c_str(),
+                    format_ns(s->hold_ns.percentile(0.99)).c_str(), format_ns(s->hold_ns.max()).c_str(),
+                    format_ns(s->wait_ns.sum()).c_str(), format_ns(s->wait_ns.percentile(0.5)).c_str(),
+                    format_ns(s->wait_ns.percentile(0.99)).c_str(), format_ns(s->wait_ns.max()).c_str());
+    }
+}
+
+// Hold/wait histograms recorded in-process (LockHoldHistogram/LockWaitHistogram records)
+static void print_summaries(const ucdbg::LockAnalyzer& analyzer, const ucdbg::BlockTraceReader& reader, size_t top,
+                            const std::string& sort) {
+    std::vector<std::pair<ucdbg::lock_id_t, const ucdbg::LockStats*>> locks;
+    for (const auto& [id, stats] : analyzer.locks()) {
+        if (stats.summary_hold_ns.count() || stats.summary_wait_ns.count()) {
+            locks.emplace_back(id, &stats);
+        }
+    }
+    if (locks.empty()) {
+        return;
+    }
+    size_t total = locks.size();
+    auto key = [&](const ucdbg::LockStats& s) {
+        return sort == "hold"           ? s.summary_hold_ns.sum()
+               : sort == "acquisitions" ? s.summary_hold_ns.count()
+                                        : s.summary_wait_ns.sum();
+    };
+    std::sort(locks.begin(), locks.end(), [&](const auto& a, const auto& b) {
+        return key(*a.second) != key(*b.second) ? key(*a.second) > key(*b.second) : a.first < b.first;
+    });
+    if (top && locks.size() > top) {
+        locks.resize(top);
+    }
+
+    std::printf("\nIn-process lock latency (%zu locks, from summary records):\n", total);
+    std::printf("%-18s %10s %9s %9s %9s %9s %10s %9s %9s %9s %9s\n", "lock_id", "holds", "hold_p50", "hold_p99",
+                "hold_p999", "hold_max", "waits", "wait_p50", "wait_p99", "wait_p999", "wait_max");
+    for (const auto& [id, s] : locks) {
+        const ucdbg::LatencyHistogram& hold = s->summary_hold_ns;
+        const ucdbg::LatencyHistogram& wait = s->summary_wait_ns;
+        std::printf("%-18.18s %10" PRIu64 " %9s %9s %9s %9s %10" PRIu64 " %9s %9s %9s %9s\n",
+                    lock_label(analyzer, reader, id).c_str(), hold.count(), format_ns(hold.percentile(0.5)).c_str(), format_ns(hold.percentile(0.99)).c_str(),
+                    format_ns(hold.percentile(0.999)).c_str(), format_ns(hold.max()).c_str(), wait.count(),
+                    format_ns(wait.percentile(0.5)).c_str(), format_ns(wait.percentile(0.99)).c_str(),
+                    format_ns(wait.percentile(0.999)).c_str(), format_ns(wait.max()).c_str());
+    }
+}
+
+static void print_threads(const ucdbg::LockAnalyzer& analyzer, const ucdbg::BlockTraceReader& reader, size_t top) {
+    std::vector<std::pair<ucdbg::thread_id_t, const ucdbg::ThreadBlockedStats*>> threads;
+    for (const auto& [tid, stats] : analyzer.threads()) {
+        threads.emplace_back(tid, &stats);
+    }
+    std::sort(threads.begin(), threads.end(), [](const auto& a, const auto& b) {
+        return a.second->blocked_ns() != b.second->blocked_ns() ? a.second->blocked_ns() > b.second->blocked_ns()
+                                                                : a.first < b.first;
+    });
+    if (top && threads.size() > top) {
+        threads.resize(top);
+    }
+
+    std::printf("\nThreads (%zu, by time blocked):\n", analyzer.threads().size());
+    std::printf("%-10s %-16s %10s %7s %10s %8s %10s %8s %10s %8s\n", "tid", "name", "blocked", "of_life",
+                "lock_wait", "count", "cond_wait", "count", "sync_wait", "count");
+    for (const auto& [tid, s] : threads) {
+        auto name = reader.thread_names().find(tid);
+        uint64_t lifetime = s->last_ts - s->first_ts;
+        double share = lifetime ? 100.0 * static_cast<double>(s->blocked_ns()) / static_cast<double>(lifetime) : 0.0;
+        std::printf("%-10" PRIu64 " %-16.16s %10s %6.1f%% %10s %8" PRIu64 " %10s %8" PRIu64 " %10s %8" PRIu64 "\n",
+                    tid, name == reader.thread_names().end() ? "-" : name->second.c_str(),
+                    format_ns(s->blocked_ns()).c_str(), share, format_ns(s->lock_wait_ns).c_str(), s->lock_waits,
+                    format_ns(s->cond_wait_ns).c_str(), s->cond_waits, format_ns(s->sync_wait_ns).c_str(),
+                    s->sync_waits);
+    }
+}
+
+// Lock pairs acquired in both orders: each is a potential deadlock
+static void print_inversions(const ucdbg::LockAnalyzer& analyzer, const ucdbg::BlockTraceReader& reader, size_t top) {
+    std::vector<ucdbg::LockOrderEdge> inversions;
+    for (const auto& [held, acquired] : analyzer.lock_order()) {
+        if (held < acquired && analyzer.lock_order().count({acquired, held})) {
+            inversions.emplace_back(held, acquired);
+        }
+    }
+    std::sort(inversions.begin(), inversions.end());
+    std::printf("\nLock order: %zu edges, %zu inversions\n", analyzer.lock_order().size(), inversions.size());
+    for (size_t i = 0; i < inversions.size() && (!top || i < top); ++i) {
+        std::printf("%s <-> %s\n", lock_label(analyzer, reader, inversions[i].first).c_str(),
+                    lock_label(analyzer, reader, inversions[i].second).c_str());
+    }
+}
+
+static std::string thread_label(const ucdbg::BlockTraceReader& reader, ucdbg::thread_id_t tid) {
+    auto name = reader.thread_names().find(tid);
+    return std::to_string(tid) + (name == reader.thread_names().end() ? "" : " (" + name->second + ")");
+}
+
+static int print_critical_path(const ucdbg::BlockTraceReader& reader, ucdbg::thread_id_t tid, uint64_t from,
+                               uint64_t to, size_t top) {
+    ucdbg::timestamp_t start = UINT64_MAX;
+    for (const auto& entry : reader.blocks()) {
+        start = std::min(start, entry.first_ts);
+    }
+    if (start == UINT64_MAX) {
+        start = 0;
+    }
+    ucdbg::timestamp_t begin = start + from;
+    ucdbg::timestamp_t end = to ? start + to : UINT64_MAX;
+    ucdbg::CriticalPathAnalyzer analyzer;
+    ucdbg::timestamp_t lead_in = begin > CRITICAL_PATH_LEAD_IN_NS ? begin - CRITICAL_PATH_LEAD_IN_NS : 0;
+    if (!reader.for_each_event_ordered(lead_in, end, [&](const ucdbg::TraceEvent& e) { analyzer.add(e); })) {
+        std::cerr << "ucdbg-analyze: corrupt block in input" << std::endl;
+        return 1;
+    }
+    ucdbg::timestamp_t first = 0, last = 0;
+    if (!analyzer.thread_span(tid, first, last)) {
+        std::cerr << "ucdbg-analyze: no concurrency events of thread " << tid << " in the window" << std::endl;
+        return 1;
+    }
+    // Unless given, the window is the thread's traced lifetime
+    begin = from ? begin : first;
+    end = to ? end : last + 1;
+    if (begin >= end) {
+        std::cerr << "ucdbg-analyze: empty critical-path window" << std::endl;
+        return 1;
+    }
+    ucdbg::CriticalPath path = analyzer.critical_path(tid, begin, end);
+    uint64_t length = path.end - path.begin;
+
+    std::printf("Critical path of thread %s: %s from %s, %zu segments, %zu waits\n\n", thread_label(reader, tid).c_str(),
+                format_ns(length).c_str(), format_ns(path.begin - start).c_str(), path.segments.size(),
+                path.waits.size());
+
+    std::vector<std::pair<ucdbg::thread_id_t, ucdbg::CriticalThreadStats>> threads(path.threads.begin(),
+                                                                                   path.threads.end());
+    std::sort(threads.begin(), threads.end(), [](const auto& a, const auto& b) {
+        return a.second.total_ns() != b.second.total_ns() ? a.second.total_ns() > b.second.total_ns()
+                                                          : a.first < b.first;
+    });
+    std::printf("Threads on the path (%zu):\n", threads.size());
+    std::printf("%-28s %10s %7s %10s %10s %10s\n", "thread", "on_path", "share", "running", "blocked", "wakeup");
+    for (size_t i = 0; i < threads.size() && (!top || i < top); ++i) {
+        const ucdbg::CriticalThreadStats& s = threads[i].second;
+        std::printf("%-28.28s %10s %6.1f%% %10s %10s %10s\n", thread_label(reader, threads[i].first).c_str(),
+                    format_ns(s.total_ns()).c_str(), length ? 100.0 * s.total_ns() / length : 0.0,
+                    format_ns(s.running_ns).c_str(), format_ns(s.blocked_ns).c_str(), format_ns(s.wakeup_ns).c_str());
+    }
+
+    std::vector<std::pair<ucdbg::lock_id_t, ucdbg::CriticalLockStats>> locks(path.locks.begin(), path.locks.end());
+    std::sort(locks.begin(), locks.end(), [](const auto& a, const auto& b) {
+        uint64_t x = a.second.wait_ns + a.second.held_ns, y = b.second.wait_ns + b.second.held_ns;
+        return x != y ? x > y : a.first < b.first;
+    });
+    std::printf("\nLocks on the path (%zu):\n", locks.size());
+    std::printf("%-18s %8s %10s %10s %10s\n", "lock_id", "waits", "wait", "handoff", "held");
+    for (size_t i = 0; i < locks.size() && (!top || i < top); ++i) {
+        const ucdbg::CriticalLockStats& s = locks[i].second;
+        std::printf("0x%-16" PRIx64 " %8" PRIu64 " %10s %10s %10s\n", locks[i].first, s.waits,
+                    format_ns(s.wait_ns).c_str(), format_ns(s.handoff_ns).c_str(), format_ns(s.held_ns).c_str());
+    }
+
+    std::vector<ucdbg::CriticalWait> waits = path.waits;
+    std::stable_sort(waits.begin(), waits.end(), [](const auto& a, const auto& b) {
+        return a.end - a.begin > b.end - b.begin;
+    });
+    std::printf("\nLongest waits on the path:\n");
+    std::printf("%-12s %-28s %-5s %-18s %10s %-28s\n", "at", "thread", "on", "object", "waited", "woken by");
+    for (size_t i = 0; i < waits.size() && (!top || i < top); ++i) {
+        const ucdbg::CriticalWait& w = waits[i];
+        std::printf("%-12s %-28.28s %-5s 0x%-16" PRIx64 " %10s %-28.28s\n", format_ns(w.begin - start).c_str(),
+                    thread_label(reader, w.thread_id).c_str(), ucdbg::dependency_kind_to_string(w.dependency),
+                    w.object, format_ns(w.end - w.begin).c_str(),
+                    w.woken ? thread_label(reader, w.waker).c_str() : "-");
+    }
+    return 0;
+}
+
+// Access site of a race side: its interned "file:line", if any
+static std::string race_site(const ucdbg::BlockTraceReader& reader, const ucdbg::RaceAccess& access) {
+    std::string site = access.site == ucdbg::NO_ACCESS_SITE ? "?" : reader.string(access.site);
+    return (access.write ? "write " : "read ") + site;
+}
+
+static int print_races(const ucdbg::BlockTraceReader& reader, size_t top) {
+    ucdbg::RaceDetector detector;
+    if (!reader.for_each_event_ordered([&](const ucdbg::TraceEvent& e) { detector.add(e); })) {
+        std::cerr << "ucdbg-analyze: corrupt block in input" << std::endl;
+        return 1;
+    }
+    ucdbg::timestamp_t start = UINT64_MAX;
+    for (const auto& entry : reader.blocks()) {
+        start = std::min(start, entry.first_ts);
+    }
+
+    std::vector<ucdbg::DataRace> races = detector.races();
+    std::stable_sort(races.begin(), races.end(), [](const auto& a, const auto& b) { return a.count > b.count; });
+    std::printf("%" PRIu64 " annotated accesses to %zu variables by %zu threads: %zu races", detector.access_count(),
+                detector.variable_count(), detector.thread_count(), races.size());
+    if (detector.dropped()) {
+        std::printf(" (+%" PRIu64 " not kept)", detector.dropped());
+    }
+    std::printf("\n");
+    for (size_t i = 0; i < races.size() && (!top || i < top); ++i) {
+        const ucdbg::DataRace& race = races[i];
+        std::printf("\nRace on 0x%" PRIx64 " (%" PRIu64 "x)\n", race.address, race.count);
+        std::printf("  %-40s thread %-28.28s at %s\n", race_site(reader, race.previous).c_str(),
+                    thread_label(reader, race.previous.thread_id).c_str(),
+                    format_ns(race.previous.ts - start).c_str());
+        std::printf("  %-40s thread %-28.28s at %s\n", race_site(reader, race.current).c_str(),
+                    thread_label(reader, race.current.thread_id).c_str(), format_ns(race.current.ts - start).c_str());
+    }
+    return 0;
+}
+
+static int print_coroutines(const ucdbg::BlockTraceReader& reader, size_t top) {
+    ucdbg::CoroutineAnalyzer analyzer;
+    if (!reader.for_each_event_ordered([&](const ucdbg::TraceEvent& e) { analyzer.add(e); })) {
+        std::cerr << "ucdbg-analyze: corrupt block in input" << std::endl;
+        return 1;
+    }
+    std::vector<std::pair<uint32_t, const ucdbg::AwaiterStats*>> awaiters;
+    for (const auto& [tag, stats] : analyzer.awaiters()) {
+        awaiters.emplace_back(tag, &stats);
+    }
+    std::sort(awaiters.begin(), awaiters.end(), [](const auto& a, const auto& b) {
+        uint64_t x = a.second->resume_ns.sum(), y = b.second->resume_ns.sum();
+        return x != y ? x > y : a.first < b.first;
+    });
+    if (top && awaiters.size() > top) {
+        awaiters.resize(top);
+    }
+
+    std::printf("Coroutine awaiters (%zu, by total resume latency), %zu coroutines still suspended at end:\n",
+                analyzer.awaiters().size(), analyzer.open_count());
+    std::printf("%-40s %10s %10s %9s %10s %9s %9s %9s %9s\n", "awaiter", "suspends", "resumes", "migrated",
+                "total", "p50", "p99", "p999", "max");
+    for (const auto& [tag, s] : awaiters) {
+        // Explicit tags need not be string IDs
+        std::string name = reader.string(tag);
+        if (name.empty()) {
+            name = "tag " + std::to_string(tag);
+        }
+        const ucdbg::LatencyHistogram& resume = s->resume_ns;
+        std::printf("%-40.40s %10" PRIu64 " %10" PRIu64 " %9" PRIu64 " %10s %9s %9s %9s %9s\n", name.c_str(),
+                    s->suspends, resume.count(), s->migrations, format_ns(resume.sum()).c_str(),
+                    format_ns(resume.percentile(0.5)).c_str(), format_ns(resume.percentile(0.99)).c_str(),
+                    format_ns(resume.percentile(0.999)).c_str(), format_ns(resume.max()).c_str());
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    size_t top = 20;
+    unsigned jobs = 0;
+    std::string sort = "wait";
+    const char* input = nullptr;
+    bool critical_path = false;
+    bool races = false;
+    bool coroutines = false;
+    bool by_class = false;
+    ucdbg::thread_id_t critical_thread = 0;
+    uint64_t from = 0, to = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--critical-path") == 0 && i + 1 < argc) {
+            critical_path = true;
+            critical_thread = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--races") == 0) {
+            races = true;
+        } else if (std::strcmp(argv[i], "--coroutines") == 0) {
+            coroutines = true;
+        } else if (std::strcmp(argv[i], "--by-class") == 0) {
+            by_class = true;
+        } else if (std::strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            from = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            to = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+            top = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--sort") == 0 && i + 1 < argc) {
+            sort = argv[++i];
+            if (sort != "wait" && sort != "hold" && sort != "acquisitions") {
+                return usage();
+            }
+        } else if (std::strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (!input && argv[i][0] != '-') {
+            input = argv[i];
+        } else {
+            return usage();
+        }
+    }
+    if (!input) {
+        return usage();
+    }
+
+    ucdbg::BlockTraceReader reader;
+    if (!reader.open(input)) {
+        std::cerr << "ucdbg-analyze: cannot read block trace " << input << std::endl;
+        return 1;
+    }
+    if (reader.recovered()) {
+        std::cerr << "ucdbg-analyze: warning: trace was not closed, recovered " << reader.blocks().size()
+                  << " blocks (" << reader.scanned_blocks() << " by scanning)" << std::endl;
+    }
+    if (critical_path) {
+        return print_critical_path(reader, critical_thread, from, to, top);
+    }
+    if (races) {
+        return print_races(reader, top);
+    }
+    if (coroutines) {
+        return print_coroutines(reader, top);
+    }
+
+    ucdbg::LockAnalyzer instances;
+    ucdbg::LockClassAnalyzer classes;
+    bool ok = by_class ? analyze(reader, classes, jobs) : analyze(reader, instances, jobs);
+    const ucdbg::LockAnalyzer& analyzer = by_class ? classes : instances;
+    if (!ok) {
+        std::cerr << "ucdbg-analyze: corrupt block in input" << std::endl;
+        return 1;
+    }
+
+    std::printf("%" PRIu64 " events, %" PRIu64 " concurrency events, %zu holds/waits still open at end\n\n",
+                reader.event_count(), analyzer.event_count(), analyzer.open_count());
+    print_locks(analyzer, reader, top, sort);
+    print_summaries(analyzer, reader, top, sort);
+    print_threads(analyzer, reader, top);
+    print_inversions(analyzer, reader, top);
+    return 0;
+}
@@ -0,0 +1,138 @@
+/**
+ * ucdbg-convert - Convert block traces written by the tracer into other layouts
+ *
+ * Usage: ucdbg-convert <format> <input.trace> <output>
+ *
+ * Formats:
+ *   columnar    Struct-of-arrays blocks for analysis scans (columnar.hpp)
+ *   raw         Time-ordered 32-byte TraceEvent records (trace_reader.hpp)
+ *   chrome      Chrome Trace Event JSON for chrome://tracing / Perfetto (chrome_trace.hpp)
+ *   perfetto    Perfetto protobuf trace, compact and fast to load (perfetto_trace.hpp)
+ */
+
+#include <ucdbg/block_reader.hpp>
+#include <ucdbg/chrome_trace.hpp>
+#include <ucdbg/columnar.hpp>
+#include <ucdbg/perfetto_trace.hpp>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+static int usage() {
+    std::cerr << "Usage: ucdbg-convert <format> <input.trace> <output>\n"
+              << "Formats:\n"
+              << "  columnar    Struct-of-arrays blocks for analysis scans\n"
+              << "  raw         Time-ordered 32-byte TraceEvent records\n"
+              << "  chrome      Chrome Trace Event JSON (chrome://tracing, Perfetto UI)\n"
+              << "  perfetto    Perfetto protobuf trace (Perfetto UI, trace_processor)\n";
+    return 2;
+}
+
+static int convert_columnar(const ucdbg::BlockTraceReader& reader, const char* output) {
+    ucdbg::ColumnarTraceWriter writer;
+    if (!writer.open(output)) {
+        std::cerr << "ucdbg-convert: cannot create " << output << std::endl;
+        return 1;
+    }
+    if (!reader.for_each_event([&](const ucdbg::TraceEvent& e) { writer.append(e); })) {
+        std::cerr << "ucdbg-convert: corrupt block in input" << std::endl;
+        return 1;
+    }
+    writer.close();
+    std::cout << reader.event_count() << " events -> " << writer.bytes_written() << " bytes" << std::endl;
+    return 0;
+}
+
+static int convert_raw(const ucdbg::BlockTraceReader& reader, const char* output) {
+    std::FILE* file = std::fopen(output, "wb");
+    if (!file) {
+        std::cerr << "ucdbg-convert: cannot create " << output << std::endl;
+        return 1;
+    }
+    std::vector<char> buffer(1 << 20);
+    std::setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+    bool ok = reader.for_each_event_ordered([&](const ucdbg::TraceEvent& e) {
+        uint8_t record[sizeof(ucdbg::TraceEvent)];
+        e.serialize_to(record);
+        std::fwrite(record, 1, sizeof(record), file);
+    });
+    bool written = std::fclose(file) == 0;
+    if (!ok || !written) {
+        std::cerr << "ucdbg-convert: " << (ok ? "write failed" : "corrupt block in input") << std::endl;
+        return 1;
+    }
+    std::cout << reader.event_count() << " events -> "
+              << reader.event_count() * sizeof(ucdbg::TraceEvent) << " bytes" << std::endl;
+    return 0;
+}
+
+static int convert_chrome(const ucdbg::BlockTraceReader& reader, const char* output) {
+    ucdbg::ChromeTraceWriter writer;
+    if (!writer.open(output)) {
+        std::cerr << "ucdbg-convert: cannot create " << output << std::endl;
+        return 1;
+    }
+    writer.set_strings(reader.strings());
+    for (const auto& [thread_id, name] : reader.thread_names()) {
+        writer.thread_name(thread_id, name);
+    }
+    bool ok = reader.for_each_event_ordered([&](const ucdbg::TraceEvent& e) { writer.append(e); });
+    bool written = writer.close();
+    if (!ok || !written) {
+        std::cerr << "ucdbg-convert: " << (ok ? "write failed" : "corrupt block in input") << std::endl;
+        return 1;
+    }
+    std::cout << reader.event_count() << " events -> " << writer.bytes_written() << " bytes" << std::endl;
+    return 0;
+}
+
+static int convert_perfetto(const ucdbg::BlockTraceReader& reader, const char* output) {
+    ucdbg::PerfettoTraceWriter writer;
+    if (!writer.open(output)) {
+        std::cerr << "ucdbg-convert: cannot create " << output << std::endl;
+        return 1;
+    }
+    writer.set_strings(reader.strings());
+    for (const auto& [thread_id, name] : reader.thread_names()) {
+        writer.thread_name(thread_id, name);
+    }
+    bool ok = reader.for_each_event_ordered([&](const ucdbg::TraceEvent& e) { writer.append(e); });
+    bool written = writer.close();
+    if (!ok || !written) {
+        std::cerr << "ucdbg-convert: " << (ok ? "write failed" : "corrupt block in input") << std::endl;
+        return 1;
+    }
+    std::cout << reader.event_count() << " events -> " << writer.bytes_written() << " bytes" << std::endl;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 4) {
+        return usage();
+    }
+    const char* format = argv[1];
+
+    ucdbg::BlockTraceReader reader;
+    if (!reader.open(argv[2])) {
+        std::cerr << "ucdbg-convert: cannot read block trace " << argv[2] << std::endl;
+        return 1;
+    }
+    if (reader.recovered()) {
+        std::cerr << "ucdbg-convert: warning: trace was not closed, recovered " << reader.blocks().size()
+                  << " blocks (" << reader.scanned_blocks() << " by scanning)" << std::endl;
+    }
+
+    if (std::strcmp(format, "columnar") == 0) {
+        return convert_columnar(reader, argv[3]);
+    }
+    if (std::strcmp(format, "raw") == 0) {
+        return convert_raw(reader, argv[3]);
+    }
+    if (std::strcmp(format, "chrome") == 0) {
+        return convert_chrome(reader, argv[3]);
+    }
+    if (std::strcmp(format, "perfetto") == 0) {
+        return convert_perfetto(reader, argv[3]);
+    }
+    return usage();
+}